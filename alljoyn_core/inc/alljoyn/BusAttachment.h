@@ -136,6 +136,29 @@ class BusAttachment : public MessageReceiver {
      */
     uint32_t GetConcurrency();
 
+    /**
+     * Set the number of threads used to encrypt outgoing messages ahead of delivery.
+     *
+     * By default a message for a secure interface is encrypted by the thread that writes it to
+     * the connection, so encryption and writes take turns. With a non-zero value, queued messages
+     * are encrypted on a pool of this many threads while earlier messages are being written.
+     * Messages are still written in the order they were sent. This must be called before Start().
+     *
+     * @param threads   Number of encryption threads, 0 encrypts messages as they are written.
+     *
+     * @return
+     *      - #ER_OK if successful.
+     *      - #ER_BUS_BUS_ALREADY_STARTED if already started
+     */
+    QStatus SetEncryptionConcurrency(uint32_t threads);
+
+    /**
+     * Get the number of threads used to encrypt outgoing messages ahead of delivery.
+     *
+     * @return The number of encryption threads, 0 if messages are encrypted as they are written.
+     */
+    uint32_t GetEncryptionConcurrency();
+
     /**
      * Get the connect spec used by the BusAttachment
      *
@@ -42,6 +42,7 @@ namespace ajn {
 /** @internal Forward references */
 class BusAttachment;
 class MethodTable;
+class MsgBodyEncoder;
 /// @endcond
 
 /**
@@ -151,6 +152,30 @@ class BusObject : public MessageReceiver {
                    uint8_t flags = 0,
                    Message* msg = NULL);
 
+    /**
+     * Send a signal with arguments marshaled by a body encoder such as MsgArgCodec.
+     *
+     * @param destination      The unique or well-known bus name or the signal recipient (NULL for broadcast signals)
+     * @param sessionId        The session this message is for.
+     * @param signal           Interface member of signal being emitted.
+     * @param body             Encoder for the signal arguments
+     * @param timeToLive       If non-zero this specifies the useful lifetime for this signal.
+     * @param flags            Logical OR of the message flags for this signals.
+     * @param msg              [OUT] If non-null, the sent signal message is returned to the caller.
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_OBJECT_NOT_REGISTERED if bus object has not yet been registered
+     *      - An error status otherwise
+     * @see Signal(const char*, SessionId, const InterfaceDescription::Member&, const MsgArg*, size_t, uint16_t, uint8_t, Message*)
+     */
+    QStatus Signal(const char* destination,
+                   SessionId sessionId,
+                   const InterfaceDescription::Member& signal,
+                   const MsgBodyEncoder& body,
+                   uint16_t timeToLive = 0,
+                   uint8_t flags = 0,
+                   Message* msg = NULL);
+
     /**
      * Remove sessionless message sent from this object from local router's
      * store/forward cache.
@@ -224,6 +249,18 @@ class BusObject : public MessageReceiver {
      */
     QStatus MethodReply(const Message& msg, const MsgArg* args = NULL, size_t numArgs = 0);
 
+    /**
+     * Reply to a method call with arguments marshaled by a body encoder such as MsgArgCodec.
+     *
+     * @param msg      The method call message
+     * @param body     Encoder for the reply arguments
+     * @return
+     *      - #ER_OK if successful
+     *      - #ER_BUS_OBJECT_NOT_REGISTERED if bus object has not yet been registered
+     *      - An error status otherwise
+     */
+    QStatus MethodReply(const Message& msg, const MsgBodyEncoder& body);
+
     /**
      * Reply to a method call with an error message.
      *
@@ -443,6 +480,24 @@ class BusObject : public MessageReceiver {
 
   private:
 
+    /**
+     * Send a signal marshaled either from args or from body.
+     */
+    QStatus SendSignal(const char* destination,
+                       SessionId sessionId,
+                       const InterfaceDescription::Member& signalMember,
+                       const MsgArg* args,
+                       size_t numArgs,
+                       const MsgBodyEncoder* body,
+                       uint16_t timeToLive,
+                       uint8_t flags,
+                       Message* outMsg);
+
+    /**
+     * Send a method reply marshaled either from args or from body.
+     */
+    QStatus SendReply(const Message& msg, const MsgArg* args, size_t numArgs, const MsgBodyEncoder* body);
+
     /**
      * Assignment operator is private.
      */
@@ -28,6 +28,7 @@
 #include <qcc/platform.h>
 #include <qcc/String.h>
 #include <qcc/ManagedObj.h>
+#include <qcc/Mutex.h>
 
 #include <alljoyn/MsgArg.h>
 #include <alljoyn/Session.h>
@@ -110,6 +111,25 @@ typedef enum {
     MESSAGE_COMPLETE
 }AllJoynMessageState;
 
+/// @cond ALLJOYN_DEV
+/**
+ * @internal
+ * Write position of a marshaled message that is being delivered to an endpoint. The marshaled
+ * buffer of a message is never modified while it is being written so a message that is routed
+ * to several endpoints is shared by all of them and each endpoint keeps its own cursor.
+ */
+struct MessageWriteCursor {
+    AllJoynMessageState writeState; ///< The current state of the message during write.
+    uint8_t* writePtr;              ///< Pointer to the current write position in the buffer.
+    size_t countWrite;              ///< Number of bytes remaining to write for completion of the message.
+
+    /**
+     * Constructor for a cursor positioned at the start of a message
+     */
+    MessageWriteCursor() : writeState(MESSAGE_NEW), writePtr(NULL), countWrite(0) { }
+};
+/// @endcond
+
 
 /** AllJoyn header fields */
 class HeaderFields {
@@ -157,6 +177,7 @@ class HeaderFields {
 class _Message;
 class _RemoteEndpoint;
 class BusAttachment;
+class MsgBodyEncoder;
 
 /**
  * @cond ALLJOYN_DEV
@@ -189,8 +210,10 @@ class _Message {
     friend class UDPTransport;
     friend class DaemonRouter;
     friend class AllJoynObj;
+    friend class SessionlessObj;
     friend class DeferredMsg;
     friend class AllJoynPeerObj;
+    friend class AllJoynArray;
     friend struct Rule;
 
   public:
@@ -554,11 +577,12 @@ class _Message {
      * @param call        The call message - can be this message.
      * @param args        The arguments for the reply (can be NULL)
      * @param numArgs     The number of arguments
+     * @param body        If not NULL marshals the reply arguments instead of args
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
      */
-    QStatus ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs);
+    QStatus ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const MsgBodyEncoder* body = NULL);
 
     /**
      * @internal
@@ -647,6 +671,7 @@ class _Message {
      * @param flags       A logical OR of the AllJoyn flags.
      * @param timeToLive  Time-to-live. Units are seconds for sessionless signals. Milliseconds for non-sessionless signals.
      *                    Signals that cannot be sent within this time limit are discarded. Zero indicates reliable delivery.
+     * @param body        If not NULL marshals the signal arguments instead of args
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
@@ -660,7 +685,8 @@ class _Message {
                       const MsgArg* args,
                       size_t numArgs,
                       uint8_t flags,
-                      uint16_t timeToLive);
+                      uint16_t timeToLive,
+                      const MsgBodyEncoder* body = NULL);
 
 
     /**
@@ -752,12 +778,41 @@ class _Message {
      * @internal
      * Deliver a marshaled message to a remote endpoint. Non-blocking
      *
+     * The message buffer is only modified if the message has to be encrypted so callers that
+     * share a message between endpoints must deliver a copy of messages for which
+     * NeedsPrivateCopy() returns true.
+     *
+     * @param endpoint   Endpoint to receive marshaled message.
+     * @param cursor     The endpoint's write position in this message.
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint, MessageWriteCursor& cursor);
+
+    /**
+     * @internal
+     * Check that a message can be delivered to an endpoint and encrypt it if required. This is
+     * the first step of DeliverNonBlocking() and is done once per message and endpoint.
+     *
      * @param endpoint   Endpoint to receive marshaled message.
+     * @param cursor     The endpoint's write position in this message. The state is set to
+     *                   MESSAGE_HEADERFIELDS if the message is to be written or to
+     *                   MESSAGE_COMPLETE if it is to be dropped because it has expired or
+     *                   is waiting for authentication to complete.
      * @return
      *      - #ER_OK if successful
      *      - An error status otherwise
      */
-    QStatus DeliverNonBlocking(RemoteEndpoint& endpoint);
+    QStatus PrepareDelivery(RemoteEndpoint& endpoint, MessageWriteCursor& cursor);
+
+    /**
+     * @internal
+     * Check if delivering this message will rewrite the marshaled buffer.
+     *
+     * @return  true if each endpoint must be given its own copy of the message.
+     */
+    bool NeedsPrivateCopy() const { return encrypt; }
     /**
      * @internal
      * Marshal the message again with the new sender name if one was provided.
@@ -875,8 +930,8 @@ class _Message {
     bool endianSwap;             ///< true if endianness will be swapped.
 
     MessageHeader msgHeader;     ///< Current message header.
-    uint8_t* _msgBuf;            ///< Pointer to the current msg buffer.
-    uint64_t* msgBuf;            ///< Pointer to the current msg buffer (8 byte aligned pointer into _msgBuf).
+    uint8_t* _msgBuf;            ///< Pointer to the current msg buffer, allocated from the bus message buffer pool.
+    uint64_t* msgBuf;            ///< Pointer to the current msg buffer (same as _msgBuf, which is 8 byte aligned).
     MsgArg* msgArgs;             ///< Pointer to the unmarshaled arguments.
     uint8_t numMsgArgs;          ///< Number of message args (signature cannot be longer than 255 chars).
 
@@ -903,9 +958,7 @@ class _Message {
     size_t countRead;               ///< Number of bytes remaining to read for completion of the message.
     size_t maxFds;                  ///< Store the number of max FDs for the endpoint, so it doesnt need to be calculated each time.
 
-    AllJoynMessageState writeState; ///< The current state of the message during write.
-    uint8_t* writePtr;              ///< Pointer to the current write position in the buffer.
-    size_t countWrite;              ///< Number of bytes remaining to write for completion of the message.
+    qcc::Mutex* deferredLock;       ///< Serializes parsing deferred array elements, NULL if no arrays were deferred.
 
     /**
      * The header fields for this message. Which header fields are present depends on the message
@@ -998,6 +1051,44 @@ class _Message {
      */
     QStatus ParseArray(MsgArg* arg, const char*& sigPtr);
 
+    /**
+     * Check that a value in the AllJoyn Message is well formed and step over it without
+     * unmarshaling it. This applies the same checks as ParseValue().
+     *
+     * @param[in]  sigPtr the signature of the value
+     * @param[in]  arrayElem true if the value being skipped is an array element
+     *
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus SkipValue(const char*& sigPtr, bool arrayElem = false);
+
+    /**
+     * Check that an array in the AllJoyn Message is well formed and step over it without
+     * unmarshaling it.
+     *
+     * @param[in]  sigPtr the signature of the array
+     *
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus SkipArray(const char*& sigPtr);
+
+    /**
+     * Check and count the elements of an array of non-scalar values without unmarshaling them.
+     *
+     * @param[in]  elemSig      the signature of an array element
+     * @param[in]  endOfArray   end of the array data
+     * @param[out] numElements  returns the number of elements in the array
+     *
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus SkipElements(const char* elemSig, const uint8_t* endOfArray, size_t& numElements);
+
     /**
      * Parse the MsgArg signature from the AllJoyn Message
      *
@@ -1052,15 +1143,20 @@ class _Message {
      *
      * If authentication has not been done this will request authentications
      *
+     * @param requestAuthentication  If false a missing key is reported as an error rather than
+     *                               starting an authentication. This is used to encrypt messages
+     *                               ahead of delivery.
+     *
      * @return
      *    - #ER_OK if the header fields are valid
      *    - #ER_BUS_NOT_AUTHORIZED not authorized to send encrypted messages
      *    - #ER_BUS_AUTHENTICATION_PENDING authentication is in progress must
      *                                     retry once authentication is complete
+     *    - #ER_BUS_KEY_UNAVAILABLE no key and requestAuthentication was false
      *    - An error status otherwise
      *
      */
-    QStatus EncryptMessage();
+    QStatus EncryptMessage(bool requestAuthentication = true);
 
     /**
      * Marshal (serialize) the Message so it is in the wire format
@@ -1072,6 +1168,7 @@ class _Message {
      * @param numArgs     number of MsgArg
      * @param flags       A logical OR of the AllJoyn flags
      * @param sessionId   The session id that the Message will be sent to
+     * @param body        If not NULL the body is marshaled by this encoder instead of from args
      *
      *  @return
      *    - #ER_OK if successful
@@ -1083,7 +1180,8 @@ class _Message {
                            const MsgArg* args,
                            uint8_t numArgs,
                            uint8_t flags,
-                           SessionId sessionId);
+                           SessionId sessionId,
+                           const MsgBodyEncoder* body = NULL);
 
     /**
      * Marshal the MsgArg arguments into the message
@@ -142,11 +142,29 @@ class AllJoynArray {
     size_t GetNumElements() const { return numElements; }
 
     /**
-     * Accessor function to return the number of array elements
+     * Accessor function to return the array elements. Arrays of containers unmarshaled from a
+     * message are parsed from the message buffer the first time the elements are accessed.
+     *
+     * @return  The array elements or NULL if the elements could not be parsed, call ParseElements()
+     *          to get the reason.
+     */
+    const MsgArg* GetElements() const {
+        if (!elements && numElements) {
+            ParseDeferredElements();
+        }
+        return elements;
+    }
+
+    /**
+     * Parse the elements of an array of containers unmarshaled from a message if they have not
+     * been parsed yet. This is done implicitly by GetElements() and is safe to call from several
+     * threads at once.
      *
-     * @return  The array elements
+     * @return
+     *      - #ER_OK if the elements are available
+     *      - An error status if the elements could not be parsed
      */
-    const MsgArg* GetElements() const { return elements; }
+    QStatus ParseElements() const { return (elements || !numElements) ? ER_OK : ParseDeferredElements(); }
 
     /**
      * Accessor function to return the array element signature.
@@ -156,9 +174,17 @@ class AllJoynArray {
     const char* GetElemSig() const { return elemSig ? elemSig : ""; }
 
   private:
+    /**
+     * Parse the elements of an array whose unmarshaling was deferred until the elements were
+     * accessed.
+     *
+     * @return  ER_OK if the elements were parsed or the status from the failed parse.
+     */
+    QStatus ParseDeferredElements() const;
+
     char* elemSig;      /**< Element signature */
     size_t numElements; /**< Number of elements in the AllJoyn array   */
-    MsgArg* elements;   /**< Pointer to array  */
+    MsgArg* elements;   /**< Pointer to array, NULL with a non-zero numElements if parsing has been deferred */
 };
 
 /**
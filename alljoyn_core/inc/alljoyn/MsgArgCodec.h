@@ -0,0 +1,928 @@
+#ifndef _ALLJOYN_MSGARGCODEC_H
+#define _ALLJOYN_MSGARGCODEC_H
+/**
+ * @file
+ * This file defines templates for marshaling and unmarshaling message arguments of types that
+ * are known at compile time.
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include MsgArgCodec.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/String.h>
+
+#include <string.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/Status.h>
+
+namespace ajn {
+
+/**
+ * Interface for objects that write a complete message body directly into the message buffer.
+ * Messages marshaled from a body encoder are always in native endianess.
+ */
+class MsgBodyEncoder {
+  public:
+
+    /**
+     * Destructor
+     */
+    virtual ~MsgBodyEncoder() { }
+
+    /**
+     * Get the signature of the message body.
+     *
+     * @return  The signature of the body.
+     */
+    virtual const char* GetSignature() const = 0;
+
+    /**
+     * Get the marshaled size of the message body.
+     *
+     * @return  The size in bytes of the body.
+     */
+    virtual size_t GetSize() const = 0;
+
+    /**
+     * Marshal the message body.
+     *
+     * @param body  The 8 byte aligned start of the body. There are GetSize() bytes available.
+     *
+     * @return
+     *      - #ER_OK if the body was marshaled
+     *      - #ER_BUS_BAD_LENGTH if an array is longer than ALLJOYN_MAX_ARRAY_LEN
+     */
+    virtual QStatus Encode(uint8_t* body) const = 0;
+};
+
+/**
+ * Placeholder for unused template arguments.
+ */
+struct MsgArgCodecNil { };
+
+/**
+ * Traits that map a C++ type to its AllJoyn wire format. Specializations are provided for the
+ * integral types, bool, double, qcc::String, const char*, std::vector (arrays), std::map
+ * (dictionaries), std::pair and MsgArgStruct (structs). Other types fail to compile.
+ *
+ * Each specialization provides:
+ *   - Alignment:        the wire alignment of the type
+ *   - Contiguous:       true if an array of the type has the same layout in memory and on the wire
+ *   - AppendSignature:  appends the signature of the type
+ *   - Size:             returns the offset of the end of a value marshaled at a given offset
+ *   - Write:            marshals a value at a given offset
+ *   - Get:              gets a value from an unmarshaled MsgArg
+ */
+template <typename T>
+struct MsgArgCodecTraits;
+
+/**
+ * @internal
+ * Round an offset up to an alignment boundary.
+ */
+static inline size_t MsgArgCodecAlign(size_t pos, size_t alignment)
+{
+    return (pos + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @internal
+ * Zero the padding up to an alignment boundary.
+ */
+static inline void MsgArgCodecPad(uint8_t* body, size_t& pos, size_t alignment)
+{
+    while (pos & (alignment - 1)) {
+        body[pos++] = 0;
+    }
+}
+
+/**
+ * @internal
+ * Behavior shared by all the basic types.
+ */
+template <typename T, char TypeId>
+struct MsgArgCodecBasic {
+    enum { Alignment = sizeof(T), Contiguous = true };
+
+    static void AppendSignature(char*& sig) { *sig++ = TypeId; }
+
+    static size_t Size(size_t pos, const T& val) { return MsgArgCodecAlign(pos, sizeof(T)) + sizeof(T); }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const T& val)
+    {
+        MsgArgCodecPad(body, pos, sizeof(T));
+        memcpy(body + pos, &val, sizeof(T));
+        pos += sizeof(T);
+        return ER_OK;
+    }
+};
+
+/**
+ * @internal
+ * Get an array of a basic type from an unmarshaled scalar array.
+ */
+template <typename T>
+static inline bool MsgArgCodecGetScalarArray(const MsgArg& arg, AllJoynTypeId typeId, const T* elements, std::vector<T>& val)
+{
+    if (arg.typeId != typeId) {
+        return false;
+    }
+    val.assign(elements, elements + arg.v_scalarArray.numElements);
+    return true;
+}
+
+/** @internal Container types are never unmarshaled as scalar arrays */
+struct MsgArgCodecContainer {
+    enum { Contiguous = false };
+
+    template <typename T>
+    static bool GetScalarArray(const MsgArg& arg, std::vector<T>& val) { return false; }
+};
+
+/** @cond ALLJOYN_DEV */
+
+template <>
+struct MsgArgCodecTraits<uint8_t> : public MsgArgCodecBasic<uint8_t, 'y'> {
+    static QStatus Get(const MsgArg& arg, uint8_t& val)
+    {
+        val = arg.v_byte;
+        return (arg.typeId == ALLJOYN_BYTE) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<uint8_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_BYTE_ARRAY, arg.v_scalarArray.v_byte, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<int16_t> : public MsgArgCodecBasic<int16_t, 'n'> {
+    static QStatus Get(const MsgArg& arg, int16_t& val)
+    {
+        val = arg.v_int16;
+        return (arg.typeId == ALLJOYN_INT16) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<int16_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_INT16_ARRAY, arg.v_scalarArray.v_int16, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<uint16_t> : public MsgArgCodecBasic<uint16_t, 'q'> {
+    static QStatus Get(const MsgArg& arg, uint16_t& val)
+    {
+        val = arg.v_uint16;
+        return (arg.typeId == ALLJOYN_UINT16) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<uint16_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_UINT16_ARRAY, arg.v_scalarArray.v_uint16, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<int32_t> : public MsgArgCodecBasic<int32_t, 'i'> {
+    static QStatus Get(const MsgArg& arg, int32_t& val)
+    {
+        val = arg.v_int32;
+        return (arg.typeId == ALLJOYN_INT32) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<int32_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_INT32_ARRAY, arg.v_scalarArray.v_int32, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<uint32_t> : public MsgArgCodecBasic<uint32_t, 'u'> {
+    static QStatus Get(const MsgArg& arg, uint32_t& val)
+    {
+        val = arg.v_uint32;
+        return (arg.typeId == ALLJOYN_UINT32) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<uint32_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_UINT32_ARRAY, arg.v_scalarArray.v_uint32, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<int64_t> : public MsgArgCodecBasic<int64_t, 'x'> {
+    static QStatus Get(const MsgArg& arg, int64_t& val)
+    {
+        val = arg.v_int64;
+        return (arg.typeId == ALLJOYN_INT64) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<int64_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_INT64_ARRAY, arg.v_scalarArray.v_int64, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<uint64_t> : public MsgArgCodecBasic<uint64_t, 't'> {
+    static QStatus Get(const MsgArg& arg, uint64_t& val)
+    {
+        val = arg.v_uint64;
+        return (arg.typeId == ALLJOYN_UINT64) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<uint64_t>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_UINT64_ARRAY, arg.v_scalarArray.v_uint64, val);
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<double> : public MsgArgCodecBasic<double, 'd'> {
+    static QStatus Get(const MsgArg& arg, double& val)
+    {
+        val = arg.v_double;
+        return (arg.typeId == ALLJOYN_DOUBLE) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+    static bool GetScalarArray(const MsgArg& arg, std::vector<double>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_DOUBLE_ARRAY, arg.v_scalarArray.v_double, val);
+    }
+};
+
+/* Booleans are marshaled as 32 bit values */
+template <>
+struct MsgArgCodecTraits<bool> {
+    enum { Alignment = 4, Contiguous = false };
+
+    static void AppendSignature(char*& sig) { *sig++ = 'b'; }
+
+    static size_t Size(size_t pos, bool val) { return MsgArgCodecAlign(pos, 4) + 4; }
+
+    static QStatus Write(uint8_t* body, size_t& pos, bool val)
+    {
+        uint32_t v = val ? 1 : 0;
+        return MsgArgCodecTraits<uint32_t>::Write(body, pos, v);
+    }
+
+    static QStatus Get(const MsgArg& arg, bool& val)
+    {
+        val = arg.v_bool;
+        return (arg.typeId == ALLJOYN_BOOLEAN) ? ER_OK : ER_BUS_SIGNATURE_MISMATCH;
+    }
+
+    static bool GetScalarArray(const MsgArg& arg, std::vector<bool>& val)
+    {
+        return MsgArgCodecGetScalarArray(arg, ALLJOYN_BOOLEAN_ARRAY, arg.v_scalarArray.v_bool, val);
+    }
+};
+
+/**
+ * @internal
+ * Strings are marshaled as a 32 bit length followed by the NUL terminated string.
+ */
+struct MsgArgCodecString : public MsgArgCodecContainer {
+    enum { Alignment = 4 };
+
+    static void AppendSignature(char*& sig) { *sig++ = 's'; }
+
+    static size_t Size(size_t pos, size_t len) { return MsgArgCodecAlign(pos, 4) + 4 + len + 1; }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const char* str, size_t len)
+    {
+        uint32_t len32 = (uint32_t)len;
+        MsgArgCodecTraits<uint32_t>::Write(body, pos, len32);
+        memcpy(body + pos, str, len);
+        pos += len;
+        body[pos++] = 0;
+        return ER_OK;
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<qcc::String> : public MsgArgCodecString {
+    static size_t Size(size_t pos, const qcc::String& val) { return MsgArgCodecString::Size(pos, val.size()); }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const qcc::String& val)
+    {
+        return MsgArgCodecString::Write(body, pos, val.data(), val.size());
+    }
+
+    static QStatus Get(const MsgArg& arg, qcc::String& val)
+    {
+        if (arg.typeId != ALLJOYN_STRING) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        val.assign(arg.v_string.str, arg.v_string.len);
+        return ER_OK;
+    }
+};
+
+/* A string returned by Get points into the message */
+template <>
+struct MsgArgCodecTraits<const char*> : public MsgArgCodecString {
+    static size_t Size(size_t pos, const char* val) { return MsgArgCodecString::Size(pos, strlen(val)); }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const char* val)
+    {
+        return MsgArgCodecString::Write(body, pos, val, strlen(val));
+    }
+
+    static QStatus Get(const MsgArg& arg, const char*& val)
+    {
+        if (arg.typeId != ALLJOYN_STRING) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        val = arg.v_string.str;
+        return ER_OK;
+    }
+};
+
+template <>
+struct MsgArgCodecTraits<MsgArgCodecNil> : public MsgArgCodecContainer {
+    enum { Alignment = 1 };
+
+    static void AppendSignature(char*& sig) { }
+
+    static size_t Size(size_t pos, const MsgArgCodecNil& val) { return pos; }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const MsgArgCodecNil& val) { return ER_OK; }
+
+    static QStatus Get(const MsgArg& arg, MsgArgCodecNil& val) { return ER_OK; }
+};
+
+/**
+ * @internal
+ * Behavior shared by arrays and dictionaries. Elements are marshaled after a 32 bit length that
+ * does not include the padding between the length and the first element.
+ */
+template <typename E, size_t ElemAlignment>
+struct MsgArgCodecArray : public MsgArgCodecContainer {
+    enum { Alignment = 4 };
+
+    static size_t Size(size_t pos, size_t numElements)
+    {
+        pos = MsgArgCodecAlign(MsgArgCodecAlign(pos, 4) + 4, ElemAlignment);
+        if (MsgArgCodecTraits<E>::Contiguous) {
+            pos += numElements * sizeof(E);
+        }
+        return pos;
+    }
+
+    static size_t Begin(uint8_t* body, size_t& pos)
+    {
+        MsgArgCodecPad(body, pos, 4);
+        size_t lenPos = pos;
+        pos += 4;
+        MsgArgCodecPad(body, pos, ElemAlignment);
+        return lenPos;
+    }
+
+    static QStatus End(uint8_t* body, size_t lenPos, size_t pos)
+    {
+        size_t len = pos - MsgArgCodecAlign(lenPos + 4, ElemAlignment);
+        if (len > ALLJOYN_MAX_ARRAY_LEN) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        uint32_t len32 = (uint32_t)len;
+        memcpy(body + lenPos, &len32, 4);
+        return ER_OK;
+    }
+};
+
+/** @internal Copy an array of a basic type */
+template <typename T>
+static inline void MsgArgCodecCopyElements(uint8_t* body, const std::vector<T>& val)
+{
+    memcpy(body, &val[0], val.size() * sizeof(T));
+}
+
+/** @internal Booleans are never copied because they have a different size on the wire */
+static inline void MsgArgCodecCopyElements(uint8_t* body, const std::vector<bool>& val)
+{
+}
+
+/** @internal Get an element of an array */
+template <typename T>
+static inline QStatus MsgArgCodecGetElement(const MsgArg& arg, std::vector<T>& val, size_t i)
+{
+    return MsgArgCodecTraits<T>::Get(arg, val[i]);
+}
+
+/** @internal Get an element of an array of booleans */
+static inline QStatus MsgArgCodecGetElement(const MsgArg& arg, std::vector<bool>& val, size_t i)
+{
+    bool b = false;
+    QStatus status = MsgArgCodecTraits<bool>::Get(arg, b);
+    val[i] = b;
+    return status;
+}
+
+template <typename T>
+struct MsgArgCodecTraits<std::vector<T> > : public MsgArgCodecArray<T, MsgArgCodecTraits<T>::Alignment> {
+    typedef MsgArgCodecArray<T, MsgArgCodecTraits<T>::Alignment> Array;
+
+    static void AppendSignature(char*& sig)
+    {
+        *sig++ = 'a';
+        MsgArgCodecTraits<T>::AppendSignature(sig);
+    }
+
+    static size_t Size(size_t pos, const std::vector<T>& val)
+    {
+        pos = Array::Size(pos, val.size());
+        if (!MsgArgCodecTraits<T>::Contiguous) {
+            for (size_t i = 0; i < val.size(); ++i) {
+                pos = MsgArgCodecTraits<T>::Size(pos, val[i]);
+            }
+        }
+        return pos;
+    }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const std::vector<T>& val)
+    {
+        QStatus status = ER_OK;
+        size_t lenPos = Array::Begin(body, pos);
+        if (MsgArgCodecTraits<T>::Contiguous) {
+            if (!val.empty()) {
+                MsgArgCodecCopyElements(body + pos, val);
+                pos += val.size() * sizeof(T);
+            }
+        } else {
+            for (size_t i = 0; (status == ER_OK) && (i < val.size()); ++i) {
+                status = MsgArgCodecTraits<T>::Write(body, pos, val[i]);
+            }
+        }
+        return (status == ER_OK) ? Array::End(body, lenPos, pos) : status;
+    }
+
+    static QStatus Get(const MsgArg& arg, std::vector<T>& val)
+    {
+        if (MsgArgCodecTraits<T>::GetScalarArray(arg, val)) {
+            return ER_OK;
+        }
+        if (arg.typeId != ALLJOYN_ARRAY) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        QStatus status = arg.v_array.ParseElements();
+        if (status != ER_OK) {
+            return status;
+        }
+        size_t numElements = arg.v_array.GetNumElements();
+        const MsgArg* elements = arg.v_array.GetElements();
+        val.resize(numElements);
+        for (size_t i = 0; (status == ER_OK) && (i < numElements); ++i) {
+            status = MsgArgCodecGetElement(elements[i], val, i);
+        }
+        return status;
+    }
+};
+
+/* Dictionary entries are aligned like structs */
+template <typename K, typename V>
+struct MsgArgCodecTraits<std::map<K, V> > : public MsgArgCodecArray<std::pair<K, V>, 8> {
+    typedef MsgArgCodecArray<std::pair<K, V>, 8> Array;
+    typedef typename std::map<K, V>::const_iterator const_iterator;
+
+    static void AppendSignature(char*& sig)
+    {
+        *sig++ = 'a';
+        *sig++ = '{';
+        MsgArgCodecTraits<K>::AppendSignature(sig);
+        MsgArgCodecTraits<V>::AppendSignature(sig);
+        *sig++ = '}';
+    }
+
+    static size_t Size(size_t pos, const std::map<K, V>& val)
+    {
+        pos = Array::Size(pos, val.size());
+        for (const_iterator it = val.begin(); it != val.end(); ++it) {
+            pos = MsgArgCodecTraits<K>::Size(MsgArgCodecAlign(pos, 8), it->first);
+            pos = MsgArgCodecTraits<V>::Size(pos, it->second);
+        }
+        return pos;
+    }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const std::map<K, V>& val)
+    {
+        QStatus status = ER_OK;
+        size_t lenPos = Array::Begin(body, pos);
+        for (const_iterator it = val.begin(); (status == ER_OK) && (it != val.end()); ++it) {
+            MsgArgCodecPad(body, pos, 8);
+            status = MsgArgCodecTraits<K>::Write(body, pos, it->first);
+            if (status == ER_OK) {
+                status = MsgArgCodecTraits<V>::Write(body, pos, it->second);
+            }
+        }
+        return (status == ER_OK) ? Array::End(body, lenPos, pos) : status;
+    }
+
+    static QStatus Get(const MsgArg& arg, std::map<K, V>& val)
+    {
+        if (arg.typeId != ALLJOYN_ARRAY) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        QStatus status = arg.v_array.ParseElements();
+        if (status != ER_OK) {
+            return status;
+        }
+        size_t numElements = arg.v_array.GetNumElements();
+        const MsgArg* entry = arg.v_array.GetElements();
+        val.clear();
+        for (size_t i = 0; (status == ER_OK) && (i < numElements); ++i, ++entry) {
+            if (entry->typeId != ALLJOYN_DICT_ENTRY) {
+                status = ER_BUS_SIGNATURE_MISMATCH;
+            } else {
+                K key;
+                status = MsgArgCodecTraits<K>::Get(*entry->v_dictEntry.key, key);
+                if (status == ER_OK) {
+                    status = MsgArgCodecTraits<V>::Get(*entry->v_dictEntry.val, val[key]);
+                }
+            }
+        }
+        return status;
+    }
+};
+
+/** @internal Get the next argument from a list of arguments */
+template <typename T>
+static inline QStatus MsgArgCodecGetArg(const MsgArg* args, size_t& i, T* val)
+{
+    const MsgArg& arg = args[i++];
+    if (val) {
+        return MsgArgCodecTraits<T>::Get(arg, *val);
+    }
+    return ER_OK;
+}
+
+/** @internal Unused arguments are skipped */
+static inline QStatus MsgArgCodecGetArg(const MsgArg* args, size_t& i, MsgArgCodecNil* val)
+{
+    return ER_OK;
+}
+
+/** @internal Identifies unused template arguments */
+template <typename T>
+struct MsgArgCodecIsNil {
+    enum { Value = false };
+};
+
+template <>
+struct MsgArgCodecIsNil<MsgArgCodecNil> {
+    enum { Value = true };
+};
+
+/**
+ * @internal
+ * A list of up to eight arguments or struct members.
+ */
+template <typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+struct MsgArgCodecList {
+    /** Number of values in the list */
+    static size_t Count()
+    {
+        return 1 + !MsgArgCodecIsNil<T2>::Value + !MsgArgCodecIsNil<T3>::Value + !MsgArgCodecIsNil<T4>::Value +
+               !MsgArgCodecIsNil<T5>::Value + !MsgArgCodecIsNil<T6>::Value + !MsgArgCodecIsNil<T7>::Value +
+               !MsgArgCodecIsNil<T8>::Value;
+    }
+
+    static void AppendSignature(char*& sig)
+    {
+        MsgArgCodecTraits<T1>::AppendSignature(sig);
+        MsgArgCodecTraits<T2>::AppendSignature(sig);
+        MsgArgCodecTraits<T3>::AppendSignature(sig);
+        MsgArgCodecTraits<T4>::AppendSignature(sig);
+        MsgArgCodecTraits<T5>::AppendSignature(sig);
+        MsgArgCodecTraits<T6>::AppendSignature(sig);
+        MsgArgCodecTraits<T7>::AppendSignature(sig);
+        MsgArgCodecTraits<T8>::AppendSignature(sig);
+    }
+
+    static size_t Size(size_t pos, const T1& a1, const T2& a2, const T3& a3, const T4& a4,
+                       const T5& a5, const T6& a6, const T7& a7, const T8& a8)
+    {
+        pos = MsgArgCodecTraits<T1>::Size(pos, a1);
+        pos = MsgArgCodecTraits<T2>::Size(pos, a2);
+        pos = MsgArgCodecTraits<T3>::Size(pos, a3);
+        pos = MsgArgCodecTraits<T4>::Size(pos, a4);
+        pos = MsgArgCodecTraits<T5>::Size(pos, a5);
+        pos = MsgArgCodecTraits<T6>::Size(pos, a6);
+        pos = MsgArgCodecTraits<T7>::Size(pos, a7);
+        return MsgArgCodecTraits<T8>::Size(pos, a8);
+    }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const T1& a1, const T2& a2, const T3& a3, const T4& a4,
+                         const T5& a5, const T6& a6, const T7& a7, const T8& a8)
+    {
+        QStatus status = MsgArgCodecTraits<T1>::Write(body, pos, a1);
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T2>::Write(body, pos, a2);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T3>::Write(body, pos, a3);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T4>::Write(body, pos, a4);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T5>::Write(body, pos, a5);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T6>::Write(body, pos, a6);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T7>::Write(body, pos, a7);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T8>::Write(body, pos, a8);
+        }
+        return status;
+    }
+
+    static QStatus Get(const MsgArg* args, size_t numArgs, T1* a1, T2* a2, T3* a3, T4* a4,
+                       T5* a5, T6* a6, T7* a7, T8* a8)
+    {
+        if (numArgs != Count()) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        size_t i = 0;
+        QStatus status = MsgArgCodecGetArg(args, i, a1);
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a2);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a3);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a4);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a5);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a6);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a7);
+        }
+        if (status == ER_OK) {
+            status = MsgArgCodecGetArg(args, i, a8);
+        }
+        return status;
+    }
+};
+
+/** @endcond */
+
+/**
+ * A struct with up to eight members that is marshaled as an AllJoyn struct. For example an
+ * argument with signature "(ius)" is declared as MsgArgStruct<int32_t, uint32_t, qcc::String>.
+ */
+template <typename T1, typename T2 = MsgArgCodecNil, typename T3 = MsgArgCodecNil, typename T4 = MsgArgCodecNil,
+          typename T5 = MsgArgCodecNil, typename T6 = MsgArgCodecNil, typename T7 = MsgArgCodecNil, typename T8 = MsgArgCodecNil>
+struct MsgArgStruct {
+    T1 m1;  /**< First member */
+    T2 m2;  /**< Second member */
+    T3 m3;  /**< Third member */
+    T4 m4;  /**< Fourth member */
+    T5 m5;  /**< Fifth member */
+    T6 m6;  /**< Sixth member */
+    T7 m7;  /**< Seventh member */
+    T8 m8;  /**< Eighth member */
+};
+
+/** @cond ALLJOYN_DEV */
+
+/**
+ * @internal
+ * Behavior shared by all structs.
+ */
+template <typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+struct MsgArgCodecStruct : public MsgArgCodecContainer {
+    typedef MsgArgCodecList<T1, T2, T3, T4, T5, T6, T7, T8> List;
+
+    enum { Alignment = 8 };
+
+    static void AppendSignature(char*& sig)
+    {
+        *sig++ = '(';
+        List::AppendSignature(sig);
+        *sig++ = ')';
+    }
+
+    static QStatus GetMembers(const MsgArg& arg, T1* a1, T2* a2, T3* a3, T4* a4, T5* a5, T6* a6, T7* a7, T8* a8)
+    {
+        if (arg.typeId != ALLJOYN_STRUCT) {
+            return ER_BUS_SIGNATURE_MISMATCH;
+        }
+        return List::Get(arg.v_struct.members, arg.v_struct.numMembers, a1, a2, a3, a4, a5, a6, a7, a8);
+    }
+};
+
+template <typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+struct MsgArgCodecTraits<MsgArgStruct<T1, T2, T3, T4, T5, T6, T7, T8> > : public MsgArgCodecStruct<T1, T2, T3, T4, T5, T6, T7, T8> {
+    typedef MsgArgCodecStruct<T1, T2, T3, T4, T5, T6, T7, T8> Struct;
+    typedef MsgArgStruct<T1, T2, T3, T4, T5, T6, T7, T8> Type;
+
+    static size_t Size(size_t pos, const Type& val)
+    {
+        return Struct::List::Size(MsgArgCodecAlign(pos, 8), val.m1, val.m2, val.m3, val.m4, val.m5, val.m6, val.m7, val.m8);
+    }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const Type& val)
+    {
+        MsgArgCodecPad(body, pos, 8);
+        return Struct::List::Write(body, pos, val.m1, val.m2, val.m3, val.m4, val.m5, val.m6, val.m7, val.m8);
+    }
+
+    static QStatus Get(const MsgArg& arg, Type& val)
+    {
+        return Struct::GetMembers(arg, &val.m1, &val.m2, &val.m3, &val.m4, &val.m5, &val.m6, &val.m7, &val.m8);
+    }
+};
+
+/* A pair is marshaled as a struct with two members */
+template <typename T1, typename T2>
+struct MsgArgCodecTraits<std::pair<T1, T2> > : public MsgArgCodecStruct<T1, T2, MsgArgCodecNil, MsgArgCodecNil,
+                                                                        MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil> {
+    typedef MsgArgCodecStruct<T1, T2, MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil, MsgArgCodecNil> Struct;
+
+    static size_t Size(size_t pos, const std::pair<T1, T2>& val)
+    {
+        pos = MsgArgCodecTraits<T1>::Size(MsgArgCodecAlign(pos, 8), val.first);
+        return MsgArgCodecTraits<T2>::Size(pos, val.second);
+    }
+
+    static QStatus Write(uint8_t* body, size_t& pos, const std::pair<T1, T2>& val)
+    {
+        MsgArgCodecPad(body, pos, 8);
+        QStatus status = MsgArgCodecTraits<T1>::Write(body, pos, val.first);
+        if (status == ER_OK) {
+            status = MsgArgCodecTraits<T2>::Write(body, pos, val.second);
+        }
+        return status;
+    }
+
+    static QStatus Get(const MsgArg& arg, std::pair<T1, T2>& val)
+    {
+        return Struct::GetMembers(arg, &val.first, &val.second, NULL, NULL, NULL, NULL, NULL, NULL);
+    }
+};
+
+/** @endcond */
+
+/**
+ * Marshals and unmarshals message arguments whose types are fixed at compile time. The signature
+ * and the marshaling code are derived from the argument types so, unlike MsgArg::Set() and
+ * MsgArg::Get(), no signature string is interpreted at runtime and when sending no MsgArgs are
+ * built: the arguments are written straight into the message buffer.
+ *
+ * The argument types map to AllJoyn types as follows:
+ *   - uint8_t, bool, int16_t, uint16_t, int32_t, uint32_t, int64_t, uint64_t, double: y b n q i u x t d
+ *   - qcc::String and const char*: s
+ *   - std::vector<T>: aT
+ *   - std::map<K, V>: a{KV}
+ *   - std::pair<T1, T2> and MsgArgStruct<T1, ...>: (T1...)
+ *
+ * For example to send a signal with signature "ua(ius)":
+ *
+ *     @code
+ *     typedef MsgArgStruct<int32_t, uint32_t, qcc::String> Entry;
+ *     std::vector<Entry> entries;
+ *     ...
+ *     Signal(NULL, 0, *member, MsgArgCodec<uint32_t, std::vector<Entry> >(count, entries));
+ *     @endcode
+ *
+ * and to receive it:
+ *
+ *     @code
+ *     QStatus status = MsgArgCodec<uint32_t, std::vector<Entry> >::Get(msg, &count, &entries);
+ *     @endcode
+ *
+ * The codec keeps references to the argument values so the values must outlive the codec. This
+ * is always the case when a temporary codec is passed directly to BusObject::Signal() or
+ * BusObject::MethodReply().
+ */
+template <typename T1, typename T2 = MsgArgCodecNil, typename T3 = MsgArgCodecNil, typename T4 = MsgArgCodecNil,
+          typename T5 = MsgArgCodecNil, typename T6 = MsgArgCodecNil, typename T7 = MsgArgCodecNil, typename T8 = MsgArgCodecNil>
+class MsgArgCodec : public MsgBodyEncoder {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param a1..a8  The argument values.
+     */
+    MsgArgCodec(const T1& a1, const T2& a2 = T2(), const T3& a3 = T3(), const T4& a4 = T4(),
+                const T5& a5 = T5(), const T6& a6 = T6(), const T7& a7 = T7(), const T8& a8 = T8()) :
+        a1(a1), a2(a2), a3(a3), a4(a4), a5(a5), a6(a6), a7(a7), a8(a8)
+    {
+        char* sig = signature;
+        List::AppendSignature(sig);
+        *sig = 0;
+        size = List::Size(0, a1, a2, a3, a4, a5, a6, a7, a8);
+    }
+
+    /**
+     * Get the signature of the arguments.
+     *
+     * @return  The signature.
+     */
+    const char* GetSignature() const { return signature; }
+
+    /**
+     * Get the marshaled size of the arguments.
+     *
+     * @return  The size in bytes.
+     */
+    size_t GetSize() const { return size; }
+
+    /**
+     * Marshal the arguments.
+     *
+     * @param body  The 8 byte aligned start of the message body.
+     *
+     * @return  #ER_OK if the arguments were marshaled, otherwise an error status.
+     */
+    QStatus Encode(uint8_t* body) const
+    {
+        size_t pos = 0;
+        return List::Write(body, pos, a1, a2, a3, a4, a5, a6, a7, a8);
+    }
+
+    /**
+     * Get the arguments of a message.
+     *
+     * @param msg     The message. The message arguments must have been unmarshaled.
+     * @param a1..a8  Returns the argument values. Arguments with a NULL pointer are skipped.
+     *
+     * @return
+     *      - #ER_OK if the arguments were returned
+     *      - #ER_BUS_SIGNATURE_MISMATCH if the message arguments do not match the argument types
+     */
+    static QStatus Get(Message& msg, T1* a1, T2* a2 = NULL, T3* a3 = NULL, T4* a4 = NULL,
+                       T5* a5 = NULL, T6* a6 = NULL, T7* a7 = NULL, T8* a8 = NULL)
+    {
+        size_t numArgs;
+        const MsgArg* args;
+        msg->GetArgs(numArgs, args);
+        return List::Get(args, numArgs, a1, a2, a3, a4, a5, a6, a7, a8);
+    }
+
+    /**
+     * Get the values of a list of MsgArgs.
+     *
+     * @param args     The MsgArgs.
+     * @param numArgs  The number of MsgArgs.
+     * @param a1..a8   Returns the argument values. Arguments with a NULL pointer are skipped.
+     *
+     * @return
+     *      - #ER_OK if the arguments were returned
+     *      - #ER_BUS_SIGNATURE_MISMATCH if the MsgArgs do not match the argument types
+     */
+    static QStatus Get(const MsgArg* args, size_t numArgs, T1* a1, T2* a2 = NULL, T3* a3 = NULL, T4* a4 = NULL,
+                       T5* a5 = NULL, T6* a6 = NULL, T7* a7 = NULL, T8* a8 = NULL)
+    {
+        return List::Get(args, numArgs, a1, a2, a3, a4, a5, a6, a7, a8);
+    }
+
+  private:
+
+    typedef MsgArgCodecList<T1, T2, T3, T4, T5, T6, T7, T8> List;
+
+    MsgArgCodec& operator=(const MsgArgCodec& other);
+
+    const T1& a1;
+    const T2& a2;
+    const T3& a3;
+    const T4& a4;
+    const T5& a5;
+    const T6& a6;
+    const T7& a7;
+    const T8& a8;
+    size_t size;
+    char signature[256];
+};
+
+}
+
+#endif
@@ -36,11 +36,68 @@
 #include "AllJoynDebugObj.h"
 #include "Bus.h"
 #include "BusController.h"
+#include "BusInternal.h"
+#include "MsgBufPool.h"
 
 using namespace ajn;
 using namespace debug;
 
 
+namespace ajn {
+namespace debug {
+
+/**
+ * Exposes the message buffer pool statistics of the routing node's bus attachment as the
+ * properties of org.alljoyn.Debug.MsgBufPool.
+ */
+class MsgBufPoolProperties : public AllJoynDebugObjAddon, public AllJoynDebugObj::Properties {
+  public:
+    MsgBufPoolProperties(BusAttachment& bus) : bus(bus) { }
+
+    QStatus Get(const char* propName, MsgArg& val) const
+    {
+        MsgBufPool::Stats stats;
+        bus.GetInternal().GetMsgBufPool().GetStats(stats);
+        const uint64_t values[] = {
+            stats.allocs, stats.frees, stats.cacheHits, stats.globalHits, stats.heapAllocs, stats.heapFrees, stats.cachedBytes
+        };
+        for (size_t i = 0; i < ArraySize(values); ++i) {
+            if (strcmp(propName, propInfo[i].name) == 0) {
+                return val.Set("t", values[i]);
+            }
+        }
+        return ER_BUS_NO_SUCH_PROPERTY;
+    }
+
+    void GetProperyInfo(const Info*& info, size_t& infoSize)
+    {
+        info = propInfo;
+        infoSize = ArraySize(propInfo);
+    }
+
+    static const char* InterfaceName;
+
+  private:
+    BusAttachment& bus;
+
+    static const Info propInfo[7];
+};
+
+const char* MsgBufPoolProperties::InterfaceName = "org.alljoyn.Debug.MsgBufPool";
+
+const AllJoynDebugObj::Properties::Info MsgBufPoolProperties::propInfo[7] = {
+    { "Allocs",      "t", PROP_ACCESS_READ },
+    { "Frees",       "t", PROP_ACCESS_READ },
+    { "CacheHits",   "t", PROP_ACCESS_READ },
+    { "GlobalHits",  "t", PROP_ACCESS_READ },
+    { "HeapAllocs",  "t", PROP_ACCESS_READ },
+    { "HeapFrees",   "t", PROP_ACCESS_READ },
+    { "CachedBytes", "t", PROP_ACCESS_READ }
+};
+
+}
+}
+
 /*
  * Singleton
  */
@@ -74,6 +131,11 @@ QStatus AllJoynDebugObj::Init()
 
         status = AddMethodHandlers(methodEntries, ArraySize(methodEntries));
 
+        if (status == ER_OK) {
+            /* Expose the message buffer pool statistics */
+            msgBufPoolProperties = new MsgBufPoolProperties(busController->GetBus());
+            status = AddDebugInterface(msgBufPoolProperties, MsgBufPoolProperties::InterfaceName, NULL, 0, *msgBufPoolProperties);
+        }
         if (status == ER_OK) {
             status = busController->GetBus().RegisterBusObject(*this);
         }
@@ -174,13 +236,15 @@ void AllJoynDebugObj::GetProp(const InterfaceDescription::Member* member, Messag
 
 AllJoynDebugObj::AllJoynDebugObj(BusController* busController) :
     BusObject(org::alljoyn::Daemon::Debug::ObjectPath),
-    busController(busController)
+    busController(busController),
+    msgBufPoolProperties(NULL)
 {
     self = this;
 }
 
 AllJoynDebugObj::~AllJoynDebugObj()
 {
+    delete msgBufPoolProperties;
     self = NULL;
 }
 
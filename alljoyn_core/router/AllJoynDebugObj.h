@@ -45,6 +45,8 @@ class BusController;
 
 namespace debug {
 
+class MsgBufPoolProperties;
+
 class AllJoynDebugObjAddon {
   public:
     virtual ~AllJoynDebugObjAddon() { }
@@ -168,6 +170,8 @@ class AllJoynDebugObj : public BusObject {
 
     AddonMethodHandlerMap methodHandlerMap;
 
+    MsgBufPoolProperties* msgBufPoolProperties;
+
     static AllJoynDebugObj* self;
 };
 
@@ -3598,6 +3598,11 @@ void AllJoynObj::ExchangeNamesSignalHandler(const InterfaceDescription::Member*
     const MsgArg* args;
     msg->GetArgs(numArgs, args);
     assert((1 == numArgs) && (ALLJOYN_ARRAY == args[0].typeId));
+    QStatus parseStatus = args[0].v_array.ParseElements();
+    if (parseStatus != ER_OK) {
+        QCC_LogError(parseStatus, ("Invalid ExchangeNames message from %s", msg->GetSender()));
+        return;
+    }
     const MsgArg* items = args[0].v_array.GetElements();
     const String& shortGuidStr = guid.ToShortString();
 
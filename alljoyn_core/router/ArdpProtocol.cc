@@ -49,6 +49,14 @@ namespace ajn {
 /* Delayed ACK timeout */
 #define ARDP_ACK_TIMEOUT 100
 
+/* Maximum number of datagrams pulled off the socket per ARDP_Run() */
+#define ARDP_RECV_BATCH 16
+/* Size of each receive slot; a UDP datagram can be up to 64K long */
+#define ARDP_RECV_BUFSIZE 65536
+
+/* Maximum number of outbound segments held back for one qcc::SendToBatch() */
+#define ARDP_TX_BATCH 64
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define ABS(a) ((a) >= 0 ? (a) : -(a))
@@ -108,9 +116,12 @@ typedef struct ARDP_SEND_BUF {
     uint8_t* hdr;
     uint32_t ttl;
     uint32_t tStart;
+    uint32_t tSent;       /* Time of the latest transmission, for RTT and delivery rate samples */
+    uint32_t delivered;   /* Connection's delivered byte count at the latest transmission */
     ARDP_SEND_BUF* next;
     ArdpTimer timer;
     bool inUse;
+    bool inFlight;        /* Counted in the connection's bytesInFlight */
     uint16_t hdrlen;
     uint16_t fastRT;
 } ArdpSndBuf;
@@ -207,6 +218,72 @@ typedef struct {
     uint32_t dataLen;    /* Length of connection handshake data */
 } ArdpSynSnd;
 
+/**
+ * An open-addressed (linear probing) index of connection records.  Each entry
+ * pairs a 32-bit key with a connection; a key may appear more than once and
+ * lookups return the first match in probe order.
+ */
+typedef struct {
+    uint32_t key;
+    ArdpConnRecord* conn;       /* NULL if the slot is empty, ARDP_INDEX_TOMBSTONE if it was deleted */
+} ArdpIndexEntry;
+
+typedef struct {
+    ArdpIndexEntry* slots;
+    uint32_t mask;              /* Number of slots minus one; the table size is a power of two */
+    uint32_t used;              /* Number of live entries */
+    uint32_t tombstones;        /* Number of deleted entries still occupying slots */
+} ArdpConnIndex;
+
+/**
+ * Per-connection congestion control state, see CcInit() and friends.  Byte
+ * counts cover payload only; rates are in bytes per millisecond.
+ */
+typedef struct {
+    bool initialized;         /* Set up on the first SendData() once the segment size is known */
+    bool inRecovery;          /* Loss recovery in progress until SND.UNA passes recover */
+    bool timedOut;            /* The current recovery was entered (or escalated) by a retransmit timeout */
+    uint8_t mode;             /* BBR state machine */
+    uint8_t cycleIndex;       /* BBR PROBE_BW gain phase */
+    uint8_t fullBwCount;      /* BBR rounds without significant bandwidth growth */
+    uint32_t cwnd;            /* Congestion window */
+    uint32_t ssthresh;        /* Slow start threshold */
+    uint32_t avoidAcc;        /* Bytes ACKed towards the next congestion avoidance increment */
+    uint32_t recover;         /* Highest sequence number sent when recovery started */
+    uint32_t bytesInFlight;   /* Bytes sent and neither acknowledged nor expired */
+    uint32_t ackedBytes;      /* Bytes acknowledged since the controller was last told */
+    uint32_t delivered;       /* Total bytes delivered, for rate samples */
+    uint32_t deliveredStamp;  /* Time delivered last moved */
+    uint32_t sampleBw;        /* Highest delivery rate seen since the controller was last told */
+    uint32_t sampleRtt;       /* Lowest RTT seen since the controller was last told */
+    uint32_t sampleDelivered; /* delivered at transmission of the newest segment in the sample */
+    uint32_t pacingRate;      /* Pacing rate, 0 if unpaced */
+    int64_t paceCredit;       /* Token bucket balance */
+    uint32_t paceStamp;       /* Time paceCredit was last refilled */
+    uint32_t paceRelease;     /* Time the last segment held back for pacing goes out */
+    uint32_t btlBw;           /* BBR bottleneck bandwidth estimate */
+    uint32_t btlBwRound;      /* Round in which btlBw was sampled */
+    uint32_t fullBw;          /* BBR bandwidth at the last significant growth */
+    uint32_t minRtt;          /* BBR propagation delay estimate */
+    uint32_t minRttStamp;     /* Time minRtt was sampled */
+    uint32_t round;           /* BBR round trip counter */
+    uint32_t roundEnd;        /* delivered value that ends the current round */
+    uint32_t cycleStamp;      /* Start of the current PROBE_BW phase */
+} ArdpCongestion;
+
+/*
+ * An outbound segment waiting in the handle's transmit batch.  The header
+ * (including the EACK mask) is copied because the originals are rewritten
+ * on every (re)transmit; the payload is referenced in place, which is safe
+ * because the batch is flushed before a send buffer can be handed back.
+ */
+typedef struct {
+    ArdpConnRecord* conn;               /* Connection the segment belongs to */
+    ArdpSndBuf* snd;                    /* Send buffer of a data segment, NULL for a bare header */
+    qcc::IOVec iov[2];                  /* Header copy and payload */
+    uint8_t hdr[ARDP_MAX_HEADER_LEN];   /* Header copy */
+} ArdpTxSlot;
+
 /**
  * A connection record describing each "connection."  This acts as a containter
  * to hold all of the interesting information about a reliable link between
@@ -244,6 +321,9 @@ struct ARDP_CONN_RECORD {
     ArdpTimer ackTimer;   /* Delayed ACK timer */
     ArdpTimer persistTimer; /* Persist (frozen window) timer */
     void* context;          /* A client-defined context pointer */
+    uint32_t deadline;      /* Earliest time any of this connection's timers may be due */
+    uint32_t heapSlot;      /* 1-based position in the handle's timer heap, 0 if not scheduled */
+    ArdpCongestion cc;      /* Congestion window and pacing */
 };
 
 struct ARDP_HANDLE {
@@ -254,6 +334,19 @@ struct ARDP_HANDLE {
     qcc::Timespec tbase;     /* Baseline time */
     uint32_t msnext;         /* To inform upper layer when to call into the protocol next time */
     void* context;           /* A client-defined context pointer */
+    uint8_t* rxBuf;          /* Backing store for the receive ring, ARDP_RECV_BATCH slots of ARDP_RECV_BUFSIZE */
+    qcc::Datagram* rxRing;   /* Receive slots handed to qcc::RecvFromBatch() */
+    ArdpConnIndex byPorts;   /* Connections keyed on (local, foreign) ARDP ports, for segment demux */
+    ArdpConnIndex byAddr;    /* Connections keyed on record address, for IsConnValid() */
+    ArdpConnRecord** heap;   /* Min-heap of connections ordered by deadline */
+    ArdpConnRecord** due;    /* Scratch space for CheckTimers(), same capacity as heap */
+    uint32_t heapSize;       /* Number of connections in the heap */
+    uint32_t heapMax;        /* Allocated capacity of heap and due */
+    ArdpTxSlot* txSlots;     /* Segments queued for the next FlushTx() */
+    qcc::OutDatagram* txDgrams; /* Datagram descriptors for txSlots, passed to qcc::SendToBatch() */
+    uint32_t txCount;        /* Number of queued segments */
+    uint32_t txDepth;        /* Nesting depth of BeginTxBatch(); segments are only held back while nonzero */
+    qcc::SocketFd txSock;    /* Socket the queued segments go out on */
 };
 
 /*
@@ -313,6 +406,239 @@ static void DeList(ListNode* node)
     node->fwd = node->bwd = node;
 }
 
+/*
+ * Connection indexes.  Every connection on handle->conns is also entered in
+ * handle->byPorts, so demultiplexing a segment is a hash probe rather than a
+ * walk of the connection list, and in handle->byAddr so that validating a
+ * connection pointer handed in by the upper layer is just as cheap.
+ */
+#define ARDP_INDEX_TOMBSTONE ((ArdpConnRecord*)1)
+#define ARDP_INDEX_MIN_SIZE 16
+
+static inline uint32_t PortsKey(uint16_t local, uint16_t foreign)
+{
+    return ((uint32_t)local << 16) | foreign;
+}
+
+static inline uint32_t AddrKey(ArdpConnRecord* conn)
+{
+    uint64_t p = reinterpret_cast<uintptr_t>(conn);
+    return (uint32_t)(p >> 4) ^ (uint32_t)(p >> 32);
+}
+
+static inline uint32_t IndexHash(uint32_t key)
+{
+    /* Fibonacci hashing spreads sequential keys across the table */
+    return key * 0x9E3779B1;
+}
+
+static QStatus IndexResize(ArdpConnIndex* index, uint32_t size)
+{
+    ArdpIndexEntry* slots = (ArdpIndexEntry*) calloc(size, sizeof(ArdpIndexEntry));
+    if (slots == NULL) {
+        return ER_OUT_OF_MEMORY;
+    }
+
+    ArdpIndexEntry* old = index->slots;
+    uint32_t oldSize = old ? index->mask + 1 : 0;
+    index->slots = slots;
+    index->mask = size - 1;
+    index->tombstones = 0;
+
+    for (uint32_t i = 0; i < oldSize; i++) {
+        if (old[i].conn != NULL && old[i].conn != ARDP_INDEX_TOMBSTONE) {
+            uint32_t j = IndexHash(old[i].key) & index->mask;
+            while (slots[j].conn != NULL) {
+                j = (j + 1) & index->mask;
+            }
+            slots[j] = old[i];
+        }
+    }
+    free(old);
+    return ER_OK;
+}
+
+static QStatus IndexInsert(ArdpConnIndex* index, uint32_t key, ArdpConnRecord* conn)
+{
+    /* Keep the table at most half full, tombstones included, so probe sequences stay short */
+    uint32_t size = index->slots ? index->mask + 1 : 0;
+    if ((index->used + index->tombstones + 1) * 2 > size) {
+        uint32_t newSize = ARDP_INDEX_MIN_SIZE;
+        while (newSize < (index->used + 1) * 4) {
+            newSize <<= 1;
+        }
+        QStatus status = IndexResize(index, newSize);
+        if (status != ER_OK) {
+            return status;
+        }
+    }
+
+    uint32_t i = IndexHash(key) & index->mask;
+    while (index->slots[i].conn != NULL && index->slots[i].conn != ARDP_INDEX_TOMBSTONE) {
+        i = (i + 1) & index->mask;
+    }
+    if (index->slots[i].conn == ARDP_INDEX_TOMBSTONE) {
+        index->tombstones--;
+    }
+    index->slots[i].key = key;
+    index->slots[i].conn = conn;
+    index->used++;
+    return ER_OK;
+}
+
+/* Find the first entry for key, or the entry for exactly (key, conn) if conn is not NULL */
+static ArdpIndexEntry* IndexProbe(ArdpConnIndex* index, uint32_t key, ArdpConnRecord* conn)
+{
+    if (index->slots == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = IndexHash(key) & index->mask; index->slots[i].conn != NULL; i = (i + 1) & index->mask) {
+        ArdpIndexEntry* entry = &index->slots[i];
+        if (entry->conn != ARDP_INDEX_TOMBSTONE && entry->key == key && (conn == NULL || entry->conn == conn)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void IndexRemove(ArdpConnIndex* index, uint32_t key, ArdpConnRecord* conn)
+{
+    ArdpIndexEntry* entry = IndexProbe(index, key, conn);
+    if (entry != NULL) {
+        entry->conn = ARDP_INDEX_TOMBSTONE;
+        index->used--;
+        index->tombstones++;
+    }
+}
+
+/*
+ * Connection timer heap.  Rather than visiting every connection on every
+ * ARDP_Run(), each connection with an armed timer sits in a binary min-heap
+ * keyed by the earliest time one of its timers may fire.  Arming a timer can
+ * only pull that time in, so InitTimer()/UpdateTimer() sift the connection
+ * up; a deadline that has since moved out just causes an early visit, after
+ * which CheckTimers() reschedules the connection for its real next deadline.
+ */
+static inline bool HeapLess(ArdpHandle* handle, uint32_t a, uint32_t b)
+{
+    return handle->heap[a]->deadline < handle->heap[b]->deadline;
+}
+
+static inline void HeapSwap(ArdpHandle* handle, uint32_t a, uint32_t b)
+{
+    ArdpConnRecord* tmp = handle->heap[a];
+    handle->heap[a] = handle->heap[b];
+    handle->heap[b] = tmp;
+    handle->heap[a]->heapSlot = a + 1;
+    handle->heap[b]->heapSlot = b + 1;
+}
+
+static void HeapSiftUp(ArdpHandle* handle, uint32_t i)
+{
+    while (i > 0 && HeapLess(handle, i, (i - 1) / 2)) {
+        HeapSwap(handle, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void HeapSiftDown(ArdpHandle* handle, uint32_t i)
+{
+    for (;;) {
+        uint32_t least = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = left + 1;
+        if (left < handle->heapSize && HeapLess(handle, left, least)) {
+            least = left;
+        }
+        if (right < handle->heapSize && HeapLess(handle, right, least)) {
+            least = right;
+        }
+        if (least == i) {
+            break;
+        }
+        HeapSwap(handle, i, least);
+        i = least;
+    }
+}
+
+static void HeapRemove(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    if (conn->heapSlot == 0) {
+        return;
+    }
+    uint32_t i = conn->heapSlot - 1;
+    uint32_t last = --handle->heapSize;
+    conn->heapSlot = 0;
+    if (i != last) {
+        handle->heap[i] = handle->heap[last];
+        handle->heap[i]->heapSlot = i + 1;
+        HeapSiftDown(handle, i);
+        HeapSiftUp(handle, i);
+    }
+}
+
+/* Make sure CheckTimers() looks at conn no later than when */
+static void ScheduleConn(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t when)
+{
+    if (conn->heapSlot != 0) {
+        if (when < conn->deadline) {
+            conn->deadline = when;
+            HeapSiftUp(handle, conn->heapSlot - 1);
+        }
+        return;
+    }
+
+    if (handle->heapSize == handle->heapMax) {
+        uint32_t newMax = handle->heapMax ? handle->heapMax * 2 : ARDP_INDEX_MIN_SIZE;
+        ArdpConnRecord** heap = (ArdpConnRecord**) realloc(handle->heap, newMax * sizeof(ArdpConnRecord*));
+        if (heap != NULL) {
+            handle->heap = heap;
+            ArdpConnRecord** due = (ArdpConnRecord**) realloc(handle->due, newMax * sizeof(ArdpConnRecord*));
+            if (due != NULL) {
+                handle->due = due;
+                handle->heapMax = newMax;
+            }
+        }
+        if (handle->heapSize == handle->heapMax) {
+            QCC_LogError(ER_OUT_OF_MEMORY, ("ScheduleConn: Failed to grow timer heap"));
+            return;
+        }
+    }
+
+    conn->deadline = when;
+    handle->heap[handle->heapSize] = conn;
+    conn->heapSlot = ++handle->heapSize;
+    HeapSiftUp(handle, handle->heapSize - 1);
+}
+
+static QStatus AddConnRecord(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    QStatus status = IndexInsert(&handle->byAddr, AddrKey(conn), conn);
+    if (status == ER_OK) {
+        status = IndexInsert(&handle->byPorts, PortsKey(conn->local, conn->foreign), conn);
+        if (status != ER_OK) {
+            IndexRemove(&handle->byAddr, AddrKey(conn), conn);
+        }
+    }
+    if (status == ER_OK) {
+        EnList(handle->conns.bwd, (ListNode*)conn);
+    }
+    return status;
+}
+
+/* The foreign port is only learned from the SYN; re-key the connection when it changes */
+static void SetConnForeign(ArdpHandle* handle, ArdpConnRecord* conn, uint16_t foreign)
+{
+    if (conn->foreign == foreign) {
+        return;
+    }
+    IndexRemove(&handle->byPorts, PortsKey(conn->local, conn->foreign), conn);
+    conn->foreign = foreign;
+    if (IndexInsert(&handle->byPorts, PortsKey(conn->local, conn->foreign), conn) != ER_OK) {
+        QCC_LogError(ER_OUT_OF_MEMORY, ("SetConnForeign: Failed to index conn %p", conn));
+    }
+}
+
 #ifndef NDEBUG
 static void DumpBuffer(uint8_t* buf, uint16_t len)
 {
@@ -388,16 +714,7 @@ static bool IsConnValid(ArdpHandle* handle, ArdpConnRecord* conn)
         return false;
     }
 
-    if (IsEmpty(&handle->conns)) {
-        return false;
-    }
-
-    for (ListNode* ln = &handle->conns; (ln = ln->fwd) != &handle->conns;) {
-        if (conn == (ArdpConnRecord*)ln) {
-            return true;
-        }
-    }
-    return false;
+    return IndexProbe(&handle->byAddr, AddrKey(conn), conn) != NULL;
 }
 
 static void InitTimer(ArdpHandle* handle, ArdpConnRecord* conn, ArdpTimer* timer, ArdpTimeoutHandler handler, void*context, uint32_t timeout, uint16_t retry)
@@ -414,6 +731,9 @@ static void InitTimer(ArdpHandle* handle, ArdpConnRecord* conn, ArdpTimer* timer
     if ((retry != 0) && (timeout < handle->msnext)) {
         handle->msnext = timeout;
     }
+    if (retry != 0) {
+        ScheduleConn(handle, conn, timer->when);
+    }
 }
 
 static void UpdateTimer(ArdpHandle* handle, ArdpConnRecord* conn, ArdpTimer* timer, uint32_t timeout, uint16_t retry)
@@ -425,6 +745,9 @@ static void UpdateTimer(ArdpHandle* handle, ArdpConnRecord* conn, ArdpTimer* tim
     if ((retry != 0) && (timeout < handle->msnext)) {
         handle->msnext = timeout;
     }
+    if (retry != 0) {
+        ScheduleConn(handle, conn, timer->when);
+    }
 }
 
 static uint32_t CheckConnTimers(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t next, uint32_t now)
@@ -528,28 +851,511 @@ static uint32_t CheckConnTimers(ArdpHandle* handle, ArdpConnRecord* conn, uint32
  */
 static uint32_t CheckTimers(ArdpHandle* handle)
 {
-    uint32_t nextTime = ARDP_NO_TIMEOUT;
     uint32_t now = TimeNow(handle->tbase);
-    ListNode* ln = &handle->conns;
 
-    if (IsEmpty(ln)) {
-        return nextTime;
+    /*
+     * Take every connection that is due off the heap before firing anything,
+     * so that a handler re-arming a timer for "now" gets serviced on the next
+     * pass instead of spinning here.
+     */
+    uint32_t ndue = 0;
+    while (handle->heapSize > 0 && handle->heap[0]->deadline <= now) {
+        ArdpConnRecord* conn = handle->heap[0];
+        HeapRemove(handle, conn);
+        handle->due[ndue++] = conn;
     }
 
-    for (; (ln = ln->fwd) != &handle->conns;) {
-        ListNode* temp = ln->bwd;
-        nextTime = CheckConnTimers(handle, (ArdpConnRecord* ) ln, nextTime, now);
+    for (uint32_t i = 0; i < ndue; i++) {
+        ArdpConnRecord* conn = handle->due[i];
+
+        /* An earlier handler in this pass may have torn the connection down */
+        if (!IsConnValid(handle, conn)) {
+            continue;
+        }
+        uint32_t next = CheckConnTimers(handle, conn, ARDP_NO_TIMEOUT, now);
 
         /* Check if connection record has been removed due to expiring connect/disconnect timers */
-        if (!IsConnValid(handle, (ArdpConnRecord*) ln)) {
-            ln = temp;
+        if (next != ARDP_NO_TIMEOUT && IsConnValid(handle, conn)) {
+            ScheduleConn(handle, conn, next);
         }
-        if (IsEmpty(&handle->conns)) {
-            break;
+    }
+
+    if (handle->heapSize == 0) {
+        return ARDP_NO_TIMEOUT;
+    }
+    uint32_t nextTime = handle->heap[0]->deadline;
+    return (nextTime > now) ? nextTime - now : 0;
+}
+
+/*
+ * Hand every queued segment to the socket in one qcc::SendToBatch() call.
+ * Data segments that did not fit into the socket are not a legitimate
+ * transmission: give the retry back and have them go out again on the next
+ * pass, as SendData() and RetransmitTimerHandler() do for ER_WOULDBLOCK.
+ * Bare headers (ACK, NUL, RST) are treated as lost in transit.
+ */
+static QStatus FlushTx(ArdpHandle* handle)
+{
+    if (handle->txCount == 0) {
+        return ER_OK;
+    }
+
+    size_t sent = 0;
+    QStatus status = qcc::SendToBatch(handle->txSock, handle->txDgrams, handle->txCount, sent);
+    if (status != ER_OK) {
+        QCC_DbgPrintf(("FlushTx(): %u of %u segments sent: %s", (uint32_t)sent, handle->txCount, QCC_StatusText(status)));
+        for (uint32_t i = sent; i < handle->txCount; ++i) {
+            ArdpTxSlot* slot = &handle->txSlots[i];
+            if (slot->snd != NULL && slot->snd->inUse && slot->snd->timer.retry != 0) {
+                UpdateTimer(handle, slot->conn, &slot->snd->timer, 0, slot->snd->timer.retry + 1);
+            }
+        }
+    }
+    handle->txCount = 0;
+    return status;
+}
+
+/*
+ * Queue a segment for transmission.  Outside of a BeginTxBatch() /
+ * EndTxBatch() bracket it is sent immediately and the socket status is
+ * returned; inside one it is held back and reported as sent.
+ */
+static QStatus QueueTx(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* snd, const void* hdr, uint32_t hdrLen, const void* data, uint32_t dataLen)
+{
+    if (handle->txCount == ARDP_TX_BATCH || (handle->txCount != 0 && handle->txSock != conn->sock)) {
+        FlushTx(handle);
+    }
+
+    ArdpTxSlot* slot = &handle->txSlots[handle->txCount];
+    qcc::OutDatagram* dg = &handle->txDgrams[handle->txCount];
+    assert(hdrLen <= ARDP_MAX_HEADER_LEN);
+    memcpy(slot->hdr, hdr, hdrLen);
+    slot->conn = conn;
+    slot->snd = snd;
+    slot->iov[0].buf = reinterpret_cast<char*>(slot->hdr);
+    slot->iov[0].len = hdrLen;
+    slot->iov[1].buf = reinterpret_cast<char*>(const_cast<void*>(data));
+    slot->iov[1].len = dataLen;
+    dg->iov = slot->iov;
+    dg->numIov = (dataLen != 0) ? 2 : 1;
+    dg->remoteAddr = conn->ipAddr;
+    dg->remotePort = conn->ipPort;
+    handle->txSock = conn->sock;
+    handle->txCount++;
+
+    return (handle->txDepth == 0) ? FlushTx(handle) : ER_OK;
+}
+
+static inline void BeginTxBatch(ArdpHandle* handle)
+{
+    handle->txDepth++;
+}
+
+static inline void EndTxBatch(ArdpHandle* handle)
+{
+    assert(handle->txDepth != 0);
+    if (--handle->txDepth == 0) {
+        FlushTx(handle);
+    }
+}
+
+/*
+ * Congestion control.
+ *
+ * Each connection carries an ArdpCongestion block that is driven through the
+ * ArdpCcOps table selected by config.congestionControl.  Windows are counted
+ * in payload bytes: bytesInFlight covers segments that have been handed to
+ * SendData() and not yet acknowledged (cumulatively or through an EACK),
+ * expired or presumed lost.  The controller sets cwnd, which ARDP_Send() and
+ * the retransmit paths honor as long as something is in flight, and
+ * pacingRate, which SendData() enforces with a token bucket by deferring
+ * segments onto their retransmit timers.
+ */
+#define ARDP_CC_GAIN_UNIT 256        /* Fixed-point unit for BBR gains */
+#define ARDP_BBR_HIGH_GAIN 739       /* 2/ln(2), startup pacing and window gain */
+#define ARDP_BBR_DRAIN_GAIN 89       /* 1/high gain */
+#define ARDP_BBR_CYCLE_LEN 8         /* Phases in the PROBE_BW gain cycle */
+#define ARDP_BBR_BW_ROUNDS 10        /* Round trips covered by the bottleneck bandwidth max filter */
+#define ARDP_BBR_MIN_RTT_WINDOW 10000 /* Milliseconds covered by the min RTT filter */
+#define ARDP_CC_MSS 1472             /* Window granularity: a UDP payload that fits an Ethernet frame */
+
+static const uint32_t bbrCycleGain[ARDP_BBR_CYCLE_LEN] = { 320, 192, 256, 256, 256, 256, 256, 256 };
+
+typedef struct {
+    void (*Init)(ArdpHandle* handle, ArdpConnRecord* conn);
+    void (*OnAck)(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t acked, uint32_t now);
+    void (*OnLoss)(ArdpHandle* handle, ArdpConnRecord* conn, bool timeout, uint32_t now);
+} ArdpCcOps;
+
+/*
+ * Segments can be as large as a UDP datagram, but the network drops and
+ * queues IP packets, so windows grow and shrink in packet-sized steps.
+ */
+static inline uint32_t CcMss(ArdpConnRecord* conn)
+{
+    return MAX(MIN((uint32_t)conn->SBUF.maxDlen, (uint32_t)ARDP_CC_MSS), 1U);
+}
+
+static void NoneInit(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    conn->cc.cwnd = 0xffffffff;
+    conn->cc.pacingRate = 0;
+}
+
+static void NoneOnAck(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t acked, uint32_t now)
+{
+}
+
+static void NoneOnLoss(ArdpHandle* handle, ArdpConnRecord* conn, bool timeout, uint32_t now)
+{
+}
+
+/*
+ * NewReno pacing follows the usual practice of spreading a window over an
+ * RTT, with headroom so pacing never becomes the bottleneck: twice the
+ * window in slow start, 1.25 times in congestion avoidance.  An RTT below
+ * the millisecond clock leaves nothing to spread the window over.
+ */
+static void NewRenoSetPacing(ArdpConnRecord* conn)
+{
+    if (!conn->rttInit || conn->rttMean == 0) {
+        conn->cc.pacingRate = 0;
+        return;
+    }
+    uint64_t rate = (uint64_t)conn->cc.cwnd / MAX(conn->rttMean, 1U);
+    rate = (conn->cc.cwnd < conn->cc.ssthresh) ? rate * 2 : rate + (rate >> 2);
+    conn->cc.pacingRate = (uint32_t)MIN(rate, (uint64_t)0xffffffff);
+}
+
+static void NewRenoInit(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    uint32_t mss = CcMss(conn);
+    /* RFC 3390 initial window */
+    conn->cc.cwnd = MIN(4 * mss, MAX(2 * mss, 4380U));
+    conn->cc.ssthresh = 0xffffffff;
+    conn->cc.pacingRate = 0;
+}
+
+static void NewRenoOnAck(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t acked, uint32_t now)
+{
+    uint32_t mss = CcMss(conn);
+
+    if (conn->cc.inRecovery) {
+        if (SEQ32_LT(conn->cc.recover, conn->SND.UNA)) {
+            /* Everything outstanding at the time of the loss is acknowledged */
+            conn->cc.inRecovery = false;
+            conn->cc.cwnd = MAX(conn->cc.ssthresh, mss);
+        }
+    } else if ((uint64_t)(conn->cc.bytesInFlight + acked) * 2 < conn->cc.cwnd) {
+        /* Application limited: a window that is not being used has not been validated (RFC 7661) */
+    } else if (conn->cc.cwnd < conn->cc.ssthresh) {
+        /* Slow start, with the RFC 3465 limit of two segments per ACK */
+        conn->cc.cwnd += MIN(acked, 2 * mss);
+    } else {
+        /* Congestion avoidance: one segment per window's worth of ACKs */
+        conn->cc.avoidAcc += acked;
+        if (conn->cc.avoidAcc >= conn->cc.cwnd) {
+            conn->cc.avoidAcc -= conn->cc.cwnd;
+            conn->cc.cwnd += mss;
         }
     }
+    NewRenoSetPacing(conn);
+}
+
+static void NewRenoOnLoss(ArdpHandle* handle, ArdpConnRecord* conn, bool timeout, uint32_t now)
+{
+    uint32_t mss = CcMss(conn);
 
-    return (nextTime != ARDP_NO_TIMEOUT) ? nextTime - now : ARDP_NO_TIMEOUT;
+    if (conn->cc.inRecovery && !timeout) {
+        /* One reduction per window of data */
+        return;
+    }
+    if (conn->cc.inRecovery && conn->cc.timedOut) {
+        return;
+    }
+    /* Halve the (validated) window rather than FlightSize, which is tiny whenever the RTT is */
+    conn->cc.ssthresh = MAX(conn->cc.cwnd / 2, 2 * mss);
+    conn->cc.cwnd = timeout ? mss : conn->cc.ssthresh;
+    conn->cc.avoidAcc = 0;
+    conn->cc.inRecovery = true;
+    conn->cc.timedOut = timeout;
+    conn->cc.recover = conn->SND.NXT - 1;
+    NewRenoSetPacing(conn);
+}
+
+/*
+ * A compact BBR: the bottleneck bandwidth is the windowed maximum of the
+ * delivery rate samples taken from ACKs, the propagation delay the windowed
+ * minimum RTT.  The sender paces at gain * bandwidth and keeps at most twice
+ * the bandwidth-delay product in flight, starting with a doubling STARTUP,
+ * DRAINing the queue that built, then cycling through PROBE_BW gains.
+ */
+enum {
+    BBR_STARTUP = 0,
+    BBR_DRAIN,
+    BBR_PROBE_BW
+};
+
+static inline uint32_t BbrBdp(ArdpConnRecord* conn)
+{
+    return conn->cc.btlBw * MAX(conn->cc.minRtt, 1U);
+}
+
+static void BbrSetWindow(ArdpConnRecord* conn)
+{
+    uint32_t gain = (conn->cc.mode == BBR_PROBE_BW) ? 2 * ARDP_CC_GAIN_UNIT : ARDP_BBR_HIGH_GAIN;
+    uint32_t pacingGain = ARDP_BBR_HIGH_GAIN;
+    if (conn->cc.mode == BBR_DRAIN) {
+        pacingGain = ARDP_BBR_DRAIN_GAIN;
+    } else if (conn->cc.mode == BBR_PROBE_BW) {
+        pacingGain = bbrCycleGain[conn->cc.cycleIndex];
+    }
+
+    if (conn->cc.btlBw == 0) {
+        return;
+    }
+    uint64_t cwnd = ((uint64_t)BbrBdp(conn) * gain) / ARDP_CC_GAIN_UNIT;
+    conn->cc.cwnd = (uint32_t)MIN(MAX(cwnd, (uint64_t)4 * CcMss(conn)), (uint64_t)0xffffffff);
+    /*
+     * With a round trip below the millisecond clock the rate samples only
+     * measure how much fits in one tick, so pacing to them would throttle
+     * the connection.  Leave such paths window-limited.
+     */
+    if (conn->cc.minRtt == 0) {
+        conn->cc.pacingRate = 0;
+        return;
+    }
+    conn->cc.pacingRate = (uint32_t)MAX(((uint64_t)conn->cc.btlBw * pacingGain) / ARDP_CC_GAIN_UNIT, (uint64_t)1);
+}
+
+static void BbrInit(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    NewRenoInit(handle, conn);
+    conn->cc.mode = BBR_STARTUP;
+    conn->cc.minRtt = 0xffffffff;
+}
+
+static void BbrOnAck(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t acked, uint32_t now)
+{
+    /* Round trips are counted in delivered data: a round ends when data sent after it started is ACKed */
+    bool newRound = false;
+    if (SEQ32_LET(conn->cc.roundEnd, conn->cc.sampleDelivered)) {
+        conn->cc.roundEnd = conn->cc.delivered;
+        conn->cc.round++;
+        newRound = true;
+    }
+
+    if (conn->cc.sampleRtt != ARDP_NO_TIMEOUT &&
+        (conn->cc.sampleRtt <= conn->cc.minRtt || (now - conn->cc.minRttStamp) > ARDP_BBR_MIN_RTT_WINDOW)) {
+        conn->cc.minRtt = conn->cc.sampleRtt;
+        conn->cc.minRttStamp = now;
+    }
+    if (conn->cc.sampleBw != 0 &&
+        (conn->cc.sampleBw >= conn->cc.btlBw || (conn->cc.round - conn->cc.btlBwRound) > ARDP_BBR_BW_ROUNDS)) {
+        conn->cc.btlBw = conn->cc.sampleBw;
+        conn->cc.btlBwRound = conn->cc.round;
+    }
+
+    switch (conn->cc.mode) {
+    case BBR_STARTUP:
+        /* The pipe is full once three rounds fail to grow the bandwidth by a quarter */
+        if (newRound && conn->cc.btlBw != 0) {
+            if (conn->cc.btlBw >= conn->cc.fullBw + (conn->cc.fullBw >> 2)) {
+                conn->cc.fullBw = conn->cc.btlBw;
+                conn->cc.fullBwCount = 0;
+            } else if (++conn->cc.fullBwCount >= 3) {
+                conn->cc.mode = BBR_DRAIN;
+            }
+        }
+        break;
+
+    case BBR_DRAIN:
+        if (conn->cc.bytesInFlight <= BbrBdp(conn)) {
+            conn->cc.mode = BBR_PROBE_BW;
+            conn->cc.cycleIndex = 0;
+            conn->cc.cycleStamp = now;
+        }
+        break;
+
+    case BBR_PROBE_BW:
+        if ((now - conn->cc.cycleStamp) >= MAX(conn->cc.minRtt, 1U)) {
+            conn->cc.cycleIndex = (conn->cc.cycleIndex + 1) % ARDP_BBR_CYCLE_LEN;
+            conn->cc.cycleStamp = now;
+        }
+        break;
+    }
+
+    BbrSetWindow(conn);
+}
+
+static void BbrOnLoss(ArdpHandle* handle, ArdpConnRecord* conn, bool timeout, uint32_t now)
+{
+    /*
+     * BBR does not treat isolated losses as congestion.  A retransmit timeout
+     * means the model is stale: fall back to one segment until ACKs resume.
+     */
+    if (timeout) {
+        conn->cc.cwnd = CcMss(conn);
+    }
+}
+
+static const ArdpCcOps ccOps[] = {
+    { NoneInit, NoneOnAck, NoneOnLoss },
+    { NewRenoInit, NewRenoOnAck, NewRenoOnLoss },
+    { BbrInit, BbrOnAck, BbrOnLoss }
+};
+
+static inline const ArdpCcOps* CcOps(ArdpHandle* handle)
+{
+    uint32_t cc = handle->config.congestionControl;
+    return &ccOps[(cc < ArraySize(ccOps)) ? cc : ARDP_CC_NONE];
+}
+
+static void CcInit(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    uint32_t now = TimeNow(handle->tbase);
+    CcOps(handle)->Init(handle, conn);
+    conn->cc.deliveredStamp = now;
+    conn->cc.paceStamp = now;
+    conn->cc.paceRelease = now;
+    conn->cc.sampleRtt = ARDP_NO_TIMEOUT;
+    conn->cc.initialized = true;
+}
+
+/* Add a segment to, or remove it from, bytesInFlight */
+static inline void EnterFlight(ArdpConnRecord* conn, ArdpSndBuf* snd)
+{
+    if (!snd->inFlight) {
+        snd->inFlight = true;
+        conn->cc.bytesInFlight += snd->datalen;
+    }
+}
+
+static inline bool LeaveFlight(ArdpConnRecord* conn, ArdpSndBuf* snd)
+{
+    if (!snd->inFlight) {
+        return false;
+    }
+    snd->inFlight = false;
+    conn->cc.bytesInFlight -= MIN(conn->cc.bytesInFlight, snd->datalen);
+    return true;
+}
+
+/* Room in the congestion window for another len bytes */
+static inline bool CcCanSend(ArdpConnRecord* conn, uint32_t len)
+{
+    return conn->cc.bytesInFlight == 0 || (uint64_t)conn->cc.bytesInFlight + len <= conn->cc.cwnd;
+}
+
+/*
+ * If the segment preceding seq is still held back by SendData() (pacing or a
+ * full socket), return the number of milliseconds until it is due so that seq
+ * does not overtake it.  The receiver would report the gap in an EACK and the
+ * sender would take it for a loss.
+ */
+static bool PrecedingHeld(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t seq, uint32_t now, uint32_t* wait)
+{
+    if (!SEQ32_LT(conn->SND.UNA, seq)) {
+        return false;
+    }
+    ArdpSndBuf* prev = &conn->SBUF.snd[(seq - 1) % conn->SND.MAX];
+    if (!prev->inUse || prev->timer.retry <= (uint32_t)(handle->config.dataRetries + 1)) {
+        return false;
+    }
+    *wait = SEQ32_LT(now, prev->timer.when) ? prev->timer.when - now : 0;
+    return true;
+}
+
+/*
+ * Remove a segment from bytesInFlight.  Segments that were delivered (as
+ * opposed to expired) also feed the delivery-rate sample used by BBR, as long
+ * as they were never retransmitted.
+ */
+static void SegmentDone(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* snd, bool delivered)
+{
+    if (!LeaveFlight(conn, snd)) {
+        return;
+    }
+    if (delivered) {
+        uint32_t now = TimeNow(handle->tbase);
+        conn->cc.delivered += snd->datalen;
+        conn->cc.deliveredStamp = now;
+        conn->cc.ackedBytes += snd->datalen;
+        if (snd->timer.retry == (handle->config.dataRetries + 1)) {
+            uint32_t elapsed = MAX(now - snd->tSent, 1U);
+            uint32_t rate = (conn->cc.delivered - snd->delivered) / elapsed;
+            conn->cc.sampleBw = MAX(conn->cc.sampleBw, rate);
+            conn->cc.sampleRtt = MIN(conn->cc.sampleRtt, now - snd->tSent);
+            if (SEQ32_LT(conn->cc.sampleDelivered, snd->delivered)) {
+                conn->cc.sampleDelivered = snd->delivered;
+            }
+        }
+    }
+}
+
+/* Report the segments SegmentDone() counted since the last call to the controller */
+static void CcOnAck(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    if (conn->cc.ackedBytes == 0 || !conn->cc.initialized) {
+        return;
+    }
+    CcOps(handle)->OnAck(handle, conn, conn->cc.ackedBytes, TimeNow(handle->tbase));
+    conn->cc.ackedBytes = 0;
+    conn->cc.sampleBw = 0;
+    conn->cc.sampleRtt = ARDP_NO_TIMEOUT;
+}
+
+static inline void CcOnLoss(ArdpHandle* handle, ArdpConnRecord* conn, bool timeout)
+{
+    if (conn->cc.initialized) {
+        CcOps(handle)->OnLoss(handle, conn, timeout, TimeNow(handle->tbase));
+    }
+}
+
+/*
+ * A retransmit timeout means everything on the wire is presumed lost (RFC
+ * 5681, section 3.1): empty the flight so the retransmits that follow are
+ * clocked out by the collapsed window.  Segments held back by SendData()
+ * were never sent and stay accounted for.
+ */
+static void CcOnTimeout(ArdpHandle* handle, ArdpConnRecord* conn)
+{
+    CcOnLoss(handle, conn, true);
+    for (uint32_t seq = conn->SND.UNA; SEQ32_LT(seq, conn->SND.NXT); seq++) {
+        ArdpSndBuf* snd = &conn->SBUF.snd[seq % conn->SND.MAX];
+        if (snd->inUse && snd->timer.retry <= (handle->config.dataRetries + 1)) {
+            LeaveFlight(conn, snd);
+        }
+    }
+}
+
+/*
+ * Token bucket pacing.  Returns how many milliseconds a segment of len bytes
+ * has to wait before it may be sent, and charges the bucket for it either
+ * way, so that the release times of held segments never decrease and
+ * segments go out in sequence order.  The bucket holds about one millisecond
+ * (at least two segments) of credit so that the millisecond timer
+ * granularity does not cap the rate.
+ */
+static uint32_t PacingDelay(ArdpConnRecord* conn, uint32_t len, uint32_t now)
+{
+    uint32_t rate = conn->cc.pacingRate;
+    uint32_t delay = SEQ32_LT(now, conn->cc.paceRelease) ? conn->cc.paceRelease - now : 0;
+    if (rate == 0) {
+        /* Unpaced, but still not ahead of what is held back */
+        return delay;
+    }
+
+    int64_t burst = MAX((int64_t)rate, 2 * (int64_t)CcMss(conn));
+    int64_t credit = conn->cc.paceCredit + (int64_t)(now - conn->cc.paceStamp) * rate;
+    conn->cc.paceStamp = now;
+    conn->cc.paceCredit = MIN(credit, burst);
+    if (conn->cc.paceCredit < 0) {
+        delay = MAX(delay, (uint32_t)((-conn->cc.paceCredit + rate - 1) / rate));
+        conn->cc.paceRelease = now + delay;
+    }
+    conn->cc.paceCredit -= len;
+    return delay;
 }
 
 static void DelConnRecord(ArdpHandle* handle, ArdpConnRecord* conn, bool forced)
@@ -565,6 +1371,9 @@ static void DelConnRecord(ArdpHandle* handle, ArdpConnRecord* conn, bool forced)
 
     }
 
+    /* Queued segments may still point at this connection and its send buffers */
+    FlushTx(handle);
+
     /* Safe to check together as these buffers are always allocated together */
     if (conn->SBUF.snd != NULL && conn->SBUF.snd[0].hdr != NULL) {
         free(conn->SBUF.snd[0].hdr);
@@ -580,6 +1389,9 @@ static void DelConnRecord(ArdpHandle* handle, ArdpConnRecord* conn, bool forced)
     }
 
     DeList((ListNode*)conn);
+    IndexRemove(&handle->byPorts, PortsKey(conn->local, conn->foreign), conn);
+    IndexRemove(&handle->byAddr, AddrKey(conn), conn);
+    HeapRemove(handle, conn);
 
     if (conn->synSnd.data != NULL) {
         free(conn->synSnd.data);
@@ -600,6 +1412,7 @@ static void FlushMessage(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* s
     do {
         snd->inUse = false;
         snd->fastRT = 0;
+        snd->inFlight = false;
         len += ntohs(h->dlen);
         snd = snd->next;
         h = (ArdpHeader*) snd->hdr;
@@ -613,6 +1426,9 @@ static void FlushMessage(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* s
     QCC_DbgPrintf(("FlushMessage(): SendCb(handle=%p, conn=%p, buf=%p, len=%d, status=%d",
                    handle, conn, buf, len, status));
 
+    /* Queued segments may still point into buf */
+    FlushTx(handle);
+
     /* Mark all fragment SND buffers as available */
     handle->cb.SendCb(handle, conn, buf, len, status);
 }
@@ -743,6 +1559,7 @@ static void ExpireMessageSnd(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBu
 
     do {
         h = (ArdpHeader*) snd->hdr;
+        SegmentDone(handle, conn, snd, false);
         snd->timer.retry = 0;
         snd = snd->next;
         snd->ttl = ARDP_TTL_EXPIRED;
@@ -753,8 +1570,8 @@ static void ExpireMessageSnd(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBu
 
 static QStatus SendMsgHeader(ArdpHandle* handle, ArdpConnRecord* conn, ArdpHeader* h)
 {
-    qcc::ScatterGatherList msgSG;
-    size_t sent;
+    uint8_t hdr[ARDP_MAX_HEADER_LEN];
+    uint32_t mskLen = conn->rcvMsk.fixedSz * sizeof(uint32_t);
 
     QCC_DbgTrace(("SendMsgHeader(): handle=0x%p, conn=0x%p, hdr=0x%p", handle, conn, h));
     if (conn->rcvMsk.sz != 0) {
@@ -762,26 +1579,22 @@ static QStatus SendMsgHeader(ArdpHandle* handle, ArdpConnRecord* conn, ArdpHeade
         QCC_DbgPrintf(("SendMsgHeader: have EACKs flags = %2x", h->flags));
     }
 
-    msgSG.AddBuffer(h, ARDP_FIXED_HEADER_LEN);
-    msgSG.AddBuffer(conn->rcvMsk.htnMask, conn->rcvMsk.fixedSz * sizeof(uint32_t));
-    return qcc::SendToSG(conn->sock, conn->ipAddr, conn->ipPort, msgSG, sent);
+    memcpy(hdr, h, ARDP_FIXED_HEADER_LEN);
+    memcpy(hdr + ARDP_FIXED_HEADER_LEN, conn->rcvMsk.htnMask, mskLen);
+    return QueueTx(handle, conn, NULL, hdr, ARDP_FIXED_HEADER_LEN + mskLen, NULL, 0);
 }
 
 static QStatus SendMsgData(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* sndBuf)
 {
 
     ArdpHeader* h = (ArdpHeader*) sndBuf->hdr;
-    qcc::ScatterGatherList msgSG;
-    size_t sent;
+    uint8_t hdr[ARDP_MAX_HEADER_LEN];
+    uint32_t mskLen = conn->rcvMsk.fixedSz * sizeof(uint32_t);
     QStatus status;
 
     QCC_DbgTrace(("SendMsgData(): handle=%p, conn=%p, hdr=%p, hdrlen=%d, data=%p, datalen=%d, ttl=%u, tStart=%u",
                   handle, conn, sndBuf->hdr, sndBuf->hdrlen, sndBuf->data, sndBuf->datalen, sndBuf->ttl, sndBuf->tStart));
 
-    msgSG.AddBuffer(sndBuf->hdr, ARDP_FIXED_HEADER_LEN);
-    msgSG.AddBuffer(conn->rcvMsk.htnMask, conn->rcvMsk.fixedSz * sizeof(uint32_t));
-    msgSG.AddBuffer(sndBuf->data, sndBuf->datalen);
-
     h->ack = htonl(conn->RCV.CUR);
     h->lcs = htonl(conn->RCV.LCS);
     h->acknxt = htonl(conn->SND.UNA);
@@ -861,9 +1674,13 @@ static QStatus SendMsgData(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf*
         }
     }
 
-    status = qcc::SendToSG(conn->sock, conn->ipAddr, conn->ipPort, msgSG, sent);
+    memcpy(hdr, h, ARDP_FIXED_HEADER_LEN);
+    memcpy(hdr + ARDP_FIXED_HEADER_LEN, conn->rcvMsk.htnMask, mskLen);
+    status = QueueTx(handle, conn, sndBuf, hdr, ARDP_FIXED_HEADER_LEN + mskLen, sndBuf->data, sndBuf->datalen);
 
     if (status == ER_OK) {
+        sndBuf->tSent = TimeNow(handle->tbase);
+        sndBuf->delivered = conn->cc.delivered;
         if (conn->ackTimer.retry != 0) {
             UpdateTimer(handle, conn, &conn->ackTimer, ARDP_ACK_TIMEOUT, 1);
         }
@@ -947,7 +1764,7 @@ static QStatus Disconnect(ArdpHandle* handle, ArdpConnRecord* conn, QStatus reas
 static void AdjustRTT(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* snd)
 {
     uint32_t now = TimeNow(handle->tbase);
-    uint32_t rtt = now - snd->tStart;
+    uint32_t rtt = now - snd->tSent;
     int32_t err;
 
     if (!conn->rttInit) {
@@ -958,8 +1775,8 @@ static void AdjustRTT(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* snd)
 
     err = rtt - conn->rttMean;
 
-    QCC_DbgPrintf(("AdjustRtt: mean = %u, var =%u, rtt = %u, now = %u, tStart= %u, error = %d",
-                   conn->rttMean, conn->rttMeanVar, rtt, now, snd->tStart, err));
+    QCC_DbgPrintf(("AdjustRtt: mean = %u, var =%u, rtt = %u, now = %u, tSent= %u, error = %d",
+                   conn->rttMean, conn->rttMeanVar, rtt, now, snd->tSent, err));
     conn->rttMean = (7 * conn->rttMean + rtt) >> 3;
     conn->rttMeanVar = (conn->rttMeanVar * 3 + ABS(err)) >> 2;
 
@@ -987,9 +1804,31 @@ static void RetransmitTimerHandler(ArdpHandle* handle, ArdpConnRecord* conn, voi
 
     if (timer->retry > 1) {
         QCC_DbgPrintf(("RetransmitTimerHandler: context=snd=%p seq=%u retries=%d", snd, ntohl(((ArdpHeader*)snd->hdr)->seq), timer->retry));
+        /* Segments SendData() held back for pacing or a full socket have never been on the wire, the rest time out */
+        uint32_t wait;
+        if (timer->retry > (handle->config.dataRetries + 1)) {
+            if (PrecedingHeld(handle, conn, ntohl(((ArdpHeader*)snd->hdr)->seq), TimeNow(handle->tbase), &wait)) {
+                timer->delta = wait;
+                return;
+            }
+        } else {
+            if (snd->inFlight) {
+                CcOnTimeout(handle, conn);
+            }
+            /*
+             * Wait for ACKs to open the window; this does not count as a retransmit.
+             * The oldest unacknowledged segment always goes out, as new data
+             * would otherwise keep taking the window from it.
+             */
+            if (ntohl(((ArdpHeader*)snd->hdr)->seq) != conn->SND.UNA && !CcCanSend(conn, snd->datalen)) {
+                timer->delta = MAX(conn->rttMean, 1U);
+                return;
+            }
+        }
         QStatus status = SendMsgData(handle, conn, snd);
 
         if (status == ER_OK) {
+            EnterFlight(conn, snd);
             timer->retry--;
             conn->backoff = MAX(conn->backoff, (handle->config.dataRetries + 1) - timer->retry);
             timer->delta = GetRTO(handle, conn);
@@ -1068,6 +1907,17 @@ ArdpHandle* ARDP_AllocHandle(ArdpGlobalConfig* config)
     GetTimeNow(&handle->tbase);
     handle->msnext = ARDP_NO_TIMEOUT;
     memcpy(&handle->config, config, sizeof(ArdpGlobalConfig));
+
+    handle->rxBuf = new uint8_t[ARDP_RECV_BATCH * ARDP_RECV_BUFSIZE];
+    handle->rxRing = new qcc::Datagram[ARDP_RECV_BATCH];
+    for (uint32_t i = 0; i < ARDP_RECV_BATCH; ++i) {
+        handle->rxRing[i].buf = handle->rxBuf + i * ARDP_RECV_BUFSIZE;
+        handle->rxRing[i].len = ARDP_RECV_BUFSIZE;
+        handle->rxRing[i].received = 0;
+        handle->rxRing[i].remotePort = 0;
+    }
+    handle->txSlots = new ArdpTxSlot[ARDP_TX_BATCH];
+    handle->txDgrams = new qcc::OutDatagram[ARDP_TX_BATCH];
     return handle;
 }
 
@@ -1082,6 +1932,14 @@ void ARDP_FreeHandle(ArdpHandle* handle)
             DelConnRecord(handle, (ArdpConnRecord*)tmp, false);
         }
     }
+    delete[] handle->txDgrams;
+    delete[] handle->txSlots;
+    delete[] handle->rxRing;
+    delete[] handle->rxBuf;
+    free(handle->byPorts.slots);
+    free(handle->byAddr.slots);
+    free(handle->heap);
+    free(handle->due);
     delete handle;
 }
 
@@ -1277,7 +2135,7 @@ static QStatus InitConnRecord(ArdpHandle* handle, ArdpConnRecord* conn, qcc::Soc
     InitSnd(conn);                               /* Initialize the sender side of the connection */
     local = (qcc::Rand32() % 65534) + 1;   /* Allocate an "ephemeral" source port */
     /* Make sure this is a unique combiation of foreign/local */
-    while (FindConn(handle, conn->local, foreign) != NULL) {
+    while (FindConn(handle, local, foreign) != NULL) {
         local++;
         count++;
         if (count == 65535) {
@@ -1321,13 +2179,10 @@ static ArdpConnRecord* FindConn(ArdpHandle* handle, uint16_t local, uint16_t for
 {
     QCC_DbgTrace(("FindConn(handle=%p, local=%d, foreign=%d)", handle, local, foreign));
 
-    for (ListNode* ln = &handle->conns; (ln = ln->fwd) != &handle->conns;) {
-        ArdpConnRecord* conn = (ArdpConnRecord*)ln;
-        QCC_DbgPrintf(("FindConn(): check out conn->local = %d, conn->foreign = %d", conn->local, conn->foreign));
-        if (conn->local == local && conn->foreign == foreign) {
-            QCC_DbgPrintf(("FindConn(): Found conn %p", conn));
-            return conn;
-        }
+    ArdpIndexEntry* entry = IndexProbe(&handle->byPorts, PortsKey(local, foreign), NULL);
+    if (entry != NULL) {
+        QCC_DbgPrintf(("FindConn(): Found conn %p", entry->conn));
+        return entry->conn;
     }
     return NULL;
 }
@@ -1351,6 +2206,10 @@ static QStatus SendData(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf,
     QCC_DbgTrace(("SendData(handle=%p, conn=%p, buf=%p, len=%d., ttl=%u.)", handle, conn, buf, len, ttl));
     QCC_DbgPrintf(("SendData(): Sending %d bytes of data from src=%d to dst=%d", len, conn->local, conn->foreign));
 
+    if (!conn->cc.initialized) {
+        CcInit(handle, conn);
+    }
+
     if (len <= conn->SBUF.maxDlen) {
         /* Data fits into one segment */
         fcnt = 1;
@@ -1410,11 +2269,21 @@ static QStatus SendData(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf,
         assert(((conn->SBUF.pending) < conn->SND.MAX) && "Number of pending segments in send queue exceeds MAX!");
         QCC_DbgPrintf(("SendData(): updated send queue at index %d", index));
 
-        status = SendMsgData(handle, conn, snd);
+        uint32_t delay = PacingDelay(conn, segLen, now);
+        uint32_t wait;
+        if (PrecedingHeld(handle, conn, conn->SND.NXT, now, &wait)) {
+            delay = MAX(delay, wait);
+            status = ER_WOULDBLOCK;
+        } else if (delay == 0) {
+            status = SendMsgData(handle, conn, snd);
+        } else {
+            QCC_DbgPrintf(("SendData(): pacing, hold segment for %u ms", delay));
+            status = ER_WOULDBLOCK;
+        }
 
         if (status == ER_WOULDBLOCK) {
             QCC_DbgPrintf(("SendData(): ER_WOULDBLOCK"));
-            timeout = 0; /* Schedule next time around */
+            timeout = delay; /* Schedule next time around, or once pacing allows */
             retries++;   /* Since that won't be a legitimate retransmit, increase number of retries by 1 */
             status = ER_OK;
         } else {
@@ -1424,6 +2293,7 @@ static QStatus SendData(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf,
         /* We change update our accounting only if the message has been sent successfully. */
         if (status == ER_OK) {
             snd->inUse = true;
+            EnterFlight(conn, snd);
             UpdateTimer(handle, conn, &snd->timer, timeout, retries);
             /* Since we scheduled a retransmit timer, cancel active persist timer */
             conn->persistTimer.retry = 0;
@@ -1560,6 +2430,7 @@ static void UpdateSndSegments(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t
 
             QCC_DbgPrintf(("UpdateSndSegments(): stop timer %p", &snd->timer));
 
+            SegmentDone(handle, conn, snd, true);
             if (snd->timer.retry != 0) {
                 DeList((ListNode*) &snd->timer);
                 snd->timer.retry = 0;
@@ -1586,57 +2457,90 @@ static void UpdateSndSegments(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t
     conn->SND.LCS = lcs;
 }
 
+/*
+ * Resend a segment the EACKs show to be lost right away rather than waiting
+ * for its retransmit timer.  This happens once per transmission of the
+ * buffer; if the resend is lost too, the retransmit timer takes over.
+ */
 static void FastRetransmit(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSndBuf* snd)
 {
-    /* Fast retransmit to fill the gap.*/
-    if (snd->fastRT == handle->config.dupackCounter) {
-        QCC_DbgPrintf(("FastRetransmit(): priority re-send %u", ntohl(((ArdpHeader*)snd->hdr)->seq)));
-        snd->timer.when = TimeNow(handle->tbase);
+    ArdpTimer* timer = &snd->timer;
+
+    if (snd->fastRT != 0 || timer->retry <= 1 || timer->retry > (handle->config.dataRetries + 1)) {
+        return;
+    }
+
+    /* A lost segment no longer counts against the window (the RFC 6675 "pipe") */
+    if (snd->inFlight) {
+        CcOnLoss(handle, conn, false);
+        LeaveFlight(conn, snd);
+    }
+    if (!CcCanSend(conn, snd->datalen)) {
+        /* Retransmitted once later ACKs make room */
+        return;
     }
     snd->fastRT++;
+
+    QCC_DbgPrintf(("FastRetransmit(): priority re-send %u", ntohl(((ArdpHeader*)snd->hdr)->seq)));
+    if (SendMsgData(handle, conn, snd) == ER_OK && timer->retry != 0) {
+        EnterFlight(conn, snd);
+        UpdateTimer(handle, conn, timer, GetRTO(handle, conn), timer->retry - 1);
+    }
 }
 
+/*
+ * Process the EACK bitmask, which starts at SND.UNA + 1.  EACKed segments have
+ * their retransmit timers cancelled.  Every hole (SND.UNA included) with at
+ * least dupackCounter EACKed segments above it is considered lost, in the
+ * manner of RFC 6675, and fast retransmitted.
+ */
 static void CancelEackedSegments(ArdpHandle* handle, ArdpConnRecord* conn, uint32_t* bitMask) {
     QCC_DbgTrace(("CancelEackedSegments(): handle=%p, conn=%p, bitMask=%p", handle, conn, bitMask));
-    uint32_t start = conn->SND.UNA;
-    uint32_t index =  start % conn->SND.MAX;
-    ArdpSndBuf* snd = &conn->SBUF.snd[index];
+    uint32_t start = conn->SND.UNA + 1;
+    uint32_t dupThresh = MAX(handle->config.dupackCounter, 1U);
+    uint32_t eacked = 0;
+    ArdpSndBuf* snd;
 
 #ifndef NDEBUG
     DumpBitMask(conn, bitMask, conn->remoteMskSz, true);
 #endif
-    FastRetransmit(handle, conn, snd);
 
-    /*
-     * Bitmask starts at SND.UNA + 1. Cycle through the mask and cancel retransmit timers
-     * on EACKed segments.
-     */
-    start = start + 1;
     for (uint32_t i = 0; i < conn->remoteMskSz; i++) {
         uint32_t mask32 = ntohl(bitMask[i]);
         uint32_t bitCheck = 1 << 31;
 
-        index = (start + (i * 32)) % conn->SND.MAX;
-        snd = &conn->SBUF.snd[index];
+        snd = &conn->SBUF.snd[(start + (i * 32)) % conn->SND.MAX];
         while (mask32 != 0) {
             if (mask32 & bitCheck) {
                 QCC_DbgPrintf(("CancelEackedSegments(): set retries to zero for timer %p", snd->timer));
+                SegmentDone(handle, conn, snd, true);
                 if (snd->timer.retry != 0) {
                     DeList((ListNode*) &snd->timer);
                     snd->timer.retry = 0;
                 }
-            } else if (i < 1) {
-                /*
-                 * Schedule fast retransmits for gaps in the first 32-segment window.
-                 * Catch the others next time the EACK window moves.
-                 */
-                FastRetransmit(handle, conn, snd);
+                eacked++;
             }
-
             mask32 = mask32 << 1;
             snd = snd->next;
         }
     }
+
+    /* Walk up from SND.UNA while there are enough EACKed segments above to call the holes lost */
+    snd = &conn->SBUF.snd[conn->SND.UNA % conn->SND.MAX];
+    if (eacked >= dupThresh) {
+        FastRetransmit(handle, conn, snd);
+    }
+    for (uint32_t i = 0; i < conn->remoteMskSz && eacked >= dupThresh; i++) {
+        uint32_t mask32 = ntohl(bitMask[i]);
+        for (uint32_t bit = 0; bit < 32 && eacked >= dupThresh; bit++) {
+            snd = snd->next;
+            if (mask32 & (1U << (31 - bit))) {
+                eacked--;
+            } else {
+                FastRetransmit(handle, conn, snd);
+            }
+        }
+    }
 }
 
 static void UpdateRcvMsk(ArdpConnRecord* conn, uint32_t delta)
@@ -1650,30 +2554,23 @@ static void UpdateRcvMsk(ArdpConnRecord* conn, uint32_t delta)
     /* First bit represents RCV.CUR + 2 */
     uint32_t skip = delta / 32;
     uint32_t lshift = delta % 32;
-    uint32_t rshift = 32 - lshift;
-    uint32_t saveBits = 0;
+    uint16_t sz = conn->rcvMsk.sz;
     uint16_t newSz = 0;
 
-    /* Shift the bitmask */
-    conn->rcvMsk.mask[0] = conn->rcvMsk.mask[skip] << lshift;
-    if (conn->rcvMsk.mask[0] > 0) {
-        newSz = 1;
-    }
-
-    for (uint32_t i = skip + 1; i < conn->rcvMsk.sz; i++) {
-        if (conn->rcvMsk.mask[i] == 0) {
-            continue;
-        }
-        saveBits = conn->rcvMsk.mask[i] >> rshift;
-        conn->rcvMsk.mask[i] = conn->rcvMsk.mask[i] << lshift;
-        conn->rcvMsk.mask[i - 1] =  conn->rcvMsk.mask[i - 1] | saveBits;
-        if (conn->rcvMsk.mask[i] > 0) {
-            newSz = i - skip;
-        }
-        conn->rcvMsk.htnMask[i - 1] = htonl(conn->rcvMsk.mask[i - 1]);
+    /*
+     * Shift the bitmask left by delta bits.  Whole words move down by skip,
+     * and every word vacated at the top is cleared since the entire mask goes
+     * out with each EACK.
+     */
+    for (uint32_t i = 0; i < sz; i++) {
+        uint32_t hi = (i + skip < sz) ? conn->rcvMsk.mask[i + skip] : 0;
+        uint32_t lo = (i + skip + 1 < sz) ? conn->rcvMsk.mask[i + skip + 1] : 0;
+        conn->rcvMsk.mask[i] = (lshift == 0) ? hi : ((hi << lshift) | (lo >> (32 - lshift)));
         conn->rcvMsk.htnMask[i] = htonl(conn->rcvMsk.mask[i]);
+        if (conn->rcvMsk.mask[i] != 0) {
+            newSz = i + 1;
+        }
     }
-    conn->rcvMsk.htnMask[0] = htonl(conn->rcvMsk.mask[0]);
     conn->rcvMsk.sz = newSz;
 }
 
@@ -1724,11 +2621,7 @@ static QStatus UpdateRcvBuffers(ArdpHandle* handle, ArdpConnRecord* conn, ArdpRc
         consumed->isDelivered = false;
         consumed->inUse = false;
         QCC_DbgPrintf(("UpdateRcvBuffers: released buffer %p (seq=%u)", consumed, consumed->seq));
-
-        if (consumed->data != NULL) {
-            free(consumed->data);
-            consumed->data = NULL;
-        }
+        /* The slot keeps its data allocation for the next segment that lands in it */
         consumed = consumed->next;
     }
 
@@ -1835,10 +2728,6 @@ static void FlushExpiredRcvMessages(ArdpHandle* handle, ArdpConnRecord* conn, ui
     index = current->seq;
     do {
         if (!current->isDelivered) {
-            if (current->data != NULL) {
-                free(current->data);
-                current->data = NULL;
-            }
             current->inUse = false;
         }
         current->ttl = ARDP_TTL_EXPIRED;
@@ -1906,11 +2795,21 @@ static QStatus AddRcvBuffer(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* s
         return ER_OK;
     }
 
-    /* Allocate holding buffer, pad up to 1K */
-    current->data = (uint8_t*) malloc((((seg->DLEN + 1023) >> 10) << 10) * sizeof(uint8_t));
-    if (current->data == NULL) {
-        QCC_LogError(ER_OUT_OF_MEMORY, ("Failed to allocate rcv data buffer"));
-        return ER_OUT_OF_MEMORY;
+    /*
+     * Allocate holding buffer, pad up to 1K.  Slots are reused round-robin as
+     * the window advances, so only grow the buffer when this segment does not
+     * fit in what the slot already holds.
+     */
+    if (current->data == NULL || current->capacity < seg->DLEN) {
+        uint32_t capacity = ((seg->DLEN + 1023) >> 10) << 10;
+        free(current->data);
+        current->capacity = 0;
+        current->data = (uint8_t*) malloc(capacity * sizeof(uint8_t));
+        if (current->data == NULL) {
+            QCC_LogError(ER_OUT_OF_MEMORY, ("Failed to allocate rcv data buffer"));
+            return ER_OUT_OF_MEMORY;
+        }
+        current->capacity = capacity;
     }
 
     if (SEQ32_LT(conn->RBUF.last, seg->SEQ)) {
@@ -2100,7 +2999,7 @@ static void ArdpMachine(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* seg,
                 conn->rcvHdrLen = ARDP_FIXED_HEADER_LEN + conn->remoteMskSz * sizeof(uint32_t);
                 QCC_DbgPrintf(("ArdpMachine(): SYN_SENT: SYN received: rcvHdrLen=%d, remoteMskSz=%d", conn->rcvHdrLen, conn->remoteMskSz));
                 conn->window = conn->SND.MAX;
-                conn->foreign = seg->SRC;
+                SetConnForeign(handle, conn, seg->SRC);
 
                 conn->RCV.IRS = seg->SEQ;
                 conn->RCV.CUR = seg->SEQ;
@@ -2261,6 +3160,8 @@ static void ArdpMachine(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* seg,
 #ifndef NDEBUG
                     DumpBuffer(buf, len);
 #endif
+                    /* Most likely a retransmit whose ACK got lost: repeat it (RFC 908, section 3.7) */
+                    UpdateTimer(handle, conn, &conn->ackTimer, 0, 1);
                     break;
                 }
             }
@@ -2313,6 +3214,9 @@ static void ArdpMachine(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* seg,
                 CancelEackedSegments(handle, conn, (uint32_t* ) (buf + ARDP_FIXED_HEADER_LEN));
             }
 
+            /* Let the congestion controller see everything this segment acknowledged */
+            CcOnAck(handle, conn);
+
             if (seg->DLEN) {
                 QCC_DbgPrintf(("ArdpMachine(): OPEN: Got %d bytes of Data with SEQ %u, RCV.CUR = %u).", seg->DLEN, seg->SEQ, conn->RCV.CUR));
                 status = ER_OK;
@@ -2321,6 +3225,13 @@ static void ArdpMachine(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* seg,
                  * receiving a retransmit of a segment with sequence number between LCS and CUR).
                  */
 
+                /*
+                 * A segment that arrives out of order or fills a hole is
+                 * acknowledged right away (RFC 5681, section 4.2) so that the
+                 * sender's loss recovery runs on EACKs rather than timeouts.
+                 */
+                bool ackNow = (seg->SEQ != (conn->RCV.CUR + 1)) || (conn->rcvMsk.sz != 0);
+
                 if (SEQ32_LT(conn->RCV.CUR, seg->SEQ)) {
                     status = AddRcvBuffer(handle, conn, seg, buf, len, seg->SEQ == (conn->RCV.CUR + 1));
                     conn->RBUF.ackPending++;
@@ -2331,10 +3242,10 @@ static void ArdpMachine(ArdpHandle* handle, ArdpConnRecord* conn, ArdpSeg* seg,
                  * pending acknowledgement.
                  * In future, make the above parameters (i.e., timeout & pending acks) configurable.
                  */
-                if (conn->ackTimer.retry == 0) {
-                    UpdateTimer(handle, conn, &conn->ackTimer, ARDP_ACK_TIMEOUT, 1);
-                } else if (conn->RBUF.ackPending >= ((conn->RCV.MAX >> 1) + 1)) {
+                if (ackNow || (conn->ackTimer.retry != 0 && conn->RBUF.ackPending >= MIN((uint32_t)((conn->RCV.MAX >> 1) + 1), (uint32_t)2))) {
                     UpdateTimer(handle, conn, &conn->ackTimer, 0, 1);
+                } else if (conn->ackTimer.retry == 0) {
+                    UpdateTimer(handle, conn, &conn->ackTimer, ARDP_ACK_TIMEOUT, 1);
                 }
 
             }
@@ -2404,7 +3315,12 @@ QStatus ARDP_Connect(ArdpHandle* handle, qcc::SocketFd sock, qcc::IPAddress ipAd
     conn->context = context;
     conn->passive = false;
 
-    EnList(handle->conns.bwd, (ListNode*)conn);
+    status = AddConnRecord(handle, conn);
+    if (status != ER_OK) {
+        free(conn->RBUF.rcv);
+        delete conn;
+        return status;
+    }
     *pConn = conn;
     return SendSyn(handle, conn, conn->SND.ISS, conn->RCV.MAX, conn->RBUF.MAX, buf, len);
 }
@@ -2474,8 +3390,16 @@ QStatus ARDP_Send(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf, uint32
     if ((conn->window == 0)  || (conn->SND.NXT - conn->SND.UNA) >= conn->SND.MAX) {
         QCC_DbgPrintf(("NXT - UNA=%u", conn->SND.NXT - conn->SND.UNA));
         return ER_ARDP_BACKPRESSURE;
+    } else if (conn->cc.bytesInFlight != 0 && (conn->cc.bytesInFlight + len) > conn->cc.cwnd) {
+        /* A message larger than the congestion window may still go out on an idle connection */
+        QCC_DbgPrintf(("ARDP_Send(): congestion window %u full, %u in flight", conn->cc.cwnd, conn->cc.bytesInFlight));
+        return ER_ARDP_BACKPRESSURE;
     } else {
-        return SendData(handle, conn, buf, len, ttl);
+        /* All fragments of the message leave in one batch */
+        BeginTxBatch(handle);
+        QStatus status = SendData(handle, conn, buf, len, ttl);
+        EndTxBatch(handle);
+        return status;
     }
 }
 
@@ -2533,7 +3457,7 @@ QStatus Accept(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf, uint16_t
 
     SEG.DLEN = ntohs(syn->dlen);               /* The data length included in the packet. */
     conn->STATE = LISTEN;                      /* The call to Accept() implies a jump to LISTEN */
-    conn->foreign = SEG.SRC;                   /* Now that we have the SYN, we have the foreign address */
+    SetConnForeign(handle, conn, SEG.SRC);     /* Now that we have the SYN, we have the foreign address */
     conn->passive = true;                      /* This connection is (will be) the result of a passive open */
 
     ArdpMachine(handle, conn, &SEG, buf, len);
@@ -2541,64 +3465,85 @@ QStatus Accept(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf, uint16_t
     return ER_OK;
 }
 
+static QStatus ProcessDatagram(ArdpHandle* handle, qcc::SocketFd sock, uint8_t* buf, uint32_t nbytes,
+                               const qcc::IPAddress& address, uint16_t port)
+{
+    QStatus status = ER_OK;
+    uint16_t local, foreign;
+
+    ProtocolDemux(buf, nbytes, &local, &foreign);
+    if (local == 0) {
+        if (handle->accepting && handle->cb.AcceptCb) {
+            ArdpConnRecord* conn = NewConnRecord();
+            status = InitConnRecord(handle, conn, sock, address, port, foreign);
+            if (status == ER_OK) {
+                status = AddConnRecord(handle, conn);
+            }
+            if (status == ER_OK) {
+                status = Accept(handle, conn, buf, nbytes);
+            } else {
+                delete conn;
+            }
+        } else {
+            status = SendRst(handle, sock, address, port, local, foreign);
+        }
+    } else {
+        /* Is there an open connection? */
+        ArdpConnRecord* conn = FindConn(handle, local, foreign);
+        if (conn) {
+            conn->lastSeen = TimeNow(handle->tbase);
+            assert(conn->lastSeen != 0);
+            status = Receive(handle, conn, buf, nbytes);
+        } else {
+            /* Is there a half open connection? */
+            conn = FindConn(handle, local, 0);
+            if (conn) {
+                conn->lastSeen = TimeNow(handle->tbase);
+                status = Receive(handle, conn, buf, nbytes);
+            }
+        }
+        /* Ignore anything else */
+    }
+    return status;
+}
+
 QStatus ARDP_Run(ArdpHandle* handle, qcc::SocketFd sock, bool socketReady, uint32_t* ms)
 {
     QCC_DbgTrace(("ARDP_Run(handle=%p, sock=%d., socketReady=%d., ms=%p)", handle, sock, socketReady, ms));
-    const size_t bufferSize = 65536;      /* UDP packet can be up to 64K long */
-    uint8_t* buf = new uint8_t[bufferSize];
-    qcc::IPAddress address;               /* The IP address of the foreign side */
-    uint16_t port;                        /* Will be the UDP port of the foreign side */
-    size_t nbytes;                        /* The number of bytes actually received */
     QStatus status = ER_FAIL;
 
+    /* Segments produced by timers and by the received batch go out together */
+    BeginTxBatch(handle);
     *ms = handle->msnext = CheckTimers(handle);            /* When to call back (timer expiration) */
     if (socketReady) {
-        status = qcc::RecvFrom(sock, address, port, buf, bufferSize, nbytes);
+        /*
+         * Drain up to ARDP_RECV_BATCH datagrams per readiness event into the
+         * handle's preallocated receive ring rather than taking one trip
+         * through the socket layer (and the allocator) per segment.
+         */
+        size_t count = 0;
+        status = qcc::RecvFromBatch(sock, handle->rxRing, ARDP_RECV_BATCH, count);
         if (status == ER_WOULDBLOCK) {
-            QCC_DbgTrace(("ARDP_Run(): qcc::RecvFrom() ER_WOULDBLOCK"));
-            delete[] buf;
+            QCC_DbgTrace(("ARDP_Run(): qcc::RecvFromBatch() ER_WOULDBLOCK"));
+            EndTxBatch(handle);
+            *ms = handle->msnext;
             return ER_OK;
         } else if (status != ER_OK) {
-            QCC_DbgTrace(("ARDP_Run(): qcc::RecvFrom() failed: %s", QCC_StatusText(status)));
-            delete[] buf;
+            QCC_DbgTrace(("ARDP_Run(): qcc::RecvFromBatch() failed: %s", QCC_StatusText(status)));
+            EndTxBatch(handle);
+            *ms = handle->msnext;
             return status;
         }
 
-        if (nbytes > 0 && nbytes < 65536) {
-            uint16_t local, foreign;
-            ProtocolDemux(buf, nbytes, &local, &foreign);
-            if (local == 0) {
-                if (handle->accepting && handle->cb.AcceptCb) {
-                    ArdpConnRecord* conn = NewConnRecord();
-                    status = InitConnRecord(handle, conn, sock, address, port, foreign);
-                    if (status == ER_OK) {
-                        EnList(handle->conns.bwd, (ListNode*)conn);
-                        status = Accept(handle, conn, buf, nbytes);
-                    }
-                } else {
-                    status = SendRst(handle, sock, address, port, local, foreign);
-                }
-            } else {
-                /* Is there an open connection? */
-                ArdpConnRecord* conn = FindConn(handle, local, foreign);
-                if (conn) {
-                    conn->lastSeen = TimeNow(handle->tbase);
-                    assert(conn->lastSeen != 0);
-                    status = Receive(handle, conn, buf, nbytes);
-                } else {
-                    /* Is there a half open connection? */
-                    conn = FindConn(handle, local, 0);
-                    if (conn) {
-                        conn->lastSeen = TimeNow(handle->tbase);
-                        status = Receive(handle, conn, buf, nbytes);
-                    }
-                }
-                /* Ignore anything else */
+        for (size_t i = 0; i < count; ++i) {
+            qcc::Datagram& dg = handle->rxRing[i];
+            if (dg.received > 0 && dg.received < ARDP_RECV_BUFSIZE) {
+                status = ProcessDatagram(handle, sock, static_cast<uint8_t*>(dg.buf), dg.received, dg.remoteAddr, dg.remotePort);
             }
         }
     }
 
-    delete[] buf;
+    EndTxBatch(handle);
     *ms = handle->msnext;
     QCC_DbgTrace(("ARDP_Run %u", *ms));
 
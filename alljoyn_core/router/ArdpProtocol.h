@@ -37,6 +37,18 @@ const uint16_t ARDP_SEGMAX = 16;              /**< Max number of segments in fli
 
 const uint32_t ARDP_CONN_ID_INVALID = 0xffffffff; /* To indicate invalid connection */
 
+/**
+ * @brief Congestion control algorithms, selected by ArdpGlobalConfig::congestionControl.
+ *
+ * Congestion control only affects how the sending side paces and limits its
+ * own segments, so both ends of a connection may use different algorithms.
+ */
+typedef enum {
+    ARDP_CC_NONE = 0,     /**< No congestion window: only the SYN-negotiated segment window limits the sender */
+    ARDP_CC_NEWRENO = 1,  /**< Loss-based slow start and congestion avoidance (RFC 5681/6582), paced at cwnd per RTT */
+    ARDP_CC_BBR = 2       /**< Rate-based: paces at the estimated bottleneck bandwidth, window of twice the BDP */
+} ArdpCongestionControl;
+
 /**
  * @brief Per-protocol-instance (global) configuration variables.
  */
@@ -51,6 +63,7 @@ typedef struct {
     uint32_t probeRetries;    /**< udp_probe_retries configuration variable */
     uint32_t dupackCounter;   /**< udp_dupack_counter configuration variable */
     uint32_t timewait;        /**< udp_timewait configuration variable */
+    uint32_t congestionControl; /**< udp_congestion_control configuration variable, an ArdpCongestionControl */
 } ArdpGlobalConfig;
 
 /**
@@ -106,6 +119,7 @@ typedef struct ARDP_RCV_BUFFER {
     uint32_t seq;          /**< Sequence number */
     uint32_t datalen;      /**< Data payload size */
     uint8_t* data;         /**< Pointer to data payload */
+    uint32_t capacity;     /**< Size of the allocation behind data, kept across segments */
     ARDP_RCV_BUFFER* next; /**< Pointer to the next buffer */
     bool inUse;            /**< Flag indicating that the buffer is occupied, but not delivered to the upper layer (fragment) */
     bool isDelivered;      /**< Flag indicating that the buffer is not delivered to the upper layer */
@@ -26,6 +26,7 @@
 #include <assert.h>
 
 #include "Bus.h"
+#include "ConfigDB.h"
 #include "DaemonRouter.h"
 #include "TransportList.h"
 
@@ -45,6 +46,18 @@ Bus::Bus(const char* applicationName, TransportFactoryContainer& factories, cons
     BusAttachment(new Internal(applicationName, *this, factories, new DaemonRouter, true, listenSpecs, EP_CONCURRENCY), EP_CONCURRENCY)
 {
     GetInternal().GetRouter().SetGlobalGUID(GetInternal().GetGlobalGUID());
+
+    /*
+     * Routers with many connected leaf nodes can spread stream I/O over several
+     * event loops instead of the single IODispatch thread.
+     */
+    uint32_t ioLoops = ConfigDB::GetConfigDB()->GetLimit("iodispatch_loops", 0);
+    if (ioLoops) {
+        QStatus status = GetInternal().GetIODispatch().SetEventLoops(ioLoops);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to create %u IODispatch event loops", ioLoops));
+        }
+    }
 }
 
 Bus::~Bus()
@@ -140,7 +140,6 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
     bool destinationEmpty = destination[0] == '\0';
     if (!destinationEmpty) {
         QCC_DbgPrintf(("DaemonRouter::PushMessage(): destinationEmpty=false"));
-        nameTable.Lock();
         BusEndpoint destEndpoint = nameTable.FindEndpoint(destination);
         if (destEndpoint->IsValid()) {
             QCC_DbgPrintf(("DaemonRouter::PushMessage(): Valid destEndpoint"));
@@ -175,10 +174,8 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                     status = ER_BUS_POLICY_VIOLATION;
 #endif
                 } else {
-                    nameTable.Unlock();
                     QCC_DbgPrintf(("DaemonRouter::PushMessage(): SendThroughEndpoint()"));
                     status = SendThroughEndpoint(msg, destEndpoint, sessionId);
-                    nameTable.Lock();
                 }
             } else {
                 QCC_DbgPrintf(("Blocked message from \"%s\" to \"%s\" (serial=%d). Receiver does not allow remote messages",
@@ -196,9 +193,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
             if ((ER_OK != status) && (ER_BUS_ENDPOINT_CLOSING != status) && (status != ER_BUS_STOPPING)) {
                 QCC_DbgPrintf(("BusEndpoint::PushMessage failed: %s", QCC_StatusText(status)));
             }
-            nameTable.Unlock();
         } else {
-            nameTable.Unlock();
             if ((msg->GetFlags() & ALLJOYN_FLAG_AUTO_START) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_BUS2BUS) &&
                 (sender->GetEndpointType() != ENDPOINT_TYPE_NULL)) {
@@ -241,38 +236,29 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
          * regular broadcast message.
          */
         QCC_DbgPrintf(("DaemonRouter::PushMessage(): broadcast messsage"));
-        nameTable.Lock();
+        set<BusEndpoint> matches;
         ruleTable.Lock();
-        RuleIterator it = ruleTable.Begin();
-        while (it != ruleTable.End()) {
-            if (it->second.IsMatch(msg)) {
-                BusEndpoint dest = it->first;
-                QCC_DbgPrintf(("DaemonRouter::PushMessage(): Routing \"%s\" (%d) to \"%s\"", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
-                /*
-                 * If the message originated locally or the destination allows remote messages
-                 * forward the message, otherwise silently ignore it.
-                 */
+        ruleTable.FindMatchingEndpoints(msg, matches);
+        ruleTable.Unlock();
+
+        for (set<BusEndpoint>::iterator it = matches.begin(); it != matches.end(); ++it) {
+            BusEndpoint dest = *it;
+            QCC_DbgPrintf(("DaemonRouter::PushMessage(): Routing \"%s\" (%d) to \"%s\"", msg->Description().c_str(), msg->GetCallSerial(), dest->GetUniqueName().c_str()));
+            /*
+             * If the message originated locally or the destination allows remote messages
+             * forward the message, otherwise silently ignore it.
+             */
 #ifdef ENABLE_POLICYDB
-                if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages()) &&
-                    ((dest == localEndpoint) || policyDB->OKToReceive(nmh, dest))) {
+            if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages()) &&
+                ((dest == localEndpoint) || policyDB->OKToReceive(nmh, dest))) {
 #else
-                if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
+            if (!((sender->GetEndpointType() == ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
 #endif
-                    ruleTable.Unlock();
-                    nameTable.Unlock();
-                    QCC_DbgPrintf(("DaemonRouter::PushMessage(): SendThroughEndpoint()"));
-                    QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId);
-                    status = (status == ER_OK) ? tStatus : status;
-                    nameTable.Lock();
-                    ruleTable.Lock();
-                }
-                it = ruleTable.AdvanceToNextEndpoint(dest);
-            } else {
-                ++it;
+                QCC_DbgPrintf(("DaemonRouter::PushMessage(): SendThroughEndpoint()"));
+                QStatus tStatus = SendThroughEndpoint(msg, dest, sessionId);
+                status = (status == ER_OK) ? tStatus : status;
             }
         }
-        ruleTable.Unlock();
-        nameTable.Unlock();
 
         if (msg->IsSessionless()) {
             /* Give "locally generated" sessionless message to SessionlessObj */
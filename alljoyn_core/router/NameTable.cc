@@ -29,6 +29,8 @@
 #include <qcc/Logger.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/atomic.h>
 
 #include "NameTable.h"
 #include "VirtualEndpoint.h"
@@ -93,6 +95,7 @@ void NameTable::AddUniqueName(BusEndpoint& endpoint)
     lock.Lock(MUTEX_CONTEXT);
     UniqueNameEntry entry = { endpoint, nameTransfer };
     uniqueNames[uniqueName] = entry;
+    InvalidateSnapshot();
     lock.Unlock(MUTEX_CONTEXT);
 
     /* Notify listeners */
@@ -157,6 +160,7 @@ void NameTable::RemoveUniqueName(const qcc::String& uniqueName)
             uniqueNames.erase(it);
             QCC_DbgPrintf(("Removed ep=%s from name table", uniqueName.c_str()));
         }
+        InvalidateSnapshot();
 
         lock.Unlock(MUTEX_CONTEXT);
         /* Notify listeners */
@@ -227,6 +231,9 @@ QStatus NameTable::AddAlias(const qcc::String& aliasName,
                 origOwnerNameTransfer = vit->second.nameTransfer;
             }
         }
+        if (newOwner) {
+            InvalidateSnapshot();
+        }
         lock.Unlock(MUTEX_CONTEXT);
 
         if (listener) {
@@ -270,7 +277,7 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
             /* Remove primary */
             if (queue.size() > 1) {
                 queue.pop_front();
-                BusEndpoint ep = FindEndpoint(queue[0].endpointName);
+                BusEndpoint ep = FindEndpointLocked(queue[0].endpointName);
                 if (ep->IsValid()) {
                     newOwner = queue[0].endpointName;
                 }
@@ -286,6 +293,7 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
             }
             oldOwner = ownerName;
             disposition = DBUS_RELEASE_NAME_REPLY_RELEASED;
+            InvalidateSnapshot();
         } else {
             /* Alias is not owned by ownerName */
             disposition = DBUS_RELEASE_NAME_REPLY_NOT_OWNER;
@@ -310,7 +318,36 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
 {
     BusEndpoint ep;
 
-    lock.Lock(MUTEX_CONTEXT);
+    /*
+     * Register as a reader of the current epoch before looking at the snapshot
+     * pointer so that InvalidateSnapshot() cannot free the snapshot under us.
+     */
+    volatile int32_t* readers = &snapshotReaders[snapshotEpoch & 1];
+    IncrementAndFetch(readers);
+    const NameSnapshot* snap = snapshot;
+    if (snap) {
+        NameSnapshot::const_iterator it = snap->find(busName);
+        if (it != snap->end()) {
+            ep = it->second;
+        }
+    }
+    DecrementAndFetch(readers);
+
+    if (!snap) {
+        lock.Lock(MUTEX_CONTEXT);
+        ep = FindEndpointLocked(busName);
+        if (!snapshot) {
+            PublishSnapshot();
+        }
+        lock.Unlock(MUTEX_CONTEXT);
+    }
+    return ep;
+}
+
+BusEndpoint NameTable::FindEndpointLocked(const qcc::String& busName) const
+{
+    BusEndpoint ep;
+
     if (busName[0] == ':') {
         unordered_map<qcc::String, UniqueNameEntry, Hash, Equal>::const_iterator it = uniqueNames.find(busName);
         if (it != uniqueNames.end()) {
@@ -320,7 +357,7 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
         unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator it = aliasNames.find(busName);
         if (it != aliasNames.end()) {
             assert(!it->second.empty());
-            ep = FindEndpoint(it->second[0].endpointName);
+            ep = FindEndpointLocked(it->second[0].endpointName);
         }
         /* Fallback to virtual (remote) aliases if a suitable local one cannot be found */
         if (!ep->IsValid()) {
@@ -331,10 +368,66 @@ BusEndpoint NameTable::FindEndpoint(const qcc::String& busName) const
             }
         }
     }
-    lock.Unlock(MUTEX_CONTEXT);
     return ep;
 }
 
+void NameTable::PublishSnapshot() const
+{
+    NameSnapshot* snap = new NameSnapshot();
+
+    unordered_map<qcc::String, UniqueNameEntry, Hash, Equal>::const_iterator uit = uniqueNames.begin();
+    while (uit != uniqueNames.end()) {
+        (*snap)[uit->first] = uit->second.endpoint;
+        ++uit;
+    }
+    unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator ait = aliasNames.begin();
+    while (ait != aliasNames.end()) {
+        assert(!ait->second.empty());
+        uit = uniqueNames.find(ait->second[0].endpointName);
+        if ((uit != uniqueNames.end()) && uit->second.endpoint->IsValid()) {
+            (*snap)[ait->first] = uit->second.endpoint;
+        }
+        ++ait;
+    }
+    /* Virtual (remote) aliases only apply where no suitable local owner exists */
+    map<qcc::StringMapKey, VirtualAliasEntry>::const_iterator vit = virtualAliasNames.begin();
+    while (vit != virtualAliasNames.end()) {
+        String alias = vit->first.c_str();
+        if (snap->find(alias) == snap->end()) {
+            VirtualEndpoint vep = vit->second.endpoint;
+            (*snap)[alias] = BusEndpoint::cast(vep);
+        }
+        ++vit;
+    }
+
+    /*
+     * Advancing the epoch is a full memory barrier, so the snapshot contents are
+     * visible to other threads before the pointer to it is.
+     */
+    IncrementAndFetch(&snapshotEpoch);
+    snapshot = snap;
+}
+
+void NameTable::InvalidateSnapshot()
+{
+    NameSnapshot* snap = snapshot;
+    if (snap) {
+        snapshot = NULL;
+        /*
+         * A reader may have sampled the epoch just before it was advanced so
+         * both reader counts have to drain before the old snapshot is unused.
+         * Advancing the epoch each time sends new readers to the other count.
+         */
+        for (size_t i = 0; i < 2; ++i) {
+            int32_t parity = (IncrementAndFetch(&snapshotEpoch) - 1) & 1;
+            while (snapshotReaders[parity] != 0) {
+                qcc::Sleep(0);
+            }
+        }
+        delete snap;
+    }
+}
+
 void NameTable::GetBusNames(vector<qcc::String>& names) const
 {
     lock.Lock(MUTEX_CONTEXT);
@@ -366,7 +459,7 @@ void NameTable::GetUniqueNamesAndAliases(vector<pair<qcc::String, vector<qcc::St
     unordered_map<qcc::String, deque<NameQueueEntry>, Hash, Equal>::const_iterator ait = aliasNames.begin();
     while (ait != aliasNames.end()) {
         if (!ait->second.empty()) {
-            BusEndpoint ep = FindEndpoint(ait->second.front().endpointName);
+            BusEndpoint ep = FindEndpointLocked(ait->second.front().endpointName);
             if (ep->IsValid()) {
                 epMap.insert(pair<BusEndpoint, qcc::String>(ep, ait->first));
             }
@@ -426,7 +519,7 @@ void NameTable::GetQueuedNames(const qcc::String& busName, std::vector<qcc::Stri
 void NameTable::UpdateVirtualAliases(const qcc::String& epName)
 {
     lock.Lock(MUTEX_CONTEXT);
-    BusEndpoint tempEp = FindEndpoint(epName);
+    BusEndpoint tempEp = FindEndpointLocked(epName);
     VirtualEndpoint ep = VirtualEndpoint::cast(tempEp);
 
     QCC_DbgTrace(("NameTable::UpdateVirtualAliases(%s)", ep->IsValid() ? ep->GetUniqueName().c_str() : "<none>"));
@@ -462,7 +555,7 @@ void NameTable::UpdateVirtualAliases(const qcc::String& epName)
 void NameTable::RemoveVirtualAliases(const qcc::String& epName)
 {
     lock.Lock(MUTEX_CONTEXT);
-    BusEndpoint tempEp = FindEndpoint(epName);
+    BusEndpoint tempEp = FindEndpointLocked(epName);
     VirtualEndpoint ep = VirtualEndpoint::cast(tempEp);
 
     QCC_DbgTrace(("NameTable::RemoveVirtualAliases(%s)", ep->IsValid() ? ep->GetUniqueName().c_str() : "<none>"));
@@ -474,6 +567,7 @@ void NameTable::RemoveVirtualAliases(const qcc::String& epName)
                 String alias = vit->first.c_str();
                 SessionOpts::NameTransferType nameTransfer = vit->second.nameTransfer;
                 virtualAliasNames.erase(vit++);
+                InvalidateSnapshot();
                 if (aliasNames.find(alias) == aliasNames.end()) {
                     lock.Unlock(MUTEX_CONTEXT);
                     CallListeners(alias,
@@ -543,6 +637,7 @@ bool NameTable::SetVirtualAlias(const qcc::String& alias,
     if (newOwner && (*newOwner)->IsValid()) {
         newName = (*newOwner)->GetUniqueName();
     }
+    InvalidateSnapshot();
 
     lock.Unlock(MUTEX_CONTEXT);
 
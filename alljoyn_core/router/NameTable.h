@@ -50,6 +50,12 @@ class NameListener;
  * bus names and the BusEndpoint that these names exist on.
  * This mapping is many (names) to one (endpoint). Every endpoint has
  * exactly one unique name and zero or more well-known names.
+ *
+ * FindEndpoint is on the message routing path so it does not take the name
+ * table lock. Instead it reads an immutable snapshot of the resolved
+ * name-to-endpoint mapping. Operations that change name ownership retire the
+ * current snapshot (waiting for readers still using it to leave) and the next
+ * FindEndpoint builds and publishes a new one under the lock.
  */
 class NameTable {
   public:
@@ -67,7 +73,16 @@ class NameTable {
     /**
      * Constructor
      */
-    NameTable() : uniqueId(0), uniquePrefix(":1.") { }
+    NameTable() : uniqueId(0), uniquePrefix(":1."), snapshot(NULL), snapshotEpoch(0)
+    {
+        snapshotReaders[0] = 0;
+        snapshotReaders[1] = 0;
+    }
+
+    /**
+     * Destructor
+     */
+    ~NameTable() { delete snapshot; }
 
     /**
      * Set the GUID of the bus.
@@ -179,6 +194,8 @@ class NameTable {
 
     /**
      * Find an endpoint for a given unique or alias bus name.
+     * This method does not block on the name table lock unless a name
+     * ownership change has happened since the last call.
      *
      * @param busName   Name of bus.
      * @return  Returns the endpoint if it was found or an invalid endpoint if not found
@@ -248,6 +265,9 @@ class NameTable {
         }
     };
 
+    /** Resolved mapping from every bus name to the endpoint that currently owns it */
+    typedef std::unordered_map<qcc::String, BusEndpoint, Hash, Equal> NameSnapshot;
+
     mutable qcc::Mutex lock;                                             /**< Lock protecting name tables */
     std::unordered_map<qcc::String, UniqueNameEntry, Hash, Equal> uniqueNames;   /**< Unique name table */
     std::unordered_map<qcc::String, std::deque<NameQueueEntry>, Hash, Equal> aliasNames;  /**< Alias name table */
@@ -258,6 +278,29 @@ class NameTable {
     std::set<ProtectedNameListener> listeners;                         /**< Listeners regsitered with name table */
     std::map<qcc::StringMapKey, VirtualAliasEntry> virtualAliasNames;    /**< map of virtual aliases to virtual endpts */
 
+    mutable NameSnapshot* volatile snapshot;            /**< Published snapshot or NULL if it needs to be rebuilt */
+    mutable volatile int32_t snapshotEpoch;             /**< Parity selects which reader count new readers use */
+    mutable volatile int32_t snapshotReaders[2];        /**< Number of readers inside the snapshot for each epoch parity */
+
+    /**
+     * Find an endpoint using the name tables. Caller must hold the lock.
+     *
+     * @param busName   Name of bus.
+     * @return  Returns the endpoint if it was found or an invalid endpoint if not found
+     */
+    BusEndpoint FindEndpointLocked(const qcc::String& busName) const;
+
+    /**
+     * Build and publish a snapshot of the name tables. Caller must hold the lock.
+     */
+    void PublishSnapshot() const;
+
+    /**
+     * Retire the published snapshot after the name tables have changed. Caller must
+     * hold the lock. Returns once no reader can still be using the old snapshot.
+     */
+    void InvalidateSnapshot();
+
     /**
      * Returns the minimum name transfer value for sessions with the endpoint.
      *
@@ -0,0 +1,243 @@
+/**
+ * @file
+ * NameTrie is a prefix tree of bus names (or interface names) used to answer
+ * discovery queries without comparing the query against every name we know.
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014 AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#ifndef _ALLJOYN_NAMETRIE_H
+#define _ALLJOYN_NAMETRIE_H
+
+#include <qcc/platform.h>
+
+#include <map>
+#include <set>
+
+#include <qcc/String.h>
+
+#include "BusUtil.h"
+
+namespace ajn {
+
+/**
+ * A prefix tree mapping names to sets of values.
+ *
+ * Queries use the same pattern language as WildcardMatch().  The common
+ * patterns, an exact name or a literal prefix followed by a single trailing
+ * '*', are answered by walking the tree so the cost is proportional to the
+ * length of the pattern plus the number of matches.  Any other pattern walks
+ * the tree down to its literal prefix and falls back to WildcardMatch() for
+ * the names below that point.
+ *
+ * NameTrie is not thread-safe; callers are expected to protect it with the
+ * same lock as the containers it indexes.
+ */
+template <typename T>
+class NameTrie {
+  public:
+
+    NameTrie() : size(0) { }
+
+    ~NameTrie() { Clear(); }
+
+    /**
+     * Associate a value with a name.
+     *
+     * @param name   The name.  Empty names are unmatchable and are ignored.
+     * @param value  The value to return when a query matches the name.
+     */
+    void Insert(const qcc::String& name, const T& value)
+    {
+        if (name.empty()) {
+            return;
+        }
+        Node* node = &root;
+        for (size_t i = 0; i < name.size(); ++i) {
+            Node*& child = node->children[name[i]];
+            if (!child) {
+                child = new Node();
+            }
+            node = child;
+        }
+        if (node->values.insert(value).second) {
+            ++size;
+        }
+    }
+
+    /**
+     * Remove the association between a value and a name, pruning any part of
+     * the tree that no longer leads to a value.
+     *
+     * @param name   The name.
+     * @param value  The value to remove.
+     */
+    void Remove(const qcc::String& name, const T& value)
+    {
+        if (name.empty()) {
+            return;
+        }
+        if (Remove(&root, name, 0, value)) {
+            --size;
+        }
+    }
+
+    /**
+     * Remove all names and values.
+     */
+    void Clear()
+    {
+        root.Clear();
+        size = 0;
+    }
+
+    /**
+     * @return  The number of (name, value) associations in the tree.
+     */
+    size_t Size() const { return size; }
+
+    /**
+     * @return  true if no names are in the tree.
+     */
+    bool Empty() const { return size == 0; }
+
+    /**
+     * Collect the values of the names that match a pattern.
+     *
+     * @param pattern    A name or wildcard pattern as accepted by WildcardMatch().
+     * @param values     Matching values are added to this set.
+     * @param maxValues  Stop looking once <values> holds this many values.
+     */
+    void Match(const qcc::String& pattern, std::set<T>& values, size_t maxValues = static_cast<size_t>(-1)) const
+    {
+        if (pattern.empty()) {
+            return;
+        }
+
+        size_t wild = pattern.find_first_of("*?");
+        size_t literal = (wild == qcc::String::npos) ? pattern.size() : wild;
+
+        const Node* node = &root;
+        for (size_t i = 0; node && i < literal; ++i) {
+            typename std::map<char, Node*>::const_iterator it = node->children.find(pattern[i]);
+            node = (it == node->children.end()) ? NULL : it->second;
+        }
+        if (!node) {
+            return;
+        }
+
+        if (wild == qcc::String::npos) {
+            values.insert(node->values.begin(), node->values.end());
+        } else if (wild == pattern.size() - 1 && pattern[wild] == '*') {
+            Collect(node, values, maxValues);
+        } else {
+            qcc::String name = pattern.substr(0, literal);
+            Collect(node, name, pattern, values, maxValues);
+        }
+    }
+
+    /**
+     * @param pattern  A name or wildcard pattern as accepted by WildcardMatch().
+     *
+     * @return  true if any name in the tree matches the pattern.
+     */
+    bool Matches(const qcc::String& pattern) const
+    {
+        std::set<T> values;
+        Match(pattern, values, 1);
+        return !values.empty();
+    }
+
+  private:
+
+    /**
+     * NameTrie cannot be copied.
+     */
+    NameTrie(const NameTrie& other);
+    NameTrie& operator=(const NameTrie& other);
+
+    struct Node {
+        std::map<char, Node*> children;     /**< The next character of the names below this node */
+        std::set<T> values;                 /**< The values of the name ending at this node */
+
+        ~Node() { Clear(); }
+
+        void Clear()
+        {
+            for (typename std::map<char, Node*>::iterator it = children.begin(); it != children.end(); ++it) {
+                delete it->second;
+            }
+            children.clear();
+            values.clear();
+        }
+    };
+
+    /**
+     * Remove a value from the name below a node.
+     *
+     * @return true if the value was found and removed.
+     */
+    bool Remove(Node* node, const qcc::String& name, size_t pos, const T& value)
+    {
+        if (pos == name.size()) {
+            return node->values.erase(value) != 0;
+        }
+        typename std::map<char, Node*>::iterator it = node->children.find(name[pos]);
+        if (it == node->children.end()) {
+            return false;
+        }
+        bool removed = Remove(it->second, name, pos + 1, value);
+        if (removed && it->second->values.empty() && it->second->children.empty()) {
+            delete it->second;
+            node->children.erase(it);
+        }
+        return removed;
+    }
+
+    /**
+     * Collect the values of every name at or below a node.
+     */
+    static void Collect(const Node* node, std::set<T>& values, size_t maxValues)
+    {
+        values.insert(node->values.begin(), node->values.end());
+        for (typename std::map<char, Node*>::const_iterator it = node->children.begin(); values.size() < maxValues && it != node->children.end(); ++it) {
+            Collect(it->second, values, maxValues);
+        }
+    }
+
+    /**
+     * Collect the values of every name at or below a node that matches a
+     * pattern.  The name of the node is built up in <name> as we go.
+     */
+    static void Collect(const Node* node, qcc::String& name, const qcc::String& pattern, std::set<T>& values, size_t maxValues)
+    {
+        if (!node->values.empty() && !WildcardMatch(name, pattern)) {
+            values.insert(node->values.begin(), node->values.end());
+        }
+        for (typename std::map<char, Node*>::const_iterator it = node->children.begin(); values.size() < maxValues && it != node->children.end(); ++it) {
+            name.push_back(it->first);
+            Collect(it->second, name, pattern, values, maxValues);
+            name.resize(name.size() - 1);
+        }
+    }
+
+    Node root;      /**< The empty name */
+    size_t size;    /**< Number of (name, value) associations */
+};
+
+}
+
+#endif
@@ -132,47 +132,9 @@ bool Rule::IsMatch(Message& msg) const
         return false;
     }
     if (!implements.empty()) {
-        if (strcmp(msg->GetInterface(), "org.alljoyn.About") || strcmp(msg->GetMemberName(), "Announce")) {
-            return false;
-        }
-        /*
-         * Clone the message since this message is unmarshalled by the
-         * LocalEndpoint too and the process of unmarshalling is not
-         * thread-safe.
-         */
-        Message clone = Message(msg, true);
-        QStatus status = clone->UnmarshalArgs("qqa(oas)a{sv}");
-        if (status != ER_OK) {
-            return false;
-        }
-
-        const MsgArg* arg = clone->GetArg(2);
-        if (!arg) {
-            return false;
-        }
-        size_t numObjectDescriptions;
-        MsgArg* objectDescriptions;
-        status = arg->Get("a(oas)", &numObjectDescriptions, &objectDescriptions);
-        if (status != ER_OK) {
-            return false;
-        }
         set<String> interfaces;
-        for (size_t ob = 0; ob < numObjectDescriptions; ++ob) {
-            char* path;
-            size_t numIntfs;
-            MsgArg* intfs;
-            status = objectDescriptions[ob].Get("(oas)", &path, &numIntfs, &intfs);
-            if (status != ER_OK) {
-                return false;
-            }
-            for (size_t in = 0; in < numIntfs; ++in) {
-                char* intf;
-                status = intfs[in].Get("s", &intf);
-                if (status != ER_OK) {
-                    return false;
-                }
-                interfaces.insert(intf);
-            }
+        if (GetAnnouncedInterfaces(msg, interfaces) != ER_OK) {
+            return false;
         }
         size_t numMatches = 0;
         for (set<String>::const_iterator im = implements.begin(); im != implements.end(); ++im) {
@@ -196,6 +158,52 @@ bool Rule::IsMatch(Message& msg) const
     return true;
 }
 
+QStatus Rule::GetAnnouncedInterfaces(Message& msg, set<String>& interfaces)
+{
+    if (strcmp(msg->GetInterface(), "org.alljoyn.About") || strcmp(msg->GetMemberName(), "Announce")) {
+        return ER_FAIL;
+    }
+    /*
+     * Clone the message since this message is unmarshalled by the
+     * LocalEndpoint too and the process of unmarshalling is not
+     * thread-safe.
+     */
+    Message clone = Message(msg, true);
+    QStatus status = clone->UnmarshalArgs("qqa(oas)a{sv}");
+    if (status != ER_OK) {
+        return status;
+    }
+
+    const MsgArg* arg = clone->GetArg(2);
+    if (!arg) {
+        return ER_FAIL;
+    }
+    size_t numObjectDescriptions;
+    MsgArg* objectDescriptions;
+    status = arg->Get("a(oas)", &numObjectDescriptions, &objectDescriptions);
+    if (status != ER_OK) {
+        return status;
+    }
+    for (size_t ob = 0; ob < numObjectDescriptions; ++ob) {
+        char* path;
+        size_t numIntfs;
+        MsgArg* intfs;
+        status = objectDescriptions[ob].Get("(oas)", &path, &numIntfs, &intfs);
+        if (status != ER_OK) {
+            return status;
+        }
+        for (size_t in = 0; in < numIntfs; ++in) {
+            char* intf;
+            status = intfs[in].Get("s", &intf);
+            if (status != ER_OK) {
+                return status;
+            }
+            interfaces.insert(intf);
+        }
+    }
+    return ER_OK;
+}
+
 qcc::String Rule::ToString() const
 {
     const char* typeStr[] = { NULL, "method_call", "method_return", "error", "signal" };
@@ -253,7 +261,8 @@ QStatus RuleTable::AddRule(BusEndpoint& endpoint, const Rule& rule)
 {
     QCC_DbgPrintf(("AddRule for endpoint %s\n  %s", endpoint->GetUniqueName().c_str(), rule.ToString().c_str()));
     Lock();
-    rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    RuleIterator it = rules.insert(std::pair<BusEndpoint, Rule>(endpoint, rule));
+    IndexRule(it);
     Unlock();
     return ER_OK;
 }
@@ -265,6 +274,7 @@ QStatus RuleTable::RemoveRule(BusEndpoint& endpoint, Rule& rule)
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     while (range.first != range.second) {
         if (range.first->second == rule) {
+            UnindexRule(range.first);
             rules.erase(range.first);
             status = ER_OK;
             break;
@@ -280,10 +290,76 @@ QStatus RuleTable::RemoveAllRules(BusEndpoint& endpoint)
     Lock();
     std::pair<RuleIterator, RuleIterator> range = rules.equal_range(endpoint);
     if (range.first != rules.end()) {
+        for (RuleIterator it = range.first; it != range.second; ++it) {
+            UnindexRule(it);
+        }
         rules.erase(range.first, range.second);
     }
     Unlock();
     return ER_OK;
 }
 
+void RuleTable::FindMatchingEndpoints(Message& msg, std::set<BusEndpoint>& endpoints)
+{
+    MatchIndex(ifaceIndex, msg->GetInterface(), msg, endpoints);
+    MatchIndex(memberIndex, msg->GetMemberName(), msg, endpoints);
+    MatchIndex(pathIndex, msg->GetObjectPath(), msg, endpoints);
+    MatchIndex(senderIndex, msg->GetSender(), msg, endpoints);
+    MatchIndex(wildcardIndex, "", msg, endpoints);
+}
+
+RuleTable::RuleIndex& RuleTable::GetIndex(const Rule& rule, qcc::String& key)
+{
+    if (!rule.iface.empty()) {
+        key = rule.iface;
+        return ifaceIndex;
+    } else if (!rule.member.empty()) {
+        key = rule.member;
+        return memberIndex;
+    } else if (!rule.path.empty()) {
+        key = rule.path;
+        return pathIndex;
+    } else if (!rule.sender.empty()) {
+        key = rule.sender;
+        return senderIndex;
+    } else {
+        key.clear();
+        return wildcardIndex;
+    }
+}
+
+void RuleTable::IndexRule(const RuleIterator& it)
+{
+    String key;
+    RuleIndex& index = GetIndex(it->second, key);
+    index.insert(std::pair<StringMapKey, RuleIterator>(StringMapKey(key), it));
+}
+
+void RuleTable::UnindexRule(const RuleIterator& it)
+{
+    String key;
+    RuleIndex& index = GetIndex(it->second, key);
+    std::pair<RuleIndex::iterator, RuleIndex::iterator> range = index.equal_range(StringMapKey(key.c_str()));
+    while (range.first != range.second) {
+        if (range.first->second == it) {
+            index.erase(range.first);
+            break;
+        }
+        ++range.first;
+    }
+}
+
+void RuleTable::MatchIndex(const RuleIndex& index, const char* key, Message& msg, std::set<BusEndpoint>& endpoints)
+{
+    std::pair<RuleIndex::const_iterator, RuleIndex::const_iterator> range = index.equal_range(StringMapKey(key));
+    while (range.first != range.second) {
+        const RuleIterator& it = range.first->second;
+        /* An endpoint only needs to match once */
+        if ((endpoints.find(it->first) == endpoints.end()) && it->second.IsMatch(msg)) {
+            endpoints.insert(it->first);
+        }
+        ++range.first;
+    }
+}
+
 }
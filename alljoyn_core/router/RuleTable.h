@@ -30,6 +30,7 @@
 #include <set>
 
 #include <qcc/String.h>
+#include <qcc/StringMapKey.h>
 #include <qcc/Mutex.h>
 
 #include <alljoyn/Message.h>
@@ -38,6 +39,8 @@
 
 #include <alljoyn/Status.h>
 
+#include <qcc/STLContainer.h>
+
 namespace ajn {
 
 /**
@@ -102,6 +105,16 @@ struct Rule {
      */
     bool IsMatch(Message& msg) const;
 
+    /**
+     * Get the interfaces advertised in an org.alljoyn.About.Announce signal.
+     * These are what an "implements" rule is matched against.
+     *
+     * @param msg         The Announce signal.
+     * @param interfaces  The interface names found in the signal.
+     * @return  ER_OK if msg is an Announce signal and could be unmarshaled.
+     */
+    static QStatus GetAnnouncedInterfaces(Message& msg, std::set<qcc::String>& interfaces);
+
     /**
      * String representation of a rule
      */
@@ -116,6 +129,13 @@ typedef std::multimap<BusEndpoint, Rule>::iterator RuleIterator;
 /**
  * RuleTable is a thread-safe store used for storing
  * and retrieving message bus routing rules.
+ *
+ * In addition to the rule table itself, each rule is filed in exactly one
+ * bucket of an inverted index keyed on the most selective field the rule
+ * specifies (interface, then member, then path, then sender). Rules that
+ * specify none of these fields go into a wildcard bucket. A message can only
+ * match rules filed under its own interface, member, path or sender, or rules
+ * in the wildcard bucket, so broadcast routing only evaluates those.
  */
 class RuleTable {
   public:
@@ -146,6 +166,16 @@ class RuleTable {
      */
     QStatus RemoveAllRules(BusEndpoint& endpoint);
 
+    /**
+     * Find all endpoints that have at least one rule matching a message.
+     * Only the index buckets the message can possibly match are evaluated.
+     * Caller should obtain lock before calling this method.
+     *
+     * @param msg        Message to match against the rules.
+     * @param endpoints  [OUT] Endpoints with one or more matching rules are added to this set.
+     */
+    void FindMatchingEndpoints(Message& msg, std::set<BusEndpoint>& endpoints);
+
     /**
      * Obtain exclusive access to rule table.
      * This method only needs to be called before using methods that return or use
@@ -208,8 +238,50 @@ class RuleTable {
     }
 
   private:
+
+    /** Inverted index from a rule field value to the rules filed under it */
+    typedef std::unordered_multimap<qcc::StringMapKey, RuleIterator> RuleIndex;
+
+    /**
+     * Select the index bucket that a rule is filed under.
+     *
+     * @param rule   The rule.
+     * @param key    [OUT] Key of the rule within the returned index.
+     * @return  The index that the rule belongs in.
+     */
+    RuleIndex& GetIndex(const Rule& rule, qcc::String& key);
+
+    /**
+     * Add a rule table entry to the index.
+     *
+     * @param it   Iterator to the rule table entry.
+     */
+    void IndexRule(const RuleIterator& it);
+
+    /**
+     * Remove a rule table entry from the index.
+     *
+     * @param it   Iterator to the rule table entry.
+     */
+    void UnindexRule(const RuleIterator& it);
+
+    /**
+     * Evaluate the rules filed under a key and collect the endpoints of the matching ones.
+     *
+     * @param index      Index to search.
+     * @param key        Key of the bucket to evaluate.
+     * @param msg        Message to match against the rules.
+     * @param endpoints  [OUT] Endpoints with one or more matching rules are added to this set.
+     */
+    static void MatchIndex(const RuleIndex& index, const char* key, Message& msg, std::set<BusEndpoint>& endpoints);
+
     qcc::Mutex lock;                            /**< Lock protecting rule table */
     std::multimap<BusEndpoint, Rule> rules;    /**< Rule table */
+    RuleIndex ifaceIndex;                       /**< Rules that specify an interface */
+    RuleIndex memberIndex;                      /**< Rules that specify a member but no interface */
+    RuleIndex pathIndex;                        /**< Rules that specify a path but no interface or member */
+    RuleIndex senderIndex;                      /**< Rules that specify only a sender */
+    RuleIndex wildcardIndex;                    /**< Rules that specify none of the above */
 };
 
 }
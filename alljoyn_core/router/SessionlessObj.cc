@@ -87,8 +87,19 @@ static const char* WildcardInterfaceName = "org.alljoyn";
  * 3. Version 1 implementations will see the "org.alljoyn.sl." advertisements
  *    from version 1 implementations and ignore them if not looking for the
  *    wildcard interface.
+ *
+ * Version 2 adds RequestRangeBatch.  It is only sent to implementations
+ * advertising version 2 or later; earlier versions continue to be sent
+ * RequestRangeMatch (or RequestRange, or RequestSignals).
+ */
+const uint32_t SessionlessObj::version = 2;
+
+/*
+ * The most bytes of marshaled signals to put in a single RangeBatch signal.
+ * This leaves room in the array for the length and padding of each element.
+ * Larger signals are sent on their own.
  */
-const uint32_t SessionlessObj::version = 1;
+static const size_t MAX_RANGE_BATCH_LEN = ALLJOYN_MAX_ARRAY_LEN / 2;
 
 const Rule SessionlessObj::legacyRule = Rule("type='error',sessionless='t'");
 
@@ -125,6 +136,8 @@ SessionlessObj::SessionlessObj(Bus& bus, BusController* busController) :
     requestSignalsSignal(NULL),
     requestRangeSignal(NULL),
     requestRangeMatchSignal(NULL),
+    requestRangeBatchSignal(NULL),
+    rangeBatchSignal(NULL),
     timer("sessionless"),
     curChangeId(0),
     sessionOpts(SessionOpts::TRAFFIC_MESSAGES, false, SessionOpts::PROXIMITY_ANY, TRANSPORT_ANY, SessionOpts::DAEMON_NAMES),
@@ -171,6 +184,8 @@ QStatus SessionlessObj::Init()
     intf->AddSignal("RequestSignals", "u", NULL, 0);
     intf->AddSignal("RequestRange", "uu", NULL, 0);
     intf->AddSignal("RequestRangeMatch", "uuas", NULL, 0);
+    intf->AddSignal("RequestRangeBatch", "uuas", NULL, 0);
+    intf->AddSignal("RangeBatch", "aayb", NULL, 0);
     intf->Activate();
 
     /* Make this object implement org.alljoyn.sl */
@@ -181,13 +196,17 @@ QStatus SessionlessObj::Init()
         return status;
     }
 
-    /* Cache requestSignals, requestRange, and requestRangeMatch interface members */
+    /* Cache requestSignals, requestRange, requestRangeMatch, requestRangeBatch, and rangeBatch interface members */
     requestSignalsSignal = sessionlessIntf->GetMember("RequestSignals");
     assert(requestSignalsSignal);
     requestRangeSignal = sessionlessIntf->GetMember("RequestRange");
     assert(requestRangeSignal);
     requestRangeMatchSignal = sessionlessIntf->GetMember("RequestRangeMatch");
     assert(requestRangeMatchSignal);
+    requestRangeBatchSignal = sessionlessIntf->GetMember("RequestRangeBatch");
+    assert(requestRangeBatchSignal);
+    rangeBatchSignal = sessionlessIntf->GetMember("RangeBatch");
+    assert(rangeBatchSignal);
 
     /* Register a signal handler for requestSignals */
     status = bus.RegisterSignalHandler(this,
@@ -216,6 +235,24 @@ QStatus SessionlessObj::Init()
         QCC_LogError(status, ("Failed to register RequestRangeMatch signal handler"));
     }
 
+    /* Register a signal handler for requestRangeBatch */
+    status = bus.RegisterSignalHandler(this,
+                                       static_cast<MessageReceiver::SignalHandler>(&SessionlessObj::RequestRangeBatchSignalHandler),
+                                       requestRangeBatchSignal,
+                                       NULL);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to register RequestRangeBatch signal handler"));
+    }
+
+    /* Register a signal handler for rangeBatch */
+    status = bus.RegisterSignalHandler(this,
+                                       static_cast<MessageReceiver::SignalHandler>(&SessionlessObj::RangeBatchSignalHandler),
+                                       rangeBatchSignal,
+                                       NULL);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to register RangeBatch signal handler"));
+    }
+
     /* Register signal handler for FoundAdvertisedName */
     /* (If we werent in the daemon, we could just use BusListener, but it doesnt work without the full BusAttachment implementation */
     const InterfaceDescription* ajIntf = bus.GetInterface(org::alljoyn::Bus::InterfaceName);
@@ -386,13 +423,7 @@ QStatus SessionlessObj::PushMessage(Message& msg)
     /* Put the message in the local cache */
     SessionlessMessageKey key(msg->GetSender(), msg->GetInterface(), msg->GetMemberName(), msg->GetObjectPath());
     advanceChangeId = true;
-    SessionlessMessage val(curChangeId, msg);
-    LocalCache::iterator it = localCache.find(key);
-    if (it == localCache.end()) {
-        localCache.insert(pair<SessionlessMessageKey, SessionlessMessage>(key, val));
-    } else {
-        it->second = val;
-    }
+    InsertLocalMessage(key, SessionlessMessage(curChangeId, msg));
 
     lock.Unlock();
     router.UnlockNameTable();
@@ -435,13 +466,11 @@ bool SessionlessObj::RouteSessionlessMessage(SessionId sid, Message& msg)
     }
     RemoteCache& cache = cit->second;
 
-    if (find(cache.routedMessages.begin(), cache.routedMessages.end(), RoutedMessage(msg)) != cache.routedMessages.end()) {
+    if (!cache.routedMessages.insert(RoutedMessage(msg)).second) {
         /* We are retrying and have already routed this message, ignore it */
         lock.Unlock();
         router.UnlockNameTable();
         return true;
-    } else {
-        cache.routedMessages.push_back(RoutedMessage(msg));
     }
 
     SendMatchingThroughEndpoint(sid, msg, cache.fromRulesId, cache.toRulesId);
@@ -528,7 +557,7 @@ QStatus SessionlessObj::CancelMessage(const qcc::String& sender, uint32_t serial
             if (!it->second.second->IsExpired()) {
                 status = ER_OK;
             }
-            localCache.erase(it);
+            EraseLocalMessage(it);
             messageErased = true;
             break;
         }
@@ -571,7 +600,7 @@ void SessionlessObj::NameOwnerChanged(const String& name,
         SessionlessMessageKey key(oldOwner->c_str(), "", "", "");
         LocalCache::iterator mit = localCache.lower_bound(key);
         while ((mit != localCache.end()) && (::strcmp(oldOwner->c_str(), mit->second.second->GetSender()) == 0)) {
-            localCache.erase(mit++);
+            EraseLocalMessage(mit++);
         }
         /* Alert the advertiser worker if the local cache is empty */
         if (localCache.empty()) {
@@ -686,37 +715,47 @@ void SessionlessObj::DoSessionLost(SessionId sid, SessionLostReason reason)
 
     RemoteCaches::iterator cit = FindRemoteCache(sid);
     if (cit != remoteCaches.end()) {
-        RemoteCache& cache = cit->second;
-        /* Reset in progress */
-        cache.state = RemoteCache::IDLE;
-        cache.sid = 0;
-
-        if (reason == ALLJOYN_SESSIONLOST_REMOTE_END_LEFT_SESSION) {
-            /* We got all the signals */
-            cache.retries = 0;
-            cache.routedMessages.clear();
-            if (IS_GREATER(uint32_t, cache.toRulesId - 1, cache.appliedRulesId)) {
-                cache.appliedRulesId = cache.toRulesId - 1;
-            }
-            if (IS_GREATER(uint32_t, cache.toChangeId - 1, cache.receivedChangeId)) {
-                cache.receivedChangeId = cache.toChangeId - 1;
-                cache.haveReceived = true;
-            }
-
-            /* Get the sessions rolling if necessary */
-            ScheduleWork();
-        } else {
-            /* An error occurred while getting the signals, so retry */
-            if (ScheduleWork(cache) != ER_OK) {
-                /* Retries exhausted. Clear state and wait for new advertisment */
-                EraseRemoteCache(cit);
-            }
-        }
+        /*
+         * A batched range is only complete once the final RangeBatch has been
+         * received, after which we leave the session ourselves.
+         */
+        bool received = (reason == ALLJOYN_SESSIONLOST_REMOTE_END_LEFT_SESSION) && !cit->second.batched;
+        FinishRemoteCacheWork(cit, received);
     }
 
     lock.Unlock();
 }
 
+void SessionlessObj::FinishRemoteCacheWork(RemoteCaches::iterator cit, bool received)
+{
+    RemoteCache& cache = cit->second;
+    /* Reset in progress */
+    cache.state = RemoteCache::IDLE;
+    cache.sid = 0;
+
+    if (received) {
+        /* We got all the signals */
+        cache.retries = 0;
+        cache.routedMessages.clear();
+        if (IS_GREATER(uint32_t, cache.toRulesId - 1, cache.appliedRulesId)) {
+            cache.appliedRulesId = cache.toRulesId - 1;
+        }
+        if (IS_GREATER(uint32_t, cache.toChangeId - 1, cache.receivedChangeId)) {
+            cache.receivedChangeId = cache.toChangeId - 1;
+            cache.haveReceived = true;
+        }
+
+        /* Get the sessions rolling if necessary */
+        ScheduleWork();
+    } else {
+        /* An error occurred while getting the signals, so retry */
+        if (ScheduleWork(cache) != ER_OK) {
+            /* Retries exhausted. Clear state and wait for new advertisment */
+            EraseRemoteCache(cit);
+        }
+    }
+}
+
 void SessionlessObj::RequestSignalsSignalHandler(const InterfaceDescription::Member* member,
                                                  const char* sourcePath,
                                                  Message& msg)
@@ -770,15 +809,132 @@ void SessionlessObj::RequestRangeMatchSignalHandler(const InterfaceDescription::
     }
 }
 
+void SessionlessObj::RequestRangeBatchSignalHandler(const InterfaceDescription::Member* member,
+                                                    const char* sourcePath,
+                                                    Message& msg)
+{
+    uint32_t fromId, toId;
+    size_t numMatchRuleArgs;
+    const MsgArg* matchRuleArgs;
+    QStatus status = msg->GetArgs("uuas", &fromId, &toId, &numMatchRuleArgs, &matchRuleArgs);
+    if (status == ER_OK) {
+        QCC_DbgPrintf(("RequestRangeBatch(sender=%s,sid=%u,fromId=%u,toId=%u,numMatchRules=%d)",
+                       msg->GetSender(), msg->GetSessionId(), fromId, toId, numMatchRuleArgs));
+        vector<String> matchRules;
+        for (size_t i = 0; i < numMatchRuleArgs; ++i) {
+            char* matchRule;
+            matchRuleArgs[i].Get("s", &matchRule);
+            QCC_DbgPrintf(("  [%d] %s", i, matchRule));
+            matchRules.push_back(matchRule);
+        }
+        HandleRangeRequest(msg->GetSender(), msg->GetSessionId(), fromId, toId, 0, 0, matchRules, true);
+    } else {
+        QCC_LogError(status, ("Message::GetArgs failed"));
+    }
+}
+
+void SessionlessObj::RangeBatchSignalHandler(const InterfaceDescription::Member* member,
+                                             const char* sourcePath,
+                                             Message& msg)
+{
+    size_t numMsgArgs;
+    const MsgArg* msgArgs;
+    bool final;
+    QStatus status = msg->GetArgs("aayb", &numMsgArgs, &msgArgs, &final);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Message::GetArgs failed"));
+        return;
+    }
+    SessionId sid = msg->GetSessionId();
+    QCC_DbgPrintf(("RangeBatch(sender=%s,sid=%u,numMsgs=%d,final=%d)", msg->GetSender(), sid, numMsgArgs, final));
+
+    lock.Lock();
+    RemoteCaches::iterator cit = FindRemoteCache(sid);
+    if ((sid == 0) || (cit == remoteCaches.end()) || !cit->second.batched) {
+        lock.Unlock();
+        QCC_LogError(ER_WARNING, ("Received RangeBatch on unexpected sid %u, ignoring", sid));
+        return;
+    }
+    String guid = cit->second.guid;
+    lock.Unlock();
+
+    /*
+     * Each element is a complete marshaled sessionless signal.  Route it as if
+     * it had been received by itself over the session.
+     */
+    String rcvEndpointName = msg->GetRcvEndpointName();
+    for (size_t i = 0; i < numMsgArgs; ++i) {
+        uint8_t* buf;
+        size_t len;
+        status = msgArgs[i].Get("ay", &len, &buf);
+        Message batchedMsg(bus);
+        if (status == ER_OK) {
+            status = batchedMsg->LoadBytes(buf, len);
+        }
+        if (status == ER_OK) {
+            status = batchedMsg->Unmarshal(rcvEndpointName, false, false);
+        }
+        if (status == ER_BUS_TIME_TO_LIVE_EXPIRED) {
+            continue;
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to unmarshal batched message on sid %u", sid));
+            continue;
+        }
+        String sender = batchedMsg->GetSender();
+        if ((batchedMsg->GetType() != MESSAGE_SIGNAL) || !batchedMsg->IsSessionless() ||
+            (sender.substr(1, sender.find_last_of('.') - 1) != guid)) {
+            QCC_LogError(ER_BUS_BAD_HDR_FLAGS, ("Batched message %s on sid %u is not a sessionless signal from %s",
+                                                batchedMsg->Description().c_str(), sid, guid.c_str()));
+            continue;
+        }
+        RouteSessionlessMessage(sid, batchedMsg);
+    }
+
+    if (final) {
+        lock.Lock();
+        cit = FindRemoteCache(sid);
+        if (cit != remoteCaches.end()) {
+            FinishRemoteCacheWork(cit, true);
+        }
+        lock.Unlock();
+
+        bus.EnableConcurrentCallbacks();
+        status = bus.LeaveSession(sid);
+        if (status == ER_OK) {
+            QCC_DbgPrintf(("LeaveSession(sid=%u)", sid));
+        } else {
+            QCC_LogError(status, ("LeaveSession sid=%u failed", sid));
+        }
+    }
+}
+
 void SessionlessObj::HandleRangeRequest(const char* sender, SessionId sid,
                                         uint32_t fromChangeId, uint32_t toChangeId,
                                         uint32_t fromLocalRulesId, uint32_t toLocalRulesId,
-                                        std::vector<qcc::String> remoteRules)
+                                        const std::vector<qcc::String>& remoteRules,
+                                        bool batched)
 {
     QStatus status = ER_OK;
     bool messageErased = false;
     QCC_DbgTrace(("SessionlessObj::HandleControlSignal(%d, %d)", fromChangeId, toChangeId));
 
+    /*
+     * Parse the remote rules once up front instead of for every message in
+     * the range.  The legacy rule is sent by older daemons to mean "send
+     * everything".
+     */
+    bool matchAll = remoteRules.empty();
+    vector<Rule> compiledRules;
+    for (vector<String>::const_iterator rit = remoteRules.begin(); !matchAll && (rit != remoteRules.end()); ++rit) {
+        Rule rule(rit->c_str());
+        if (rule == legacyRule) {
+            matchAll = true;
+        } else {
+            compiledRules.push_back(rule);
+        }
+    }
+
     /* Enable concurrency since PushMessage could block */
     bus.EnableConcurrentCallbacks();
 
@@ -790,43 +946,72 @@ void SessionlessObj::HandleRangeRequest(const char* sender, SessionId sid,
         advanceChangeId = false;
     }
 
-    /* Send all messages in local cache in range [fromChangeId, toChangeId) */
-    LocalCache::iterator it = localCache.begin();
+    /*
+     * Send all messages in local cache in range [fromChangeId, toChangeId).
+     * The range may wrap around, in which case the scan continues from the
+     * beginning of changeIdIndex.  The locks are released while sending, so
+     * the scan resumes after the last visited entry rather than holding on
+     * to an iterator.
+     */
     uint32_t rangeLen = toChangeId - fromChangeId;
-    while (it != localCache.end()) {
-        if (IN_WINDOW(uint32_t, fromChangeId, rangeLen, it->second.first)) {
-            SessionlessMessageKey key = it->first;
-            if (it->second.second->IsExpired()) {
-                /* Remove expired message without sending */
-                localCache.erase(it++);
-                messageErased = true;
-            } else if (sid != 0) {
-                /* Send message to remote destination */
-                bool isMatch = remoteRules.empty();
-                for (vector<String>::iterator rit = remoteRules.begin(); !isMatch && (rit != remoteRules.end()); ++rit) {
-                    Rule rule(rit->c_str());
-                    isMatch = rule.IsMatch(it->second.second) || (rule == legacyRule);
+    bool wrapped = false;
+    BusEndpoint batchEp;
+    vector<Message> batch;
+    if (batched && (sid != 0)) {
+        batchEp = router.FindEndpoint(sender);
+    }
+    ChangeIdIndex::iterator iit = changeIdIndex.lower_bound(pair<uint32_t, SessionlessMessageKey>(fromChangeId, SessionlessMessageKey()));
+    while (true) {
+        if (iit == changeIdIndex.end()) {
+            if (wrapped || (static_cast<uint32_t>(fromChangeId + rangeLen) >= fromChangeId)) {
+                break;
+            }
+            wrapped = true;
+            iit = changeIdIndex.begin();
+            continue;
+        }
+        if (!IN_WINDOW(uint32_t, fromChangeId, rangeLen, iit->first)) {
+            break;
+        }
+        ChangeIdIndex::value_type entry = *iit;
+        LocalCache::iterator it = localCache.find(entry.second);
+        if (it == localCache.end()) {
+            /* Not expected, changeIdIndex is kept in step with localCache */
+            iit = changeIdIndex.upper_bound(entry);
+            continue;
+        }
+        if (it->second.second->IsExpired()) {
+            /* Remove expired message without sending */
+            EraseLocalMessage(it);
+            messageErased = true;
+        } else if (sid != 0) {
+            /* Send message to remote destination */
+            bool isMatch = matchAll;
+            for (vector<Rule>::const_iterator rit = compiledRules.begin(); !isMatch && (rit != compiledRules.end()); ++rit) {
+                isMatch = rit->IsMatch(it->second.second);
+            }
+            if (isMatch && batched) {
+                /* Collect the range while holding the locks, send it afterwards */
+                if (batchEp->IsValid() && OKToReceive(it->second.second, batchEp)) {
+                    batch.push_back(it->second.second);
                 }
-                if (isMatch) {
-                    BusEndpoint ep = router.FindEndpoint(sender);
-                    if (ep->IsValid()) {
-                        lock.Unlock();
-                        router.UnlockNameTable();
-                        QCC_DbgPrintf(("Send cid=%u,serialNum=%u to sid=%u", it->second.first, it->second.second->GetCallSerial(), sid));
-                        SendThroughEndpoint(it->second.second, ep, sid);
-                        router.LockNameTable();
-                        lock.Lock();
-                    }
+            } else if (isMatch) {
+                BusEndpoint ep = router.FindEndpoint(sender);
+                if (ep->IsValid()) {
+                    Message msg = it->second.second;
+                    lock.Unlock();
+                    router.UnlockNameTable();
+                    QCC_DbgPrintf(("Send cid=%u,serialNum=%u to sid=%u", entry.first, msg->GetCallSerial(), sid));
+                    SendThroughEndpoint(msg, ep, sid);
+                    router.LockNameTable();
+                    lock.Lock();
                 }
-                it = localCache.upper_bound(key);
-            } else {
-                /* Send message to local destination */
-                SendMatchingThroughEndpoint(sid, it->second.second, fromLocalRulesId, toLocalRulesId);
-                it = localCache.upper_bound(key);
             }
         } else {
-            ++it;
+            /* Send message to local destination */
+            SendMatchingThroughEndpoint(sid, it->second.second, fromLocalRulesId, toLocalRulesId);
         }
+        iit = changeIdIndex.upper_bound(entry);
     }
     lock.Unlock();
     router.UnlockNameTable();
@@ -838,6 +1023,15 @@ void SessionlessObj::HandleRangeRequest(const char* sender, SessionId sid,
         status = timer.AddAlarm(Alarm(zero, slObj));
     }
 
+    if ((sid != 0) && batched) {
+        /* The requestor closes the session once it has the final batch */
+        status = SendRangeBatch(sender, sid, batch);
+        if (status == ER_OK) {
+            return;
+        }
+        QCC_LogError(status, ("SendRangeBatch to %s failed", sender));
+    }
+
     /* Close the session */
     if (sid != 0) {
         status = bus.LeaveSession(sid);
@@ -884,7 +1078,7 @@ void SessionlessObj::AlarmTriggered(const Alarm& alarm, QStatus reason)
         LocalCache::iterator it = localCache.begin();
         while (it != localCache.end()) {
             if (it->second.second->IsExpired(&expire)) {
-                localCache.erase(it++);
+                EraseLocalMessage(it++);
             } else {
                 ++it;
             }
@@ -972,7 +1166,9 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId sid, const SessionO
         uint32_t toId = cache.toChangeId;
         bool rangeCapable = false;
         bool matchCapable = false;
+        bool batchCapable = false;
         vector<String> matchRules;
+        cache.batched = false;
         if (status == ER_OK) {
             /* Update session ID */
             cache.sid = sid;
@@ -986,6 +1182,9 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId sid, const SessionO
                     matchCapable = (rep->GetRemoteProtocolVersion() >= 10);
                 }
             }
+            /* Only version 2 and later implementations understand RequestRangeBatch */
+            batchCapable = matchCapable && (cache.version >= 2);
+            cache.batched = batchCapable;
             if (!rangeCapable && (toId != cache.changeId + 1)) {
                 /* This session can't be used because the remote side doesn't support RequestRange */
                 bus.LeaveSession(sid);
@@ -1025,7 +1224,9 @@ void SessionlessObj::JoinSessionCB(QStatus status, SessionId sid, const SessionO
              * RequestRange since it may be possible to receive duplicates when
              * RequestSignals is used together with RequestRange.
              */
-            if (matchCapable) {
+            if (batchCapable) {
+                status = RequestRangeBatch(ctx->name.c_str(), sid, fromId, toId, matchRules);
+            } else if (matchCapable) {
                 status = RequestRangeMatch(ctx->name.c_str(), sid, fromId, toId, matchRules);
             } else if (rangeCapable) {
                 status = RequestRange(ctx->name.c_str(), sid, fromId, toId);
@@ -1118,20 +1319,75 @@ QStatus SessionlessObj::RequestRangeMatch(const char* name, SessionId sid, uint3
     return Signal(name, sid, *requestRangeMatchSignal, args, ArraySize(args));
 }
 
-QStatus SessionlessObj::SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sid)
+QStatus SessionlessObj::RequestRangeBatch(const char* name, SessionId sid, uint32_t fromId, uint32_t toId,
+                                          std::vector<qcc::String>& matchRules)
 {
-    QStatus status;
+    MsgArg args[3];
+    args[0].Set("u", fromId);
+    args[1].Set("u", toId);
+    args[2].Set("a$", matchRules.size(), matchRules.empty() ? NULL : &matchRules[0]);
+    QCC_DbgPrintf(("RequestRangeBatch(name=%s,sid=%u,fromId=%d,toId=%d,numRules=%d)", name, sid, fromId, toId, matchRules.size()));
+    return Signal(name, sid, *requestRangeBatchSignal, args, ArraySize(args));
+}
+
+QStatus SessionlessObj::SendRangeBatch(const char* name, SessionId sid, std::vector<Message>& msgs)
+{
+    QStatus status = ER_OK;
+    size_t begin = 0;
+    while (status == ER_OK) {
+        /* Fill the next batch, leaving out any signal too large to batch */
+        size_t end = begin;
+        size_t batchLen = 0;
+        while ((end < msgs.size()) && (msgs[end]->GetBufferSize() <= MAX_RANGE_BATCH_LEN) &&
+               (batchLen + msgs[end]->GetBufferSize() <= MAX_RANGE_BATCH_LEN)) {
+            batchLen += msgs[end]->GetBufferSize();
+            ++end;
+        }
+        bool final = (end == msgs.size());
+
+        vector<MsgArg> elements(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            elements[i - begin].Set("ay", msgs[i]->GetBufferSize(), msgs[i]->GetBuffer());
+        }
+        MsgArg args[2];
+        args[0].Set("aay", elements.size(), elements.empty() ? NULL : &elements[0]);
+        args[1].Set("b", final);
+        if (!elements.empty() || final) {
+            QCC_DbgPrintf(("RangeBatch(name=%s,sid=%u,numMsgs=%d,len=%d,final=%d)", name, sid, elements.size(), batchLen, final));
+            status = Signal(name, sid, *rangeBatchSignal, args, ArraySize(args));
+        }
+        if (final) {
+            break;
+        }
+
+        /* Send a signal too large to batch on its own */
+        if ((status == ER_OK) && (msgs[end]->GetBufferSize() > MAX_RANGE_BATCH_LEN)) {
+            BusEndpoint ep = router.FindEndpoint(name);
+            status = ep->IsValid() ? SendThroughEndpoint(msgs[end], ep, sid) : ER_BUS_NO_ENDPOINT;
+            ++end;
+        }
+        begin = end;
+    }
+    return status;
+}
 
+bool SessionlessObj::OKToReceive(Message& msg, BusEndpoint& ep)
+{
 #ifdef ENABLE_POLICYDB
     PolicyDB policyDB = ConfigDB::GetConfigDB()->GetPolicyDB();
     BusEndpoint dummy;
     NormalizedMsgHdr nmh(msg, policyDB, dummy);
-    bool okToReceive = policyDB->OKToReceive(nmh, ep);
+    return policyDB->OKToReceive(nmh, ep);
 #else
-    bool okToReceive = true;
+    return true;
 #endif
+}
+
+QStatus SessionlessObj::SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sid)
+{
+    QStatus status;
 
-    if (!okToReceive) {
+    if (!OKToReceive(msg, ep)) {
         status = ER_BUS_POLICY_VIOLATION;
     } else if (ep->GetEndpointType() == ENDPOINT_TYPE_VIRTUAL) {
         status = VirtualEndpoint::cast(ep)->PushMessage(msg, sid);
@@ -1428,12 +1684,34 @@ bool SessionlessObj::SendResponseIfMatch(TransportMask transport, const qcc::IPE
     Rule rule(ruleStr.c_str());
     String name;
     lock.Lock();
-    for (LocalCache::iterator mit = localCache.begin(); mit != localCache.end(); ++mit) {
-        Message& msg = mit->second.second;
-        if (rule.IsMatch(msg)) {
-            name = AdvertisedName(msg->GetInterface(), lastAdvertisements[msg->GetInterface()]);
-            sendResponse = true;
-            break;
+    if (rule.implements.empty()) {
+        for (LocalCache::iterator mit = localCache.begin(); mit != localCache.end(); ++mit) {
+            Message& msg = mit->second.second;
+            if (rule.IsMatch(msg)) {
+                name = AdvertisedName(msg->GetInterface(), lastAdvertisements[msg->GetInterface()]);
+                sendResponse = true;
+                break;
+            }
+        }
+    } else {
+        /*
+         * Only announcements of an interface matching the first implements
+         * pattern can match the rule, so let the index pick the candidates
+         * instead of unmarshaling every cached message.
+         */
+        set<SessionlessMessageKey> keys;
+        implementsIndex.Match(*rule.implements.begin(), keys);
+        for (set<SessionlessMessageKey>::iterator kit = keys.begin(); kit != keys.end(); ++kit) {
+            LocalCache::iterator mit = localCache.find(*kit);
+            if (mit == localCache.end()) {
+                continue;
+            }
+            Message& msg = mit->second.second;
+            if (rule.IsMatch(msg)) {
+                name = AdvertisedName(msg->GetInterface(), lastAdvertisements[msg->GetInterface()]);
+                sendResponse = true;
+                break;
+            }
         }
     }
     lock.Unlock();
@@ -1453,6 +1731,42 @@ bool SessionlessObj::SendResponseIfMatch(TransportMask transport, const qcc::IPE
     return sendResponse;
 }
 
+void SessionlessObj::IndexImplements(const SessionlessMessageKey& key, Message& msg, bool add)
+{
+    set<String> interfaces;
+    if (Rule::GetAnnouncedInterfaces(msg, interfaces) != ER_OK) {
+        return;
+    }
+    for (set<String>::const_iterator iit = interfaces.begin(); iit != interfaces.end(); ++iit) {
+        if (add) {
+            implementsIndex.Insert(*iit, key);
+        } else {
+            implementsIndex.Remove(*iit, key);
+        }
+    }
+}
+
+void SessionlessObj::InsertLocalMessage(const SessionlessMessageKey& key, const SessionlessMessage& val)
+{
+    LocalCache::iterator it = localCache.find(key);
+    if (it == localCache.end()) {
+        it = localCache.insert(pair<SessionlessMessageKey, SessionlessMessage>(key, val)).first;
+    } else {
+        IndexImplements(key, it->second.second, false);
+        changeIdIndex.erase(pair<uint32_t, SessionlessMessageKey>(it->second.first, key));
+        it->second = val;
+    }
+    changeIdIndex.insert(pair<uint32_t, SessionlessMessageKey>(val.first, key));
+    IndexImplements(key, it->second.second, true);
+}
+
+void SessionlessObj::EraseLocalMessage(LocalCache::iterator it)
+{
+    IndexImplements(it->first, it->second.second, false);
+    changeIdIndex.erase(pair<uint32_t, SessionlessMessageKey>(it->second.first, it->first));
+    localCache.erase(it);
+}
+
 bool SessionlessObj::ResponseHandler(TransportMask transport, MDNSPacket response, uint16_t recvPort)
 {
     MDNSResourceRecord* advRecord;
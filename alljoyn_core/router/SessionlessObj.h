@@ -38,6 +38,7 @@
 #include "Bus.h"
 #include "DaemonRouter.h"
 #include "NameTable.h"
+#include "NameTrie.h"
 #include "RuleTable.h"
 #include "Transport.h"
 #include "ns/IpNameService.h"
@@ -221,6 +222,28 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
                                         const char* sourcePath,
                                         Message& msg);
 
+    /**
+     * Process incoming RequestRangeBatch signals from remote daemons.
+     *
+     * @param member        Interface member for signal
+     * @param sourcePath    object path sending the signal.
+     * @param msg           The signal message.
+     */
+    void RequestRangeBatchSignalHandler(const InterfaceDescription::Member* member,
+                                        const char* sourcePath,
+                                        Message& msg);
+
+    /**
+     * Process incoming RangeBatch signals from remote daemons.
+     *
+     * @param member        Interface member for signal
+     * @param sourcePath    object path sending the signal.
+     * @param msg           The signal message.
+     */
+    void RangeBatchSignalHandler(const InterfaceDescription::Member* member,
+                                 const char* sourcePath,
+                                 Message& msg);
+
   private:
     friend struct RemoteCacheSnapshot;
 
@@ -243,7 +266,9 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
      * emitting the signals.
      *
      * When sid is non-0, rules in the remote rules are applied before emitting
-     * the signals.
+     * the signals.  When batched is also true the signals are sent in
+     * RangeBatch signals instead of one by one, and the requestor is left to
+     * leave the session once it has received the final batch.
      *
      * @param sender           Unique name of requestor/sender
      * @param sid              Session ID
@@ -252,11 +277,13 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
      * @param fromLocalRulesId Beginning of rules ID range (inclusive)
      * @param toLocalRulesId   End of rules ID range (exclusive)
      * @param remoteRules      Remotely-supplied rules to apply
+     * @param batched          Send the signals in RangeBatch signals
      */
     void HandleRangeRequest(const char* sender, SessionId sid,
                             uint32_t fromId, uint32_t toId,
                             uint32_t fromLocalRulesId = 0, uint32_t toLocalRulesId = 0,
-                            std::vector<qcc::String> remoteRules = std::vector<qcc::String>());
+                            const std::vector<qcc::String>& remoteRules = std::vector<qcc::String>(),
+                            bool batched = false);
 
     /**
      * SessionLost helper handler.
@@ -280,12 +307,16 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
     const InterfaceDescription::Member* requestSignalsSignal;    /**< org.alljoyn.sl.RequestSignal signal */
     const InterfaceDescription::Member* requestRangeSignal;      /**< org.alljoyn.sl.RequestRange signal */
     const InterfaceDescription::Member* requestRangeMatchSignal; /**< org.alljoyn.sl.RequestRangeMatch signal */
+    const InterfaceDescription::Member* requestRangeBatchSignal; /**< org.alljoyn.sl.RequestRangeBatch signal */
+    const InterfaceDescription::Member* rangeBatchSignal;        /**< org.alljoyn.sl.RangeBatch signal */
 
     qcc::Timer timer;                     /**< Timer object for reaping expired names */
 
     /** A key into the local sessionless message queue */
     class SessionlessMessageKey : public qcc::String {
       public:
+        /** The empty key, which orders before every other key */
+        SessionlessMessageKey() { }
         SessionlessMessageKey(const char* sender, const char* iface, const char* member, const char* objPath) :
             qcc::String(sender, 0, ::strlen(sender) + ::strlen(iface) + ::strlen(member) + ::strlen(objPath) + 4)
         {
@@ -303,11 +334,25 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
     /** Storage for sessionless messages waiting to be delivered */
     LocalCache localCache;
 
+    typedef std::set<std::pair<uint32_t, SessionlessMessageKey> > ChangeIdIndex;
+    /**
+     * Index of the keys in localCache ordered by change ID, used to answer
+     * range requests without visiting every cached message.
+     */
+    ChangeIdIndex changeIdIndex;
+
+    /**
+     * Index from the interfaces announced by the org.alljoyn.About.Announce
+     * signals in localCache to their keys, used to answer implements queries.
+     */
+    NameTrie<SessionlessMessageKey> implementsIndex;
+
     struct RoutedMessage {
         RoutedMessage(const Message& msg) : sender(msg->GetSender()), serial(msg->GetCallSerial()) { }
         qcc::String sender;
         uint32_t serial;
         bool operator==(const RoutedMessage& other) const { return (sender == other.sender) && (serial == other.serial); }
+        bool operator<(const RoutedMessage& other) const { return (serial < other.serial) || ((serial == other.serial) && (sender < other.sender)); }
     };
 
     class RemoteCache {
@@ -315,7 +360,7 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
         RemoteCache(const qcc::String& name, uint32_t version, const qcc::String& guid, const qcc::String& iface, uint32_t changeId, TransportMask transport) :
             name(name), version(version), guid(guid), changeId(changeId), transport(transport), haveReceived(false),
             receivedChangeId(std::numeric_limits<uint32_t>::max()), appliedRulesId(std::numeric_limits<uint32_t>::max()),
-            state(IDLE), retries(0), sid(0) {
+            state(IDLE), batched(false), retries(0), sid(0) {
             ifaces.insert(iface);
         }
 
@@ -341,11 +386,12 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
             IDLE = 0,
             IN_PROGRESS
         } state;
+        bool batched; /* true when the work item was requested with RequestRangeBatch */
         uint32_t retries;
         qcc::Timespec firstJoinTime;
         qcc::Timespec nextJoinTime;
         SessionId sid;
-        std::list<RoutedMessage> routedMessages;
+        std::set<RoutedMessage> routedMessages;
     };
 
     typedef std::map<qcc::String, RemoteCache> RemoteCaches;
@@ -358,6 +404,15 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
     /** Erase info associated with the remote cache */
     void EraseRemoteCache(RemoteCaches::iterator cit);
 
+    /**
+     * Finish the work item of a remote cache, either recording the range as
+     * received or scheduling a retry.  Must be called with lock held.
+     *
+     * @param cit       The remote cache
+     * @param received  true if all the signals in the range were received
+     */
+    void FinishRemoteCacheWork(RemoteCaches::iterator cit, bool received);
+
     qcc::Mutex lock;            /**< Mutex that protects this object's data structures */
     uint32_t curChangeId;       /**< Change id assoc with current pushed signal(s) */
     bool isDiscoveryStarted;    /**< True when FindAdvetiseName is ongoing */
@@ -416,6 +471,36 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
      */
     QStatus RequestRangeMatch(const char* name, SessionId sid, uint32_t fromId, uint32_t toId, std::vector<qcc::String>& matchRules);
 
+    /**
+     * Internal helper for sending the RequestRangeBatch signal.
+     *
+     * @param[in] name        Advertised name of sender
+     * @param[in] sid         Session ID
+     * @param[in] fromId      Beginning of changeId range (inclusive)
+     * @param[in] toId        End of changeId range (exclusive)
+     * @param[in] matchRules  Match rules to apply to changeId range
+     */
+    QStatus RequestRangeBatch(const char* name, SessionId sid, uint32_t fromId, uint32_t toId, std::vector<qcc::String>& matchRules);
+
+    /**
+     * Internal helper for sending a range of sessionless signals in
+     * RangeBatch signals.  The last RangeBatch signal sent is marked final.
+     *
+     * @param[in] name  Unique name of the requestor
+     * @param[in] sid   Session ID
+     * @param[in] msgs  The sessionless signals in the range
+     */
+    QStatus SendRangeBatch(const char* name, SessionId sid, std::vector<Message>& msgs);
+
+    /**
+     * Internal helper for checking that policy allows an endpoint to receive
+     * a sessionless signal.
+     *
+     * @param[in] msg The sessionless signal
+     * @param[in] ep The destination endpoint
+     */
+    bool OKToReceive(Message& msg, BusEndpoint& ep);
+
     /**
      * Internal helper for sending sessionless signals.
      *
@@ -595,6 +680,23 @@ class SessionlessObj : public BusObject, public NameListener, public SessionList
     bool QueryHandler(TransportMask transport, MDNSPacket query, uint16_t recvPort,
                       const qcc::IPEndpoint& ns4);
     bool SendResponseIfMatch(TransportMask transport, const qcc::IPEndpoint& ns4, const qcc::String& ruleStr);
+
+    /*
+     * Add (or remove) the interfaces announced by a message in the local cache
+     * to (or from) implementsIndex.  Must be called with lock held.
+     */
+    void IndexImplements(const SessionlessMessageKey& key, Message& msg, bool add);
+
+    /*
+     * Put a message in the local cache, replacing any message with the same
+     * key.  Must be called with lock held.
+     */
+    void InsertLocalMessage(const SessionlessMessageKey& key, const SessionlessMessage& val);
+
+    /*
+     * Remove a message from the local cache.  Must be called with lock held.
+     */
+    void EraseLocalMessage(LocalCache::iterator it);
     bool ResponseHandler(TransportMask transport, MDNSPacket response, uint16_t recvPort);
 
     void FoundAdvertisedNameHandler(const char* name, TransportMask transport, const char* prefix, bool doInitialBackoff = true);
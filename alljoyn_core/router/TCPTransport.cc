@@ -281,33 +281,43 @@
  * and create a TCPEndpoint for the *proposed* new connection.  Recall
  * that an endpoint is not brought up immediately, but an authentication step
  * must be performed.  The server accept loop starts this process by placing the
- * new TCPEndpoint on an authList, or list of authenticating endpoints.
- * It then calls the endpoint Authenticate() method which spins up an
- * authentication thread and returns immediately.  This process transfers the
- * responsibility for the connection and its resources to the authentication
- * thread.  Authentication can succeed, fail, or take to long and be aborted.
+ * new TCPEndpoint on an authList, or list of authenticating endpoints, and at
+ * the back of an authQueue of endpoints waiting to authenticate.  Whenever a
+ * thread of the bounded auth thread pool is free, the first endpoint in the
+ * authQueue that has sent us something has its Authenticate() method called,
+ * which hands an auth task to the pool and returns immediately.  This process
+ * transfers the responsibility for the connection and its resources to the
+ * auth task.  Authentication can succeed, fail, or take to long and be aborted.
+ * Since the pool is bounded, a storm of incoming connections costs us queue
+ * entries and sockets, not threads.
  *
- * If authentication succeeds, the authentication thread calls back into the
+ * An auth task never blocks waiting for the remote side.  It runs the
+ * authentication exchange as far as the data already received allows and, if
+ * the remote side has not sent enough yet, puts the endpoint back in line on
+ * the authQueue and gives its thread back to the pool.  The endpoint gets a
+ * thread again once it has sent more, so clients that trickle bytes at us, or
+ * send one and then go quiet, cannot tie up the pool.
+ *
+ * If authentication succeeds, the auth task calls back into the
  * TCPTransport's Authenticated() method.  Along with indicating that
  * authentication has completed successfully, this transfers ownership of the
- * TCPEndpoint back to the TCPTransport from the authentication
- * thread.  At this time, the TCPEndpoint is Start()ed which spins up
- * the transmit and receive threads and enables Message routing across the
- * transport.
+ * TCPEndpoint back to the TCPTransport from the auth task.  At this time,
+ * the TCPEndpoint is Start()ed which registers it with IODispatch and enables
+ * Message routing across the transport.
  *
- * If the authentication fails, the authentication thread simply sets a the
- * TCPEndpoint state to FAILED and exits.  The server accept loop looks at
- * authenticating endpoints (those on the authList)each time through its loop.
- * If an endpoint has failed authentication, and its thread has actually gone
- * away (or more precisely is at least going away in such a way that it will
- * never touch the endpoint data structure again).  This means that the endpoint
- * can be deleted.
+ * If the authentication fails, the auth task simply sets a the TCPEndpoint
+ * state to FAILED and gives its thread back to the pool.  The server accept
+ * loop looks at authenticating endpoints (those on the authList) each time
+ * through its loop.  If an endpoint has failed authentication, the task has
+ * promised never to touch the endpoint data structure again.  This means that
+ * the endpoint can be deleted.
  *
- * If the authentication takes "too long" we assume that a denial of service
- * attack in in progress.  We call AuthStop() on such an endpoint which will most
- * likely induce a failure (unless we happen to call abort just as the endpoint
- * actually finishes the authentication which is highly unlikely but okay).
- * This AuthStop() will cause the endpoint to be scavenged using the above mechanism
+ * If the authentication (or the wait for a pool thread) takes "too long" we
+ * assume that a denial of service attack in in progress.  We call AuthStop() on
+ * such an endpoint which shuts down its socket and will most likely induce a
+ * failure (unless we happen to call abort just as the endpoint actually
+ * finishes the authentication which is highly unlikely but okay).  This
+ * AuthStop() will cause the endpoint to be scavenged using the above mechanism
  * the next time through the accept loop.
  *
  * A daemon transport can accept incoming connections, and it can make outgoing
@@ -350,17 +360,17 @@
  *
  *   1) Threads that may be running in the server accept loop with associated Events
  *      and their dependent socketFds stored in the listenFds list.
- *   2) Threads that may be running authentication with associated endpoint objects,
- *      streams and SocketFds.  These threads are accessible through endpoint objects
+ *   2) Auth pool threads that may be running authentication with associated
+ *      endpoint objects, streams and SocketFds.  These endpoint objects are
  *      stored on the authList.
  *   3) Unregistering the endpoint from IODispatch that stops any future read/write callbacks
  *      from occuring and schedules a ExitCallback that can be used for clean up.
  *
- * Note that we also have to understand and deal with the fact that threads
- * running in state (2) above, will exit and depend on the server accept loop to
- * scavenge the associated objects off of the authList and delete them.  This
- * means that the server accept loop cannot be Stop()ped until the authList is
- * empty.  We further have to understand that read/write callbacks running in state (3) above
+ * Note that we also have to understand and deal with the fact that auth tasks
+ * running in state (2) above, will finish and depend on the server accept loop
+ * to scavenge the associated objects off of the authList and delete them.  This
+ * means that the authList cannot be cleared until the auth thread pool is
+ * joined.  We further have to understand that read/write callbacks running in state (3) above
  * will depend on the hooked EndpointExit function to dispose of associated
  * resources.  This will happen in the context of either the IODispatch callbacks (the last to go).
  * We can't delete the transport until all of its
@@ -410,22 +420,22 @@ class _TCPEndpoint : public _RemoteEndpoint {
   public:
     friend class TCPTransport;
     /**
-     * There are three threads that can be running around in this data
-     * structure.  An auth thread is run before the endpoint is started in order
-     * to handle the security stuff that must be taken care of before messages
-     * can start passing.  This enum reflects the states of the authentication
-     * process and the state can be found in m_authState.  Once authentication
-     * is complete, the auth thread must go away, but it must also be joined,
-     * which is indicated by the AUTH_DONE state.  The state of Read and Write
+     * Before the endpoint is started, an authentication task is run on one of
+     * the threads of the transport's auth thread pool in order to handle the
+     * security stuff that must be taken care of before messages can start
+     * passing.  This enum reflects the states of the authentication process and
+     * the state can be found in m_authState.  Once authentication is complete,
+     * the auth task hands the endpoint back to the server accept loop, which
+     * is indicated by the AUTH_DONE state.  The state of Read and Write
      * callbacks is dealt with by the EndpointState.
      */
     enum AuthState {
         AUTH_ILLEGAL = 0,
-        AUTH_INITIALIZED,    /**< This endpoint structure has been allocated but no auth thread has been run */
-        AUTH_AUTHENTICATING, /**< We have spun up an authentication thread and it has begun running our user function */
-        AUTH_FAILED,         /**< The authentication has failed and the authentication thread is exiting immidiately */
+        AUTH_INITIALIZED,    /**< This endpoint is waiting in line and no auth task is running on it */
+        AUTH_AUTHENTICATING, /**< We have handed an auth task to the auth thread pool */
+        AUTH_FAILED,         /**< The authentication has failed and the auth task will not touch the endpoint again */
         AUTH_SUCCEEDED,      /**< The auth process (Establish) has succeeded and the connection is ready to be started */
-        AUTH_DONE,           /**< The auth thread has been successfully shut down and joined */
+        AUTH_DONE,           /**< The auth task is finished and the server accept loop owns the endpoint */
     };
 
     /**
@@ -475,7 +485,9 @@ class _TCPEndpoint : public _RemoteEndpoint {
         m_authState(AUTH_INITIALIZED),
         m_epState(EP_INITIALIZED),
         m_tStart(qcc::Timespec(0)),
-        m_authThread(this),
+        m_authStopped(false),
+        m_authReadable(false),
+        m_authNulRead(false),
         m_stream(sock),
         m_ipAddr(ipAddr),
         m_port(port),
@@ -493,7 +505,9 @@ class _TCPEndpoint : public _RemoteEndpoint {
         m_authState(AUTH_INITIALIZED),
         m_epState(EP_INITIALIZED),
         m_tStart(qcc::Timespec(0)),
-        m_authThread(this),
+        m_authStopped(false),
+        m_authReadable(false),
+        m_authNulRead(false),
         m_stream(family, type),
         m_ipAddr(ipAddr),
         m_port(port),
@@ -518,9 +532,8 @@ class _TCPEndpoint : public _RemoteEndpoint {
 
     void SetStartTime(qcc::Timespec tStart) { m_tStart = tStart; }
     qcc::Timespec GetStartTime(void) { return m_tStart; }
-    QStatus Authenticate(void);
+    QStatus Authenticate(qcc::ThreadPool& pool);
     void AuthStop(void);
-    void AuthJoin(void);
     const qcc::IPAddress& GetIPAddress() { return m_ipAddr; }
     uint16_t GetPort() { return m_port; }
 
@@ -539,6 +552,15 @@ class _TCPEndpoint : public _RemoteEndpoint {
 
     AuthState GetAuthState(void) { return m_authState; }
 
+    bool IsAuthReadable(void) { return m_authReadable; }
+    void SetAuthReadable(void) { m_authReadable = true; }
+
+    void SetAuthWaiting(void)
+    {
+        m_authReadable = false;
+        m_authState = AUTH_INITIALIZED;
+    }
+
     void SetAuthDone(void)
     {
         Timespec tNow;
@@ -596,60 +618,47 @@ class _TCPEndpoint : public _RemoteEndpoint {
         return status;
     }
 
+  private:
     /*
-     * Return true if the auth thread is STARTED, RUNNING or STOPPING.  A true
-     * response means the authentication thread is in a state that indicates
-     * a possibility it might touch the endpoint data structure.  This means
-     * don't delete the endpoint if this method returns true.  This method
-     * indicates nothing about endpoint Read and WriteCallback state.
+     * The closure handed to the auth thread pool.  It runs as much of the SASL
+     * and Hello exchange for one endpoint as the data already received allows
+     * and then goes away; the pool thread is returned to the pool for the next
+     * connection in line.
      */
-    bool IsAuthThreadRunning(void)
-    {
-        return m_authThread.IsRunning();
-    }
-    virtual void ThreadExit(qcc::Thread* thread);
-
-  private:
-    class AuthThread : public qcc::Thread {
+    class AuthTask : public qcc::Runnable {
       public:
-        AuthThread(_TCPEndpoint* ep) : Thread("auth"), m_endpoint(ep)  { }
+        AuthTask(_TCPEndpoint* ep) : m_endpoint(ep) { }
+        virtual void Run(void);
       private:
-        virtual qcc::ThreadReturn STDCALL Run(void* arg);
-
         _TCPEndpoint* m_endpoint;
     };
 
+    void RunAuthentication(void);
+
     TCPTransport* m_transport;        /**< The server holding the connection */
     volatile SideState m_sideState;   /**< Is this an active or passive connection */
     volatile AuthState m_authState;   /**< The state of the endpoint authentication process */
     volatile EndpointState m_epState; /**< The state of the endpoint authentication process */
     qcc::Timespec m_tStart;           /**< Timestamp indicating when the authentication process started */
-    AuthThread m_authThread;          /**< Thread used to do blocking calls during startup */
+    bool m_authStopped;               /**< True once AuthStop() has shut down the socket under the auth task */
+    bool m_authReadable;              /**< True once the remote side has sent something for the auth task to read */
+    bool m_authNulRead;               /**< True once the auth task has eaten the leading NUL byte */
     qcc::SocketStream m_stream;       /**< Stream used by authentication code */
     qcc::IPAddress m_ipAddr;          /**< Remote IP address. */
     uint16_t m_port;                  /**< Remote port. */
     bool m_wasSuddenDisconnect;       /**< If true, assumption is that any disconnect is unexpected due to lower level error */
 };
 
-void _TCPEndpoint::ThreadExit(qcc::Thread* thread)
-{
-    /* If the auth thread exits before it even enters the AuthThread::Run() function, set the state to AUTH_FAILED. */
-    if (thread == &m_authThread) {
-        if (m_authState == AUTH_INITIALIZED) {
-            m_authState = AUTH_FAILED;
-        }
-        m_transport->Alert();
-    }
-    _RemoteEndpoint::ThreadExit(thread);
-}
-
-QStatus _TCPEndpoint::Authenticate(void)
+QStatus _TCPEndpoint::Authenticate(qcc::ThreadPool& pool)
 {
     QCC_DbgTrace(("TCPEndpoint::Authenticate()"));
     /*
-     * Start the authentication thread.
+     * Hand an authentication task to the auth thread pool.  The server accept
+     * loop only calls us when it knows a pool thread is available, so a
+     * failure here means the pool is going away.
      */
-    QStatus status = m_authThread.Start(this, this);
+    m_authState = AUTH_AUTHENTICATING;
+    QStatus status = pool.Execute(Ptr<Runnable>(new AuthTask(this)));
     if (status != ER_OK) {
         m_authState = AUTH_FAILED;
     }
@@ -661,183 +670,162 @@ void _TCPEndpoint::AuthStop(void)
     QCC_DbgTrace(("TCPEndpoint::AuthStop()"));
 
     /*
-     * Ask the auth thread to stop executing.  The only ways out of the thread
-     * run function will set the state to either AUTH_SUCCEEDED or AUTH_FAILED.
-     * There is a very small chance that we will send a stop to the thread after
-     * it has successfully authenticated, but we expect that this will result in
-     * an AUTH_FAILED state for the vast majority of cases.  In this case, we
-     * notice that the thread failed the next time through the main server run
-     * loop, join the thread via AuthJoin below and delete the endpoint.  Note
-     * that this is a lazy cleanup of the endpoint.
+     * An incoming connection that is still waiting in line for a pool thread
+     * has nothing running on it, so we can fail it directly.  The server accept
+     * loop will notice the AUTH_FAILED state and pitch the endpoint.  Outgoing
+     * connections authenticate in the context of the thread calling Connect()
+     * and are dealt with there.
      */
-    m_authThread.Stop();
-}
-
-void _TCPEndpoint::AuthJoin(void)
-{
-    QCC_DbgTrace(("TCPEndpoint::AuthJoin()"));
+    if (m_authState == AUTH_INITIALIZED) {
+        if (m_sideState == SIDE_PASSIVE) {
+            m_authState = AUTH_FAILED;
+        }
+        return;
+    }
 
     /*
-     * Join the auth thread to stop executing.  All threads must be joined in
-     * order to communicate their return status.  The auth thread is no exception.
-     * This is done in a lazy fashion from the main server accept loop, where we
-     * cleanup every time through the loop.
+     * An auth task that is running only reads what the remote side has
+     * already sent, but it may be pushing a response.  The pool thread belongs
+     * to the pool, not to us, so rather than stopping it we shut down the
+     * socket underneath it.  The next read or write returns an error and the
+     * task finishes with AUTH_FAILED, which we notice the next time through
+     * the main server run loop.  There is a very small chance that we do this
+     * just after the endpoint has authenticated, which will cause the new
+     * connection to fail.  This is okay.
      */
-    m_authThread.Join();
+    if (m_authState == AUTH_AUTHENTICATING && !m_authStopped) {
+        m_authStopped = true;
+        qcc::Shutdown(m_stream.GetSocketFd());
+    }
 }
 
-void* _TCPEndpoint::AuthThread::Run(void* arg)
+void _TCPEndpoint::AuthTask::Run(void)
 {
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run()"));
+    m_endpoint->RunAuthentication();
+}
 
-    m_endpoint->m_authState = AUTH_AUTHENTICATING;
+void _TCPEndpoint::RunAuthentication(void)
+{
+    QCC_DbgTrace(("TCPEndpoint::RunAuthentication()"));
 
     /*
-     * We're running an authentication process here and we are cooperating with
-     * the main server thread.  This thread is running in an object that is
-     * allocated on the heap, and the server is managing these objects so we
-     * need to coordinate getting all of this cleaned up.
+     * We're running an authentication process here on a thread borrowed from
+     * the transport's auth thread pool and we are cooperating with the main
+     * server thread.  This endpoint is allocated on the heap, and the server
+     * is managing these objects so we need to coordinate getting all of this
+     * cleaned up.
      *
-     * There is a state variable that only we write.  The server thread only
-     * reads this variable, so there are no data sharing issues.  If there is an
-     * authentication failure, this thread sets that state variable to
-     * AUTH_FAILED and then exits.  The server holds a list of currently
-     * authenticating connections and will look for AUTH_FAILED connections when
-     * it runs its Accept loop.  If it finds one, it will AuthJoin() this
-     * thread.  Since we set AUTH_FAILED immediately before exiting, there will
-     * be no problem having the server block waiting for the Join() to complete.
-     * We fail authentication here and let the server clean up after us, lazily.
+     * There is a state variable that only we write while we are running.  The
+     * server thread only reads this variable, so there are no data sharing
+     * issues.  If there is an authentication failure, we set that state
+     * variable to AUTH_FAILED and return the thread to the pool.  The server
+     * holds a list of currently authenticating connections and will look for
+     * AUTH_FAILED connections when it runs its Accept loop.  If it finds one,
+     * it will delete the endpoint.
      *
-     * If we succeed in the authentication process, we set the state variable
-     * to AUTH_SUCEEDED and then call back into the server telling it that we are
-     * up and running.  It needs to take us off of the list of authenticating
-     * connections and put us on the list of running connections.  This thread
-     * will quickly go away and will be replaced by the Read and WriteCallbacks of
-     * the running RemoteEndpoint.
+     * If we succeed in the authentication process, we call back into the server
+     * telling it that we are up and running and then set the state variable to
+     * AUTH_SUCCEEDED.  The server needs to take us off of the list of
+     * authenticating connections and put us on the list of running connections.
+     * The Read and WriteCallbacks of the running RemoteEndpoint take over from
+     * here.
      *
-     * If we are running an authentication process, we are probably ultimately
-     * blocked on a socket.  We expect that if the server is asked to shut
-     * down, it will run through its list of authenticating connections and
-     * AuthStop() each one.  That will cause a thread Stop() which should unblock
-     * all of the reads and return an error which will eventually pop out here
-     * with an authentication failure.
-     *
-     * Finally, if the server decides we've spent too much time here and we are
-     * actually a denial of service attack, it can close us down by doing an
-     * AuthStop() on the authenticating endpoint.  This will do a thread Stop()
-     * on the auth thread of the endpoint which will pop out of here as an
-     * authentication failure as well.  The only ways out of this method must be
-     * with state = AUTH_FAILED or state = AUTH_SUCCEEDED.
-     */
-    uint8_t byte;
-    size_t nbytes;
+     * We never block waiting for the remote side.  All reads are made with a
+     * zero timeout, and if the remote side has not sent enough for the
+     * exchange to go any further, we hand the endpoint back to the server
+     * accept loop to wait in line for more data and return the thread to the
+     * pool.  The EndpointAuth keeps track of how far the exchange got.  If the
+     * server decides we've spent too much time authenticating (we are actually
+     * a denial of service attack) or is asked to shut down, it will AuthStop()
+     * the endpoint, which shuts the socket down and fails the next read.  The
+     * only ways out of this method must be by handing the endpoint back, or
+     * with state = AUTH_FAILED or state = AUTH_SUCCEEDED, and as soon as
+     * that is done we are not allowed to touch the endpoint again.
+     */
+    TCPTransport* transport = m_transport;
+    QStatus status = ER_OK;
 
-    /*
-     * Eat the first byte of the stream.  This is required to be zero by the
-     * DBus protocol.  It is used in the Unix socket implementation to carry
-     * out-of-band capabilities, but is discarded here.  We do this here since
-     * it involves a read that can block.
-     */
-    QStatus status = m_endpoint->m_stream.PullBytes(&byte, 1, nbytes);
-    if ((status != ER_OK) || (nbytes != 1) || (byte != 0)) {
-        QCC_LogError(status, ("Failed to read first byte from stream"));
+    if (!m_authNulRead) {
+        uint8_t byte;
+        size_t nbytes;
 
         /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
+         * Eat the first byte of the stream.  This is required to be zero by
+         * the DBus protocol.  It is used in the Unix socket implementation to
+         * carry out-of-band capabilities, but is discarded here.
          */
-        m_endpoint->m_authState = AUTH_FAILED;
-        return (void*)ER_FAIL;
-    }
+        status = m_stream.PullBytes(&byte, 1, nbytes, 0);
+        if (status == ER_TIMEOUT) {
+            status = ER_WOULDBLOCK;
+        } else if ((status != ER_OK) || (nbytes != 1) || (byte != 0)) {
+            status = (status == ER_OK) ? ER_FAIL : status;
+            QCC_LogError(status, ("Failed to read first byte from stream"));
+        } else {
+            m_authNulRead = true;
 
-    /* Initialized the features for this endpoint */
-    m_endpoint->GetFeatures().isBusToBus = false;
-    m_endpoint->GetFeatures().isBusToBus = false;
-    m_endpoint->GetFeatures().handlePassing = false;
+            /* Initialized the features for this endpoint */
+            GetFeatures().isBusToBus = false;
+            GetFeatures().handlePassing = false;
 
-    /* Run the actual connection authentication code. */
-    qcc::String authName;
-    qcc::String redirection;
-    DaemonRouter& router = reinterpret_cast<DaemonRouter&>(m_endpoint->m_transport->m_bus.GetInternal().GetRouter());
-    AuthListener* authListener = router.GetBusController()->GetAuthListener();
-    /* Since the TCPTransport allows untrusted clients, it must implement UntrustedClientStart and
-     * UntrustedClientExit.
-     * As a part of Establish, the endpoint can call the Transport's UntrustedClientStart method if
-     * it is an untrusted client, so the transport MUST call m_endpoint->SetListener before calling Establish
-     * Note: This is only required on the accepting end i.e. for incoming endpoints.
-     */
-    m_endpoint->SetListener(m_endpoint->m_transport);
-    if (authListener) {
-        status = m_endpoint->Establish("ALLJOYN_PIN_KEYX ANONYMOUS", authName, redirection, authListener);
-    } else {
-        status = m_endpoint->Establish("ANONYMOUS", authName, redirection, authListener);
+            /* Since the TCPTransport allows untrusted clients, it must implement UntrustedClientStart and
+             * UntrustedClientExit.
+             * As a part of establishment, the endpoint can call the Transport's UntrustedClientStart method if
+             * it is an untrusted client, so the transport MUST call SetListener before establishing.
+             * Note: This is only required on the accepting end i.e. for incoming endpoints.
+             */
+            SetListener(transport);
+        }
     }
-    if (status != ER_OK) {
-        QCC_LogError(status, ("Failed to establish TCP endpoint"));
 
+    if (status == ER_OK) {
+        /* Run the actual connection authentication code as far as it will go. */
+        qcc::String authName;
+        DaemonRouter& router = reinterpret_cast<DaemonRouter&>(transport->m_bus.GetInternal().GetRouter());
+        AuthListener* authListener = router.GetBusController()->GetAuthListener();
+        if (authListener) {
+            status = TryEstablish("ALLJOYN_PIN_KEYX ANONYMOUS", authName, authListener);
+        } else {
+            status = TryEstablish("ANONYMOUS", authName, authListener);
+        }
+        if ((status != ER_OK) && (status != ER_WOULDBLOCK)) {
+            QCC_LogError(status, ("Failed to establish TCP endpoint"));
+        }
+    }
+
+    if (status == ER_WOULDBLOCK) {
         /*
-         * Management of the resources used by the authentication thread is done
-         * in one place, by the server Accept loop.  The authentication thread
-         * writes its state into the connection and the server Accept loop reads
-         * this state.  As soon as we set this state to AUTH_FAILED, we are
-         * telling the Accept loop that we are done with the conn data
-         * structure.  That thread is then free to do anything it wants with the
-         * connection, including deleting it, so we are not allowed to touch
-         * conn after setting this state.
-         *
-         * In addition to releasing responsibility for the conn data structure,
-         * when we set the state to AUTH_SUCCEEDED we are telling the server
-         * accept loop that we are exiting now and so it can Join() on us (the
-         * authentication thread) without being worried about blocking since the
-         * next thing we do is exit.
+         * The remote side has not sent enough yet.  Get back in line.
          */
-        m_endpoint->m_authState = AUTH_FAILED;
-        return (void*)status;
+        TCPEndpoint tcpEp = TCPEndpoint::wrap(this);
+        transport->AuthTaskWouldBlock(tcpEp);
+        return;
     }
 
-    /*
-     * Tell the transport that the authentication has succeeded and that it can
-     * now bring the connection up.
-     */
-    TCPEndpoint tcpEp = TCPEndpoint::wrap(m_endpoint);
-    m_endpoint->m_transport->Authenticated(tcpEp);
+    if (status == ER_OK) {
+        /*
+         * Tell the transport that the authentication has succeeded and that it can
+         * now bring the connection up.
+         */
+        TCPEndpoint tcpEp = TCPEndpoint::wrap(this);
+        transport->Authenticated(tcpEp);
+    }
 
-    QCC_DbgTrace(("TCPEndpoint::AuthThread::Run(): Returning"));
+    QCC_DbgTrace(("TCPEndpoint::RunAuthentication(): Returning"));
 
     /*
-     * We are now done with the authentication process.  We have succeeded doing
-     * the authentication and we may or may not have succeeded in starting the
-     * endpoint TX and RX threads depending on what happened down in
-     * Authenticated().  What concerns us here is that we are done with this
-     * thread (the authentication thread) and we are about to exit.  Before
-     * exiting, we must tell server accept loop that we are done with this data
-     * structure.  As soon as we set this state to AUTH_SUCCEEDED that thread is
-     * then free to do anything it wants with the connection, including deleting
-     * it, so we are not allowed to touch conn after setting this state.
-     *
-     * In addition to releasing responsibility for the conn data structure, when
-     * we set the state to AUTH_SUCCEEDED we are telling the server accept loop
-     * that we are exiting now and so it can Join() the authentication thread
-     * without being worried about blocking since the next thing we do is exit.
+     * We are now done with the authentication process.  Before giving the
+     * thread back to the pool, we must tell server accept loop that we are
+     * done with this data structure.  As soon as we set this state to
+     * AUTH_SUCCEEDED or AUTH_FAILED that thread is then free to do anything it
+     * wants with the connection, including deleting it, so we are not allowed
+     * to touch the endpoint after setting this state.
      */
-    m_endpoint->m_authState = AUTH_SUCCEEDED;
-    return (void*)status;
+    m_authState = (status == ER_OK) ? AUTH_SUCCEEDED : AUTH_FAILED;
+    transport->AuthTaskDone();
 }
 
 TCPTransport::TCPTransport(BusAttachment& bus)
-    : Thread("TCPTransport"), m_bus(bus), m_stopping(false), m_listener(0),
+    : Thread("TCPTransport"), m_bus(bus), m_stopping(false), m_listener(0), m_authPool(NULL), m_authTasks(0),
     m_foundCallback(m_listener), m_networkEventCallback(*this),
     m_isAdvertising(false), m_isDiscovering(false), m_isListening(false),
     m_isNsEnabled(false), m_reload(STATE_RELOADING),
@@ -857,6 +845,39 @@ TCPTransport::~TCPTransport()
     QCC_DbgTrace(("TCPTransport::~TCPTransport()"));
     Stop();
     Join();
+    delete m_authPool;
+}
+
+void TCPTransport::AuthTaskDone(void)
+{
+    QCC_DbgTrace(("TCPTransport::AuthTaskDone()"));
+    /*
+     * A thread is on its way back to the pool, so wake up the server accept
+     * loop to scavenge the finished endpoint and dispatch the next one in line.
+     */
+    DecrementAndFetch(&m_authTasks);
+    Alert();
+}
+
+void TCPTransport::AuthTaskWouldBlock(TCPEndpoint& conn)
+{
+    QCC_DbgTrace(("TCPTransport::AuthTaskWouldBlock()"));
+
+    /*
+     * The endpoint goes to the back of the line and the server accept loop
+     * waits for it to become readable again before handing it another pool
+     * thread.  If it was AuthStop()ped while the task was running there is no
+     * point; fail it so that ManageEndpoints() scavenges it.
+     */
+    m_endpointListLock.Lock(MUTEX_CONTEXT);
+    if (conn->m_authStopped) {
+        conn->m_authState = _TCPEndpoint::AUTH_FAILED;
+    } else {
+        conn->SetAuthWaiting();
+        m_authQueue.push_back(conn);
+    }
+    m_endpointListLock.Unlock(MUTEX_CONTEXT);
+    AuthTaskDone();
 }
 
 void TCPTransport::Authenticated(TCPEndpoint& conn)
@@ -871,7 +892,7 @@ void TCPTransport::Authenticated(TCPEndpoint& conn)
     }
     /*
      * If Authenticated() is being called, it is as a result of the
-     * authentication thread telling us that it has succeeded.  What we need to
+     * authentication task telling us that it has succeeded.  What we need to
      * do here is to try and Start() the endpoint which will set up
      * Read and WriteCallbacks and register the endpoint with the daemon router.
      * As soon as we call Start(), we are transferring responsibility for error reporting
@@ -977,6 +998,17 @@ QStatus TCPTransport::Start()
     m_nsReleaseCount = 0;
     IpNameService::Instance().Acquire(guidStr);
 
+    /*
+     * Incoming connections are authenticated on a bounded pool of threads so
+     * that a storm of connection requests cannot make us spin up a thread per
+     * connection.  Connections that arrive while all of the threads are busy
+     * wait in line on m_authQueue.
+     */
+    if (m_authPool == NULL) {
+        uint32_t maxAuthThreads = ConfigDB::GetConfigDB()->GetLimit("max_auth_threads", ALLJOYN_MAX_AUTH_THREADS_TCP_DEFAULT);
+        m_authPool = new ThreadPool("TCPAuth", maxAuthThreads ? maxAuthThreads : 1);
+    }
+
     /*
      * Tell the name service to call us back on our FoundCallback method when
      * we hear about a new well-known bus name.
@@ -1045,17 +1077,23 @@ QStatus TCPTransport::Stop(void)
     }
 
     /*
-     * Ask any authenticating endpoints to shut down and exit their threads.  By its
-     * presence on the m_authList, we know that the endpoint is authenticating and
-     * the authentication thread has responsibility for dealing with the endpoint
-     * data structure.  We call Stop() to stop that thread from running.  The
-     * endpoint Read and WriteCallbacks will not be running yet.
+     * Ask any authenticating endpoints to shut down.  By its presence on the
+     * m_authList, we know that the endpoint is authenticating or waiting in
+     * line to authenticate and an auth task may have responsibility for
+     * dealing with the endpoint data structure.  AuthStop() fails the next
+     * read or write of any running task.  The endpoint Read and WriteCallbacks will not be
+     * running yet.  We then ask the auth thread pool to stop, which drops any
+     * tasks that have not started running yet.
      */
     for (set<TCPEndpoint>::iterator i = m_authList.begin(); i != m_authList.end(); ++i) {
         TCPEndpoint ep = *i;
         ep->AuthStop();
     }
 
+    if (m_authPool) {
+        m_authPool->Stop();
+    }
+
     /*
      * Ask any running endpoints to shut down and exit their threads.  By its
      * presence on the m_endpointList, we know that authentication is compete and
@@ -1108,39 +1146,40 @@ QStatus TCPTransport::Join(void)
      * running in those endpoints actually stop running.
      *
      * Since Stop() is a request to stop, and this is what has ultimately been
-     * done to both authentication threads and Read and WriteCallbacks, it is possible
+     * done to both authentication tasks and Read and WriteCallbacks, it is possible
      * that a thread is actually running after the call to Stop().  If that
-     * thead happens to be an authenticating endpoint, it is possible that an
+     * thead happens to be authenticating an endpoint, it is possible that an
      * authentication actually completes after Stop() is called.  This will move
      * a connection from the m_authList to the m_endpointList, so we need to
-     * make sure we wait for all of the connections on the m_authList to go away
-     * before we look for the connections on the m_endpointlist.
+     * make sure we wait for all of the auth pool threads to go away before we
+     * look for the connections on the m_endpointlist.
      */
+    if (m_authPool) {
+        m_authPool->Join();
+    }
+
     m_endpointListLock.Lock(MUTEX_CONTEXT);
 
     /*
-     * Any authenticating endpoints have been asked to shut down and exit their
-     * authentication threads in a previously required Stop().  We need to
-     * Join() all of these auth threads here.
+     * No auth task can touch an endpoint once the pool is joined, so anything
+     * left authenticating or waiting in line can simply be dropped, along
+     * with any exchange it left waiting for data.
      */
-    set<TCPEndpoint>::iterator it = m_authList.begin();
-    while (it != m_authList.end()) {
-        TCPEndpoint ep = *it;
-        m_authList.erase(it);
-        m_endpointListLock.Unlock(MUTEX_CONTEXT);
-        ep->AuthJoin();
-        m_endpointListLock.Lock(MUTEX_CONTEXT);
-        it = m_authList.upper_bound(ep);
+    for (set<TCPEndpoint>::iterator i = m_authList.begin(); i != m_authList.end(); ++i) {
+        TCPEndpoint ep = *i;
+        ep->AbortEstablish();
     }
+    m_authQueue.clear();
+    m_authList.clear();
 
 
     /*
      * Any running endpoints have been asked it their threads in a previously
      * required Stop().  We need to Join() all of thesse threads here.  This
      * Join() will wait on the endpoint Read and WriteCallbacks to exit as opposed to
-     * the joining of the auth thread we did above.
+     * the joining of the auth thread pool we did above.
      */
-    it = m_endpointList.begin();
+    set<TCPEndpoint>::iterator it = m_endpointList.begin();
     while (it != m_endpointList.end()) {
         TCPEndpoint ep = *it;
         m_endpointList.erase(it);
@@ -1450,17 +1489,16 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
 
         if (authState == _TCPEndpoint::AUTH_FAILED) {
             /*
-             * The endpoint has failed authentication and the auth thread is
-             * gone or is going away.  Since it has failed there is no way this
-             * endpoint is going to be started so we can get rid of it as soon
-             * as we Join() the (failed) authentication thread.
+             * The endpoint has failed authentication and the auth task has
+             * promised not to touch it again.  Since it has failed there is no
+             * way this endpoint is going to be started so we can get rid of it.
+             * If it failed while waiting in line, DispatchAuthenticators() drops
+             * it from the m_authQueue below.  Any exchange it left waiting for
+             * data holds a reference to the endpoint, so let go of that too.
              */
             QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
-            m_authList.erase(i);
-            m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
-            m_endpointListLock.Lock(MUTEX_CONTEXT);
-            i = m_authList.upper_bound(ep);
+            ep->AbortEstablish();
+            m_authList.erase(i++);
             continue;
         }
 
@@ -1469,26 +1507,29 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
 
         if (ep->GetStartTime() + authTimeout < tNow) {
             /*
-             * This endpoint is taking too long to authenticate.  Stop the
-             * authentication process.  The auth thread is still running, so we
-             * can't just delete the connection, we need to let it stop in its
-             * own time.  What that thread will do is to set AUTH_FAILED and
-             * exit.  we will then clean it up the next time through this loop.
-             * In the hope that the thread can exit and we can catch its exit
-             * here and now, we take our thread off the OS ready list (Sleep)
-             * and let the other thread run before looping back.
+             * This endpoint is taking too long to authenticate (or to get a
+             * pool thread).  Stop the authentication process.  An auth
+             * task may still be running, so we can't just delete the
+             * connection, we need to let it stop in its own time.  What that
+             * task will do is to set AUTH_FAILED and return its thread to the
+             * pool.  We will then clean it up the next time through this loop.
              */
             QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging slow authenticator"));
             ep->AuthStop();
-            qcc::Sleep(1);
         }
         ++i;
     }
 
+    /*
+     * Threads may have come back to the auth thread pool, so give them to the
+     * connections waiting in line.
+     */
+    DispatchAuthenticators();
+
     /*
      * We've handled the authList, so now run through the list of connections on
-     * the endpointList and cleanup any that are no longer running or Join()
-     * authentication threads that have successfully completed.
+     * the endpointList and cleanup any that are no longer running or take
+     * ownership of endpoints whose auth tasks have successfully completed.
      */
     i = m_endpointList.begin();
     while (i != m_endpointList.end()) {
@@ -1509,20 +1550,16 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
 
         if (authState == _TCPEndpoint::AUTH_SUCCEEDED) {
             /*
-             * The endpoint has succeeded authentication and the auth thread is
-             * gone or is going away.  Take this opportunity to join the auth
-             * thread.  Since the auth thread promised not to touch the state
-             * after setting AUTH_SUCCEEEDED, we can safely change the state
-             * here since we now own the conn.  We do this through a method call
-             * to enable this single special case where we are allowed to set
-             * the state.
+             * The endpoint has succeeded authentication and the auth task has
+             * given its thread back to the pool.  Since the auth task promised
+             * not to touch the state after setting AUTH_SUCCEEEDED, we can
+             * safely change the state here since we now own the conn.  We do
+             * this through a method call to enable this single special case
+             * where we are allowed to set the state.
              */
-            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Scavenging failed authenticator"));
-            m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
+            QCC_DbgHLPrintf(("TCPTransport::ManageEndpoints(): Taking ownership of authenticated endpoint"));
             ep->SetAuthDone();
-            m_endpointListLock.Lock(MUTEX_CONTEXT);
-            i = m_endpointList.upper_bound(ep);
+            ++i;
             continue;
         }
         /*
@@ -1551,11 +1588,7 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
          * joined.
          */
         if (endpointState == _TCPEndpoint::EP_FAILED) {
-            m_endpointList.erase(i);
-            m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
-            m_endpointListLock.Lock(MUTEX_CONTEXT);
-            i = m_endpointList.upper_bound(ep);
+            m_endpointList.erase(i++);
             continue;
         }
 
@@ -1568,13 +1601,11 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
          * EndpointExit function.  If we find this, we need to Join
          * the endpoint threads, remove the endpoint from the
          * endpoint list and delete it.  Note that we are calling
-         * the endpoint Join() to join the TX and RX threads and not
-         * the endpoint AuthJoin() to join the auth thread.
+         * the endpoint Join() to join the TX and RX threads.
          */
         if (endpointState == _TCPEndpoint::EP_STOPPING) {
             m_endpointList.erase(i);
             m_endpointListLock.Unlock(MUTEX_CONTEXT);
-            ep->AuthJoin();
             ep->Join();
             m_endpointListLock.Lock(MUTEX_CONTEXT);
             i = m_endpointList.upper_bound(ep);
@@ -1585,6 +1616,53 @@ void TCPTransport::ManageEndpoints(Timespec authTimeout, Timespec sessionSetupTi
     m_endpointListLock.Unlock(MUTEX_CONTEXT);
 }
 
+void TCPTransport::DispatchAuthenticators(void)
+{
+    if (m_authPool == NULL) {
+        return;
+    }
+
+    /*
+     * Endpoints sit on the m_authQueue in the order they were accepted.  The
+     * first ones in line that have data for us to read get the free pool
+     * threads.  Endpoints that were AuthStop()ped while waiting in line are
+     * dropped here.
+     */
+    list<TCPEndpoint>::iterator i = m_authQueue.begin();
+    while (i != m_authQueue.end()) {
+        TCPEndpoint ep = *i;
+        if (ep->GetAuthState() != _TCPEndpoint::AUTH_INITIALIZED) {
+            i = m_authQueue.erase(i);
+            continue;
+        }
+
+        if (!ep->IsAuthReadable()) {
+            ++i;
+            continue;
+        }
+
+        if (static_cast<uint32_t>(m_authTasks) >= m_authPool->GetConcurrency()) {
+            break;
+        }
+
+        /*
+         * A task that has called AuthTaskDone() may not quite have given its
+         * thread back to the pool yet.  That window is a few instructions
+         * long, so we wait it out rather than miss the wakeup.  If we are
+         * alerted in the meantime we will be back here soon enough.
+         */
+        if (m_authPool->WaitForAvailableThread() != ER_OK) {
+            break;
+        }
+
+        i = m_authQueue.erase(i);
+        IncrementAndFetch(&m_authTasks);
+        if (ep->Authenticate(*m_authPool) != ER_OK) {
+            DecrementAndFetch(&m_authTasks);
+        }
+    }
+}
+
 void* TCPTransport::Run(void* arg)
 {
     QCC_DbgTrace(("TCPTransport::Run()"));
@@ -1661,8 +1739,29 @@ void* TCPTransport::Run(void* arg)
         for (list<pair<qcc::String, SocketFd> >::const_iterator i = m_listenFds.begin(); i != m_listenFds.end(); ++i) {
             checkEvents.push_back(new Event(i->second, Event::IO_READ));
         }
+        size_t numListenEvents = checkEvents.size();
         m_listenFdsLock.Unlock(MUTEX_CONTEXT);
 
+        /*
+         * We also wait for the connections waiting in line to say something.
+         * A connection is only given a pool thread once it has data for us to
+         * read, so clients that connect and then sit there cost us a socket
+         * but not a thread.  Once a connection has been seen to be readable it
+         * stays marked as such until it gets its thread, so we stop waiting on
+         * it.  The waiting map holds a reference to each endpoint so that its
+         * source event stays around for as long as we are waiting on it.
+         */
+        map<Event*, TCPEndpoint> waiting;
+        m_endpointListLock.Lock(MUTEX_CONTEXT);
+        for (list<TCPEndpoint>::iterator i = m_authQueue.begin(); i != m_authQueue.end(); ++i) {
+            if (((*i)->GetAuthState() == _TCPEndpoint::AUTH_INITIALIZED) && !(*i)->IsAuthReadable()) {
+                Event* event = &(*i)->m_stream.GetSourceEvent();
+                waiting.insert(pair<Event*, TCPEndpoint>(event, *i));
+                checkEvents.push_back(event);
+            }
+        }
+        m_endpointListLock.Unlock(MUTEX_CONTEXT);
+
         /*
          * We have our list of events, so now wait for something to happen
          * on that list (or get alerted).
@@ -1671,10 +1770,8 @@ void* TCPTransport::Run(void* arg)
 
         status = Event::Wait(checkEvents, signaledEvents);
         if (ER_OK != status) {
-            for (vector<Event*>::iterator i = checkEvents.begin(); i != checkEvents.end(); ++i) {
-                if (*i != &stopEvent) {
-                    delete *i;
-                }
+            for (size_t i = 1; i < numListenEvents; ++i) {
+                delete checkEvents[i];
             }
             QCC_LogError(status, ("Event::Wait failed"));
             break;
@@ -1690,7 +1787,12 @@ void* TCPTransport::Run(void* arg)
          * the stopEvent will be on the list of signalled events.  The
          * difference can be found by a call to IsStopping() which is found
          * above.  An alert means that a request to start or stop listening
-         * on a given address and port has been queued up for us.
+         * on a given address and port has been queued up for us, or that an
+         * auth task has finished.
+         *
+         * If the source event of a connection waiting in line is signalled,
+         * the connection is ready to be handed to the auth thread pool, which
+         * ManageEndpoints() takes care of.
          */
         for (vector<Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
             /*
@@ -1701,14 +1803,21 @@ void* TCPTransport::Run(void* arg)
                 stopEvent.ResetEvent();
             }
 
-            /*
-             * In order to rationalize management of resources, we manage the
-             * various lists in one place on one thread.  This thread is a
-             * convenient victim, so we do it here.
-             */
-            ManageEndpoints(authTimeout, sessionSetupTimeout);
+            map<Event*, TCPEndpoint>::iterator w = waiting.find(*i);
+            if (w != waiting.end()) {
+                w->second->SetAuthReadable();
+            }
+        }
 
-            if (*i == &stopEvent) {
+        /*
+         * In order to rationalize management of resources, we manage the
+         * various lists in one place on one thread.  This thread is a
+         * convenient victim, so we do it here.
+         */
+        ManageEndpoints(authTimeout, sessionSetupTimeout);
+
+        for (vector<Event*>::iterator i = signaledEvents.begin(); i != signaledEvents.end(); ++i) {
+            if (*i == &stopEvent || waiting.find(*i) != waiting.end()) {
                 continue;
             }
 
@@ -1750,19 +1859,17 @@ void* TCPTransport::Run(void* arg)
                     GetTimeNow(&tNow);
                     conn->SetStartTime(tNow);
                     /*
-                     * By putting the connection on the m_authList, we are
-                     * transferring responsibility for the connection to the
-                     * Authentication thread.  Therefore, we must check that the
-                     * thread actually started running to ensure the handoff
-                     * worked.  If it didn't we need to deal with the connection
-                     * here.  Since there are no threads running we can just
-                     * pitch the connection.
+                     * By putting the connection on the m_authList and in line
+                     * on the m_authQueue, we are transferring responsibility
+                     * for the connection to the auth thread pool.  Once the
+                     * connection has something for us to read and a pool
+                     * thread is free, it is dispatched the next time through
+                     * this loop.  Any failure to hand it off shows up as
+                     * AUTH_FAILED and the connection is pitched by
+                     * ManageEndpoints().
                      */
-                    std::pair<std::set<TCPEndpoint>::iterator, bool> ins = m_authList.insert(conn);
-                    status = conn->Authenticate();
-                    if (status != ER_OK) {
-                        m_authList.erase(ins.first);
-                    }
+                    m_authList.insert(conn);
+                    m_authQueue.push_back(conn);
                     m_endpointListLock.Unlock(MUTEX_CONTEXT);
                 } else {
                     m_endpointListLock.Unlock(MUTEX_CONTEXT);
@@ -1789,12 +1896,11 @@ void* TCPTransport::Run(void* arg)
         /*
          * We're going to loop back and create a new list of checkEvents that
          * reflect the current state, so we need to delete the checkEvents we
-         * created on this iteration.
+         * created on this iteration.  The source events of the connections
+         * waiting in line belong to their streams.
          */
-        for (vector<Event*>::iterator i = checkEvents.begin(); i != checkEvents.end(); ++i) {
-            if (*i != &stopEvent) {
-                delete *i;
-            }
+        for (size_t i = 1; i < numListenEvents; ++i) {
+            delete checkEvents[i];
         }
 
     }
@@ -37,6 +37,7 @@
 #include <qcc/Thread.h>
 #include <qcc/Socket.h>
 #include <qcc/SocketStream.h>
+#include <qcc/ThreadPool.h>
 #include <qcc/time.h>
 
 #include <alljoyn/TransportMask.h>
@@ -298,6 +299,9 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
     bool m_stopping;                                               /**< True if Stop() has been called but endpoints still exist */
     TransportListener* m_listener;                                 /**< Registered TransportListener */
     std::set<TCPEndpoint> m_authList;                              /**< List of authenticating endpoints */
+    std::list<TCPEndpoint> m_authQueue;                            /**< Incoming endpoints waiting for an auth pool thread */
+    qcc::ThreadPool* m_authPool;                                   /**< Bounded pool of threads running authentication tasks */
+    volatile int32_t m_authTasks;                                  /**< Number of auth tasks handed to m_authPool and not yet done */
     std::set<TCPEndpoint> m_endpointList;                          /**< List of active endpoints */
     std::set<Thread*> m_activeEndpointsThreadList;                 /**< List of threads starting up active endpoints */
     qcc::Mutex m_endpointListLock;                                 /**< Mutex that protects the endpoint and auth lists */
@@ -350,6 +354,15 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      */
     void ManageEndpoints(qcc::Timespec authTimeout, qcc::Timespec sessionSetupTimeout);
 
+    /**
+     * @internal
+     * @brief Hand queued incoming endpoints that have data to read to the
+     * auth thread pool for as long as it has threads available.
+     *
+     * Must be called with m_endpointListLock taken.
+     */
+    void DispatchAuthenticators(void);
+
     /**
      * @internal
      * @brief Thread entry point.
@@ -458,6 +471,27 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      */
     void Authenticated(TCPEndpoint& conn);
 
+    /**
+     * @internal
+     * @brief Auth task complete notification.
+     *
+     * Called on an auth pool thread after the task has set the final auth
+     * state of its endpoint.  Frees up a slot for the next queued endpoint.
+     */
+    void AuthTaskDone(void);
+
+    /**
+     * @internal
+     * @brief Auth task waiting for data notification.
+     *
+     * Called on an auth pool thread when the endpoint has not sent enough
+     * for its authentication to go any further.  Puts the endpoint back in
+     * line on m_authQueue to wait for more data and frees up the slot.
+     *
+     * @param conn Reference to the TCPEndpoint that is waiting for data.
+     */
+    void AuthTaskWouldBlock(TCPEndpoint& conn);
+
     /**
      * @internal
      * @brief Normalize a listen specification.
@@ -535,6 +569,19 @@ class TCPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
      */
     static const uint32_t ALLJOYN_MAX_INCOMPLETE_CONNECTIONS_TCP_DEFAULT = 10;
 
+    /**
+     * @brief The default value for the maximum number of threads used to
+     * authenticate incoming connections.
+     *
+     * Incoming connections are authenticated on a bounded thread pool.  If
+     * more than this number of connections are authenticating at once, the
+     * rest wait in line (subject to "auth_timeout") for a thread to free up,
+     * so "max_incomplete_connections" can be raised without creating an OS
+     * thread per connection.  To override this value, change the limit,
+     * "max_auth_threads".
+     */
+    static const uint32_t ALLJOYN_MAX_AUTH_THREADS_TCP_DEFAULT = 8;
+
     /**
      * @brief The default value for the maximum number of TCP connections
      * (remote endpoints).
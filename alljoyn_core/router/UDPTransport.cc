@@ -19,7 +19,11 @@
  *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  ******************************************************************************/
 
+#include <map>
+#include <set>
+
 #include <qcc/platform.h>
+#include <qcc/Condition.h>
 #include <qcc/IPAddress.h>
 #include <qcc/Socket.h>
 #include <qcc/Thread.h>
@@ -447,6 +451,7 @@ const uint32_t UDP_PROBE_TIMEOUT = 10000;   /**< How long to we wait on an idle
 const uint32_t UDP_PROBE_RETRIES = 5;       /**< How many times do we try to probe on an idle link before terminating the connection */
 const uint32_t UDP_DUPACK_COUNTER = 1;      /**< How many duplicate acknowledgements to we need to trigger a data retransmission */
 const uint32_t UDP_TIMEWAIT = 1000;         /**< How long do we stay in TIMWAIT state before releasing the per-connection resources */
+const uint32_t UDP_CONGESTION_CONTROL = ajn::ARDP_CC_NONE; /**< Which ArdpCongestionControl algorithm paces and limits our sends */
 
 namespace ajn {
 
@@ -537,22 +542,24 @@ class ArdpStream : public qcc::Stream {
         m_disc(false),
         m_discSent(false),
         m_discStatus(ER_OK),
-        m_writeEvent(NULL),
+        m_writeCondition(),
         m_writesOutstanding(0),
+        m_writeGeneration(0),
         m_writeWaits(0),
+        m_threadCount(0),
+        m_nonBlocking(false),
+        m_txMessage(NULL),
+        m_txBuf(NULL),
+        m_txLen(0),
+        m_txHeld(),
         m_buffers()
     {
         QCC_DbgTrace(("ArdpStream::ArdpStream()"));
-        m_writeEvent = new qcc::Event();
     }
 
     virtual ~ArdpStream()
     {
         QCC_DbgTrace(("ArdpStream::~ArdpStream()"));
-
-        QCC_DbgPrintf(("ArdpStream::~ArdpStream(): delete events"));
-        delete m_writeEvent;
-        m_writeEvent = NULL;
     }
 
     /**
@@ -640,53 +647,45 @@ class ArdpStream : public qcc::Stream {
     }
 
     /**
-     * Add the currently running thread to a set of threads that may be
-     * currently referencing the internals of the stream.  We need this list to
-     * make sure we don't try to delete the stream if there are threads
-     * currently using the stream, and to wake those threads in case the threads
-     * are blocked waiting for a send to complete when the associated endpoint
-     * is shut down.
+     * Note that the currently running thread may be referencing the internals
+     * of the stream or its endpoint.  We need this count to make sure we don't
+     * try to delete the stream if there are threads currently using the
+     * stream.  Threads that are blocked waiting for a send to complete are
+     * woken by WakeThreadSet() when the associated endpoint is shut down.
      */
     void AddCurrentThread()
     {
         QCC_DbgTrace(("ArdpStream::AddCurrentThread()"));
 
-        ThreadEntry entry;
-        entry.m_thread = qcc::Thread::GetThread();
-        entry.m_stream = this;
         m_lock.Lock(MUTEX_CONTEXT);
-        m_threads.insert(entry);
+        ++m_threadCount;
         m_lock.Unlock(MUTEX_CONTEXT);
     }
 
     /**
-     * Remove the currently running thread from the set of threads that may be
-     * currently referencing the internals of the stream.
+     * Note that the currently running thread is no longer referencing the
+     * internals of the stream.
      */
     void RemoveCurrentThread()
     {
         QCC_DbgTrace(("ArdpStream::RemoveCurrentThread()"));
 
-        ThreadEntry entry;
-        entry.m_thread = qcc::Thread::GetThread();
-        entry.m_stream = this;
-
         m_lock.Lock(MUTEX_CONTEXT);
-        set<ThreadEntry>::iterator i = m_threads.find(entry);
-        assert(i != m_threads.end() && "ArdpStream::RemoveCurrentThread(): Thread not on m_threads");
-        m_threads.erase(i);
+        assert(m_threadCount > 0 && "ArdpStream::RemoveCurrentThread(): No thread in stream");
+        --m_threadCount;
         m_lock.Unlock(MUTEX_CONTEXT);
     }
 
+    /**
+     * Wake every thread that is blocked in PushBytes() so it notices that the
+     * endpoint is going away.
+     */
     void WakeThreadSet()
     {
         QCC_DbgTrace(("ArdpStream::WakeThreadSet()"));
 
         m_lock.Lock(MUTEX_CONTEXT);
-        for (set<ThreadEntry>::iterator i = m_threads.begin(); i != m_threads.end(); ++i) {
-            QCC_DbgTrace(("ArdpStream::Alert(): Wake thread %p waiting on stream %p", i->m_thread, i->m_stream));
-            i->m_stream->m_writeEvent->SetEvent();
-        }
+        m_writeCondition.Broadcast();
         m_lock.Unlock(MUTEX_CONTEXT);
     }
 
@@ -699,7 +698,7 @@ class ArdpStream : public qcc::Stream {
         QCC_DbgTrace(("ArdpStream::ThreadSetEmpty()"));
 
         m_lock.Lock(MUTEX_CONTEXT);
-        bool empty = m_threads.empty();
+        bool empty = (m_threadCount == 0);
         m_lock.Unlock(MUTEX_CONTEXT);
 
         QCC_DbgTrace(("ArdpStream::ThreadSetEmpty(): -> %s", empty ? "true" : "false"));
@@ -747,16 +746,30 @@ class ArdpStream : public qcc::Stream {
     }
 
     /**
-     * Set the stream's write event if it exists
+     * Put the stream into non-blocking mode.  Instead of blocking the caller
+     * when the protocol applies backpressure, PushBytes() returns ER_WOULDBLOCK
+     * without having sent anything and the caller retries after the next send
+     * callback.
      */
-    void SetWriteEvent()
+    void SetNonBlocking(bool nonBlocking)
     {
-        QCC_DbgTrace(("ArdpStream::SetWriteEvent()"));
-        m_lock.Lock(MUTEX_CONTEXT);
-        if (m_writeEvent) {
-            m_writeEvent->SetEvent();
-        }
-        m_lock.Unlock(MUTEX_CONTEXT);
+        QCC_DbgTrace(("ArdpStream::SetNonBlocking(nonBlocking=%d.)", nonBlocking));
+        m_nonBlocking = nonBlocking;
+    }
+
+    /**
+     * Tell the stream which message the bytes handed to PushBytes() come
+     * from.  Bytes that lie in the marshaled buffer of that message are sent
+     * by reference: ARDP fragments the message buffer in place and the stream
+     * holds a reference to the message until the send callback returns the
+     * buffer.  Bytes from anywhere else are copied.  Pass NULL when delivery
+     * of the message is done.
+     */
+    void SetTxMessage(const Message* msg, const uint8_t* buf, size_t len)
+    {
+        m_txMessage = msg;
+        m_txBuf = buf;
+        m_txLen = len;
     }
 
     /**
@@ -781,17 +794,16 @@ class ArdpStream : public qcc::Stream {
      * some data.  In this case we need to block the calling thread until it can
      * continue.
      *
-     * TODO: Note that the blocking is on an endpoint-by-endpoint basis, which
-     * means there is a write event per endpoint.  This could be changed to one
-     * event per transport, but would mean waking all blocked threads only to
-     * have one of them succeed and the rest go back to sleep if the event
-     * wasn't directed at them.  This is the classic thundering herd, but trades
-     * CPU for event resources which may be a good way to go since our events
-     * can be so expensive.  It's a simple change conceptually but there is no
-     * bradcast condition variable in common, which would be the way to go.
+     * Blocked writers park on a condition variable that is part of the stream,
+     * so a blocked endpoint does not cost an OS event.  A send callback wakes
+     * one writer, and a writer that manages to send passes the wakeup on to
+     * the next one, so backpressure being relieved does not wake every writer
+     * only to have all but one of them go back to sleep.  Shutting the
+     * endpoint down or losing the connection wakes them all.
      *
-     * For now, we will take the one event per endpoint approach and optimize
-     * that as time permits.
+     * In non-blocking mode, set by an endpoint that keeps its own transmit
+     * queue, we return ER_WOULDBLOCK instead of blocking and the endpoint
+     * retries when it is told the send window has opened.
      *
      * When a buffer is sent, the ARDP protocol takes ownership of it until it
      * is ACKed by the other side or it times out.  When the ACK happens, a send
@@ -816,29 +828,35 @@ class ArdpStream : public qcc::Stream {
             return status;
         }
 
-        /*
-         * There's a new thread in town, so add it to the list of threads
-         * wandering around in the associated endpoint.  We need to keep track
-         * of this in case the endpoint is stopped while the current thread is
-         * wandering around in the stream trying to get its send done.
-         */
-        AddCurrentThread();
-
 #ifndef NDEBUG
         DumpBytes((uint8_t*)buf, numBytes);
 #endif
         /*
-         * Copy in the bytes to preserve the buffer management approach expected by
-         * higher level code.
+         * ARDP owns the buffer we give it until the send callback.  If the
+         * bytes are part of the marshaled message being delivered, the message
+         * can hold them for us and no copy is needed; otherwise copy in the
+         * bytes to preserve the buffer management approach expected by higher
+         * level code.
          */
-        QCC_DbgPrintf(("ArdpStream::PushBytes(): Copy in"));
+        uint8_t* buffer;
+        bool held = false;
+        if (m_txMessage && m_txBuf) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+            held = bytes >= m_txBuf && bytes + numBytes <= m_txBuf + m_txLen;
+        }
+        if (held) {
+            QCC_DbgPrintf(("ArdpStream::PushBytes(): Send from message buffer"));
+            buffer = const_cast<uint8_t*>(static_cast<const uint8_t*>(buf));
+        } else {
+            QCC_DbgPrintf(("ArdpStream::PushBytes(): Copy in"));
 #ifndef NDEBUG
-        uint8_t* buffer = new uint8_t[numBytes + SEAL_SIZE];
-        SealBuffer(buffer + numBytes);
+            buffer = new uint8_t[numBytes + SEAL_SIZE];
+            SealBuffer(buffer + numBytes);
 #else
-        uint8_t* buffer = new uint8_t[numBytes];
+            buffer = new uint8_t[numBytes];
 #endif
-        memcpy(buffer, buf, numBytes);
+            memcpy(buffer, buf, numBytes);
+        }
 
         /*
          * Set up a timeout on the write.  If we call ARDP_Send, we expect it to
@@ -867,17 +885,32 @@ class ArdpStream : public qcc::Stream {
          * underlying UDP send has failed.  In that case, we give up since
          * presumably something bad has happened, like the Wi-Fi has
          * disassociated or someone has unplugged a cable.
+         *
+         * The stream lock is held across the ARDP_Send() so that a send
+         * callback cannot slip in between the send being refused and this
+         * thread going to sleep.  The lock order (stream lock, then ARDP lock)
+         * is the same one Disconnect() uses.  The thread is counted in the
+         * stream while it is in here, so the lock must be held exactly once
+         * when we wait on the condition.
          */
+        m_lock.Lock(MUTEX_CONTEXT);
+        ++m_threadCount;
+
         while (true) {
             if (m_transport->IsRunning() == false || m_transport->m_stopping == true) {
-#ifndef NDEBUG
-                CheckSeal(buffer + numBytes);
-#endif
-                delete[] buffer;
                 status = ER_UDP_STOPPING;
                 QCC_LogError(status, ("ArdpStream::PushBytes(): UDP Transport not running or stopping"));
-                RemoveCurrentThread();
-                return status;
+                break;
+            }
+
+            /*
+             * If there was a disconnect in the underlying connection, there's
+             * nothing we can do but return the error.
+             */
+            if (m_disc) {
+                status = m_discStatus;
+                QCC_LogError(status, ("ArdpStream::PushBytes(): Disconnected"));
+                break;
             }
 
             Timespec tNow;
@@ -886,16 +919,12 @@ class ArdpStream : public qcc::Stream {
             int32_t tRemaining = tStart + timeout - tNow;
             QCC_DbgPrintf(("ArdpStream::PushBytes(): tRemaining is %d.", tRemaining));
             if (tRemaining <= 0) {
-#ifndef NDEBUG
-                CheckSeal(buffer + numBytes);
-#endif
-                delete[] buffer;
                 status = ER_TIMEOUT;
                 QCC_LogError(status, ("ArdpStream::PushBytes(): Timed out"));
-                RemoveCurrentThread();
-                return status;
+                break;
             }
 
+            uint32_t generation = m_writeGeneration;
             m_transport->m_ardpLock.Lock();
             status = ARDP_Send(m_handle, m_conn, buffer, numBytes, ttl);
             m_transport->m_ardpLock.Unlock();
@@ -917,149 +946,92 @@ class ArdpStream : public qcc::Stream {
              * kernel.
              */
             if (status == ER_OK) {
-                m_transport->m_cbLock.Lock();
 #if SENT_SANITY
+                m_transport->m_cbLock.Lock();
                 m_sentSet.insert(buffer);
+                m_transport->m_cbLock.Unlock();
 #endif
+                if (held) {
+                    m_txHeld.insert(std::pair<uint8_t* const, Message>(buffer, *m_txMessage));
+                }
+                buffer = NULL;
                 ++m_writesOutstanding;
                 QCC_DbgPrintf(("ArdpStream::PushBytes(): ARDP_Send(): Success. m_writesOutstanding=%d.", m_writesOutstanding));
-                m_transport->m_cbLock.Unlock();
                 numSent = numBytes;
-                RemoveCurrentThread();
-                return status;
+                break;
             }
 
             /*
              * If the send failed, and the failure was not due to the application
              * of backpressure by the protocol, we have a hard failure and we need
-             * to give up.  Since the buffer wasn't sent, the callback won't happen
-             * and we need to dispose of it here and now.
+             * to give up.
              */
             if (status != ER_ARDP_BACKPRESSURE) {
-#ifndef NDEBUG
-                CheckSeal(buffer + numBytes);
-#endif
-                delete[] buffer;
                 QCC_LogError(status, ("ArdpStream::PushBytes(): ARDP_Send(): Hard failure"));
-                RemoveCurrentThread();
-                return status;
+                break;
+            }
+
+            if (m_nonBlocking) {
+                QCC_DbgPrintf(("ArdpStream::PushBytes(): ER_ARDP_BACKPRESSURE. Would block"));
+                status = ER_WOULDBLOCK;
+                break;
             }
 
             /*
              * Backpressure has been applied.  We can't send another message on
              * this connection until the other side ACKs one of the outstanding
-             * datagrams.  It communicates this to us by a send callback which,
-             * in turn, sets an event that wakes us up.
+             * datagrams or opens its receive window.  Either one shows up as a
+             * new write generation (see SendCb() and SendWindowCb()).
              */
-            if (status == ER_ARDP_BACKPRESSURE) {
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): ER_ARDP_BACKPRESSURE"));
-
-                /*
-                 * Multiple threads could conceivably be trying to write at the
-                 * same time another thread fires callbacks, so we have to be
-                 * careful.  If m_writesOutstanding is non-zero, the ARDP
-                 * protocol has a contract with us to call back when writes are
-                 * is complete.  To make sure we are synchronized with the
-                 * callback thread, we release the callback lock during the call
-                 * to Event::Wait().
-                 *
-                 * To make sure only one of the threads does the reset of the
-                 * event (confusing another), we keep track of how many are
-                 * waiting at any one time and only let the first one reset the
-                 * underlying event.  This means that a second waiter could be
-                 * awakened unnecessarily, but it will immediately try agian and
-                 * go back to sleep.
-                 */
-                m_transport->m_cbLock.Lock();
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. m_writesOutstanding=%d.", m_writesOutstanding));
-
-                /*
-                 * It is possible that between the time we called ARDP_Send and
-                 * the time we just took the callback lock immediately above,
-                 * all (especially if the window is one) of the previous sends
-                 * that caused the rejection of the current send has actually
-                 * completed and relieved the backpressure.  Now that we are in
-                 * firm control of the process with the lock taken, check to see
-                 * if there are any writes outstanding.  If there are not, we
-                 * will never get a callback to wake us up, so we need to loop
-                 * back around and see if we can write again.  Since there are
-                 * no writes outstanding, the answer will be yes.
-                 */
-                if (m_writesOutstanding == 0) {
-                    m_transport->m_cbLock.Unlock();
-                    QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure relieved"));
-                    continue;
-                }
-
-                /*
-                 * Multiple threads could conceivably be trying to write at the
-                 * same time another thread fires callbacks, so we have to be
-                 * careful.  To make sure only one of the writer threads does
-                 * the reset of the event (confusing another), we keep track of
-                 * how many are waiting at any one time and only let the first
-                 * one reset the underlying event.  This means that a second
-                 * waiter could be awakened unnecessarily, but it will
-                 * immediately try again and go back to sleep.  To make sure we
-                 * are synchronized with the callback thread, we release the
-                 * callback lock during the call to Event::Wait().
-                 */
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. m_writeWaits=%d.", m_writeWaits));
-                if (m_writeWaits == 0) {
-                    QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. Reset write event"));
-                    m_writeEvent->ResetEvent();
-                }
-                ++m_writeWaits;
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. Event::Wait(). m_writeWaits=%d.", m_writeWaits));
-                status = qcc::Event::Wait(*m_writeEvent, m_transport->m_cbLock, tRemaining);
-                m_transport->m_cbLock.Lock();
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. Back from Event::Wait(). m_writeWaits=%d.", m_writeWaits));
-                --m_writeWaits;
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. Decremented m_writeWaits=%d.", m_writeWaits));
-                m_transport->m_cbLock.Unlock();
-
-                /*
-                 * If the wait fails, then there's nothing we can do but bail.  If we
-                 * never actually started the send sucessfully, the callback will never
-                 * happen and we need to free the buffer we newed here.
-                 */
+            ++m_writeWaits;
+            QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure. m_writesOutstanding=%d., m_writeWaits=%d.", m_writesOutstanding, m_writeWaits));
+            while (generation == m_writeGeneration && m_disc == false && m_transport->m_stopping == false && tRemaining > 0) {
+                status = m_writeCondition.Wait(m_lock, tRemaining);
                 if (status != ER_OK && status != ER_TIMEOUT) {
-#ifndef NDEBUG
-                    CheckSeal(buffer + numBytes);
-#endif
-                    delete[] buffer;
-                    QCC_LogError(status, ("ArdpStream::PushBytes(): WaitWriteEvent() failed"));
-                    RemoveCurrentThread();
-                    return status;
-                }
-
-                /*
-                 * If there was a disconnect in the underlying connection, there's
-                 * nothing we can do but return the error.
-                 */
-                if (m_disc) {
-#ifndef NDEBUG
-                    CheckSeal(buffer + numBytes);
-#endif
-                    delete[] buffer;
-                    QCC_LogError(m_discStatus, ("ArdpStream::PushBytes(): Disconnected"));
-                    RemoveCurrentThread();
-                    return m_discStatus;
+                    break;
                 }
+                GetTimeNow(&tNow);
+                tRemaining = tStart + timeout - tNow;
+            }
+            --m_writeWaits;
 
-                QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure loop"));
+            /*
+             * If the wait fails, then there's nothing we can do but bail.
+             */
+            if (status != ER_OK && status != ER_TIMEOUT) {
+                QCC_LogError(status, ("ArdpStream::PushBytes(): Condition::Wait() failed"));
+                break;
             }
 
             /*
              * We detected backpressure and waited until a callback indicated
-             * that the backpressure was relieved.  We gave up the cb lock,
-             * so now we loop back around and try the ARDP_Send again, maybe
-             * waiting again.
+             * that the backpressure was relieved (or we timed out or were
+             * disconnected), so now we loop back around and try again.
              */
+            QCC_DbgPrintf(("ArdpStream::PushBytes(): Backpressure loop"));
         }
 
-        assert(0 && "ArdpStream::PushBytes(): Impossible condition");
-        RemoveCurrentThread();
-        return ER_FAIL;
+        /*
+         * We may have been the one writer a callback woke up; now that we are
+         * done it is the next writer's turn to see if there is room.
+         */
+        if (m_writeWaits > 0) {
+            m_writeCondition.Signal();
+        }
+        --m_threadCount;
+        m_lock.Unlock(MUTEX_CONTEXT);
+
+        /*
+         * If we never actually started the send sucessfully, the callback will
+         * never happen and we need to free the buffer we newed here.
+         */
+        if (buffer && !held) {
+#ifndef NDEBUG
+            CheckSeal(buffer + numBytes);
+#endif
+            delete[] buffer;
+        }
+        return status;
     }
 
     /*
@@ -1322,6 +1294,14 @@ class ArdpStream : public qcc::Stream {
                 }
             }
         }
+
+        /*
+         * Writers blocked on backpressure will never see their sends complete
+         * on a connection that is gone, so send them all off with the news.
+         */
+        if (m_disc) {
+            m_writeCondition.Broadcast();
+        }
         m_lock.Unlock(MUTEX_CONTEXT);
     }
 
@@ -1334,47 +1314,76 @@ class ArdpStream : public qcc::Stream {
     void SendCb(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf, uint32_t len, QStatus status)
     {
         QCC_DbgTrace(("ArdpStream::SendCb(handle=%p, conn=%p, buf=%p, len=%d.)", handle, conn, buf, len));
+        /*
+         * A buffer that was sent out of a message buffer is released by
+         * dropping our reference to the message.  The same message may be in
+         * flight more than once, in which case any of the references will do.
+         */
+        m_lock.Lock(MUTEX_CONTEXT);
+        std::multimap<uint8_t*, Message>::iterator held = m_txHeld.find(buf);
+        bool owned = (held == m_txHeld.end());
+        if (!owned) {
+            m_txHeld.erase(held);
+        }
+        m_lock.Unlock(MUTEX_CONTEXT);
+
 #if SENT_SANITY
         m_transport->m_cbLock.Lock();
-        set<uint8_t*>::iterator i = find(m_sentSet.begin(), m_sentSet.end(), buf);
+        multiset<uint8_t*>::iterator i = m_sentSet.find(buf);
         if (i == m_sentSet.end()) {
             QCC_LogError(ER_FAIL, ("ArdpStream::SendCb(): Callback for buffer never sent or already freed (%p, %d.).  Ignored", buf, len));
         } else {
             m_sentSet.erase(i);
+            if (owned) {
 #ifndef NDEBUG
-            CheckSeal(buf + len);
+                CheckSeal(buf + len);
 #endif
-            delete[] buf;
+                delete[] buf;
+            }
         }
         m_transport->m_cbLock.Unlock();
 #else
+        if (owned) {
 #ifndef NDEBUG
-        CheckSeal(buf + len);
+            CheckSeal(buf + len);
 #endif
-        delete[] buf;
+            delete[] buf;
+        }
 #endif
 
         /*
-         * If there are any threads waiting for a chance to send bits, wake them
-         * up.  They will retry their sends when this event gets set.  If the
-         * send callbacks are part of normal operation, the sends may succeed
-         * the next time around.  If this callback is part of disconnect
-         * processing the next send will fail with an error; and PushBytes()
-         * will manage the outstanding write count.
+         * If there are any threads waiting for a chance to send bits, wake one
+         * of them up.  It will retry its send and, if that goes through, wake
+         * the next one.  If the send callbacks are part of normal operation,
+         * the sends may succeed the next time around.  If this callback is
+         * part of disconnect processing the next send will fail with an error.
          */
-        if (m_writeEvent) {
-            QCC_DbgPrintf(("ArdpStream::SendCb(): SetEvent()"));
-            m_transport->m_cbLock.Lock();
-            m_writeEvent->SetEvent();
-            m_transport->m_cbLock.Unlock();
+        m_lock.Lock(MUTEX_CONTEXT);
+        if (m_writesOutstanding > 0) {
+            --m_writesOutstanding;
         }
+        ++m_writeGeneration;
+        if (m_writeWaits > 0) {
+            QCC_DbgPrintf(("ArdpStream::SendCb(): Signal()"));
+            m_writeCondition.Signal();
+        }
+        m_lock.Unlock(MUTEX_CONTEXT);
     }
 
-    class ThreadEntry {
-      public:
-        qcc::Thread* m_thread;
-        ArdpStream* m_stream;
-    };
+    /**
+     * The remote side has opened its receive window while we had nothing in
+     * flight, so no send callback is coming to tell blocked writers to retry.
+     */
+    void SendWindowCb(ArdpHandle* handle, ArdpConnRecord* conn, QStatus status)
+    {
+        QCC_DbgTrace(("ArdpStream::SendWindowCb(handle=%p, conn=%p)", handle, conn));
+        m_lock.Lock(MUTEX_CONTEXT);
+        ++m_writeGeneration;
+        if (m_writeWaits > 0) {
+            m_writeCondition.Signal();
+        }
+        m_lock.Unlock(MUTEX_CONTEXT);
+    }
 
   private:
     ArdpStream(const ArdpStream& other);
@@ -1386,18 +1395,23 @@ class ArdpStream : public qcc::Stream {
     ArdpConnRecord* m_conn;           /**< The ARDP connection associated with this endpoint / stream combination */
     uint32_t m_dataTimeout;           /**< The timeout that the ARDP protocol will use when retrying sends */
     uint32_t m_dataRetries;           /**< The number of retries that the ARDP protocol will use when sending */
-    qcc::Mutex m_lock;                /**< Mutex that protects m_threads and disconnect state */
+    qcc::Mutex m_lock;                /**< Mutex that protects the write state, thread count and disconnect state */
     bool m_disc;                      /**< Set to true when ARDP fires the DisconnectCb on the associated connection */
     bool m_discSent;                  /**< Set to true when the endpoint calls ARDP_Disconnect */
     QStatus m_discStatus;             /**< The status code that was the reason for the last disconnect */
-    qcc::Event* m_writeEvent;         /**< The write event that callers are blocked on to apply backpressure */
+    qcc::Condition m_writeCondition;  /**< The condition that callers are blocked on to apply backpressure */
     int32_t m_writesOutstanding;      /**< The number of writes that are outstanding with ARDP */
+    uint32_t m_writeGeneration;       /**< Bumped whenever a send completes or the send window opens */
     int32_t m_writeWaits;             /**< The number of Threads that are blocked trying to write to an ARDP connection */
-
-    std::set<ThreadEntry> m_threads;  /**< Threads that are wandering around in the stream and possibly associated endpoint */
+    uint32_t m_threadCount;           /**< Threads that are wandering around in the stream and possibly associated endpoint */
+    bool m_nonBlocking;               /**< If true, PushBytes() returns ER_WOULDBLOCK rather than blocking on backpressure */
+    const Message* m_txMessage;       /**< The message whose bytes PushBytes() is currently being handed, if any */
+    const uint8_t* m_txBuf;           /**< The marshaled buffer of m_txMessage */
+    size_t m_txLen;                   /**< The size of the marshaled buffer of m_txMessage */
+    std::multimap<uint8_t*, Message> m_txHeld; /**< Messages holding buffers that ARDP is sending by reference */
 
 #if SENT_SANITY
-    std::set<uint8_t*> m_sentSet;
+    std::multiset<uint8_t*> m_sentSet;
 #endif
 
     class BufEntry {
@@ -1414,11 +1428,6 @@ class ArdpStream : public qcc::Stream {
 };
 
 
-bool operator<(const ArdpStream::ThreadEntry& lhs, const ArdpStream::ThreadEntry& rhs)
-{
-    return lhs.m_thread < rhs.m_thread;
-}
-
 /*
  * An endpoint class to handle the details of authenticating a connection in a
  * way that avoids denial of service attacks.
@@ -1444,6 +1453,13 @@ class _UDPEndpoint : public _RemoteEndpoint {
         EP_DONE              /**< Threads have been shut down and joined */
     };
 
+    /**
+     * The number of messages that may be waiting for the ARDP send window
+     * before senders are blocked.  This matches the transmit queue limit of
+     * the socket based remote endpoints.
+     */
+    static const size_t MAX_TX_QUEUE_SIZE = 30;
+
     /**
      * Connections can either be created as a result of incoming or outgoing
      * connection requests.  If a connection happens as a result of a Connect()
@@ -1486,7 +1502,12 @@ class _UDPEndpoint : public _RemoteEndpoint {
         m_exitScheduled(false),
         m_disconnected(false),
         m_refCount(0),
-        m_stateLock()
+        m_stateLock(),
+        m_txQueue(),
+        m_txCursor(),
+        m_txLock(),
+        m_txCondition(),
+        m_txWaits(0)
     {
         QCC_DbgHLPrintf(("_UDPEndpoint::_UDPEndpoint(transport=%p, bus=%p, incoming=%d., connectSpec=\"%s\")",
                          transport, &bus, incoming, connectSpec.c_str()));
@@ -1769,6 +1790,14 @@ class _UDPEndpoint : public _RemoteEndpoint {
             m_stream->Disconnect(false, ER_UDP_LOCAL_DISCONNECT);
         }
 
+        /*
+         * Senders waiting for room in the transmit queue need to notice that
+         * we are stopping as well.
+         */
+        m_txLock.Lock(MUTEX_CONTEXT);
+        m_txCondition.Broadcast();
+        m_txLock.Unlock(MUTEX_CONTEXT);
+
         DecrementAndFetch(&m_refCount);
         return ER_OK;
     }
@@ -2028,6 +2057,7 @@ class _UDPEndpoint : public _RemoteEndpoint {
         m_stream->SetConn(conn);
         m_stream->SetDataTimeout(dataTimeout);
         m_stream->SetDataRetries(dataRetries);
+        m_stream->SetNonBlocking(true);
 
         /*
          * This is actually a call to the underlying endpoint that provides the
@@ -2125,17 +2155,13 @@ class _UDPEndpoint : public _RemoteEndpoint {
         RemoteEndpoint rep = RemoteEndpoint::wrap(this);
 
         /*
-         * If we are going to pass the Message off to be delivered, the act of
-         * delivering will change the write state of the message.  Since
-         * delivering to a multipoint session is done by taking a Message and
-         * sending it off to multiple endpoints for delivery, if we just use the
-         * Message we are given, we will eventually change the writeState of the
-         * message to MESSAGE_COMPLETE when we've pushed all of the bits.  That
-         * would cause any subsequent PushMessage calls to complete before
-         * actually writing any bits since they would think they are done.  This
-         * means we have to do a deep copy of every message before we send it.
+         * Delivering to a multipoint session is done by taking a Message and
+         * sending it off to multiple endpoints for delivery, so the write
+         * position is kept here rather than in the message.  The marshaled
+         * buffer is only rewritten if the message is encrypted during delivery,
+         * in which case we have to deliver a copy.
          */
-        Message msgCopy = Message(msg, true);
+        Message msgCopy = msg->NeedsPrivateCopy() ? Message(msg, true) : msg;
 
         /*
          * We know we hold a reference, so now we can call out to the daemon
@@ -2145,13 +2171,166 @@ class _UDPEndpoint : public _RemoteEndpoint {
          * out in short order.
          */
         m_transport->m_endpointListLock.Unlock(MUTEX_CONTEXT);
-        QCC_DbgPrintf(("_UDPEndpoint::PushMessage(): DeliverNonBlocking()"));
-        QStatus status = msgCopy->DeliverNonBlocking(rep);
-        QCC_DbgPrintf(("_UDPEndpoint::PushMessage(): DeliverNonBlocking() returns \"%s\"", QCC_StatusText(status)));
+        QStatus status = QueueMessage(rep, msgCopy);
         DecrementAndFetch(&m_refCount);
         return status;
     }
 
+    /**
+     * Send a message or, if the ARDP send window is closed, add it to the
+     * transmit queue of the endpoint.  This works like the transmit queue of
+     * a socket based _RemoteEndpoint except that the queue is drained from
+     * the send callbacks instead of a write callback from IODispatch.  The
+     * caller only blocks if the queue is full, and then on a condition
+     * variable rather than an event of its own.
+     */
+    QStatus QueueMessage(RemoteEndpoint& rep, Message& msg)
+    {
+        QCC_DbgTrace(("_UDPEndpoint::QueueMessage(msg=%p)", &msg));
+        QStatus status = ER_OK;
+
+        m_txLock.Lock(MUTEX_CONTEXT);
+
+        /*
+         * Nothing is queued ahead of this message so try to send it right away.
+         * The stream is in non-blocking mode, so ER_WOULDBLOCK means that the
+         * protocol is applying backpressure and the message has to wait.
+         */
+        if (m_txQueue.empty()) {
+            MessageWriteCursor cursor;
+            QCC_DbgPrintf(("_UDPEndpoint::QueueMessage(): DeliverNonBlocking()"));
+            status = Deliver(rep, msg, cursor);
+            QCC_DbgPrintf(("_UDPEndpoint::QueueMessage(): DeliverNonBlocking() returns \"%s\"", QCC_StatusText(status)));
+            if (status == ER_WOULDBLOCK) {
+                m_txQueue.push_back(msg);
+                m_txCursor = cursor;
+                status = ER_OK;
+            }
+            m_txLock.Unlock(MUTEX_CONTEXT);
+            return status;
+        }
+
+        /*
+         * Wait for room in the queue, dropping expired messages to make room
+         * if we can.  The message at the head of the queue may have been
+         * partially delivered so it is left alone.
+         */
+        uint32_t timeout = m_stream ? m_stream->GetDataTimeout() * (2 + m_stream->GetDataRetries()) : 0;
+        Timespec tStart;
+        GetTimeNow(&tStart);
+        while (m_txQueue.size() >= MAX_TX_QUEUE_SIZE) {
+            for (std::deque<Message>::iterator i = m_txQueue.begin() + 1; i != m_txQueue.end(); ++i) {
+                if ((*i)->IsExpired()) {
+                    m_txQueue.erase(i);
+                    break;
+                }
+            }
+            if (m_txQueue.size() < MAX_TX_QUEUE_SIZE) {
+                break;
+            }
+
+            Timespec tNow;
+            GetTimeNow(&tNow);
+            int32_t tRemaining = tStart + timeout - tNow;
+            if (GetEpState() != EP_STARTED || m_stream == NULL) {
+                status = ER_UDP_STOPPING;
+            } else if (tRemaining <= 0) {
+                status = ER_TIMEOUT;
+            }
+            if (status != ER_OK) {
+                QCC_LogError(status, ("_UDPEndpoint::QueueMessage(): Transmit queue full"));
+                break;
+            }
+
+            /*
+             * Count ourselves as a thread in the stream so the endpoint is not
+             * torn down while we wait.  Stop() wakes us up.
+             */
+            m_stream->AddCurrentThread();
+            ++m_txWaits;
+            QStatus waitStatus = m_txCondition.Wait(m_txLock, tRemaining);
+            --m_txWaits;
+            m_stream->RemoveCurrentThread();
+            if (waitStatus != ER_OK && waitStatus != ER_TIMEOUT) {
+                status = waitStatus;
+                break;
+            }
+        }
+
+        if (status == ER_OK) {
+            m_txQueue.push_back(msg);
+        }
+
+        /*
+         * We may have taken the wakeup that was meant for another waiter.
+         */
+        if (m_txWaits > 0 && m_txQueue.size() < MAX_TX_QUEUE_SIZE) {
+            m_txCondition.Signal();
+        }
+        m_txLock.Unlock(MUTEX_CONTEXT);
+        return status;
+    }
+
+    /**
+     * Push a message into the stream, letting the stream send straight out of
+     * the message buffer.  Called with m_txLock held, which serializes all
+     * deliveries on this endpoint.
+     */
+    QStatus Deliver(RemoteEndpoint& rep, Message& msg, MessageWriteCursor& cursor)
+    {
+        if (m_stream) {
+            m_stream->SetTxMessage(&msg, msg->GetBuffer(), msg->GetBufferSize());
+        }
+        QStatus status = msg->DeliverNonBlocking(rep, cursor);
+        if (m_stream) {
+            m_stream->SetTxMessage(NULL, NULL, 0);
+        }
+        return status;
+    }
+
+    /**
+     * Send as many queued messages as the ARDP send window allows.  Called on
+     * the dispatcher thread after a send callback, or after the send window
+     * opened while nothing was in flight.
+     */
+    void DrainTxQueue()
+    {
+        QCC_DbgTrace(("_UDPEndpoint::DrainTxQueue()"));
+
+        m_txLock.Lock(MUTEX_CONTEXT);
+        if (m_txQueue.empty()) {
+            m_txLock.Unlock(MUTEX_CONTEXT);
+            return;
+        }
+
+        RemoteEndpoint rep = RemoteEndpoint::wrap(this);
+        while (!m_txQueue.empty()) {
+            QStatus status = Deliver(rep, m_txQueue.front(), m_txCursor);
+            if (status == ER_WOULDBLOCK) {
+                break;
+            }
+
+            /*
+             * Nobody is left to report the failure to, so all we can do is
+             * drop the message.  If the connection is going away every queued
+             * message is going to fail in the same way.
+             */
+            if (status != ER_OK) {
+                if (GetEpState() == EP_STARTED) {
+                    QCC_LogError(status, ("_UDPEndpoint::DrainTxQueue(): Dropping queued message"));
+                } else {
+                    QCC_DbgPrintf(("_UDPEndpoint::DrainTxQueue(): Dropping queued message: \"%s\"", QCC_StatusText(status)));
+                }
+            }
+            m_txQueue.pop_front();
+            m_txCursor = MessageWriteCursor();
+            if (m_txWaits > 0) {
+                m_txCondition.Signal();
+            }
+        }
+        m_txLock.Unlock(MUTEX_CONTEXT);
+    }
+
     /**
      * Callback (indirectly) from the ARDP implementation letting us know that
      * our connection has been disconnected for some reason.
@@ -2595,6 +2774,28 @@ class _UDPEndpoint : public _RemoteEndpoint {
             delete[] buf;
         }
 
+        /*
+         * The send that completed made room in the send window for whatever
+         * is waiting on our transmit queue.
+         */
+        DrainTxQueue();
+
+        DecrementAndFetch(&m_refCount);
+    }
+
+    /**
+     * Callback (indirectly) from the ARDP implementation letting us know that
+     * the remote side opened its receive window while we had nothing in
+     * flight.
+     */
+    void SendWindowCb(ArdpHandle* handle, ArdpConnRecord* conn, QStatus status)
+    {
+        IncrementAndFetch(&m_refCount);
+        QCC_DbgTrace(("_UDPEndpoint::SendWindowCb(handle=%p, conn=%p)", handle, conn));
+        if (m_stream) {
+            m_stream->SendWindowCb(handle, conn, status);
+        }
+        DrainTxQueue();
         DecrementAndFetch(&m_refCount);
     }
 
@@ -2926,6 +3127,11 @@ class _UDPEndpoint : public _RemoteEndpoint {
     volatile bool m_disconnected;     /**< Indicates an interlocked handling of the ARDP_Disconnect has happened */
     volatile int32_t m_refCount;      /**< Incremented if a thread is wandering through the endpoint, decrememted when it leaves */
     qcc::Mutex m_stateLock;           /**< Mutex protecting the endpoint state against multiple threads attempting changes */
+    std::deque<Message> m_txQueue;    /**< Messages waiting for the ARDP send window to open, oldest first */
+    MessageWriteCursor m_txCursor;    /**< Write position in the message at the head of m_txQueue */
+    qcc::Mutex m_txLock;              /**< Mutex protecting the transmit queue */
+    qcc::Condition m_txCondition;     /**< Condition senders wait on when the transmit queue is full */
+    uint32_t m_txWaits;               /**< The number of threads waiting for room in the transmit queue */
 };
 
 /**
@@ -2976,6 +3182,7 @@ UDPTransport::UDPTransport(BusAttachment& bus) :
     ardpConfig.probeRetries = config->GetLimit("udp_probe_retries", UDP_PROBE_RETRIES);
     ardpConfig.dupackCounter = config->GetLimit("udp_dupack_counter", UDP_DUPACK_COUNTER);
     ardpConfig.timewait = config->GetLimit("udp_timewait", UDP_TIMEWAIT);
+    ardpConfig.congestionControl = config->GetLimit("udp_congestion_control", UDP_CONGESTION_CONTROL);
     memcpy(&m_ardpConfig, &ardpConfig, sizeof(ArdpGlobalConfig));
 
     /*
@@ -3183,6 +3390,13 @@ ThreadReturn STDCALL UDPTransport::DispatcherThread::Run(void* arg)
                                     break;
                                 }
 
+                            case WorkerCommandQueueEntry::SEND_WINDOW_CB:
+                                {
+                                    QCC_DbgPrintf(("UDPTransport::DispatcherThread::Run(): SEND_WINDOW_CB: SendWindowCb()"));
+                                    ep->SendWindowCb(entry.m_handle, entry.m_conn, entry.m_status);
+                                    break;
+                                }
+
                             case WorkerCommandQueueEntry::RECV_CB:
                                 {
                                     QCC_DbgPrintf(("UDPTransport::DispatcherThread::Run(): RECV_CB: RecvCb()"));
@@ -5183,6 +5397,35 @@ void UDPTransport::SendWindowCb(ArdpHandle* handle, ArdpConnRecord* conn, uint16
     IncrementAndFetch(&m_refCount);
     QCC_DbgTrace(("UDPTransport::SendWindowCb(handle=%p, conn=%p, window=%d.)", handle, conn, window));
     QCC_DbgPrintf(("UDPTransport::SendWindowCb(): callback from conn ID == %d", ARDP_GetConnId(handle, conn)));
+
+    /*
+     * Send callbacks drain the transmit queues of the endpoints as long as
+     * there is data in flight.  We only need to get involved when the window
+     * opens with nothing outstanding, since no send callback is coming then.
+     */
+    if (status != ER_OK || ARDP_GetConnPending(handle, conn) != 0) {
+        DecrementAndFetch(&m_refCount);
+        return;
+    }
+
+    if (m_dispatcher == NULL) {
+        QCC_DbgPrintf(("UDPTransport::SendWindowCb(): m_dispatcher is NULL"));
+        DecrementAndFetch(&m_refCount);
+        return;
+    }
+
+    UDPTransport::WorkerCommandQueueEntry entry;
+    entry.m_command = UDPTransport::WorkerCommandQueueEntry::SEND_WINDOW_CB;
+    entry.m_handle = handle;
+    entry.m_conn = conn;
+    entry.m_connId = ARDP_GetConnId(handle, conn);
+    entry.m_status = status;
+
+    QCC_DbgPrintf(("UDPTransport::SendWindowCb(): sending SEND_WINDOW_CB request to dispatcher)"));
+    m_workerCommandQueueLock.Lock(MUTEX_CONTEXT);
+    m_workerCommandQueue.push(entry);
+    m_workerCommandQueueLock.Unlock(MUTEX_CONTEXT);
+    m_dispatcher->Alert();
     DecrementAndFetch(&m_refCount);
 }
 
@@ -819,7 +819,8 @@ class UDPTransport : public Transport, public _RemoteEndpoint::EndpointListener,
             CONNECT_CB,
             DISCONNECT_CB,
             RECV_CB,
-            SEND_CB
+            SEND_CB,
+            SEND_WINDOW_CB
         };
         Command m_command;
         ArdpHandle* m_handle;
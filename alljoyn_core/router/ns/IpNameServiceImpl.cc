@@ -42,6 +42,7 @@
 #include <qcc/IfConfig.h>
 #include <qcc/time.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Util.h>
 #include <qcc/GUID.h>
 #include <qcc/Event.h>
 
@@ -360,6 +361,8 @@ const uint32_t IpNameServiceImpl::RETRY_INTERVALS[] = { 1, 2, 6, 18 };
 IpNameServiceImpl::IpNameServiceImpl()
     : Thread("IpNameServiceImpl"), m_state(IMPL_SHUTDOWN), m_isProcSuspending(false),
     m_terminal(false), m_protect_callback(false), m_protect_net_callback(false), m_timer(0),
+    m_advertisementCapture(NULL), m_responseDelayMin(RESPONSE_DELAY_MIN), m_responseDelayMax(RESPONSE_DELAY_MAX),
+    m_responseHoldDown(RESPONSE_HOLDDOWN), m_responsesSent(0), m_responsesSuppressed(0), m_responsesCoalesced(0),
     m_tDuration(DEFAULT_DURATION), m_tRetransmit(RETRANSMIT_TIME), m_tQuestion(QUESTION_TIME),
     m_modulus(QUESTION_MODULUS), m_retries(sizeof(RETRY_INTERVALS) / sizeof(RETRY_INTERVALS[0])),
     m_loopback(false), m_enableIPv4(false), m_enableIPv6(false), m_enableV1(false),
@@ -425,6 +428,19 @@ QStatus IpNameServiceImpl::Init(const qcc::String& guid, bool loopback)
     //
     m_enableV1 = config->GetFlag("ns_enable_v1", false);
 
+    //
+    // We hold responses to questions for a random time between these limits
+    // so that questions from many devices arriving at once can be answered
+    // together.  Setting ns_response_delay_max to zero answers immediately.
+    // Setting ns_response_holddown to zero answers repeated questions.
+    //
+    m_responseDelayMin = config->GetLimit("ns_response_delay_min", RESPONSE_DELAY_MIN);
+    m_responseDelayMax = config->GetLimit("ns_response_delay_max", RESPONSE_DELAY_MAX);
+    if (m_responseDelayMin > m_responseDelayMax) {
+        m_responseDelayMin = m_responseDelayMax;
+    }
+    m_responseHoldDown = config->GetLimit("ns_response_holddown", RESPONSE_HOLDDOWN);
+
     //
     // Set the broadcast bit to true for WinRT. For all other platforms,
     // this field should be derived from the property disable_directed_broadcast
@@ -631,6 +647,7 @@ QStatus IpNameServiceImpl::OpenInterface(TransportMask transportMask, const qcc:
 
     m_processTransport = true;
     m_requestedInterfaces[transportIndex].push_back(specifier);
+    InvalidateAdvertisementCache();
     m_forceLazyUpdate = true;
     m_wakeEvent.SetEvent();
     m_mutex.Unlock();
@@ -716,6 +733,7 @@ QStatus IpNameServiceImpl::OpenInterface(TransportMask transportMask, const qcc:
 
     m_processTransport = true;
     m_requestedInterfaces[transportIndex].push_back(specifier);
+    InvalidateAdvertisementCache();
     m_forceLazyUpdate = true;
     m_wakeEvent.SetEvent();
     m_mutex.Unlock();
@@ -769,6 +787,7 @@ QStatus IpNameServiceImpl::CloseInterface(TransportMask transportMask, const qcc
         }
     }
 
+    InvalidateAdvertisementCache();
     m_forceLazyUpdate = true;
     m_wakeEvent.SetEvent();
     m_mutex.Unlock();
@@ -838,6 +857,7 @@ QStatus IpNameServiceImpl::CloseInterface(TransportMask transportMask, const qcc
         }
     }
 
+    InvalidateAdvertisementCache();
     m_forceLazyUpdate = true;
     m_wakeEvent.SetEvent();
     m_mutex.Unlock();
@@ -923,6 +943,7 @@ void IpNameServiceImpl::ClearLiveInterfaces(void)
 
     QCC_DbgPrintf(("IpNameServiceImpl::ClearLiveInterfaces(): Clear interfaces"));
     m_liveInterfaces.clear();
+    InvalidateAdvertisementCache();
 
     m_mutex.Unlock();
 
@@ -1454,6 +1475,7 @@ void IpNameServiceImpl::LazyUpdateInterfaces(const qcc::NetworkEventSet& network
         // Lazy update is called with the mutex taken, so this is safe here.
         //
         m_liveInterfaces.push_back(live);
+        InvalidateAdvertisementCache();
     }
     if (m_liveInterfaces.size() > 0) {
         if (m_ipv4UnicastSockFd == qcc::INVALID_SOCKET_FD) {
@@ -1718,6 +1740,7 @@ QStatus IpNameServiceImpl::Enable(TransportMask transportMask,
     m_enabledUnreliableIPv4[i] = !m_unreliableIPv4PortMap[i].empty();
     m_enabledReliableIPv6[i] = enableReliableIPv6;
     m_enabledUnreliableIPv6[i] = enableUnreliableIPv6;
+    InvalidateAdvertisementCache();
     //
     // We might be wanting to disable the name service depending on whether we
     // end up disabling the last of the enabled ports.
@@ -2120,11 +2143,14 @@ void IpNameServiceImpl::SetCriticalParameters(
     uint32_t modulus,
     uint32_t retries)
 {
+    m_mutex.Lock();
     m_tDuration = tDuration;
     m_tRetransmit = tRetransmit;
     m_tQuestion = tQuestion;
     m_modulus = modulus;
     m_retries = retries;
+    InvalidateAdvertisementCache();
+    m_mutex.Unlock();
 }
 
 QStatus IpNameServiceImpl::SetCallback(TransportMask transportMask,
@@ -2326,6 +2352,7 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
             set<qcc::String>::iterator j = find(m_advertised_quietly[transportIndex].begin(), m_advertised_quietly[transportIndex].end(), wkn[i]);
             if (j == m_advertised_quietly[transportIndex].end()) {
                 m_advertised_quietly[transportIndex].insert(wkn[i]);
+                m_advertisedQuietlyTrie[transportIndex].Insert(wkn[i], wkn[i]);
             } else {
                 //
                 // Nothing has changed, so don't bother.
@@ -2348,6 +2375,8 @@ QStatus IpNameServiceImpl::AdvertiseName(TransportMask transportMask, vector<qcc
             set<qcc::String>::iterator j = find(m_advertised[transportIndex].begin(), m_advertised[transportIndex].end(), wkn[i]);
             if (j == m_advertised[transportIndex].end()) {
                 m_advertised[transportIndex].insert(wkn[i]);
+                m_advertisedTrie[transportIndex].Insert(wkn[i], wkn[i]);
+                InvalidateAdvertisementCache();
             } else {
                 //
                 // Nothing has changed, so don't bother.
@@ -2658,12 +2687,15 @@ QStatus IpNameServiceImpl::CancelAdvertiseName(TransportMask transportMask, vect
         set<qcc::String>::iterator j = find(m_advertised[transportIndex].begin(), m_advertised[transportIndex].end(), wkn[i]);
         if (j != m_advertised[transportIndex].end()) {
             m_advertised[transportIndex].erase(j);
+            m_advertisedTrie[transportIndex].Remove(wkn[i], wkn[i]);
+            InvalidateAdvertisementCache();
             changed = true;
         }
 
         set<qcc::String>::iterator k = find(m_advertised_quietly[transportIndex].begin(), m_advertised_quietly[transportIndex].end(), wkn[i]);
         if (k != m_advertised_quietly[transportIndex].end()) {
             m_advertised_quietly[transportIndex].erase(k);
+            m_advertisedQuietlyTrie[transportIndex].Remove(wkn[i], wkn[i]);
         }
     }
 
@@ -3383,7 +3415,45 @@ void IpNameServiceImpl::SendProtocolMessage(
     }
 
     //
-    // Since we have fallen through to here,
+    // If an active retransmission is being recorded, keep a copy of exactly
+    // what goes out so the next retransmit interval doesn't have to build and
+    // serialize the same packets all over again.
+    //
+    if (m_advertisementCapture) {
+        AdvertisementImage image;
+        image.m_sockFd = sockFd;
+        image.m_interfaceAddress = interfaceAddress;
+        image.m_interfaceAddressPrefixLen = interfaceAddressPrefixLen;
+        image.m_flags = flags;
+        image.m_sockFdIsIPv4 = sockFdIsIPv4;
+        image.m_msgVersion = msgVersion;
+        image.m_interfaceIndex = interfaceIndex;
+        image.m_localAddress = localAddress;
+        m_advertisementCapture->m_images.push_back(image);
+        m_advertisementCapture->m_images.back().m_buffer.assign(buffer, buffer + size);
+    }
+
+    SendProtocolBuffer(sockFd, interfaceAddress, interfaceAddressPrefixLen, flags, sockFdIsIPv4, msgVersion,
+                       buffer, size, interfaceIndex, localAddress);
+
+    delete [] buffer;
+}
+
+void IpNameServiceImpl::SendProtocolBuffer(
+    qcc::SocketFd sockFd,
+    qcc::IPAddress interfaceAddress,
+    uint32_t interfaceAddressPrefixLen,
+    uint32_t flags,
+    bool sockFdIsIPv4,
+    uint32_t msgVersion,
+    const uint8_t* buffer,
+    size_t size,
+    uint32_t interfaceIndex,
+    const qcc::IPAddress& localAddress)
+{
+    size_t sent;
+
+    //
     // Now it's time to send the packets.  Packets is plural since we will try
     // to get our name service information across to peers in as many ways as is
     // reasonably possible since it turns out that discovery is a weak link in
@@ -3523,8 +3593,6 @@ void IpNameServiceImpl::SendProtocolMessage(
             }
         }
     }
-
-    delete [] buffer;
 }
 
 bool IpNameServiceImpl::InterfaceRequested(uint32_t transportIndex, uint32_t liveIndex)
@@ -4985,6 +5053,12 @@ void* IpNameServiceImpl::Run(void* arg)
     const uint32_t MS_PER_SEC = 1000;
     qcc::Event timerEvent(MS_PER_SEC, MS_PER_SEC);
 
+    //
+    // Instantiate an event that we set to fire when the next pending response
+    // to a question is due.
+    //
+    qcc::Event responseEvent(qcc::Event::WAIT_FOREVER, 0);
+
     qcc::NetworkEventSet networkEvents;
 
     qcc::SocketFd networkEventFd = qcc::INVALID_SOCKET_FD;
@@ -5083,6 +5157,7 @@ void* IpNameServiceImpl::Run(void* arg)
             m_forceLazyUpdate = false;
         }
         SendOutboundMessages();
+        SendPendingResponses();
 
         //
         // Now, worry about what to do next.  Create a set of events to wait on.
@@ -5097,6 +5172,10 @@ void* IpNameServiceImpl::Run(void* arg)
         }
         checkEvents.push_back(&m_wakeEvent);
         checkEvents.push_back(&networkEvent);
+        if (!m_pendingResponses.empty()) {
+            responseEvent.ResetTime(NextResponseDelay(), 0);
+            checkEvents.push_back(&responseEvent);
+        }
         if (m_unicastEvent) {
             checkEvents.push_back(m_unicastEvent);
         }
@@ -5186,6 +5265,11 @@ void* IpNameServiceImpl::Run(void* arg)
                 // advertisements.
                 //
                 DoPeriodicMaintenance();
+            } else if (*i == &responseEvent) {
+                //
+                // A pending response is due.  It is sent when we next run
+                // through the loop.
+                //
             } else if (*i == &m_wakeEvent) {
                 QCC_DbgPrintf(("IpNameServiceImpl::Run(): Wake event fired"));
                 //
@@ -5862,6 +5946,275 @@ void IpNameServiceImpl::GetQueryPackets(std::list<Packet>& packets, const uint8_
     m_mutex.Unlock();
 }
 
+void IpNameServiceImpl::InvalidateAdvertisementCache(void)
+{
+    m_advertisementCache.clear();
+    m_advertisementCapture = NULL;
+}
+
+bool IpNameServiceImpl::ReplayAdvertisement(uint32_t transportIndex, uint8_t type, int32_t interfaceIndex, qcc::AddressFamily family, const qcc::IPAddress& localAddress)
+{
+    for (list<AdvertisementCache>::iterator i = m_advertisementCache.begin(); i != m_advertisementCache.end(); ++i) {
+        if (i->m_transportIndex != transportIndex || i->m_type != type || i->m_interfaceIndex != interfaceIndex ||
+            i->m_family != family || i->m_localAddress != localAddress) {
+            continue;
+        }
+
+        QCC_DbgPrintf(("IpNameServiceImpl::ReplayAdvertisement(): Sending %d cached messages", i->m_images.size()));
+        for (vector<AdvertisementImage>::iterator j = i->m_images.begin(); (m_state == IMPL_RUNNING || m_terminal) && j != i->m_images.end(); ++j) {
+            SendProtocolBuffer(j->m_sockFd, j->m_interfaceAddress, j->m_interfaceAddressPrefixLen, j->m_flags, j->m_sockFdIsIPv4,
+                               j->m_msgVersion, &j->m_buffer[0], j->m_buffer.size(), j->m_interfaceIndex, j->m_localAddress);
+        }
+        return true;
+    }
+    return false;
+}
+
+void IpNameServiceImpl::BeginAdvertisementCapture(uint32_t transportIndex, uint8_t type, int32_t interfaceIndex, qcc::AddressFamily family, const qcc::IPAddress& localAddress)
+{
+    //
+    // Only record what happens while we are up and running.  Messages that we
+    // fail to send because we are not yet (or no longer) running must not be
+    // remembered as having gone out.
+    //
+    if (m_state != IMPL_RUNNING) {
+        return;
+    }
+
+    AdvertisementCache cache;
+    cache.m_transportIndex = transportIndex;
+    cache.m_type = type;
+    cache.m_interfaceIndex = interfaceIndex;
+    cache.m_family = family;
+    cache.m_localAddress = localAddress;
+    m_advertisementCache.push_back(cache);
+    m_advertisementCapture = &m_advertisementCache.back();
+}
+
+void IpNameServiceImpl::EndAdvertisementCapture(void)
+{
+    if (m_advertisementCapture && m_state != IMPL_RUNNING) {
+        InvalidateAdvertisementCache();
+    }
+    m_advertisementCapture = NULL;
+}
+
+void IpNameServiceImpl::GetResponseCounters(uint32_t& sent, uint32_t& suppressed, uint32_t& coalesced)
+{
+    m_mutex.Lock();
+    sent = m_responsesSent;
+    suppressed = m_responsesSuppressed;
+    coalesced = m_responsesCoalesced;
+    m_mutex.Unlock();
+}
+
+void IpNameServiceImpl::ScheduleResponse(PendingResponse& response)
+{
+    //
+    // The key identifies what a response carries and where it goes, so two
+    // responses with the same key are interchangeable.  Version two responses
+    // carry the same names whichever transport matched the question, so the
+    // transport index is left out of their keys.
+    //
+    if (response.m_quietly) {
+        response.m_key = "q" + U32ToString(response.m_type) + ":" +
+                         (response.m_type == TRANSMIT_V2 ? String() : U32ToString(response.m_transportIndex)) + ":" +
+                         response.m_destination.ToString();
+    } else {
+        response.m_key = "a" + U32ToString(response.m_type) + ":" + U32ToString(response.m_transportIndex) + ":" +
+                         I32ToString(response.m_interfaceIndex) + ":" + U32ToString(response.m_family) + ":" +
+                         response.m_localAddress.ToString();
+    }
+
+    uint64_t now = GetTimestamp64();
+    for (map<String, RecentResponse>::iterator it = m_recentResponses.begin(); it != m_recentResponses.end();) {
+        if (it->second.m_sent + m_responseHoldDown <= now) {
+            m_recentResponses.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    //
+    // If we have just sent this response, the asker has its answer and is
+    // repeating the question (another copy from the same burst, or another
+    // transport asking the same thing).  The asker also has its answer if we
+    // have just multicast a version two response on the interface it asked
+    // on and it is only asking about names we advertise actively.
+    //
+    String keys[2] = { response.m_key, String() };
+    if (response.m_type == TRANSMIT_V2 && !response.m_quietMatch && response.m_interfaceIndex != -1) {
+        keys[1] = "a" + U32ToString(TRANSMIT_V2) + ":" + I32ToString(response.m_interfaceIndex);
+    }
+    for (uint32_t i = 0; i < 2; ++i) {
+        map<String, RecentResponse>::const_iterator it = m_recentResponses.find(keys[i]);
+        if (it == m_recentResponses.end()) {
+            continue;
+        }
+        const RecentResponse& recent = it->second;
+        if ((response.m_transportMask & ~recent.m_transportMask) == 0 &&
+            (recent.m_allNames || (!response.m_allNames && includes(recent.m_wkns.begin(), recent.m_wkns.end(),
+                                                                    response.m_wkns.begin(), response.m_wkns.end())))) {
+            QCC_DbgPrintf(("IpNameServiceImpl::ScheduleResponse(): Suppressing duplicate of %s", keys[i].c_str()));
+            ++m_responsesSuppressed;
+            return;
+        }
+    }
+
+    //
+    // If the same response is already waiting to go out, it will answer this
+    // question as well once it includes the names asked about.
+    //
+    for (list<PendingResponse>::iterator it = m_pendingResponses.begin(); it != m_pendingResponses.end(); ++it) {
+        if (it->m_key == response.m_key) {
+            QCC_DbgPrintf(("IpNameServiceImpl::ScheduleResponse(): Coalescing with pending %s", response.m_key.c_str()));
+            it->Merge(response);
+            ++m_responsesCoalesced;
+            return;
+        }
+    }
+
+    if (m_responseDelayMax == 0) {
+        SendResponse(response);
+        return;
+    }
+
+    //
+    // We are called from the main thread which works out how long to wait
+    // for the next pending response each time around its loop, so there is
+    // no need to wake it up.
+    //
+    response.m_due = now + m_responseDelayMin + qcc::Rand16() % (m_responseDelayMax - m_responseDelayMin + 1);
+    m_pendingResponses.push_back(response);
+}
+
+void IpNameServiceImpl::SendPendingResponses(void)
+{
+    //
+    // Anything still pending when we start shutting down would go out after
+    // the terminal advertisements that withdraw our names, so drop it.
+    //
+    if (m_state != IMPL_RUNNING) {
+        m_pendingResponses.clear();
+        return;
+    }
+
+    uint64_t now = GetTimestamp64();
+    list<PendingResponse>::iterator it = m_pendingResponses.begin();
+    while (it != m_pendingResponses.end()) {
+        if (it->m_due > now) {
+            ++it;
+            continue;
+        }
+
+        //
+        // Version two responses are sent directly to the asker.  If several
+        // devices that asked over the same interface are waiting for responses
+        // that only involve actively advertised names, we multicast a single
+        // response on that interface instead, which every one of them hears.
+        // Responses that have not yet reached their time are pulled forward
+        // since they would carry the same answer.
+        //
+        if (it->m_type == TRANSMIT_V2 && !it->m_quietMatch && it->m_interfaceIndex != -1) {
+            PendingResponse multicast = *it;
+            uint32_t nMerged = 0;
+            for (list<PendingResponse>::iterator j = m_pendingResponses.begin(); j != m_pendingResponses.end(); ++j) {
+                if (j != it && j->m_type == TRANSMIT_V2 && !j->m_quietMatch && j->m_interfaceIndex == it->m_interfaceIndex) {
+                    multicast.Merge(*j);
+                    ++nMerged;
+                }
+            }
+
+            if (nMerged) {
+                QCC_DbgPrintf(("IpNameServiceImpl::SendPendingResponses(): Multicasting %d responses on interface %d",
+                               nMerged + 1, multicast.m_interfaceIndex));
+                for (list<PendingResponse>::iterator j = m_pendingResponses.begin(); j != m_pendingResponses.end();) {
+                    if (j->m_type == TRANSMIT_V2 && !j->m_quietMatch && j->m_interfaceIndex == multicast.m_interfaceIndex) {
+                        j = m_pendingResponses.erase(j);
+                    } else {
+                        ++j;
+                    }
+                }
+                multicast.m_quietly = false;
+                multicast.m_key = "a" + U32ToString(TRANSMIT_V2) + ":" + I32ToString(multicast.m_interfaceIndex);
+                m_responsesCoalesced += nMerged;
+                SendResponse(multicast);
+                it = m_pendingResponses.begin();
+                continue;
+            }
+        }
+
+        PendingResponse response = *it;
+        it = m_pendingResponses.erase(it);
+        SendResponse(response);
+    }
+}
+
+void IpNameServiceImpl::SendResponse(PendingResponse& response)
+{
+    vector<String> wkns;
+    if (!response.m_allNames) {
+        wkns.assign(response.m_wkns.begin(), response.m_wkns.end());
+    }
+
+    ++m_responsesSent;
+    Retransmit(response.m_transportIndex, false, response.m_quietly, response.m_destination, response.m_type,
+               response.m_transportMask, wkns, response.m_interfaceIndex, response.m_family, response.m_localAddress);
+
+    if (m_responseHoldDown) {
+        RecentResponse& recent = m_recentResponses[response.m_key];
+        recent.m_sent = GetTimestamp64();
+        recent.m_transportMask = response.m_transportMask;
+        recent.m_allNames = response.m_allNames;
+        recent.m_wkns = response.m_wkns;
+    }
+}
+
+uint32_t IpNameServiceImpl::NextResponseDelay(void) const
+{
+    if (m_pendingResponses.empty()) {
+        return qcc::Event::WAIT_FOREVER;
+    }
+
+    uint64_t due = m_pendingResponses.front().m_due;
+    for (list<PendingResponse>::const_iterator it = m_pendingResponses.begin(); it != m_pendingResponses.end(); ++it) {
+        due = std::min(due, it->m_due);
+    }
+
+    uint64_t now = GetTimestamp64();
+    return due > now ? static_cast<uint32_t>(due - now) : 0;
+}
+
+bool IpNameServiceImpl::KnownAnswer(MDNSPacket mdnsPacket, const std::set<qcc::String>& names)
+{
+    //
+    // Following RFC 6762 section 7.1, a querier may list the answers it
+    // already has.  An answer only counts if it has at least half of its
+    // lifetime left; otherwise the asker is due a refresh.
+    //
+    MDNSResourceRecord* answer;
+    if (!mdnsPacket->GetAnswer("advertise." + m_guid + ".local.", MDNSResourceRecord::TXT, &answer)) {
+        return false;
+    }
+    if (answer->GetRRttl() < m_tDuration / 2) {
+        return false;
+    }
+
+    MDNSAdvertiseRData* advRData = static_cast<MDNSAdvertiseRData*>(answer->GetRData());
+    if (!advRData) {
+        return false;
+    }
+
+    set<String> known;
+    for (uint16_t i = 0; i < advRData->GetNumFields(); ++i) {
+        pair<String, String> field = advRData->GetFieldAt(i);
+        if (field.first.find("n_") == 0) {
+            known.insert(field.second);
+        }
+    }
+    return includes(known.begin(), known.end(), names.begin(), names.end());
+}
+
 void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool quietly, const qcc::IPEndpoint& destination, uint8_t type, TransportMask completeTransportMask, vector<qcc::String>& wkns, const int32_t interfaceIndex, const qcc::AddressFamily family, const qcc::IPAddress& localAddress)
 {
     //
@@ -5930,7 +6283,16 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
     // possibility in version zero and keeping in mind that we aren't going to
     // send version zero messages over our newly defined "quiet" mechanism.
     //
-    if (transportIndex == TRANSPORT_INDEX_TCP && quietly == false && (type & TRANSMIT_V0)) {
+    // Active advertisements don't change from one retransmit interval to the
+    // next, so unless we are exiting we send the messages we serialized the
+    // last time around if nothing has changed since then.
+    //
+    if (transportIndex == TRANSPORT_INDEX_TCP && quietly == false && (type & TRANSMIT_V0) &&
+        (exiting || ReplayAdvertisement(transportIndex, TRANSMIT_V0, interfaceIndex, family, localAddress) == false)) {
+        if (!exiting) {
+            BeginAdvertisementCapture(transportIndex, TRANSMIT_V0, interfaceIndex, family, localAddress);
+        }
+
         //
         // Keep track of how many messages we actually send in order to get all of
         // the advertisements out.
@@ -6116,13 +6478,21 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
         } else {
             SendOutboundMessageActively(Packet::cast(nspacket));
         }
+
+        EndAdvertisementCapture();
     }
 
     //
-    // Put together and send response packets for version one.
+    // Put together and send response packets for version one.  Quiet
+    // responses depend on the names asked for, so only active ones are cached.
     //
+    bool cacheV1 = !exiting && !quietly;
+    if ((transportIndex == TRANSPORT_INDEX_TCP) && type & TRANSMIT_V1 &&
+        (cacheV1 == false || ReplayAdvertisement(transportIndex, TRANSMIT_V1, interfaceIndex, family, localAddress) == false)) {
+        if (cacheV1) {
+            BeginAdvertisementCapture(transportIndex, TRANSMIT_V1, interfaceIndex, family, localAddress);
+        }
 
-    if ((transportIndex == TRANSPORT_INDEX_TCP) && type & TRANSMIT_V1) {
         //
         // Keep track of how many messages we actually send in order to get all of
         // the advertisements out.
@@ -6198,22 +6568,19 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
         // A user can consume all available resources here by flooding us with
         // advertisements but she will only be shooting herself in the foot.
         //
-        for (set<qcc::String>::iterator i = m_advertised[transportIndex].begin(); i != m_advertised[transportIndex].end(); ++i) {
-
-            //Do not send non-matching names if replying quietly
-            if (quietly) {
-                bool ignore = true;
-                for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
-                    //Do not send non-matching names if replying quietly
-                    if (!(WildcardMatch((*i), (*itWkn)))) {
-                        ignore = false;
-                        break;
-                    }
-                }
-                if (ignore) {
-                    continue;
-                }
+        // Do not send non-matching names if replying quietly.  The names that
+        // match what was asked for come straight out of the prefix trees.
+        //
+        set<qcc::String> matched, matchedQuietly;
+        if (quietly) {
+            for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
+                m_advertisedTrie[transportIndex].Match(*itWkn, matched);
+                m_advertisedQuietlyTrie[transportIndex].Match(*itWkn, matchedQuietly);
             }
+        }
+        const set<qcc::String>& advertised = quietly ? matched : m_advertised[transportIndex];
+
+        for (set<qcc::String>::const_iterator i = advertised.begin(); i != advertised.end(); ++i) {
             QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*i).c_str()));
 
             //
@@ -6297,20 +6664,7 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
         }
 
         if (quietly) {
-            for (set<qcc::String>::iterator i = m_advertised_quietly[transportIndex].begin(); i != m_advertised_quietly[transportIndex].end(); ++i) {
-                if (quietly) {
-                    bool ignore = true;
-                    for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
-                        //Do not send non-matching names if replying quietly
-                        if (!(WildcardMatch((*i), (*itWkn)))) {
-                            ignore = false;
-                            break;
-                        }
-                    }
-                    if (ignore) {
-                        continue;
-                    }
-                }
+            for (set<qcc::String>::const_iterator i = matchedQuietly.begin(); i != matchedQuietly.end(); ++i) {
                 QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating (quiet) \"%s\"", (*i).c_str()));
 
                 size_t currentSize = nspacket->GetSerializedSize() + isAt.GetSerializedSize();
@@ -6380,6 +6734,7 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
             }
         }
 
+        EndAdvertisementCapture();
     }
 
     if (type & TRANSMIT_V2) {
@@ -6473,6 +6828,21 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
 
         TransportMask transportMaskArr[3] = { TRANSPORT_TCP, TRANSPORT_UDP, TRANSPORT_TCP | TRANSPORT_UDP };
 
+        //
+        // If the requestor has set send_matching_only (i.e. wkns.size() > 0)
+        // collect the names that match what was asked for from the prefix
+        // trees up front.
+        //
+        set<String> matched;
+        for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
+            m_advertisedTrie[TRANSPORT_INDEX_TCP].Match(*itWkn, matched);
+            m_advertisedTrie[TRANSPORT_INDEX_UDP].Match(*itWkn, matched);
+            if (quietly) {
+                m_advertisedQuietlyTrie[TRANSPORT_INDEX_TCP].Match(*itWkn, matched);
+                m_advertisedQuietlyTrie[TRANSPORT_INDEX_UDP].Match(*itWkn, matched);
+            }
+        }
+
         for (int i = 0; i < 3; i++) {
             TransportMask tm = transportMaskArr[i];
             set<String> advertising = GetAdvertising(tm);
@@ -6484,18 +6854,8 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
             for (set<qcc::String>::iterator it = advertising.begin(); it != advertising.end(); ++it) {
 
                 //Do not send non-matching names if requestor has set send_matching_only i.e. wkns.size() > 0
-                if (wkns.size() > 0) {
-                    bool ignore = true;
-                    for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
-                        //Do not send non-matching names if requestor has set send_matching_only i.e. wkns.size() > 0
-                        if (!(WildcardMatch((*it), (*itWkn)))) {
-                            ignore = false;
-                            break;
-                        }
-                    }
-                    if (ignore) {
-                        continue;
-                    }
+                if (wkns.size() > 0 && matched.find(*it) == matched.end()) {
+                    continue;
                 }
 
                 QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating \"%s\"", (*it).c_str()));
@@ -6543,6 +6903,16 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
                         SendOutboundMessageQuietly(Packet::cast(mdnsPacket));
                     } else {
                         mdnsPacket->ClearDestination();
+                        if (interfaceIndex != -1) {
+                            mdnsPacket->SetInterfaceIndex(interfaceIndex);
+                        } else {
+                            mdnsPacket->ClearInterfaceIndex();
+                        }
+                        if (family != qcc::QCC_AF_UNSPEC) {
+                            mdnsPacket->SetAddressFamily(family);
+                        } else {
+                            mdnsPacket->ClearAddressFamily();
+                        }
                         SendOutboundMessageActively(Packet::cast(mdnsPacket));
                     }
 
@@ -6573,18 +6943,8 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
 
                 for (set<qcc::String>::iterator it = advertising_quietly.begin(); it != advertising_quietly.end(); ++it) {
                     //Do not send non-matching names if requestor has set send_matching_only i.e. wkns.size() > 0
-                    if (wkns.size() > 0) {
-                        bool ignore = true;
-                        for (vector<String>::iterator itWkn = wkns.begin(); itWkn != wkns.end(); itWkn++) {
-                            //Do not send non-matching names if requestor has set send_matching_only i.e. wkns.size() > 0
-                            if (!(WildcardMatch((*it), (*itWkn)))) {
-                                ignore = false;
-                                break;
-                            }
-                        }
-                        if (ignore) {
-                            continue;
-                        }
+                    if (wkns.size() > 0 && matched.find(*it) == matched.end()) {
+                        continue;
                     }
                     QCC_DbgPrintf(("IpNameServiceImpl::Retransmit(): Accumulating (quiet) \"%s\"", (*it).c_str()));
 
@@ -6633,6 +6993,16 @@ void IpNameServiceImpl::Retransmit(uint32_t transportIndex, bool exiting, bool q
             SendOutboundMessageQuietly(Packet::cast(mdnsPacket));
         } else {
             mdnsPacket->ClearDestination();
+            if (interfaceIndex != -1) {
+                mdnsPacket->SetInterfaceIndex(interfaceIndex);
+            } else {
+                mdnsPacket->ClearInterfaceIndex();
+            }
+            if (family != qcc::QCC_AF_UNSPEC) {
+                mdnsPacket->SetAddressFamily(family);
+            } else {
+                mdnsPacket->ClearAddressFamily();
+            }
             SendOutboundMessageActively(Packet::cast(mdnsPacket));
         }
 
@@ -6769,49 +7139,31 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, const qcc::IPEndpo
             // from V1 to support legacy thin core leaf nodes looking for router
             // nodes.
             //
-            for (set<qcc::String>::iterator j = m_advertised[index].begin(); m_enableV1 && (j != m_advertised[index].end()); ++j) {
-
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (WildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    break;
-                }
+            // The requested name comes in from the WhoHas message and we
+            // allow wildcards there, so look it up in the prefix tree rather
+            // than comparing it against every name we advertise.
+            //
+            if (m_enableV1 && m_advertisedTrie[index].Matches(wkn)) {
+                respond = true;
             }
 
             //
             // Check to see if this name on the list of names we quietly advertise.
             //
-            for (set<qcc::String>::iterator j = m_advertised_quietly[index].begin(); j != m_advertised_quietly[index].end(); ++j) {
-
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (WildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleProtocolQuestion(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    respondQuietly = true;
-                    break;
-                }
+            if (m_advertisedQuietlyTrie[index].Matches(wkn)) {
+                respond = true;
+                respondQuietly = true;
             }
         }
 
         //
         // Since any response we send must include all of the advertisements we
         // are exporting; this just means to retransmit all of our advertisements.
+        // We don't do that right away, but hand the response to the scheduler
+        // which will fold it in with the responses to other questions that
+        // arrive at about the same time.
         //
         if (respond) {
-            m_mutex.Unlock();
             qcc::AddressFamily family = qcc::QCC_AF_UNSPEC;
             if (endpoint.GetAddress().IsIPv4()) {
                 family = QCC_AF_INET;
@@ -6819,14 +7171,32 @@ void IpNameServiceImpl::HandleProtocolQuestion(WhoHas whoHas, const qcc::IPEndpo
             if (endpoint.GetAddress().IsIPv6()) {
                 family = QCC_AF_INET6;
             }
+            PendingResponse response;
+            response.m_transportIndex = index;
+            response.m_quietly = respondQuietly;
+            response.m_quietMatch = respondQuietly;
+            response.m_destination = endpoint;
+            response.m_transportMask = MaskFromIndex(index);
+            response.m_interfaceIndex = interfaceIndex;
+            response.m_family = family;
+            response.m_localAddress = localAddress;
             if (nsVersion == 0 && msgVersion == 0) {
-                vector<String> empty;
-                Retransmit(index, false, respondQuietly, endpoint, TRANSMIT_V0, MaskFromIndex(index), empty, interfaceIndex, family, localAddress);
+                response.m_type = TRANSMIT_V0;
+                response.m_allNames = true;
+                ScheduleResponse(response);
             }
             if (nsVersion == 1 && msgVersion == 1) {
-                Retransmit(index, false, respondQuietly, endpoint, TRANSMIT_V1, MaskFromIndex(index), wkns, interfaceIndex, family, localAddress);
+                //
+                // Quiet version one responses only carry the names that were
+                // asked about; active ones carry everything.
+                //
+                response.m_type = TRANSMIT_V1;
+                response.m_allNames = !respondQuietly;
+                if (respondQuietly) {
+                    response.m_wkns.insert(wkns.begin(), wkns.end());
+                }
+                ScheduleResponse(response);
             }
-            m_mutex.Lock();
         }
     }
 
@@ -7283,7 +7653,7 @@ void IpNameServiceImpl::HandleProtocolMessage(uint8_t const* buffer, uint32_t nb
         }
 
         if (mdnsPacket->GetHeader().GetQRType() == MDNSHeader::MDNS_QUERY) {
-            HandleProtocolQuery(mdnsPacket, endpoint, recvPort);
+            HandleProtocolQuery(mdnsPacket, endpoint, recvPort, interfaceIndex);
         } else {
             HandleProtocolResponse(mdnsPacket, endpoint, recvPort, interfaceIndex);
         }
@@ -7744,7 +8114,7 @@ bool IpNameServiceImpl::HandleAdvertiseResponse(MDNSPacket mdnsPacket, uint16_t
     return true;
 }
 
-void IpNameServiceImpl::HandleProtocolQuery(MDNSPacket mdnsPacket, IPEndpoint endpoint, uint16_t recvPort)
+void IpNameServiceImpl::HandleProtocolQuery(MDNSPacket mdnsPacket, IPEndpoint endpoint, uint16_t recvPort, int32_t interfaceIndex)
 {
     bool isAllJoynQuery = true;
     // Check if someone is asking about an alljoyn service.
@@ -7810,13 +8180,13 @@ void IpNameServiceImpl::HandleProtocolQuery(MDNSPacket mdnsPacket, IPEndpoint en
         m_mutex.Unlock();
         return;
     }
-    HandleSearchQuery(completeTransportMask, mdnsPacket, recvPort, guid, ns4);
+    HandleSearchQuery(completeTransportMask, mdnsPacket, recvPort, guid, ns4, interfaceIndex);
 
     m_mutex.Unlock();
 }
 
 bool IpNameServiceImpl::HandleSearchQuery(TransportMask completeTransportMask, MDNSPacket mdnsPacket, uint16_t recvPort,
-                                          const qcc::String& guid, const qcc::IPEndpoint& ns4)
+                                          const qcc::String& guid, const qcc::IPEndpoint& ns4, int32_t interfaceIndex)
 {
     QCC_DbgPrintf(("IpNameServiceImpl::HandleSearchQuery"));
     MDNSResourceRecord* searchRecord;
@@ -7865,6 +8235,7 @@ bool IpNameServiceImpl::HandleSearchQuery(TransportMask completeTransportMask, M
         // one.
         //
         bool respond = false;
+        bool quietMatch = false;
         for (int i = 0; i < searchRData->GetNumNames(); ++i) {
             String wkn = searchRData->GetNameAt(i);
             if (searchRData->SendMatchOnly()) {
@@ -7879,54 +8250,66 @@ bool IpNameServiceImpl::HandleSearchQuery(TransportMask completeTransportMask, M
             }
 
             //
-            // Check to see if this name on the list of names we actively advertise.
+            // Check to see if this name on the list of names we actively or
+            // quietly advertise.  The requested name may contain wildcards.
             //
-            for (set<String>::iterator j = m_advertised[index].begin(); j != m_advertised[index].end(); ++j) {
-
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (WildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleSearchQuery(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    break;
-                }
+            if (m_advertisedTrie[index].Matches(wkn)) {
+                respond = true;
+            }
+            if (m_advertisedQuietlyTrie[index].Matches(wkn)) {
+                respond = true;
+                quietMatch = true;
             }
+        }
 
-            //
-            // Check to see if this name on the list of names we quietly advertise.
-            //
-            for (set<String>::iterator j = m_advertised_quietly[index].begin(); j != m_advertised_quietly[index].end(); ++j) {
+        if (!respond || !ns4.GetAddress().IsIPv4()) {
+            continue;
+        }
 
-                //
-                // The requested name comes in from the WhoHas message and we
-                // allow wildcards there.
-                //
-                if (WildcardMatch((*j), wkn)) {
-                    QCC_DbgPrintf(("IpNameServiceImpl::HandleSearchQuery(): request for %s does not match my %s",
-                                   wkn.c_str(), (*j).c_str()));
-                    continue;
-                } else {
-                    respond = true;
-                    break;
+        //
+        // The asker may have told us what it already knows about us.  If that
+        // covers everything we would send, there is no point in sending it.
+        //
+        if (mdnsPacket->GetNumAnswers()) {
+            set<String> names;
+            if (searchRData->SendMatchOnly()) {
+                for (vector<String>::iterator it = wkns.begin(); it != wkns.end(); ++it) {
+                    m_advertisedTrie[TRANSPORT_INDEX_TCP].Match(*it, names);
+                    m_advertisedTrie[TRANSPORT_INDEX_UDP].Match(*it, names);
+                    m_advertisedQuietlyTrie[TRANSPORT_INDEX_TCP].Match(*it, names);
+                    m_advertisedQuietlyTrie[TRANSPORT_INDEX_UDP].Match(*it, names);
                 }
+            } else {
+                names = GetAdvertising(completeTransportMask);
+                set<String> quietNames = GetAdvertisingQuietly(completeTransportMask);
+                names.insert(quietNames.begin(), quietNames.end());
+            }
+            if (KnownAnswer(mdnsPacket, names)) {
+                QCC_DbgPrintf(("IpNameServiceImpl::HandleSearchQuery(): Known answer from %s", ns4.ToString().c_str()));
+                ++m_responsesSuppressed;
+                return true;
             }
         }
+
         //
         // Since any response we send must include all of the advertisements we
         // are exporting; this just means to retransmit all of our advertisements.
-        //
-        if (respond) {
-            m_mutex.Unlock();
-            if (ns4.GetAddress().IsIPv4()) {
-                Retransmit(index, false, true, ns4, TRANSMIT_V2, completeTransportMask, wkns);
-            }
-            m_mutex.Lock();
-        }
+        // The response doesn't depend on which transport matched, so asking
+        // the scheduler for one per matching transport results in one message.
+        //
+        PendingResponse response;
+        response.m_transportIndex = index;
+        response.m_type = TRANSMIT_V2;
+        response.m_quietly = true;
+        response.m_quietMatch = quietMatch;
+        response.m_destination = ns4;
+        response.m_transportMask = completeTransportMask;
+        response.m_allNames = wkns.empty();
+        response.m_wkns.insert(wkns.begin(), wkns.end());
+        response.m_interfaceIndex = interfaceIndex;
+        response.m_family = qcc::QCC_AF_INET;
+        response.m_localAddress = qcc::IPAddress("0.0.0.0");
+        ScheduleResponse(response);
     }
     return true;
 }
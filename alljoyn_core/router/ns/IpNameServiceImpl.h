@@ -47,6 +47,7 @@
 #include <Callback.h>
 
 #include "IpNsProtocol.h"
+#include "NameTrie.h"
 #include "IpNameService.h"
 
 namespace ajn {
@@ -179,6 +180,23 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     static const uint32_t BURST_RESPONSE_RETRIES = 3;
 
+    /**
+     * @brief The default bounds of the random delay before we answer a
+     * question.  Units are in milliseconds.  These are the shared-record
+     * delays recommended by RFC 6762 section 6.
+     */
+    static const uint32_t RESPONSE_DELAY_MIN = 20;
+    static const uint32_t RESPONSE_DELAY_MAX = 120;
+
+    /**
+     * @brief The default time for which a response we sent answers a repeat
+     * of the question that caused it.  Units are in milliseconds.  This
+     * covers the copies of a question sent in one burst, but is well short of
+     * the first locate retry interval so that a lost response is recovered by
+     * the next retry.
+     */
+    static const uint32_t RESPONSE_HOLDDOWN = 500;
+
     /**
      * @brief The maximum size of the payload of a name service message.
      *
@@ -835,6 +853,17 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     bool RemoveFromPeerInfoMap(const qcc::String& guid);
 
+    /**
+     * @internal
+     * @brief Get the counters kept by the question response scheduler.
+     *
+     * @param[out] sent        The number of responses to questions sent.
+     * @param[out] suppressed  The number of responses not sent because the
+     *                         asker had recently been sent the same answer.
+     * @param[out] coalesced   The number of responses folded into another
+     *                         response instead of being sent on their own.
+     */
+    void GetResponseCounters(uint32_t& sent, uint32_t& suppressed, uint32_t& coalesced);
 
   private:
     /**
@@ -1103,6 +1132,24 @@ class IpNameServiceImpl : public qcc::Thread {
         uint32_t interfaceIndex,
         const qcc::IPAddress& localAddress =  qcc::IPAddress("0.0.0.0"));
 
+    /**
+     * @internal
+     * @brief Send a serialized protocol message actively out over the multicast
+     * groups and subnet directed broadcast address appropriate to an interface.
+     * The parameters are as described for SendProtocolMessage().
+     */
+    void SendProtocolBuffer(
+        qcc::SocketFd sockFd,
+        qcc::IPAddress interfaceAddress,
+        uint32_t interfaceAddressPrefixLen,
+        uint32_t flags,
+        bool sockFdIsIPv4,
+        uint32_t msgVersion,
+        const uint8_t* buffer,
+        size_t size,
+        uint32_t interfaceIndex,
+        const qcc::IPAddress& localAddress);
+
 
     /**
      * @internal
@@ -1188,7 +1235,7 @@ class IpNameServiceImpl : public qcc::Thread {
      * @internal
      * @brief Do something with a received MDNS protocol query.
      */
-    void HandleProtocolQuery(MDNSPacket packet, qcc::IPEndpoint endpoint, uint16_t recvPort);
+    void HandleProtocolQuery(MDNSPacket packet, qcc::IPEndpoint endpoint, uint16_t recvPort, int32_t interfaceIndex);
 
     /**
      * @internal
@@ -1235,6 +1282,14 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     std::set<qcc::String> m_advertised_quietly[N_TRANSPORTS];
 
+    /**
+     * @internal @brief Prefix trees over m_advertised and m_advertised_quietly
+     * used to match the (possibly wildcarded) names in incoming queries.  The
+     * value stored with each name is the name itself.
+     */
+    NameTrie<qcc::String> m_advertisedTrie[N_TRANSPORTS];
+    NameTrie<qcc::String> m_advertisedQuietlyTrie[N_TRANSPORTS];
+
     /**
      * @internal
      * @brief The daemon GUID string of the daemon assoicated with this instance
@@ -1349,6 +1404,204 @@ class IpNameServiceImpl : public qcc::Thread {
      */
     void DoPeriodicMaintenance(void);
 
+    /**
+     * @internal
+     * @brief A serialized advertisement along with the socket and interface
+     * information SendProtocolMessage() used to send it.
+     */
+    class AdvertisementImage {
+      public:
+        qcc::SocketFd m_sockFd;                 /**< The socket the image was sent over */
+        qcc::IPAddress m_interfaceAddress;      /**< The address of the interface the image was sent over */
+        uint32_t m_interfaceAddressPrefixLen;   /**< The address prefix (cf netmask) of that interface */
+        uint32_t m_flags;                       /**< The IfConfig flags of that interface */
+        bool m_sockFdIsIPv4;                    /**< The address family of m_sockFd */
+        uint32_t m_msgVersion;                  /**< The message version of the serialized packet */
+        uint32_t m_interfaceIndex;              /**< The index into the live interfaces the image was sent over */
+        qcc::IPAddress m_localAddress;          /**< The local address restriction the image was sent with */
+        std::vector<uint8_t> m_buffer;          /**< The serialized packet */
+    };
+
+    /**
+     * @internal
+     * @brief The images produced by one active (not quiet, not exiting)
+     * version zero or version one retransmission of the names advertised by a
+     * transport.  Every retransmit interval produces exactly the same bytes
+     * until the advertised names, the live interfaces or the enabled ports
+     * change, so we keep them around and just send them again.
+     */
+    class AdvertisementCache {
+      public:
+        uint32_t m_transportIndex;              /**< The transport whose names are advertised */
+        uint8_t m_type;                         /**< TRANSMIT_V0 or TRANSMIT_V1 */
+        int32_t m_interfaceIndex;               /**< The interface restriction passed to Retransmit() */
+        qcc::AddressFamily m_family;            /**< The address family restriction passed to Retransmit() */
+        qcc::IPAddress m_localAddress;          /**< The local address restriction passed to Retransmit() */
+        std::vector<AdvertisementImage> m_images;   /**< What went out on the wire, in order */
+    };
+
+    /**
+     * @internal
+     * @brief The cached active advertisements.  Protected by m_mutex and
+     * emptied by InvalidateAdvertisementCache().
+     */
+    std::list<AdvertisementCache> m_advertisementCache;
+
+    /**
+     * @internal
+     * @brief If non-NULL, SendProtocolMessage() appends a copy of every
+     * actively sent message to the images in this cache entry.
+     */
+    AdvertisementCache* m_advertisementCapture;
+
+    /**
+     * @internal
+     * @brief Send the cached images of an active retransmission, if we have
+     * them.
+     *
+     * @return true if a cache entry was found and its images were sent.
+     */
+    bool ReplayAdvertisement(uint32_t transportIndex, uint8_t type, int32_t interfaceIndex, qcc::AddressFamily family, const qcc::IPAddress& localAddress);
+
+    /**
+     * @internal
+     * @brief Start recording the messages sent by an active retransmission
+     * into a new cache entry.
+     */
+    void BeginAdvertisementCapture(uint32_t transportIndex, uint8_t type, int32_t interfaceIndex, qcc::AddressFamily family, const qcc::IPAddress& localAddress);
+
+    /**
+     * @internal
+     * @brief Stop recording messages started by BeginAdvertisementCapture().
+     */
+    void EndAdvertisementCapture(void);
+
+    /**
+     * @internal
+     * @brief Throw away all cached advertisements.  Must be called with
+     * m_mutex held whenever the actively advertised names, the live interfaces,
+     * the requested interfaces, the enabled ports or the advertisement
+     * duration change.
+     */
+    void InvalidateAdvertisementCache(void);
+
+    /**
+     * @internal
+     * @brief A response to one or more received questions.  Rather than
+     * answering every question as it arrives, we hold responses for a short
+     * random time so that the answers to questions that arrive in a flurry
+     * (for example when many devices join a network at once) can go out in
+     * one message.
+     */
+    class PendingResponse {
+      public:
+        qcc::String m_key;                      /**< Identifies the content and destination of the response */
+        uint32_t m_transportIndex;              /**< The transport index passed to Retransmit() */
+        uint8_t m_type;                         /**< TRANSMIT_V0, TRANSMIT_V1 or TRANSMIT_V2 */
+        bool m_quietly;                         /**< Send the response directly to m_destination */
+        bool m_quietMatch;                      /**< A quietly advertised name was asked about */
+        qcc::IPEndpoint m_destination;          /**< Where to send a quiet response */
+        TransportMask m_transportMask;          /**< The complete transport mask passed to Retransmit() */
+        bool m_allNames;                        /**< Respond with all names, not only those matching m_wkns */
+        std::set<qcc::String> m_wkns;           /**< The names asked about */
+        int32_t m_interfaceIndex;               /**< The interface the question arrived on */
+        qcc::AddressFamily m_family;            /**< The address family of the question */
+        qcc::IPAddress m_localAddress;          /**< The local address the question arrived on */
+        uint64_t m_due;                         /**< When to send the response (cf. GetTimestamp64()) */
+
+        /**
+         * Fold another response to the same destination into this one.
+         */
+        void Merge(const PendingResponse& other)
+        {
+            m_quietMatch = m_quietMatch || other.m_quietMatch;
+            m_transportMask |= other.m_transportMask;
+            if (other.m_allNames) {
+                m_allNames = true;
+                m_wkns.clear();
+            } else if (!m_allNames) {
+                m_wkns.insert(other.m_wkns.begin(), other.m_wkns.end());
+            }
+        }
+    };
+
+    /**
+     * @internal
+     * @brief A record of a response we sent recently, used to suppress
+     * responses to questions the asker must already have the answer to.
+     */
+    class RecentResponse {
+      public:
+        uint64_t m_sent;                        /**< When the response was sent (cf. GetTimestamp64()) */
+        TransportMask m_transportMask;          /**< The complete transport mask of the response */
+        bool m_allNames;                        /**< The response included all of our names */
+        std::set<qcc::String> m_wkns;           /**< Otherwise, the names the response answered */
+    };
+
+    /**
+     * @internal
+     * @brief Responses waiting out their random delay, in no particular
+     * order.  Only touched by the main thread with m_mutex held.
+     */
+    std::list<PendingResponse> m_pendingResponses;
+
+    /**
+     * @internal
+     * @brief Responses sent within the last m_responseHoldDown milliseconds,
+     * indexed by PendingResponse::m_key.
+     */
+    std::map<qcc::String, RecentResponse> m_recentResponses;
+
+    uint32_t m_responseDelayMin;    /**< Lower bound of the random response delay in ms (ns_response_delay_min) */
+    uint32_t m_responseDelayMax;    /**< Upper bound of the random response delay in ms (ns_response_delay_max) */
+    uint32_t m_responseHoldDown;    /**< How long a response answers repeated questions in ms (ns_response_holddown) */
+
+    uint32_t m_responsesSent;       /**< Responses sent */
+    uint32_t m_responsesSuppressed; /**< Responses suppressed as duplicates or known answers */
+    uint32_t m_responsesCoalesced;  /**< Responses merged into another response */
+
+    /**
+     * @internal
+     * @brief Arrange to answer a question, unless we have recently answered
+     * it already or an answer is already pending.  Must be called with
+     * m_mutex held.
+     */
+    void ScheduleResponse(PendingResponse& response);
+
+    /**
+     * @internal
+     * @brief Send the pending responses whose delay has expired, coalescing
+     * version two responses on the same interface into one multicast
+     * response.  Must be called with m_mutex held.
+     */
+    void SendPendingResponses(void);
+
+    /**
+     * @internal
+     * @brief Send a response now and remember that we did.
+     */
+    void SendResponse(PendingResponse& response);
+
+    /**
+     * @internal
+     * @brief The number of milliseconds until the next pending response is
+     * due, or qcc::Event::WAIT_FOREVER if there are none.
+     */
+    uint32_t NextResponseDelay(void) const;
+
+    /**
+     * @internal
+     * @brief Check whether an MDNS query lists our advertisement among its
+     * known answers with enough of its lifetime left that it doesn't need
+     * refreshing.
+     *
+     * @param mdnsPacket  The query.
+     * @param names       The names we would send in response.
+     *
+     * @return true if the asker already knows all of <names>.
+     */
+    bool KnownAnswer(MDNSPacket mdnsPacket, const std::set<qcc::String>& names);
+
     /**
      * @internal
      * @brief Retransmit exported advertisements.
@@ -1606,7 +1859,7 @@ class IpNameServiceImpl : public qcc::Thread {
     BurstExpiryHandler* burstExpiryHandler;
 
     bool HandleSearchQuery(TransportMask transport, MDNSPacket mdnsPacket, uint16_t recvPort,
-                           const qcc::String& guid, const qcc::IPEndpoint& ns4);
+                           const qcc::String& guid, const qcc::IPEndpoint& ns4, int32_t interfaceIndex = -1);
 
     bool HandleAdvertiseResponse(MDNSPacket mdnsPacket, uint16_t recvPort,
                                  const qcc::String& guid, const qcc::IPEndpoint& ns4,
@@ -51,6 +51,7 @@ const uint32_t UDP_PROBE_TIMEOUT = 3000;    /**< How long to we wait on an idle
 const uint32_t UDP_PROBE_RETRIES = 5;       /**< How many times do we try to probe on an idle link before terminating the connection */
 const uint32_t UDP_DUPACK_COUNTER = 1;      /**< How many duplicate acknowledgements to we need to trigger a data retransmission */
 const uint32_t UDP_TIMEWAIT = 1000;         /**< How long do we stay in TIMWAIT state before releasing the per-connection resources */
+const uint32_t UDP_CONGESTION_CONTROL = ARDP_CC_NONE; /**< Which ArdpCongestionControl algorithm paces and limits our sends */
 
 bool g_user = false;
 char const* g_localport = "9954";
@@ -192,6 +193,7 @@ void* Test::Run(void* arg)
     config.probeRetries = UDP_PROBE_RETRIES;
     config.dupackCounter = UDP_DUPACK_COUNTER;
     config.timewait = UDP_TIMEWAIT;
+    config.congestionControl = UDP_CONGESTION_CONTROL;
 
     ArdpHandle* handle = ARDP_AllocHandle(&config);
     ARDP_SetAcceptCb(handle, AcceptCb);
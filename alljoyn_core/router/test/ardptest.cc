@@ -24,16 +24,21 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#include <algorithm>
+#include <new>
 #include <vector>
 #include <queue>
+#include <deque>
 
 #include <qcc/platform.h>
+#include <qcc/atomic.h>
 #include <qcc/Debug.h>
 #include <qcc/Event.h>
 #include <qcc/Socket.h>
 #include <qcc/SocketTypes.h>
 #include <qcc/Thread.h>
 #include <qcc/StringUtil.h>
+#include <qcc/time.h>
 #include <alljoyn/Status.h>
 
 #include <ArdpProtocol.h>
@@ -54,6 +59,7 @@ const uint32_t UDP_PROBE_TIMEOUT = 3000;    /**< How long to we wait on an idle
 const uint32_t UDP_PROBE_RETRIES = 5;       /**< How many times do we try to probe on an idle link before terminating the connection */
 const uint32_t UDP_DUPACK_COUNTER = 1;      /**< How many duplicate acknowledgements to we need to trigger a data retransmission */
 const uint32_t UDP_TIMEWAIT = 1000;         /**< How long do we stay in TIMWAIT state before releasing the per-connection resources */
+const uint32_t UDP_CONGESTION_CONTROL = ARDP_CC_NONE; /**< Which ArdpCongestionControl algorithm paces and limits our sends */
 
 char const* g_local_port = "9954";
 char const* g_foreign_port = "9955";
@@ -74,6 +80,45 @@ static void SigIntHandler(int sig)
     g_interrupt = true;
 }
 
+/*
+ * Heap allocation counter for the -bench mode.  Every operator new in the
+ * process is counted, as is every malloc() on glibc, where the protocol's
+ * receive buffer copies come from.
+ */
+static volatile int32_t g_allocs = 0;
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    IncrementAndFetch(&g_allocs);
+    return __libc_malloc(size);
+}
+#endif
+
+void* operator new(size_t size)
+{
+    IncrementAndFetch(&g_allocs);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size)
+{
+    IncrementAndFetch(&g_allocs);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p)
+{
+    free(p);
+}
+
+void operator delete[](void* p)
+{
+    free(p);
+}
+
 char* get_line(char*str, size_t num, FILE*fp)
 {
     char*p = fgets(str, num, fp);
@@ -216,6 +261,371 @@ class ThreadClass : public Thread {
 
 };
 
+/*
+ * Loopback throughput benchmark (-bench <seconds>).  Two ARDP handles live in
+ * this process, each on its own UDP socket: the passive one accepts -conns
+ * connections from the active one, which then sends -size byte messages
+ * round-robin across them until the run ends.  The receiver hands every
+ * buffer straight back with ARDP_RecvReady().  With many connections the
+ * aggregate number of unconsumed messages is capped at BENCH_MAX_INFLIGHT so
+ * the run measures per-segment protocol cost rather than socket overruns.
+ */
+static const uint32_t BENCH_MAX_INFLIGHT = 256;
+static std::vector<ArdpConnRecord*> g_benchPending;
+static std::vector<ArdpConnRecord*> g_benchSenders;
+static uint64_t g_benchSegments = 0;
+static uint64_t g_benchBytes = 0;
+static std::queue<std::pair<ArdpConnRecord*, ArdpRcvBuf*> > g_benchRecvd;
+static uint16_t g_benchSegmax = ARDP_SEGMAX;
+static uint16_t g_benchSegbmax = ARDP_SEGBMAX;
+
+static bool BenchAcceptCb(ArdpHandle* handle, qcc::IPAddress ipAddr, uint16_t ipPort, ArdpConnRecord* conn, uint8_t* buf, uint16_t len, QStatus status)
+{
+    g_benchPending.push_back(conn);
+    return true;
+}
+
+static void BenchConnectCb(ArdpHandle* handle, ArdpConnRecord* conn, bool passive, uint8_t* buf, uint16_t len, QStatus status)
+{
+    if (!passive && status == ER_OK) {
+        g_benchSenders.push_back(conn);
+    }
+}
+
+static void BenchDisconnectCb(ArdpHandle* handle, ArdpConnRecord* conn, QStatus status)
+{
+    std::vector<ArdpConnRecord*>::iterator it = std::find(g_benchSenders.begin(), g_benchSenders.end(), conn);
+    if (it != g_benchSenders.end()) {
+        g_benchSenders.erase(it);
+    }
+}
+
+static void BenchRecvCb(ArdpHandle* handle, ArdpConnRecord* conn, ArdpRcvBuf* rcv, QStatus status)
+{
+    ArdpRcvBuf* buf = rcv;
+    for (uint16_t i = 0; i < rcv->fcnt; i++) {
+        g_benchSegments++;
+        g_benchBytes += buf->datalen;
+        buf = buf->next;
+    }
+    g_benchRecvd.push(std::make_pair(conn, rcv));
+}
+
+static void BenchSendCb(ArdpHandle* handle, ArdpConnRecord* conn, uint8_t* buf, uint32_t len, QStatus status)
+{
+}
+
+static void BenchSendWindowCb(ArdpHandle* handle, ArdpConnRecord* conn, uint16_t window, QStatus status)
+{
+}
+
+static QStatus BenchSocket(const char* address, const char* port, qcc::SocketFd& sock)
+{
+    QStatus status = qcc::Socket(qcc::QCC_AF_INET, qcc::QCC_SOCK_DGRAM, sock);
+    if (status == ER_OK) {
+        status = qcc::SetBlocking(sock, false);
+    }
+    if (status == ER_OK) {
+        /*
+         * A full window of large segments overruns the default receive
+         * buffer and the run then measures retransmit timeouts instead of
+         * the receive path.
+         */
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        status = qcc::Bind(sock, qcc::IPAddress(address), atoi(port));
+    }
+    return status;
+}
+
+/*
+ * Impairment shim for the benchmark (-loss, -delay, -rate).  When any of them
+ * is set the sender connects to a relay socket on the port after -fp instead
+ * of the receiver.  The relay forwards datagrams both ways, dropping -loss
+ * percent of them and holding each for -delay ms.  In the data direction it
+ * also models a -rate KB/s bottleneck link behind a -queue KB drop-tail
+ * buffer, which is what congestion control is up against on a busy Wi-Fi hop.
+ */
+struct ShimPacket {
+    double due;
+    uint16_t toPort;
+    std::vector<uint8_t> data;
+};
+
+static uint32_t g_shimLoss = 0;          /* Drop probability in units of 0.01% */
+static uint32_t g_shimDelay = 0;         /* One-way delay in ms */
+static uint32_t g_shimRate = 0;          /* Bottleneck rate in KB/s, 0 for unlimited */
+static uint32_t g_shimQueue = 64;        /* Bottleneck buffer in KB */
+static uint32_t g_shimSeed = 2463534242U;
+static std::deque<ShimPacket> g_shimData;
+static std::deque<ShimPacket> g_shimAcks;
+static double g_shimLinkFree = 0;
+static uint64_t g_shimDrops = 0;
+static uint64_t g_shimOverflows = 0;
+
+static bool ShimEnabled()
+{
+    return g_shimLoss != 0 || g_shimDelay != 0 || g_shimRate != 0;
+}
+
+static bool ShimDrop()
+{
+    /* A private xorshift generator: ARDP_AllocHandle() reseeds rand() */
+    g_shimSeed ^= g_shimSeed << 13;
+    g_shimSeed ^= g_shimSeed >> 17;
+    g_shimSeed ^= g_shimSeed << 5;
+    return (g_shimSeed % 10000) < g_shimLoss;
+}
+
+static double ShimNow()
+{
+    qcc::Timespec now;
+    qcc::GetTimeNow(&now);
+    return now.seconds * 1000.0 + now.mseconds;
+}
+
+/* Pull everything off the relay socket, then forward whatever is due.  Returns ms until the next departure */
+static uint32_t ShimPump(qcc::SocketFd relay, uint16_t dataPort, uint16_t ackPort, uint8_t* buf, size_t bufLen)
+{
+    double now = ShimNow();
+    for (;;) {
+        qcc::IPAddress addr;
+        uint16_t port;
+        size_t len;
+        if (qcc::RecvFrom(relay, addr, port, buf, bufLen, len) != ER_OK) {
+            break;
+        }
+        if (ShimDrop()) {
+            ++g_shimDrops;
+            continue;
+        }
+        ShimPacket pkt;
+        pkt.data.assign(buf, buf + len);
+        if (port == ackPort) {
+            /* Sender to receiver: through the bottleneck */
+            pkt.toPort = dataPort;
+            double depart = now;
+            if (g_shimRate != 0) {
+                double backlog = (g_shimLinkFree > now) ? (g_shimLinkFree - now) * g_shimRate : 0;
+                if (backlog + len > g_shimQueue * 1024.0) {
+                    ++g_shimOverflows;
+                    continue;
+                }
+                g_shimLinkFree = std::max(g_shimLinkFree, now) + len / (double)g_shimRate;
+                depart = g_shimLinkFree;
+            }
+            pkt.due = depart + g_shimDelay;
+            g_shimData.push_back(pkt);
+        } else {
+            pkt.toPort = ackPort;
+            pkt.due = now + g_shimDelay;
+            g_shimAcks.push_back(pkt);
+        }
+    }
+
+    qcc::IPAddress local(g_local_address);
+    std::deque<ShimPacket>* queues[2] = { &g_shimData, &g_shimAcks };
+    double next = now + 100;
+    for (int q = 0; q < 2; ++q) {
+        std::deque<ShimPacket>& queue = *queues[q];
+        while (!queue.empty() && queue.front().due <= now) {
+            size_t sent;
+            qcc::SendTo(relay, local, queue.front().toPort, &queue.front().data[0], queue.front().data.size(), sent);
+            queue.pop_front();
+        }
+        if (!queue.empty()) {
+            next = std::min(next, queue.front().due);
+        }
+    }
+    return (uint32_t)(next - now);
+}
+
+static ArdpHandle* BenchHandle(ArdpGlobalConfig& config)
+{
+    ArdpHandle* handle = ARDP_AllocHandle(&config);
+    ARDP_SetAcceptCb(handle, BenchAcceptCb);
+    ARDP_SetConnectCb(handle, BenchConnectCb);
+    ARDP_SetDisconnectCb(handle, BenchDisconnectCb);
+    ARDP_SetRecvCb(handle, BenchRecvCb);
+    ARDP_SetSendCb(handle, BenchSendCb);
+    ARDP_SetSendWindowCb(handle, BenchSendWindowCb);
+    return handle;
+}
+
+static int RunBenchmark(ArdpGlobalConfig& config, uint32_t seconds, uint32_t size, uint32_t nconns)
+{
+    qcc::SocketFd rxSock;
+    qcc::SocketFd txSock;
+    QStatus status = BenchSocket(g_local_address, g_local_port, rxSock);
+    if (status == ER_OK) {
+        status = BenchSocket(g_foreign_address, g_foreign_port, txSock);
+    }
+    if (status != ER_OK) {
+        printf("Unable to set up loopback sockets: %s\n", QCC_StatusText(status));
+        return 1;
+    }
+
+    qcc::SocketFd relaySock = qcc::INVALID_SOCKET_FD;
+    uint16_t connectPort = atoi(g_local_port);
+    char relayPort[8];
+    snprintf(relayPort, sizeof(relayPort), "%d", atoi(g_foreign_port) + 1);
+    if (ShimEnabled()) {
+        status = BenchSocket(g_local_address, relayPort, relaySock);
+        if (status != ER_OK) {
+            printf("Unable to set up relay socket: %s\n", QCC_StatusText(status));
+            return 1;
+        }
+        connectPort = atoi(relayPort);
+    }
+    uint8_t* relayBuf = new uint8_t[65536];
+
+    ArdpHandle* rx = BenchHandle(config);
+    ArdpHandle* tx = BenchHandle(config);
+    ARDP_StartPassive(rx);
+
+    /* Connection timestamps are relative to handle creation; keep them off zero */
+    qcc::Sleep(10);
+
+    for (uint32_t i = 0; i < nconns; ++i) {
+        ArdpConnRecord* conn;
+        status = ARDP_Connect(tx, txSock, qcc::IPAddress(g_local_address), connectPort, g_benchSegmax, g_benchSegbmax, &conn, (uint8_t*)g_ajnConnString, strlen(g_ajnConnString) + 1, NULL);
+        if (status != ER_OK) {
+            printf("ARDP_Connect failed: %s\n", QCC_StatusText(status));
+            return 1;
+        }
+    }
+    uint64_t setupDeadline = qcc::GetTimestamp64() + 30000;
+
+    /* Nothing ever writes to the payload, so every in-flight send can share it */
+    uint8_t* payload = new uint8_t[size];
+    memset(payload, 0xa5, size);
+
+    qcc::Event rxEvent(rxSock, qcc::Event::IO_READ);
+    qcc::Event txEvent(txSock, qcc::Event::IO_READ);
+    std::vector<qcc::Event*> checkEvents;
+    checkEvents.push_back(&rxEvent);
+    checkEvents.push_back(&txEvent);
+    qcc::Event* relayEvent = NULL;
+    if (relaySock != qcc::INVALID_SOCKET_FD) {
+        relayEvent = new qcc::Event(relaySock, qcc::Event::IO_READ);
+        checkEvents.push_back(relayEvent);
+    }
+
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    size_t cursor = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+    int32_t allocsAtStart = 0;
+    uint64_t segmentsAtStart = 0;
+    uint64_t bytesAtStart = 0;
+    uint32_t wakeups = 0;
+    uint32_t rxMs = 0;
+    uint32_t txMs = 0;
+    uint32_t relayMs = ARDP_NO_TIMEOUT;
+    std::vector<qcc::Event*> signaledEvents;
+
+    while (!g_interrupt) {
+        /* Sleep until a socket is readable or the earlier of the two protocol timers is due */
+        signaledEvents.clear();
+        qcc::Event::Wait(checkEvents, signaledEvents, std::min(std::min(std::min(rxMs, txMs), relayMs), (uint32_t)100));
+        bool rxReady = false;
+        bool txReady = false;
+        for (std::vector<qcc::Event*>::iterator it = signaledEvents.begin(); it != signaledEvents.end(); ++it) {
+            rxReady |= (*it == &rxEvent);
+            txReady |= (*it == &txEvent);
+        }
+        ARDP_Run(rx, rxSock, rxReady, &rxMs);
+        ARDP_Run(tx, txSock, txReady, &txMs);
+        if (relayEvent) {
+            relayMs = ShimPump(relaySock, atoi(g_local_port), atoi(g_foreign_port), relayBuf, 65536);
+        }
+
+        for (size_t i = 0; i < g_benchPending.size(); ++i) {
+            status = ARDP_Accept(rx, g_benchPending[i], g_benchSegmax, g_benchSegbmax, (uint8_t*)g_ajnAcceptString, strlen(g_ajnAcceptString) + 1);
+            if (status != ER_OK) {
+                printf("ARDP_Accept failed: %s\n", QCC_StatusText(status));
+                break;
+            }
+        }
+        g_benchPending.clear();
+
+        while (!g_benchRecvd.empty()) {
+            ARDP_RecvReady(rx, g_benchRecvd.front().first, g_benchRecvd.front().second);
+            g_benchRecvd.pop();
+            ++received;
+        }
+
+        if (start == 0 && g_benchSenders.size() < nconns) {
+            if (qcc::GetTimestamp64() >= setupDeadline) {
+                printf("ardp loopback: only %u of %u connections opened\n", (uint32_t)g_benchSenders.size(), nconns);
+                break;
+            }
+            continue;
+        }
+        if (g_benchSenders.empty()) {
+            break;
+        }
+
+        if (start == 0) {
+            start = qcc::GetTimestamp64();
+            end = start + seconds * 1000;
+            allocsAtStart = g_allocs;
+            segmentsAtStart = g_benchSegments;
+            bytesAtStart = g_benchBytes;
+        } else if (qcc::GetTimestamp64() >= end) {
+            break;
+        }
+        ++wakeups;
+
+        /* Round-robin across the connections, skipping any whose window is full */
+        uint32_t blocked = 0;
+        while (sent - received < BENCH_MAX_INFLIGHT && blocked < g_benchSenders.size()) {
+            cursor = (cursor + 1) % g_benchSenders.size();
+            if (ARDP_Send(tx, g_benchSenders[cursor], payload, size, 0) == ER_OK) {
+                ++sent;
+                blocked = 0;
+            } else {
+                ++blocked;
+            }
+        }
+    }
+
+    if (start != 0) {
+        double elapsed = (qcc::GetTimestamp64() - start) / 1000.0;
+        uint64_t segments = g_benchSegments - segmentsAtStart;
+        uint64_t bytes = g_benchBytes - bytesAtStart;
+        int32_t allocs = g_allocs - allocsAtStart;
+        static const char* ccNames[] = { "none", "newreno", "bbr" };
+        printf("ardp loopback: %u connections, %u byte messages for %.2f s, %u wakeups, congestion control %s\n",
+               nconns, size, elapsed, wakeups, ccNames[config.congestionControl % (sizeof(ccNames) / sizeof(ccNames[0]))]);
+        if (relayEvent) {
+            printf("  shim: loss %.2f%%, delay %u ms, rate %u KB/s, queue %u KB: %llu dropped, %llu overflowed\n",
+                   g_shimLoss / 100.0, g_shimDelay, g_shimRate, g_shimQueue,
+                   (unsigned long long)g_shimDrops, (unsigned long long)g_shimOverflows);
+        }
+        printf("  sent %llu messages, received %llu segments (%.1f MB)\n",
+               (unsigned long long)sent, (unsigned long long)segments, bytes / (1024.0 * 1024.0));
+        printf("  segments/s:     %.0f\n", segments / elapsed);
+        printf("  MB/s:           %.2f\n", bytes / elapsed / (1024.0 * 1024.0));
+        printf("  allocations/s:  %.0f (%.2f per segment)\n", allocs / elapsed, segments ? (double)allocs / segments : 0.0);
+    } else if (g_benchSenders.empty()) {
+        printf("ardp loopback: connection never opened\n");
+    }
+
+    ARDP_FreeHandle(tx);
+    ARDP_FreeHandle(rx);
+    qcc::Close(txSock);
+    qcc::Close(rxSock);
+    if (relayEvent) {
+        delete relayEvent;
+        qcc::Close(relaySock);
+    }
+    delete [] relayBuf;
+    delete [] payload;
+    return (start != 0) ? 0 : 1;
+}
+
 static void Print_Conn() {
     std::map<uint32_t, ArdpConnRecord*>::iterator it;
     printf("===================================================== \n");
@@ -236,11 +646,21 @@ static void usage() {
     printf("exit \n");
     printf("help \n");
     printf("list \n");
+    printf("\n");
+    printf("Command line: ardptest [-la addr] [-lp port] [-fa addr] [-fp port] [-bench seconds [-size bytes] [-conns n] [-segmax n] [-segbmax bytes]\n");
+    printf("                      [-cc none|newreno|bbr] [-loss percent] [-delay ms] [-rate KB/s [-queue KB]]]\n");
+    printf("  -bench runs a loopback throughput test between the local and foreign ports and exits\n");
+    printf("  -segmax and -segbmax override the window and segment size the benchmark connections ask for\n");
+    printf("  -cc picks the congestion controller; -loss, -delay and -rate route the test through an impairment relay\n");
 }
 
 int main(int argc, char** argv)
 {
     QStatus status = ER_OK;
+    uint32_t benchSeconds = 0;
+    uint32_t benchSize = 1024;
+    uint32_t benchConns = 1;
+    uint32_t benchCc = UDP_CONGESTION_CONTROL;
 
     for (int i = 1; i < argc; ++i) {
         if (0 == strcmp("-lp", argv[i])) {
@@ -255,6 +675,45 @@ int main(int argc, char** argv)
         } else if (0 == strcmp("-fa", argv[i])) {
             g_foreign_address = argv[i + 1];
             i++;
+        } else if (0 == strcmp("-bench", argv[i]) && i + 1 < argc) {
+            benchSeconds = StringToU32(argv[i + 1], 0, 10);
+            i++;
+        } else if (0 == strcmp("-size", argv[i]) && i + 1 < argc) {
+            benchSize = StringToU32(argv[i + 1], 0, 1024);
+            i++;
+        } else if (0 == strcmp("-conns", argv[i]) && i + 1 < argc) {
+            benchConns = std::max(StringToU32(argv[i + 1], 0, 1), (uint32_t)1);
+            i++;
+        } else if (0 == strcmp("-segmax", argv[i]) && i + 1 < argc) {
+            g_benchSegmax = (uint16_t)StringToU32(argv[i + 1], 0, ARDP_SEGMAX);
+            i++;
+        } else if (0 == strcmp("-segbmax", argv[i]) && i + 1 < argc) {
+            g_benchSegbmax = (uint16_t)StringToU32(argv[i + 1], 0, ARDP_SEGBMAX);
+            i++;
+        } else if (0 == strcmp("-cc", argv[i]) && i + 1 < argc) {
+            if (0 == strcmp("none", argv[i + 1])) {
+                benchCc = ARDP_CC_NONE;
+            } else if (0 == strcmp("newreno", argv[i + 1])) {
+                benchCc = ARDP_CC_NEWRENO;
+            } else if (0 == strcmp("bbr", argv[i + 1])) {
+                benchCc = ARDP_CC_BBR;
+            } else {
+                printf("Unknown congestion control %s\n", argv[i + 1]);
+                exit(0);
+            }
+            i++;
+        } else if (0 == strcmp("-loss", argv[i]) && i + 1 < argc) {
+            g_shimLoss = (uint32_t)(StringToDouble(argv[i + 1]) * 100);
+            i++;
+        } else if (0 == strcmp("-delay", argv[i]) && i + 1 < argc) {
+            g_shimDelay = StringToU32(argv[i + 1], 0, 0);
+            i++;
+        } else if (0 == strcmp("-rate", argv[i]) && i + 1 < argc) {
+            g_shimRate = StringToU32(argv[i + 1], 0, 0);
+            i++;
+        } else if (0 == strcmp("-queue", argv[i]) && i + 1 < argc) {
+            g_shimQueue = StringToU32(argv[i + 1], 0, 64);
+            i++;
         } else {
             printf("Unknown option %s\n", argv[i]);
             exit(0);
@@ -268,6 +727,23 @@ int main(int argc, char** argv)
 
     signal(SIGINT, SigIntHandler);
 
+    //Populate default values for timers, couters, etc.
+    ArdpGlobalConfig config;
+    config.connectTimeout = UDP_CONNECT_TIMEOUT;
+    config.connectRetries = UDP_CONNECT_RETRIES;
+    config.dataTimeout = UDP_DATA_TIMEOUT;
+    config.dataRetries = UDP_DATA_RETRIES;
+    config.persistTimeout = UDP_PERSIST_TIMEOUT;
+    config.persistRetries = UDP_PERSIST_RETRIES;
+    config.probeTimeout = UDP_PROBE_TIMEOUT;
+    config.probeRetries = UDP_PROBE_RETRIES;
+    config.dupackCounter = UDP_DUPACK_COUNTER;
+    config.timewait = UDP_TIMEWAIT;
+    config.congestionControl = benchCc;
+
+    if (benchSeconds > 0) {
+        return RunBenchmark(config, benchSeconds, benchSize, benchConns);
+    }
 
     //One time activity- Create a socket, set to blocking, bind it to local port, local address
     qcc::SocketFd sock;
@@ -290,19 +766,6 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    //Populate default values for timers, couters, etc.
-    ArdpGlobalConfig config;
-    config.connectTimeout = UDP_CONNECT_TIMEOUT;
-    config.connectRetries = UDP_CONNECT_RETRIES;
-    config.dataTimeout = UDP_DATA_TIMEOUT;
-    config.dataRetries = UDP_DATA_RETRIES;
-    config.persistTimeout = UDP_PERSIST_TIMEOUT;
-    config.persistRetries = UDP_PERSIST_RETRIES;
-    config.probeTimeout = UDP_PROBE_TIMEOUT;
-    config.probeRetries = UDP_PROBE_RETRIES;
-    config.dupackCounter = UDP_DUPACK_COUNTER;
-    config.timewait = UDP_TIMEWAIT;
-
     //Allocate a handle (ARDP protocol instance).
     ArdpHandle* handle = ARDP_AllocHandle(&config);
 
@@ -21,6 +21,8 @@
 
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
+#include <set>
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
@@ -30,13 +32,17 @@
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 #include <qcc/IfConfig.h>
+#include <qcc/Mutex.h>
 #include <qcc/GUID.h>
 #include <qcc/Thread.h>  // For qcc::Sleep()
+#include <qcc/time.h>
 
 #include <alljoyn/Status.h>
 #include <ns/IpNameService.h>
 #include <ns/IpNameServiceImpl.h>
 #include <ConfigDB.h>
+#include <NameTrie.h>
+#include <BusUtil.h>
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -46,6 +52,16 @@ static const char config[] =
     "<busconfig>"
     "</busconfig>";
 
+//
+// Answer every question as soon as it arrives, the way the name service did
+// before it learned to suppress and coalesce responses.
+//
+static const char configNoSuppression[] =
+    "<busconfig>"
+    "  <limit name=\"ns_response_delay_max\">0</limit>"
+    "  <limit name=\"ns_response_holddown\">0</limit>"
+    "</busconfig>";
+
 char const* g_names[] = {
     "org.randomteststring.A",
     "org.randomteststring.B",
@@ -204,6 +220,203 @@ static void PrintFlags(uint32_t flags)
 
 #define ERROR_EXIT exit(1)
 
+//
+// Compare the way the name service used to match the names in a query against
+// its advertisements (WildcardMatch() on every advertised name) with the
+// prefix tree it uses now.
+//
+static void Benchmark(uint32_t numNames, uint32_t iterations)
+{
+    std::set<qcc::String> advertised;
+    NameTrie<qcc::String> trie;
+
+    for (uint32_t i = 0; i < numNames; ++i) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "org.alljoyn.bench.d%u.n%u", i % 100, i);
+        advertised.insert(buf);
+        trie.Insert(buf, buf);
+    }
+
+    char const* queries[] = {
+        "org.alljoyn.bench.d42.n4242",      // exact hit
+        "org.alljoyn.bench.d42.n4243",      // exact miss
+        "org.alljoyn.bench.d42.*",          // prefix, 1% of the names
+        "org.alljoyn.bench.*",              // prefix, all of the names
+        "org.alljoyn.bench.d4?.n4242",      // wildcard in the middle
+        "com.example.*",                    // prefix miss
+    };
+
+    printf("%u advertised names, %u iterations per query\n", numNames, iterations);
+    printf("%-32s %8s %12s %12s\n", "query", "matches", "linear(us)", "trie(us)");
+
+    for (uint32_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q) {
+        qcc::String pattern(queries[q]);
+
+        std::set<qcc::String> linearMatches;
+        uint64_t start = qcc::GetTimestamp64();
+        for (uint32_t n = 0; n < iterations; ++n) {
+            linearMatches.clear();
+            for (std::set<qcc::String>::iterator it = advertised.begin(); it != advertised.end(); ++it) {
+                if (!WildcardMatch(*it, pattern)) {
+                    linearMatches.insert(*it);
+                }
+            }
+        }
+        uint64_t linear = qcc::GetTimestamp64() - start;
+
+        std::set<qcc::String> trieMatches;
+        start = qcc::GetTimestamp64();
+        for (uint32_t n = 0; n < iterations; ++n) {
+            trieMatches.clear();
+            trie.Match(pattern, trieMatches);
+        }
+        uint64_t tried = qcc::GetTimestamp64() - start;
+
+        if (linearMatches != trieMatches) {
+            printf("Mismatch for %s: %u linear, %u trie\n", queries[q],
+                   static_cast<uint32_t>(linearMatches.size()), static_cast<uint32_t>(trieMatches.size()));
+            ERROR_EXIT;
+        }
+
+        printf("%-32s %8u %12.1f %12.1f\n", queries[q], static_cast<uint32_t>(trieMatches.size()),
+               1000.0 * linear / iterations, 1000.0 * tried / iterations);
+    }
+}
+
+//
+// Counts the distinct names each name service instance in a storm finds.
+//
+class StormFinder {
+  public:
+    void Callback(const qcc::String& busAddr, const qcc::String& guid, std::vector<qcc::String>& wkn, uint32_t timer)
+    {
+        m_lock.Lock();
+        if (timer) {
+            m_found.insert(wkn.begin(), wkn.end());
+        }
+        m_lock.Unlock();
+    }
+
+    size_t Found()
+    {
+        m_lock.Lock();
+        size_t found = m_found.size();
+        m_lock.Unlock();
+        return found;
+    }
+
+  private:
+    qcc::Mutex m_lock;
+    std::set<qcc::String> m_found;
+};
+
+//
+// Start a number of name service instances in this process, all talking over
+// the same interface (multicast is looped back to us), have each of them
+// advertise a name and then have all of them look for every name at the same
+// time, as happens when many devices join a network at once.  Returns the
+// number of responses the instances sent between them.
+//
+static uint32_t Storm(uint32_t numInstances, bool suppress, const qcc::String& interface)
+{
+    ConfigDB configdb(suppress ? config : configNoSuppression);
+    if (!configdb.LoadConfig()) {
+        printf("Failed to load the internal config.\n");
+        ERROR_EXIT;
+    }
+
+    std::vector<IpNameServiceImpl*> instances;
+    std::vector<StormFinder*> finders;
+    for (uint32_t i = 0; i < numInstances; ++i) {
+        IpNameServiceImpl* ns = new IpNameServiceImpl();
+        StormFinder* finder = new StormFinder();
+        instances.push_back(ns);
+        finders.push_back(finder);
+
+        QStatus status = ns->Init(qcc::GUID128().ToString(), true);
+        if (status == ER_OK) {
+            status = ns->Start();
+        }
+        if (status == ER_OK) {
+            status = ns->OpenInterface(TRANSPORT_TCP, interface);
+        }
+        if (status == ER_OK) {
+            uint16_t port = 9955 + i;
+            std::map<qcc::String, uint16_t> portMap;
+            portMap["*"] = port;
+            status = ns->Enable(TRANSPORT_TCP, portMap, port, portMap, port, true, true, true, true);
+        }
+        if (status == ER_OK) {
+            ns->SetCallback(TRANSPORT_TCP, new CallbackImpl<StormFinder, void, const qcc::String&, const qcc::String&,
+                                                            std::vector<qcc::String>&, uint32_t>(finder, &StormFinder::Callback));
+            char wkn[64];
+            snprintf(wkn, sizeof(wkn), "org.alljoyn.storm.d%u", i);
+            status = ns->AdvertiseName(TRANSPORT_TCP, wkn, false, TRANSPORT_TCP);
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to set up name service instance %u", i));
+            ERROR_EXIT;
+        }
+    }
+
+    //
+    // Let the initial advertisements die down before everyone starts asking.
+    //
+    qcc::Sleep(2000);
+
+    uint32_t sent0 = 0, suppressed0 = 0, coalesced0 = 0;
+    for (uint32_t i = 0; i < numInstances; ++i) {
+        uint32_t sent, suppressed, coalesced;
+        instances[i]->GetResponseCounters(sent, suppressed, coalesced);
+        sent0 += sent;
+        suppressed0 += suppressed;
+        coalesced0 += coalesced;
+    }
+
+    for (uint32_t i = 0; i < numInstances; ++i) {
+        QStatus status = instances[i]->FindAdvertisement(TRANSPORT_TCP, "name='org.alljoyn.storm.*'", IpNameServiceImpl::ALWAYS_RETRY, TRANSPORT_TCP);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("FindAdvertisement failed"));
+            ERROR_EXIT;
+        }
+    }
+
+    //
+    // Wait out the first few locate retries.
+    //
+    qcc::Sleep(5000);
+
+    uint32_t totalSent = 0, totalSuppressed = 0, totalCoalesced = 0;
+    size_t minFound = numInstances;
+    for (uint32_t i = 0; i < numInstances; ++i) {
+        uint32_t sent, suppressed, coalesced;
+        instances[i]->GetResponseCounters(sent, suppressed, coalesced);
+        totalSent += sent;
+        totalSuppressed += suppressed;
+        totalCoalesced += coalesced;
+        minFound = std::min(minFound, finders[i]->Found());
+    }
+    totalSent -= sent0;
+    totalSuppressed -= suppressed0;
+    totalCoalesced -= coalesced0;
+
+    printf("%-14s %10u %10u %10u %12u/%u\n", suppress ? "suppression" : "no suppression",
+           totalSent, totalSuppressed, totalCoalesced, static_cast<uint32_t>(minFound), numInstances - 1);
+
+    for (uint32_t i = 0; i < numInstances; ++i) {
+        instances[i]->Stop();
+        instances[i]->Join();
+        delete instances[i];
+        delete finders[i];
+    }
+
+    if (minFound < numInstances - 1) {
+        printf("Not every instance found every other instance\n");
+        ERROR_EXIT;
+    }
+    return totalSent;
+}
+
 int main(int argc, char** argv)
 {
     QStatus status;
@@ -214,14 +427,20 @@ int main(int argc, char** argv)
     bool runtests = false;
     bool wildcard = false;
     bool longnames = false;
+    bool benchmark = false;
+    uint32_t storm = 0;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp("-a", argv[i]) == 0) {
             advertise = true;
+        } else if (strcmp("-b", argv[i]) == 0) {
+            benchmark = true;
         } else if (strcmp("-e", argv[i]) == 0) {
             useEth0 = true;
         } else if (strcmp("-l", argv[i]) == 0) {
             longnames = true;
+        } else if (strcmp("-s", argv[i]) == 0 && i + 1 < argc) {
+            storm = strtoul(argv[++i], NULL, 10);
         } else if (strcmp("-t", argv[i]) == 0) {
             runtests = true;
         } else if (strcmp("-w", argv[i]) == 0) {
@@ -236,6 +455,38 @@ int main(int argc, char** argv)
         exit(0);
     }
 
+    if (benchmark) {
+        Benchmark(5000, 1000);
+        exit(0);
+    }
+
+    if (storm > 1) {
+        std::vector<qcc::IfConfigEntry> entries;
+        status = qcc::IfConfig(entries);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("IfConfig failed"));
+            ERROR_EXIT;
+        }
+        qcc::String interface;
+        for (uint32_t i = 0; interface.empty() && i < entries.size(); ++i) {
+            uint32_t flags = entries[i].m_flags;
+            if ((flags & qcc::IfConfigEntry::UP) && (flags & qcc::IfConfigEntry::MULTICAST) && !(flags & qcc::IfConfigEntry::LOOPBACK)) {
+                interface = entries[i].m_name;
+            }
+        }
+        if (interface.empty()) {
+            printf("No multicast interface to run the storm over\n");
+            ERROR_EXIT;
+        }
+
+        printf("%u name service instances over %s\n", storm, interface.c_str());
+        printf("%-14s %10s %10s %10s %14s\n", "", "sent", "suppressed", "coalesced", "min found");
+        uint32_t before = Storm(storm, false, interface);
+        uint32_t after = Storm(storm, true, interface);
+        printf("Responses reduced from %u to %u\n", before, after);
+        exit(0);
+    }
+
     //
     // Load the configuration information
     //
@@ -26,6 +26,7 @@
 #endif
 
 #include <qcc/platform.h>
+#include <qcc/Crypto.h>
 #include <qcc/KeyBlob.h>
 
 #include <alljoyn/Message.h>
@@ -48,6 +49,7 @@ class Crypto {
      *
      * @param message         The message being encrypted
      * @param keyBlob         The key blob containing the key for the encryption operation.
+     * @param aes             The AES-CCM context for the key in the key blob.
      * @param msgBuf          The message data to be encrypted. The data buffer must be large enough to handle
      *                        the expansion specified in the ExpansionBytes member variable.
      * @param hdrLen          The length of the header part of the message that will not be encrypted.
@@ -58,7 +60,7 @@ class Crypto {
      *         - ER_BUS_KEYBLOB_OP_INVALID if the key blob cannot be used for encryption.
      *         - Other errors if the arguments are invalid.
      */
-    static QStatus Encrypt(const _Message& message, const qcc::KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+    static QStatus Encrypt(const _Message& message, const qcc::KeyBlob& keyBlob, qcc::Crypto_AES* aes, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
 
     /**
      * Decrypt and authenticate marshaled message inplace using the key blob provided and the
@@ -66,6 +68,7 @@ class Crypto {
      *
      * @param message         The message being decrypted
      * @param keyBlob         The key blob containing the key for the decryption operation.
+     * @param aes             The AES-CCM context for the key in the key blob.
      * @param msgBuf          The message data to be decrypted.
      * @param hdrLen          The length of the non-encrypted header part of the message.
      * @param bodyLen[in/out] On input the size of the crypttext body, on output the size of the
@@ -75,7 +78,7 @@ class Crypto {
      *         - ER_BUS_KEYBLOB_OP_INVALID if the key blob cannot be used for decryption.
      *         - Other errors if the arguments are invalid.
      */
-    static QStatus Decrypt(const _Message& message, const qcc::KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+    static QStatus Decrypt(const _Message& message, const qcc::KeyBlob& keyBlob, qcc::Crypto_AES* aes, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
 
     /**
      * Compute a SHA1 hash over the header fields and return the result in a key blob.
@@ -117,6 +117,7 @@ BusAttachment::Internal::Internal(const char* appName,
                                   uint32_t concurrency) :
     application(appName ? appName : "unknown"),
     bus(bus),
+    msgBufPool(new MsgBufPool()),
     listenersLock(),
     listeners(),
     m_ioDispatch("iodisp", 96),
@@ -130,7 +131,9 @@ BusAttachment::Internal::Internal(const char* appName,
     allowRemoteMessages(allowRemoteMessages),
     listenAddresses(listenAddresses ? listenAddresses : ""),
     stopLock(),
-    stopCount(0)
+    stopCount(0),
+    cryptoConcurrency(0),
+    cryptoPool(NULL)
 {
     /*
      * Bus needs a pointer to this internal object.
@@ -160,8 +163,11 @@ BusAttachment::Internal::~Internal()
      * Make sure that all threads that might possibly access this object have been joined.
      */
     transportList.Join();
+    delete cryptoPool;
+    cryptoPool = NULL;
     delete router;
     router = NULL;
+    msgBufPool->Release();
 }
 
 /*
@@ -312,6 +318,20 @@ uint32_t BusAttachment::GetConcurrency()
     return concurrency;
 }
 
+QStatus BusAttachment::SetEncryptionConcurrency(uint32_t threads)
+{
+    if (isStarted) {
+        return ER_BUS_BUS_ALREADY_STARTED;
+    }
+    busInternal->cryptoConcurrency = threads;
+    return ER_OK;
+}
+
+uint32_t BusAttachment::GetEncryptionConcurrency()
+{
+    return busInternal->cryptoConcurrency;
+}
+
 qcc::String BusAttachment::GetConnectSpec()
 {
     return connectSpec;
@@ -349,6 +369,11 @@ QStatus BusAttachment::Start()
 
     isStarted = true;
 
+    /* Encryption threads are created before the transports so they are available to every endpoint */
+    if (busInternal->cryptoConcurrency && !busInternal->cryptoPool) {
+        busInternal->cryptoPool = new ThreadPool("crypto", busInternal->cryptoConcurrency);
+    }
+
     /* Start the transports */
     status = busInternal->transportList.Start(busInternal->GetListenAddresses());
 
@@ -625,6 +650,11 @@ QStatus BusAttachment::StopInternal(bool blockUntilStopped)
             QCC_LogError(status, ("TransportList::Stop() failed"));
         }
 
+        /* Stop encrypting messages that will never be written */
+        if (busInternal->cryptoPool) {
+            busInternal->cryptoPool->Stop();
+        }
+
         /* Stop the threads currently waiting for join to complete */
         busInternal->joinLock.Lock();
         map<Thread*, Internal::JoinContext>::iterator jit = busInternal->joinThreads.begin();
@@ -674,6 +704,13 @@ void BusAttachment::WaitStopInternal()
         if (isStarted) {
             busInternal->transportList.Join();
 
+            /* The encryption threads use the peer state so they must be gone before it is cleared */
+            if (busInternal->cryptoPool) {
+                busInternal->cryptoPool->Join();
+                delete busInternal->cryptoPool;
+                busInternal->cryptoPool = NULL;
+            }
+
             /* Clear peer state */
             busInternal->peerStateTable.Clear();
 
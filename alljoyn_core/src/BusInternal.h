@@ -32,6 +32,7 @@
 #include <qcc/atomic.h>
 #include <qcc/ManagedObj.h>
 #include <qcc/IODispatch.h>
+#include <qcc/ThreadPool.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/InterfaceDescription.h>
@@ -39,6 +40,7 @@
 #include "AuthManager.h"
 #include "ClientRouter.h"
 #include "KeyStore.h"
+#include "MsgBufPool.h"
 #include "PeerState.h"
 #include "Transport.h"
 #include "TransportList.h"
@@ -130,6 +132,14 @@ class BusAttachment::Internal : public MessageReceiver, public JoinSessionAsyncC
      * @return  The iodispatch
      */
     qcc::IODispatch& GetIODispatch(void) { return m_ioDispatch; }
+
+    /**
+     * Get the pool of threads that encrypt outgoing messages ahead of delivery.
+     *
+     * @return  The encryption thread pool or NULL if messages are encrypted as they are written.
+     */
+    qcc::ThreadPool* GetCryptoPool(void) { return cryptoPool; }
+
     /**
      * Get the header compression rules
      *
@@ -142,6 +152,13 @@ class BusAttachment::Internal : public MessageReceiver, public JoinSessionAsyncC
      */
     void OverrideCompressionRules(CompressionRules& newRules) { compressionRules = newRules; }
 
+    /**
+     * Get the pool that message buffers for this bus attachment are allocated from.
+     *
+     * @return The message buffer pool.
+     */
+    MsgBufPool& GetMsgBufPool() { return *msgBufPool; }
+
     /**
      * Constructor called by BusAttachment.
      */
@@ -275,6 +292,7 @@ class BusAttachment::Internal : public MessageReceiver, public JoinSessionAsyncC
 
     qcc::String application;              /* Name of the that owns the BusAttachment application */
     BusAttachment& bus;                   /* Reference back to the bus attachment that owns this state */
+    MsgBufPool* msgBufPool;               /* Pool for marshaled message buffers, released when all buffers are freed */
 
 
     qcc::Mutex listenersLock;             /* Mutex that protects BusListeners container (set) */
@@ -297,6 +315,8 @@ class BusAttachment::Internal : public MessageReceiver, public JoinSessionAsyncC
     qcc::String listenAddresses;          /* The set of bus addresses that this bus can listen on. (empty for clients) */
     qcc::Mutex stopLock;                  /* Protects BusAttachement::Stop from being reentered */
     int32_t stopCount;                    /* Number of caller's blocked in BusAttachment::Stop() */
+    uint32_t cryptoConcurrency;           /* Number of threads in cryptoPool, 0 to encrypt messages as they are written */
+    qcc::ThreadPool* cryptoPool;          /* Threads that encrypt queued messages while the bus is started */
 
     typedef qcc::ManagedObj<SessionPortListener*> ProtectedSessionPortListener;
     typedef std::map<SessionPort, ProtectedSessionPortListener> SessionPortListenerMap;
@@ -526,6 +526,30 @@ QStatus BusObject::Signal(const char* destination,
                           uint16_t timeToLive,
                           uint8_t flags,
                           Message* outMsg)
+{
+    return SendSignal(destination, sessionId, signalMember, args, numArgs, NULL, timeToLive, flags, outMsg);
+}
+
+QStatus BusObject::Signal(const char* destination,
+                          SessionId sessionId,
+                          const InterfaceDescription::Member& signalMember,
+                          const MsgBodyEncoder& body,
+                          uint16_t timeToLive,
+                          uint8_t flags,
+                          Message* outMsg)
+{
+    return SendSignal(destination, sessionId, signalMember, NULL, 0, &body, timeToLive, flags, outMsg);
+}
+
+QStatus BusObject::SendSignal(const char* destination,
+                              SessionId sessionId,
+                              const InterfaceDescription::Member& signalMember,
+                              const MsgArg* args,
+                              size_t numArgs,
+                              const MsgBodyEncoder* body,
+                              uint16_t timeToLive,
+                              uint8_t flags,
+                              Message* outMsg)
 {
     /* Protect against calling Signal before object is registered */
     if (!bus) {
@@ -553,7 +577,8 @@ QStatus BusObject::Signal(const char* destination,
                             args,
                             numArgs,
                             flags,
-                            timeToLive);
+                            timeToLive,
+                            body);
     if (status == ER_OK) {
         BusEndpoint bep = BusEndpoint::cast(bus->GetInternal().GetLocalEndpoint());
         status = bus->GetInternal().GetRouter().PushMessage(msg, bep);
@@ -604,6 +629,16 @@ QStatus BusObject::CancelSessionlessMessage(uint32_t serialNum)
 }
 
 QStatus BusObject::MethodReply(const Message& msg, const MsgArg* args, size_t numArgs)
+{
+    return SendReply(msg, args, numArgs, NULL);
+}
+
+QStatus BusObject::MethodReply(const Message& msg, const MsgBodyEncoder& body)
+{
+    return SendReply(msg, NULL, 0, &body);
+}
+
+QStatus BusObject::SendReply(const Message& msg, const MsgArg* args, size_t numArgs, const MsgBodyEncoder* body)
 {
     QStatus status;
 
@@ -616,7 +651,7 @@ QStatus BusObject::MethodReply(const Message& msg, const MsgArg* args, size_t nu
         status = ER_BUS_NO_CALL_FOR_REPLY;
     } else {
         Message reply(*bus);
-        status = reply->ReplyMsg(msg, args, numArgs);
+        status = reply->ReplyMsg(msg, args, numArgs, body);
         if (status == ER_OK) {
             BusEndpoint bep = BusEndpoint::cast(bus->GetInternal().GetLocalEndpoint());
             status = bus->GetInternal().GetRouter().PushMessage(reply, bep);
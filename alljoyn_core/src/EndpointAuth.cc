@@ -164,7 +164,33 @@ QStatus EndpointAuth::WaitHello(qcc::String& authUsed)
     if (status != ER_OK) {
         return status;
     }
-    status = hello->Unmarshal(endpoint, false);
+    status = ReplyHello(hello, authUsed, redirection);
+    if ((ER_OK == status) && !redirection.empty()) {
+        /*
+         * We expect the other end to shutdown the endpoint socket as soon as it receives the
+         * redirection error response. The only way we can tell if the socket is closed is by
+         * attempting to read or write to it. We do a read with a timeout. If we actually read data
+         * or the timeout expires it means the socket wasn't closed by the other end so we assume
+         * the the redirection failed.
+         */
+        uint8_t buf[1];
+        size_t sz;
+        Source& source = endpoint->GetSource();
+        status = source.PullBytes(buf, sizeof(buf), sz, REDIRECT_TIMEOUT);
+        if (status == ER_OK || status == ER_TIMEOUT) {
+            status = ER_BUS_ESTABLISH_FAILED;
+        } else {
+            status = ER_BUS_ENDPOINT_REDIRECTED;
+        }
+    }
+    return status;
+}
+
+QStatus EndpointAuth::ReplyHello(Message& hello, qcc::String& authUsed, qcc::String& redirection)
+{
+    QCC_DbgTrace(("EndpointAuth::ReplyHello(authUsed=\"%s\")", authUsed.c_str()));
+
+    QStatus status = hello->Unmarshal(endpoint, false);
     if (ER_OK == status) {
         if (hello->GetType() != MESSAGE_METHOD_CALL) {
             QCC_DbgPrintf(("First message must be Hello/BusHello method call"));
@@ -270,24 +296,6 @@ QStatus EndpointAuth::WaitHello(qcc::String& authUsed)
             QCC_LogError(status, ("%s", __FUNCTION__));
         }
     }
-    if ((ER_OK == status) && !redirection.empty()) {
-        /*
-         * We expect the other end to shutdown the endpoint socket as soon as it receives the
-         * redirection error response. The only way we can tell if the socket is closed is by
-         * attempting to read or write to it. We do a read with a timeout. If we actually read data
-         * or the timeout expires it means the socket wasn't closed by the other end so we assume
-         * the the redirection failed.
-         */
-        uint8_t buf[1];
-        size_t sz;
-        Source& source = endpoint->GetSource();
-        status = source.PullBytes(buf, sizeof(buf), sz, REDIRECT_TIMEOUT);
-        if (status == ER_OK || status == ER_TIMEOUT) {
-            status = ER_BUS_ESTABLISH_FAILED;
-        } else {
-            status = ER_BUS_ENDPOINT_REDIRECTED;
-        }
-    }
     return status;
 }
 
@@ -503,4 +511,96 @@ ExitEstablish:
     return status;
 }
 
+QStatus EndpointAuth::TryEstablish(const qcc::String& authMechanisms, qcc::String& authUsed, AuthListener* listener)
+{
+    QCC_DbgTrace(("EndpointAuth::TryEstablish(authMechanism=\"%s\", listener=0x%p)", authMechanisms.c_str(), listener));
+
+    if (!isAccepting) {
+        return ER_NOT_IMPLEMENTED;
+    }
+
+    QStatus status = ER_OK;
+    size_t numPushed;
+    SASLEngine::AuthState state;
+    qcc::String outStr;
+    qcc::String redirection;
+
+    if (establishState == ESTABLISH_IDLE) {
+        endpoint->SetFlowType(_BusEndpoint::ENDPOINT_FLOW_CHARS);
+        if (listener) {
+            authListener.Set(listener);
+        }
+        sasl = new SASLEngine(bus, AuthMechanism::CHALLENGER, authMechanisms, NULL, authListener, this);
+        /*
+         * The server's GUID is sent to the client when the authentication succeeds
+         */
+        sasl->SetLocalId(bus.GetInternal().GetGlobalGUID().ToString());
+        establishState = ESTABLISH_SASL;
+    }
+
+    /*
+     * All reads below are made with a zero timeout.  A timeout means the remote side has not
+     * sent the rest of the current line or message yet; what has been read so far is kept in
+     * inStr or in the hello message and the read picks up where it left off on the next call.
+     */
+    while (establishState == ESTABLISH_SASL) {
+        status = endpoint->GetSource().GetLine(inStr, 0);
+        if (status == ER_TIMEOUT) {
+            return ER_WOULDBLOCK;
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to read from stream"));
+            goto ExitTryEstablish;
+        }
+        QCC_DbgPrintf(("EndpointAuth::TryEstablish(): Got \"%s\" from stream", inStr.c_str()));
+        status = sasl->Advance(inStr, outStr, state);
+        inStr.clear();
+        if (status != ER_OK) {
+            QCC_DbgPrintf(("Server authentication failed %s", QCC_StatusText(status)));
+            goto ExitTryEstablish;
+        }
+        if (state == SASLEngine::ALLJOYN_AUTH_SUCCESS) {
+            mechanism = sasl->GetMechanism();
+            delete sasl;
+            sasl = NULL;
+            endpoint->SetFlowType(_BusEndpoint::ENDPOINT_FLOW_HELLO);
+            establishState = ESTABLISH_HELLO;
+            break;
+        }
+        status = endpoint->GetSink().PushBytes((void*)(outStr.data()), outStr.length(), numPushed);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to write to stream"));
+            goto ExitTryEstablish;
+        }
+    }
+
+    while (hello->readState != MESSAGE_COMPLETE) {
+        status = hello->PullBytes(endpoint, false, true, 0);
+        if (status == ER_TIMEOUT) {
+            return ER_WOULDBLOCK;
+        }
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to read hello message"));
+            goto ExitTryEstablish;
+        }
+    }
+
+    status = ReplyHello(hello, mechanism, redirection);
+    if ((status == ER_OK) && !redirection.empty()) {
+        status = ER_BUS_ESTABLISH_FAILED;
+    }
+    if (status == ER_OK) {
+        authUsed = mechanism;
+    }
+    endpoint->SetFlowType(_BusEndpoint::ENDPOINT_FLOW_MSGS);
+
+ExitTryEstablish:
+
+    authListener.Set(NULL);
+
+    QCC_DbgPrintf(("TryEstablish complete %s", QCC_StatusText(status)));
+
+    return status;
+}
+
 }
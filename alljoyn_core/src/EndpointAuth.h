@@ -59,13 +59,16 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
         endpoint(endpoint),
         uniqueName(bus.GetInternal().GetRouter().GenerateUniqueName()),
         isAccepting(isAcceptor),
-        remoteProtocolVersion(0)
+        remoteProtocolVersion(0),
+        establishState(ESTABLISH_IDLE),
+        sasl(NULL),
+        hello(bus)
     { }
 
     /**
      * Destructor
      */
-    ~EndpointAuth() { };
+    ~EndpointAuth() { delete sasl; };
 
     /**
      * Establish a connection.
@@ -83,6 +86,23 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
      */
     QStatus Establish(const qcc::String& authMechanisms, qcc::String& authUsed, qcc::String& redirection, AuthListener* listener = NULL);
 
+    /**
+     * Establish an accepted connection without blocking.  Each call runs as much of the SASL and
+     * Hello exchange as the data already received from the remote side allows and then returns.
+     * Call again with the same arguments once the endpoint source is readable. Redirection is not
+     * supported here, use Establish() for endpoints that redirect.
+     *
+     * @param authMechanisms  The authentication mechanisms to try.
+     * @param authUsed        Returns the name of the authentication method that was used to establish the connection.
+     * @param listener        Authentication credentials listener
+     *
+     * @return
+     *      - ER_OK if successful
+     *      - ER_WOULDBLOCK if the exchange is waiting for more data from the remote side
+     *      - An error status otherwise
+     */
+    QStatus TryEstablish(const qcc::String& authMechanisms, qcc::String& authUsed, AuthListener* listener = NULL);
+
     /**
      * Get the unique bus name assigned by the bus for this endpoint.
      *
@@ -145,10 +165,26 @@ class EndpointAuth : public SASLEngine::ExtensionHandler {
     uint32_t nameTransfer;
     ProtectedAuthListener authListener;  ///< Authentication listener
 
+    /**
+     * Progress of an establishment driven by TryEstablish()
+     */
+    enum EstablishState {
+        ESTABLISH_IDLE,   ///< TryEstablish() has not been called
+        ESTABLISH_SASL,   ///< Exchanging SASL lines
+        ESTABLISH_HELLO   ///< Waiting for the Hello message
+    };
+
+    EstablishState establishState;   ///< Progress of TryEstablish()
+    SASLEngine* sasl;                ///< SASL conversation in progress for TryEstablish()
+    qcc::String inStr;               ///< Partial SASL line received by TryEstablish()
+    qcc::String mechanism;           ///< Authentication mechanism agreed on by TryEstablish()
+    Message hello;                   ///< Hello message being received by TryEstablish()
+
     /* Internal methods */
 
     QStatus Hello(qcc::String& redirection);
     QStatus WaitHello(qcc::String& authUsed);
+    QStatus ReplyHello(Message& hello, qcc::String& authUsed, qcc::String& redirection);
 };
 
 }
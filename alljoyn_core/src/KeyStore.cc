@@ -54,10 +54,82 @@ namespace ajn {
  */
 static const uint16_t LowStoreVersion = 0x0102;
 
+/*
+ * Last key store version that stored all keys in a single encrypted blob
+ */
+static const uint16_t BlobStoreVersion = 0x0103;
+
 /*
  * Current key store version we will write
  */
-static const uint16_t KeyStoreVersion = 0x0103;
+static const uint16_t KeyStoreVersion = 0x0104;
+
+/*
+ * From version 0x0104 the header (version, revision, GUID) is followed by a journal of
+ * individually encrypted entries. Storing appends entries for the keys that changed, a later
+ * entry for a GUID supersedes earlier ones, and the journal is periodically compacted by
+ * rewriting it with just the live entries. Each entry is laid out as:
+ *
+ *   uint32_t length    Length of the entry following this field
+ *   uint8_t  op        JOURNAL_ADD or JOURNAL_DEL
+ *   uint32_t revision  Key store revision when the entry was written
+ *   uint8_t  guid[16]  GUID of the key
+ *
+ * JOURNAL_ADD entries continue with:
+ *
+ *   uint64_t seconds   Key expiration seconds, zero if the key does not expire
+ *   uint16_t mseconds  Key expiration milliseconds
+ *   uint8_t  nonce[12] Random nonce
+ *   uint8_t  keys[]    Key blob and access rights encrypted with AES-CCM
+ *
+ * JOURNAL_DEL entries continue with:
+ *
+ *   uint8_t  nonce[12] Random nonce
+ *   uint8_t  mac[16]   AES-CCM authentication tag over an empty payload
+ *
+ * The cleartext fields are authenticated as additional data so keys can be indexed by GUID and
+ * expired without decrypting them. Keys are only decrypted when they are first used.
+ */
+static const uint8_t JOURNAL_ADD = 1;
+static const uint8_t JOURNAL_DEL = 2;
+
+static const size_t JournalHdrLen = sizeof(uint8_t) + sizeof(uint32_t) + qcc::GUID128::SIZE;
+static const size_t JournalAddHdrLen = JournalHdrLen + sizeof(uint64_t) + sizeof(uint16_t);
+static const size_t JournalNonceLen = 12;
+static const size_t JournalMacLen = 16;
+
+/*
+ * Sanity check on the length of an individual journal entry
+ */
+static const size_t MaxJournalEntry = 64000;
+
+/*
+ * Number of superseded entries tolerated before the journal is compacted
+ */
+static const size_t JournalSlack = 64;
+
+/*
+ * Build the cleartext header for a journal entry
+ */
+static qcc::String JournalHeader(uint8_t op, uint32_t revision, const qcc::GUID128& guid)
+{
+    qcc::String hdr;
+    hdr.append((const char*)&op, sizeof(op));
+    hdr.append((const char*)&revision, sizeof(revision));
+    hdr.append((const char*)guid.GetBytes(), qcc::GUID128::SIZE);
+    return hdr;
+}
+
+/*
+ * Prepend the length field to a journal entry
+ */
+static qcc::String JournalEntry(const qcc::String& body)
+{
+    uint32_t len = body.size();
+    qcc::String entry((const char*)&len, sizeof(len), sizeof(len) + body.size());
+    entry.append(body);
+    return entry;
+}
 
 
 QStatus KeyStoreListener::PutKeys(KeyStore& keyStore, const qcc::String& source, const qcc::String& password)
@@ -133,12 +205,18 @@ class DefaultKeyStoreListener : public KeyStoreListener {
 
     QStatus StoreRequest(KeyStore& keyStore) {
         QStatus status;
-        FileSink sink(fileName, FileSink::PRIVATE);
+        /* Append the changes to the journal unless it needs to be rewritten */
+        bool append = keyStore.CanAppend();
+        FileSink sink(fileName, append ? FileSink::APPEND : FileSink::PRIVATE);
         if (sink.IsValid()) {
             sink.Lock(true);
-            status = keyStore.Push(sink);
+            if (append) {
+                status = keyStore.Append(sink);
+            } else {
+                status = keyStore.Push(sink);
+            }
             if (status == ER_OK) {
-                QCC_DbgHLPrintf(("Wrote key store to %s", fileName.c_str()));
+                QCC_DbgHLPrintf(("%s key store %s", append ? "Appended to" : "Wrote", fileName.c_str()));
             }
             sink.Unlock();
         } else {
@@ -158,6 +236,8 @@ KeyStore::KeyStore(const qcc::String& application) :
     application(application),
     storeState(UNAVAILABLE),
     keys(new KeyMap),
+    journalEntries(0),
+    compact(true),
     defaultListener(NULL),
     listener(NULL),
     thisGuid(),
@@ -381,6 +461,8 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
     if (status == ER_EOF) {
         keys->clear();
         storeState = MODIFIED;
+        compact = true;
+        journalEntries = 0;
         revision = 0;
         status = ER_OK;
         goto ExitPull;
@@ -389,69 +471,148 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
         goto ExitPull;
     }
     QCC_DbgPrintf(("KeyStore::Pull (revision %d)", revision));
-    /* Get length of the encrypted keys */
-    status = source.PullBytes(&len, sizeof(len), pulled);
-    if (status != ER_OK) {
-        goto ExitPull;
-    }
-    /* Sanity check on the length */
-    if (len > 64000) {
-        status = ER_BUS_CORRUPT_KEYSTORE;
-        goto ExitPull;
-    }
-    if (len > 0) {
-        uint8_t* data = NULL;
+    journalEntries = 0;
+    compact = false;
+    if (version > BlobStoreVersion) {
         /*
-         * Pull the encrypted keys.
+         * Read the journal and index the entries by GUID. Keys are not decrypted until they are used.
          */
-        data = new uint8_t[len];
-        status = source.PullBytes(data, len, pulled);
-        if (pulled != len) {
+        qcc::String journal;
+        uint8_t buf[4096];
+        while (status == ER_OK) {
+            status = source.PullBytes(buf, sizeof(buf), pulled);
+            if ((status == ER_OK) && (pulled > 0)) {
+                journal.append((const char*)buf, pulled);
+            }
+        }
+        if (status == ER_EOF) {
+            status = ER_OK;
+        }
+        size_t pos = 0;
+        while ((status == ER_OK) && (pos < journal.size())) {
+            const uint8_t* entry = (const uint8_t*)journal.data() + pos;
+            size_t avail = journal.size() - pos;
+            uint32_t entryLen = 0;
+            if (avail >= sizeof(entryLen)) {
+                memcpy(&entryLen, entry, sizeof(entryLen));
+            }
+            if ((avail < sizeof(entryLen)) || ((avail - sizeof(entryLen)) < entryLen)) {
+                /*
+                 * An interrupted store can leave a partial entry at the end of the journal. Ignore
+                 * it and rewrite the journal on the next store so nothing gets appended after it.
+                 */
+                QCC_LogError(ER_BUS_CORRUPT_KEYSTORE, ("Ignoring truncated key store entry at offset %u", pos));
+                compact = true;
+                break;
+            }
+            if ((entryLen < JournalHdrLen) || (entryLen > MaxJournalEntry)) {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+                break;
+            }
+            const uint8_t* hdr = entry + sizeof(entryLen);
+            uint32_t rev;
+            memcpy(&rev, hdr + sizeof(uint8_t), sizeof(rev));
+            qcc::GUID128 guid(0);
+            guid.SetBytes(hdr + sizeof(uint8_t) + sizeof(rev));
+            if (hdr[0] == JOURNAL_DEL) {
+                if (VerifyDeletion(hdr, entryLen) == ER_OK) {
+                    keys->erase(guid);
+                } else {
+                    /*
+                     * Deletions are authenticated like keys so a forged one cannot remove a key.
+                     * Ignore it and rewrite the journal without it on the next store.
+                     */
+                    QCC_LogError(ER_BUS_CORRUPT_KEYSTORE, ("Ignoring unauthenticated key store deletion for GUID %s", guid.ToString().c_str()));
+                    compact = true;
+                }
+            } else if ((hdr[0] == JOURNAL_ADD) && (entryLen >= (JournalAddHdrLen + JournalNonceLen + JournalMacLen))) {
+                Timespec expiration;
+                memcpy(&expiration.seconds, hdr + JournalHdrLen, sizeof(expiration.seconds));
+                memcpy(&expiration.mseconds, hdr + JournalHdrLen + sizeof(expiration.seconds), sizeof(expiration.mseconds));
+                KeyRecord& keyRec = (*keys)[guid];
+                keyRec.revision = rev;
+                keyRec.key = KeyBlob();
+                keyRec.key.SetExpiration(expiration);
+                keyRec.entry = qcc::String((const char*)entry, sizeof(entryLen) + entryLen);
+                keyRec.sealed = true;
+            } else {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+                break;
+            }
+            QCC_DbgPrintf(("KeyStore::Pull %s rev:%d GUID %s", (hdr[0] == JOURNAL_DEL) ? "del" : "add", rev, guid.ToString().c_str()));
+            revision = max(revision, rev);
+            ++journalEntries;
+            pos += sizeof(entryLen) + entryLen;
+        }
+    } else {
+        /* Get length of the encrypted keys */
+        status = source.PullBytes(&len, sizeof(len), pulled);
+        if (status != ER_OK) {
+            goto ExitPull;
+        }
+        /* Sanity check on the length */
+        if (len > 64000) {
             status = ER_BUS_CORRUPT_KEYSTORE;
+            goto ExitPull;
         }
-        if (status == ER_OK) {
+        if (len > 0) {
+            uint8_t* data = NULL;
             /*
-             * Decrypt the key store.
+             * Pull the encrypted keys.
              */
-            KeyBlob nonce((uint8_t*)&revision, sizeof(revision), KeyBlob::GENERIC);
-            Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
-            status = aes.Decrypt_CCM(data, data, len, nonce, NULL, 0, 16);
-            /*
-             * Unpack the guid/key pairs from an intermediate string source.
-             */
-            StringSource strSource(data, len);
-            while (status == ER_OK) {
-                uint32_t rev;
-                status = strSource.PullBytes(&rev, sizeof(rev), pulled);
-                if (status == ER_OK) {
-                    status = strSource.PullBytes(guidBuf, qcc::GUID128::SIZE, pulled);
-                }
-                if (status == ER_OK) {
-                    qcc::GUID128 guid;
-                    guid.SetBytes(guidBuf);
-                    KeyRecord& keyRec = (*keys)[guid];
-                    keyRec.revision = rev;
-                    status = keyRec.key.Load(strSource);
+            data = new uint8_t[len];
+            status = source.PullBytes(data, len, pulled);
+            if (pulled != len) {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+            }
+            if (status == ER_OK) {
+                /*
+                 * Decrypt the key store.
+                 */
+                KeyBlob nonce((uint8_t*)&revision, sizeof(revision), KeyBlob::GENERIC);
+                Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+                status = aes.Decrypt_CCM(data, data, len, nonce, NULL, 0, 16);
+                /*
+                 * Unpack the guid/key pairs from an intermediate string source.
+                 */
+                StringSource strSource(data, len);
+                while (status == ER_OK) {
+                    uint32_t rev;
+                    status = strSource.PullBytes(&rev, sizeof(rev), pulled);
+                    if (status == ER_OK) {
+                        status = strSource.PullBytes(guidBuf, qcc::GUID128::SIZE, pulled);
+                    }
                     if (status == ER_OK) {
-                        if (version > LowStoreVersion) {
-                            status = strSource.PullBytes(&keyRec.accessRights, sizeof(keyRec.accessRights), pulled);
-                        } else {
-                            /*
-                             * Maintain backwards compatibility with an older key store
-                             */
-                            for (size_t i = 0; i < ArraySize(keyRec.accessRights); ++i) {
-                                keyRec.accessRights[i] = _PeerState::ALLOW_SECURE_TX | _PeerState::ALLOW_SECURE_RX;
+                        qcc::GUID128 guid;
+                        guid.SetBytes(guidBuf);
+                        KeyRecord& keyRec = (*keys)[guid];
+                        keyRec.revision = rev;
+                        status = keyRec.key.Load(strSource);
+                        if (status == ER_OK) {
+                            if (version > LowStoreVersion) {
+                                status = strSource.PullBytes(&keyRec.accessRights, sizeof(keyRec.accessRights), pulled);
+                            } else {
+                                /*
+                                 * Maintain backwards compatibility with an older key store
+                                 */
+                                for (size_t i = 0; i < ArraySize(keyRec.accessRights); ++i) {
+                                    keyRec.accessRights[i] = _PeerState::ALLOW_SECURE_TX | _PeerState::ALLOW_SECURE_RX;
+                                }
                             }
                         }
+                        QCC_DbgPrintf(("KeyStore::Pull rev:%d GUID %s %s", rev, QCC_StatusText(status), guid.ToString().c_str()));
                     }
-                    QCC_DbgPrintf(("KeyStore::Pull rev:%d GUID %s %s", rev, QCC_StatusText(status), guid.ToString().c_str()));
+                }
+                if (status == ER_EOF) {
+                    status = ER_OK;
                 }
             }
-            if (status == ER_EOF) {
-                status = ER_OK;
-            }
+            delete [] data;
         }
-        delete [] data;
+        /*
+         * Convert to the journal format the next time the key store is stored
+         */
+        compact = true;
     }
     if (status != ER_OK) {
         goto ExitPull;
@@ -467,6 +628,7 @@ ExitPull:
     if (status != ER_OK) {
         keys->clear();
         storeState = MODIFIED;
+        compact = true;
     }
     if (loaded) {
         loaded->SetEvent();
@@ -485,6 +647,8 @@ QStatus KeyStore::Clear()
     storeState = MODIFIED;
     revision = 0;
     deletions.clear();
+    changes.clear();
+    compact = true;
     lock.Unlock(MUTEX_CONTEXT);
     listener->StoreRequest(*this);
     return ER_OK;
@@ -548,6 +712,7 @@ QStatus KeyStore::Reload()
                      * In case of a merge conflict go with the key that is currently stored
                      */
                     QCC_DbgPrintf(("KeyStore::Reload merge conflict rev:%d %s", it->second.revision, it->first.ToString().c_str()));
+                    changes.erase(it->first);
                 } else {
                     (*keys)[it->first] = it->second;
                     QCC_DbgPrintf(("KeyStore::Reload merging %s", it->first.ToString().c_str()));
@@ -570,6 +735,123 @@ QStatus KeyStore::Reload()
     return status;
 }
 
+QStatus KeyStore::Seal(const qcc::GUID128& guid, KeyRecord& keyRec)
+{
+    size_t pushed;
+    /*
+     * Pack the key into an intermediate string sink.
+     */
+    StringSink strSink;
+    QStatus status = keyRec.key.Store(strSink);
+    if (status == ER_OK) {
+        status = strSink.PushBytes(&keyRec.accessRights, sizeof(keyRec.accessRights), pushed);
+    }
+    if (status != ER_OK) {
+        return status;
+    }
+    /*
+     * The expiration is stored in the clear so expired keys can be erased without decrypting them.
+     */
+    Timespec expiration;
+    keyRec.key.GetExpiration(expiration);
+    qcc::String hdr = JournalHeader(JOURNAL_ADD, keyRec.revision, guid);
+    hdr.append((const char*)&expiration.seconds, sizeof(expiration.seconds));
+    hdr.append((const char*)&expiration.mseconds, sizeof(expiration.mseconds));
+
+    uint8_t nonceBuf[JournalNonceLen];
+    status = Crypto_GetRandomBytes(nonceBuf, sizeof(nonceBuf));
+    if (status != ER_OK) {
+        return status;
+    }
+    KeyBlob nonce(nonceBuf, sizeof(nonceBuf), KeyBlob::GENERIC);
+    size_t len = strSink.GetString().size();
+    uint8_t* data = new uint8_t[len + JournalMacLen];
+    Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+    status = aes.Encrypt_CCM(strSink.GetString().data(), data, len, nonce, hdr.data(), hdr.size(), JournalMacLen);
+    if (status == ER_OK) {
+        hdr.append((const char*)nonceBuf, sizeof(nonceBuf));
+        hdr.append((const char*)data, len);
+        keyRec.entry = JournalEntry(hdr);
+    }
+    delete [] data;
+    return status;
+}
+
+QStatus KeyStore::Unseal(const qcc::GUID128& guid, KeyRecord& keyRec)
+{
+    QStatus status = ER_BUS_CORRUPT_KEYSTORE;
+    size_t offset = sizeof(uint32_t) + JournalAddHdrLen + JournalNonceLen;
+
+    QCC_DbgPrintf(("KeyStore::Unseal %s", guid.ToString().c_str()));
+    if (keyRec.entry.size() >= (offset + JournalMacLen)) {
+        const uint8_t* hdr = (const uint8_t*)keyRec.entry.data() + sizeof(uint32_t);
+        KeyBlob nonce(hdr + JournalAddHdrLen, JournalNonceLen, KeyBlob::GENERIC);
+        size_t len = keyRec.entry.size() - offset;
+        uint8_t* data = new uint8_t[len];
+        Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+        status = aes.Decrypt_CCM(hdr + JournalAddHdrLen + JournalNonceLen, data, len, nonce, hdr, JournalAddHdrLen, JournalMacLen);
+        if (status == ER_OK) {
+            size_t pulled;
+            StringSource strSource(data, len);
+            status = keyRec.key.Load(strSource);
+            if (status == ER_OK) {
+                status = strSource.PullBytes(&keyRec.accessRights, sizeof(keyRec.accessRights), pulled);
+                if ((status == ER_OK) && (pulled != sizeof(keyRec.accessRights))) {
+                    status = ER_BUS_CORRUPT_KEYSTORE;
+                }
+            }
+        }
+        delete [] data;
+    }
+    if (status == ER_OK) {
+        keyRec.sealed = false;
+    } else {
+        /*
+         * The caller drops the key. Record the deletion so the next store removes the entry from
+         * the journal even if it appends rather than compacts.
+         */
+        QCC_LogError(status, ("Failed to decrypt key store entry for GUID %s", guid.ToString().c_str()));
+        storeState = MODIFIED;
+        deletions.insert(guid);
+        changes.erase(guid);
+        compact = true;
+    }
+    return status;
+}
+
+QStatus KeyStore::SealDeletion(const qcc::GUID128& guid, qcc::String& entry)
+{
+    qcc::String hdr = JournalHeader(JOURNAL_DEL, revision, guid);
+    uint8_t nonceBuf[JournalNonceLen];
+    QStatus status = Crypto_GetRandomBytes(nonceBuf, sizeof(nonceBuf));
+    if (status != ER_OK) {
+        return status;
+    }
+    KeyBlob nonce(nonceBuf, sizeof(nonceBuf), KeyBlob::GENERIC);
+    uint8_t mac[JournalMacLen];
+    size_t len = 0;
+    Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+    status = aes.Encrypt_CCM(NULL, mac, len, nonce, hdr.data(), hdr.size(), JournalMacLen);
+    if (status == ER_OK) {
+        hdr.append((const char*)nonceBuf, sizeof(nonceBuf));
+        hdr.append((const char*)mac, len);
+        entry = JournalEntry(hdr);
+    }
+    return status;
+}
+
+QStatus KeyStore::VerifyDeletion(const uint8_t* hdr, size_t len)
+{
+    if (len != (JournalHdrLen + JournalNonceLen + JournalMacLen)) {
+        return ER_BUS_CORRUPT_KEYSTORE;
+    }
+    KeyBlob nonce(hdr + JournalHdrLen, JournalNonceLen, KeyBlob::GENERIC);
+    uint8_t empty[JournalMacLen];
+    size_t macLen = JournalMacLen;
+    Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+    return aes.Decrypt_CCM(hdr + JournalHdrLen + JournalNonceLen, empty, macLen, nonce, hdr, JournalHdrLen, JournalMacLen);
+}
+
 QStatus KeyStore::Push(Sink& sink)
 {
     size_t pushed;
@@ -579,18 +861,21 @@ QStatus KeyStore::Push(Sink& sink)
     lock.Lock(MUTEX_CONTEXT);
 
     /*
-     * Pack the keys into an intermediate string sink.
+     * Write the whole key store as a compacted journal. Keys that have not changed since they were
+     * loaded are written as they were read without decrypting them.
      */
-    StringSink strSink;
+    qcc::String journal;
     KeyMap::iterator it;
     for (it = keys->begin(); it != keys->end(); ++it) {
-        strSink.PushBytes(&it->second.revision, sizeof(revision), pushed);
-        strSink.PushBytes(it->first.GetBytes(), qcc::GUID128::SIZE, pushed);
-        it->second.key.Store(strSink);
-        strSink.PushBytes(&it->second.accessRights, sizeof(it->second.accessRights), pushed);
+        if (it->second.entry.empty()) {
+            status = Seal(it->first, it->second);
+            if (status != ER_OK) {
+                goto ExitPush;
+            }
+        }
+        journal.append(it->second.entry);
         QCC_DbgPrintf(("KeyStore::Push rev:%d GUID %s", it->second.revision, it->first.ToString().c_str()));
     }
-    size_t keysLen = strSink.GetString().size();
     /*
      * First two bytes are the version number.
      */
@@ -616,33 +901,111 @@ QStatus KeyStore::Push(Sink& sink)
     if (status != ER_OK) {
         goto ExitPush;
     }
-    if (keysLen > 0) {
-        /*
-         * Encrypt keys.
-         */
-        KeyBlob nonce((uint8_t*)&revision, sizeof(revision), KeyBlob::GENERIC);
-        uint8_t* keysData = new uint8_t[keysLen + 16];
-        Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
-        status = aes.Encrypt_CCM(strSink.GetString().data(), keysData, keysLen, nonce, NULL, 0, 16);
-        /* Store the length of the encrypted keys */
-        if (status == ER_OK) {
-            status = sink.PushBytes(&keysLen, sizeof(keysLen), pushed);
-        }
-        /* Store the encrypted keys */
-        if (status == ER_OK) {
-            status = sink.PushBytes(keysData, keysLen, pushed);
+    /*
+     * Store the journal entries
+     */
+    if (!journal.empty()) {
+        status = sink.PushBytes(journal.data(), journal.size(), pushed);
+        if ((status == ER_OK) && (pushed != journal.size())) {
+            status = ER_BUS_WRITE_ERROR;
         }
-        delete [] keysData;
-    } else {
-        status = sink.PushBytes(&keysLen, sizeof(keysLen), pushed);
     }
     if (status != ER_OK) {
         goto ExitPush;
     }
     storeState = LOADED;
+    journalEntries = keys->size();
+    changes.clear();
+    compact = false;
 
 ExitPush:
 
+    if (status != ER_OK) {
+        compact = true;
+    }
+    if (stored) {
+        stored->SetEvent();
+    }
+    lock.Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
+bool KeyStore::CanAppend()
+{
+    lock.Lock(MUTEX_CONTEXT);
+    /*
+     * Compact the journal once superseded entries outnumber the live keys
+     */
+    size_t entries = journalEntries + changes.size() + deletions.size();
+    bool canAppend = (storeState != UNAVAILABLE) && !compact && (entries <= (2 * keys->size() + JournalSlack));
+    lock.Unlock(MUTEX_CONTEXT);
+    return canAppend;
+}
+
+QStatus KeyStore::Append(Sink& sink)
+{
+    size_t pushed;
+    QStatus status = ER_OK;
+
+    QCC_DbgHLPrintf(("KeyStore::Append (revision %d)", revision + 1));
+    lock.Lock(MUTEX_CONTEXT);
+
+    /*
+     * The revision number is incremented each time the key store is stored. The appended entries
+     * carry the new revision so other applications sharing the key store see the change.
+     */
+    ++revision;
+    qcc::String journal;
+    size_t count = 0;
+    std::set<qcc::GUID128>::iterator itGuid;
+    for (itGuid = changes.begin(); itGuid != changes.end(); ++itGuid) {
+        KeyMap::iterator it = keys->find(*itGuid);
+        if (it != keys->end()) {
+            it->second.revision = revision;
+            status = Seal(it->first, it->second);
+            if (status != ER_OK) {
+                goto ExitAppend;
+            }
+            journal.append(it->second.entry);
+            ++count;
+            QCC_DbgPrintf(("KeyStore::Append rev:%d GUID %s", revision, it->first.ToString().c_str()));
+        }
+    }
+    for (itGuid = deletions.begin(); itGuid != deletions.end(); ++itGuid) {
+        if (keys->find(*itGuid) == keys->end()) {
+            qcc::String entry;
+            status = SealDeletion(*itGuid, entry);
+            if (status != ER_OK) {
+                goto ExitAppend;
+            }
+            journal.append(entry);
+            ++count;
+            QCC_DbgPrintf(("KeyStore::Append rev:%d delete GUID %s", revision, itGuid->ToString().c_str()));
+        }
+    }
+    /*
+     * Write all the entries at once so a partial append can only leave a truncated final entry.
+     */
+    if (!journal.empty()) {
+        status = sink.PushBytes(journal.data(), journal.size(), pushed);
+        if ((status == ER_OK) && (pushed != journal.size())) {
+            status = ER_BUS_WRITE_ERROR;
+        }
+    }
+    if (status != ER_OK) {
+        goto ExitAppend;
+    }
+    storeState = LOADED;
+    journalEntries += count;
+    changes.clear();
+    /* Deletions are now recorded in the journal */
+    deletions.clear();
+
+ExitAppend:
+
+    if (status != ER_OK) {
+        compact = true;
+    }
     if (stored) {
         stored->SetEvent();
     }
@@ -658,8 +1021,13 @@ QStatus KeyStore::GetKey(const qcc::GUID128& guid, KeyBlob& key, uint8_t accessR
     QStatus status;
     lock.Lock(MUTEX_CONTEXT);
     QCC_DbgPrintf(("KeyStore::GetKey %s", guid.ToString().c_str()));
-    if (keys->find(guid) != keys->end()) {
-        KeyRecord& keyRec = (*keys)[guid];
+    KeyMap::iterator it = keys->find(guid);
+    if ((it != keys->end()) && it->second.sealed && (Unseal(guid, it->second) != ER_OK)) {
+        keys->erase(it);
+        it = keys->end();
+    }
+    if (it != keys->end()) {
+        KeyRecord& keyRec = it->second;
         key = keyRec.key;
         memcpy(accessRights, &keyRec.accessRights, sizeof(uint8_t) * 4);
         QCC_DbgPrintf(("AccessRights %1x%1x%1x%1x", accessRights[0], accessRights[1], accessRights[2], accessRights[3]));
@@ -695,8 +1063,11 @@ QStatus KeyStore::AddKey(const qcc::GUID128& guid, const KeyBlob& key, const uin
     keyRec.key = key;
     QCC_DbgPrintf(("AccessRights %1x%1x%1x%1x", accessRights[0], accessRights[1], accessRights[2], accessRights[3]));
     memcpy(&keyRec.accessRights, accessRights, sizeof(uint8_t) * 4);
+    keyRec.entry.clear();
+    keyRec.sealed = false;
     storeState = MODIFIED;
     deletions.erase(guid);
+    changes.insert(guid);
     lock.Unlock(MUTEX_CONTEXT);
     return ER_OK;
 }
@@ -711,6 +1082,7 @@ QStatus KeyStore::DelKey(const qcc::GUID128& guid)
     keys->erase(guid);
     storeState = MODIFIED;
     deletions.insert(guid);
+    changes.erase(guid);
     lock.Unlock(MUTEX_CONTEXT);
     listener->StoreRequest(*this);
     return ER_OK;
@@ -724,9 +1096,16 @@ QStatus KeyStore::SetKeyExpiration(const qcc::GUID128& guid, const Timespec& exp
     QStatus status = ER_OK;
     lock.Lock(MUTEX_CONTEXT);
     QCC_DbgPrintf(("KeyStore::SetExpiration %s", guid.ToString().c_str()));
-    if (keys->count(guid) != 0) {
-        (*keys)[guid].key.SetExpiration(expiration);
+    KeyMap::iterator it = keys->find(guid);
+    if ((it != keys->end()) && it->second.sealed && (Unseal(guid, it->second) != ER_OK)) {
+        keys->erase(it);
+        it = keys->end();
+    }
+    if (it != keys->end()) {
+        it->second.key.SetExpiration(expiration);
+        it->second.entry.clear();
         storeState = MODIFIED;
+        changes.insert(guid);
     } else {
         status = ER_BUS_KEY_UNAVAILABLE;
     }
@@ -762,6 +1141,15 @@ QStatus KeyStore::GetKeyExpiration(const qcc::GUID128& guid, Timespec& expiratio
 QStatus KeyStore::SearchAssociatedKeys(const qcc::GUID128& guid, qcc::GUID128** list, size_t* numItems) {
     size_t count = 0;
     lock.Lock(MUTEX_CONTEXT);
+    /*
+     * The associations are encrypted so any keys that have not been used yet must be decrypted
+     */
+    for (KeyMap::iterator it = keys->begin(); it != keys->end();) {
+        KeyMap::iterator current = it++;
+        if (current->second.sealed && (Unseal(current->first, current->second) != ER_OK)) {
+            keys->erase(current);
+        }
+    }
     for (KeyMap::iterator it = keys->begin(); it != keys->end(); ++it) {
         if ((it->second.key.GetAssociationMode() != KeyBlob::ASSOCIATE_MEMBER)
             && (it->second.key.GetAssociationMode() != KeyBlob::ASSOCIATE_BOTH)) {
@@ -266,6 +266,28 @@ class KeyStore {
      */
     QStatus Push(qcc::Sink& sink);
 
+    /**
+     * Indicates if the changes made since the key store was last loaded or stored can be appended
+     * to the key store journal with Append(). If this returns false the whole key store must be
+     * written with Push(), either because it was loaded from an older format, it was cleared, or
+     * because the journal has accumulated enough superseded records to be worth compacting.
+     *
+     * @return  Returns true if Append() can be used to store the key store.
+     */
+    bool CanAppend();
+
+    /**
+     * Append the keys that were added, modified or deleted since the key store was last loaded or
+     * stored to the end of a key store journal previously written by Push(). Only the changed keys
+     * are encrypted and written.
+     *
+     * @param sink The sink to append the changed keys to.
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus Append(qcc::Sink& sink);
+
     /**
      * Indicates if this is a shared key store.
      *
@@ -311,6 +333,31 @@ class KeyStore {
      */
     QStatus Load();
 
+    /**
+     *  Type for a key record
+     */
+    class KeyRecord;
+
+    /**
+     * Internal function to encrypt a key record into a journal entry
+     */
+    QStatus Seal(const qcc::GUID128& guid, KeyRecord& keyRec);
+
+    /**
+     * Internal function to decrypt a key record that was lazily loaded from the journal
+     */
+    QStatus Unseal(const qcc::GUID128& guid, KeyRecord& keyRec);
+
+    /**
+     * Internal function to build an authenticated journal entry recording the deletion of a key
+     */
+    QStatus SealDeletion(const qcc::GUID128& guid, qcc::String& entry);
+
+    /**
+     * Internal function to check the authentication tag of a deletion entry read from the journal
+     */
+    QStatus VerifyDeletion(const uint8_t* hdr, size_t len);
+
     /**
      * The application that owns this key store. If the key store is shared this will be the name
      * of a suite of applications.
@@ -331,10 +378,12 @@ class KeyStore {
      */
     class KeyRecord {
       public:
-        KeyRecord() : revision(0) { }
+        KeyRecord() : revision(0), sealed(false) { }
         uint32_t revision;       ///< Revision number when this key was added
         qcc::KeyBlob key;        ///< The key blob for the key
         uint8_t accessRights[4]; ///< Access rights associated with this record (see PeerState)
+        qcc::String entry;       ///< Encrypted journal entry for this key, empty if not written yet
+        bool sealed;             ///< True if key and accessRights have not been decrypted from entry yet
     };
 
     /**
@@ -352,6 +401,21 @@ class KeyStore {
      */
     std::set<qcc::GUID128> deletions;
 
+    /**
+     * GUID for keys that have been added or modified since the key store was last stored
+     */
+    std::set<qcc::GUID128> changes;
+
+    /**
+     * Number of entries in the key store journal including superseded entries
+     */
+    size_t journalEntries;
+
+    /**
+     * Indicates the key store must be rewritten in full rather than appended to
+     */
+    bool compact;
+
     /**
      * Default listener for handling load/store requests
      */
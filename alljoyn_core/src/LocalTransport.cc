@@ -22,7 +22,9 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 
+#include <deque>
 #include <list>
+#include <vector>
 
 #include <qcc/Debug.h>
 #include <qcc/GUID.h>
@@ -55,26 +57,139 @@ namespace ajn {
 
 static const uint32_t LOCAL_ENDPOINT_CONCURRENCY = 4;
 
+/*
+ * Number of strands incoming messages are hashed onto. Messages on the same strand are
+ * dispatched one at a time in the order they were received.
+ */
+static const uint32_t LOCAL_ENDPOINT_STRANDS = 64;
+
+/* Number of messages a worker dispatches from a strand before giving other strands a turn */
+static const uint32_t LOCAL_ENDPOINT_STRAND_BATCH = 8;
 
-class _LocalEndpoint::Dispatcher : public qcc::Timer, public qcc::AlarmListener {
+/**
+ * Executor that runs the method, signal and reply handlers of the local endpoint.
+ *
+ * Incoming messages are queued on a strand chosen by hashing the sender so all messages from
+ * one sender, whatever their type or object path, are handled in the order they were received
+ * while messages from different senders can be handled by any worker. A strand with queued messages is put on the deque of the worker its
+ * hash maps to; workers with an empty deque steal strands from the back of the other deques.
+ *
+ * Only one handler runs at a time unless the running handler calls EnableConcurrentCallbacks().
+ * Doing so also hands the handler's strand over to another worker so that messages queued behind
+ * it, such as a call back into the same object, are not held up while the handler blocks.
+ */
+class _LocalEndpoint::Dispatcher {
   public:
-    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY) : Timer("lepDisp" + U32ToString(qcc::IncrementAndFetch(&dispatcherCnt)), true, concurrency, true, 0), AlarmListener(), endpoint(endpoint) { }
+    Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency = LOCAL_ENDPOINT_CONCURRENCY);
+
+    ~Dispatcher();
+
+    QStatus Start();
+
+    QStatus Stop();
+
+    QStatus Join();
+
     QStatus DispatchMessage(Message& msg);
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    QStatus DispatchDeferredCallbacks();
+
+    void EnableReentrancy();
+
+    bool ThreadHoldsLock();
+
+    void GetStats(DispatchStats& stats);
 
   private:
+
+    class Worker;
+
+    struct Work {
+        Work(_Message* msg) : msg(msg), queued(GetTimestamp64()) { }
+        _Message* msg;      /**< Message holding a reference for the dispatcher or NULL for the deferred callbacks */
+        uint64_t queued;    /**< Time the work was queued */
+    };
+
+    struct Strand {
+        Strand() : scheduled(false) { }
+        Mutex lock;
+        std::deque<Work> queue;
+        bool scheduled;     /**< Strand is on a worker's deque or is being run by a worker */
+    };
+
+    QStatus Enqueue(uint32_t key, _Message* msg);
+    void Schedule(Strand* strand, uint32_t home);
+    Strand* NextStrand(uint32_t index);
+    void RunStrand(Worker* worker, Strand* strand);
+    void Dispatch(Worker* worker, Work& work);
+    Worker* CurrentWorker();
+    static void Release(_Message* msg);
+    static void Record(volatile int32_t* histogram, uint64_t ms);
+
     _LocalEndpoint* endpoint;
+    std::vector<Worker*> workers;
+    Strand strands[LOCAL_ENDPOINT_STRANDS];
+    Mutex callbackLock;     /**< Held by a worker running a handler unless the handler enabled concurrent callbacks */
+    volatile bool running;
+    volatile int32_t queueDepth;
+    volatile int32_t maxQueueDepth;
+    volatile int32_t queueLatency[DispatchStats::NUM_BUCKETS];
+    volatile int32_t handlerLatency[DispatchStats::NUM_BUCKETS];
     static int32_t dispatcherCnt;
 };
 
 int32_t _LocalEndpoint::Dispatcher::dispatcherCnt = 0;
 
-class _LocalEndpoint::DeferredCallbacks : public qcc::AlarmListener {
+class _LocalEndpoint::Dispatcher::Worker : public qcc::Thread {
+  public:
+    Worker(const qcc::String& name, uint32_t index, Dispatcher* dispatcher) :
+        Thread(name), index(index), idle(false), holdsLock(false), strand(NULL), dispatcher(dispatcher) { }
+
+    void Push(Strand* s)
+    {
+        lock.Lock(MUTEX_CONTEXT);
+        ready.push_back(s);
+        lock.Unlock(MUTEX_CONTEXT);
+        wake.SetEvent();
+    }
+
+    Strand* Pop(bool front)
+    {
+        Strand* s = NULL;
+        lock.Lock(MUTEX_CONTEXT);
+        if (!ready.empty()) {
+            if (front) {
+                s = ready.front();
+                ready.pop_front();
+            } else {
+                s = ready.back();
+                ready.pop_back();
+            }
+        }
+        lock.Unlock(MUTEX_CONTEXT);
+        return s;
+    }
+
+    const uint32_t index;
+    Mutex lock;
+    std::deque<Strand*> ready;  /**< Strands scheduled on this worker */
+    Event wake;
+    volatile bool idle;
+    bool holdsLock;             /**< Worker holds the dispatcher's callback lock */
+    Strand* strand;             /**< Strand being run or NULL if it was handed over */
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg);
+
+  private:
+    Dispatcher* dispatcher;
+};
+
+class _LocalEndpoint::DeferredCallbacks {
   public:
     DeferredCallbacks(_LocalEndpoint* ep) : endpoint(ep) { }
 
-    void AlarmTriggered(const qcc::Alarm& alarm, QStatus reason);
+    void ObjectRegistrations();
 
   private:
     _LocalEndpoint* endpoint;
@@ -392,22 +507,298 @@ QStatus _LocalEndpoint::PeerInterface(Message& message)
 }
 
 
-QStatus _LocalEndpoint::Dispatcher::DispatchMessage(Message& msg)
+_LocalEndpoint::Dispatcher::Dispatcher(_LocalEndpoint* endpoint, uint32_t concurrency) :
+    endpoint(endpoint),
+    running(false),
+    queueDepth(0),
+    maxQueueDepth(0)
 {
-    uint32_t zero = 0;
-    void* context = new Message(msg);
-    qcc::AlarmListener* localEndpointListener = this;
-    Alarm alarm(zero, localEndpointListener, context, zero);
-    QStatus status = AddAlarm(alarm);
-    if (status != ER_OK) {
-        Message* temp = static_cast<Message*>(context);
-        if (temp) {
-            delete temp;
+    for (size_t i = 0; i < DispatchStats::NUM_BUCKETS; ++i) {
+        queueLatency[i] = 0;
+        handlerLatency[i] = 0;
+    }
+    String name = "lepDisp" + U32ToString(qcc::IncrementAndFetch(&dispatcherCnt));
+    for (uint32_t i = 0; i < max(concurrency, static_cast<uint32_t>(1)); ++i) {
+        workers.push_back(new Worker(name + "_" + U32ToString(i), i, this));
+    }
+}
+
+_LocalEndpoint::Dispatcher::~Dispatcher()
+{
+    Stop();
+    Join();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
+}
+
+QStatus _LocalEndpoint::Dispatcher::Start()
+{
+    QStatus status = ER_OK;
+    running = true;
+    for (size_t i = 0; (status == ER_OK) && (i < workers.size()); ++i) {
+        status = workers[i]->Start();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to start dispatcher thread %s", workers[i]->GetName()));
+        }
+    }
+    return status;
+}
+
+QStatus _LocalEndpoint::Dispatcher::Stop()
+{
+    QStatus status = ER_OK;
+    running = false;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus tStatus = workers[i]->Stop();
+        status = (status == ER_OK) ? tStatus : status;
+    }
+    return status;
+}
+
+QStatus _LocalEndpoint::Dispatcher::Join()
+{
+    QStatus status = ER_OK;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        QStatus tStatus = workers[i]->Join();
+        status = (status == ER_OK) ? tStatus : status;
+        workers[i]->ready.clear();
+    }
+    /*
+     * Discard anything that was queued but not dispatched
+     */
+    for (uint32_t i = 0; i < LOCAL_ENDPOINT_STRANDS; ++i) {
+        Strand& strand = strands[i];
+        strand.lock.Lock(MUTEX_CONTEXT);
+        while (!strand.queue.empty()) {
+            Release(strand.queue.front().msg);
+            strand.queue.pop_front();
+            DecrementAndFetch(&queueDepth);
         }
+        strand.scheduled = false;
+        strand.lock.Unlock(MUTEX_CONTEXT);
     }
     return status;
 }
 
+void _LocalEndpoint::Dispatcher::Release(_Message* msg)
+{
+    if (msg) {
+        /* Drop the reference taken in DispatchMessage */
+        Message m = Message::wrap(msg);
+        m.DecRef();
+    }
+}
+
+QStatus _LocalEndpoint::Dispatcher::DispatchMessage(Message& msg)
+{
+    /*
+     * All message types are keyed on the sender alone so that a reply cannot overtake a signal
+     * the same sender sent before it.
+     */
+    uint32_t key = 2166136261U;
+    for (const char* c = msg->GetSender(); *c; ++c) {
+        key = (key ^ static_cast<uint8_t>(*c)) * 16777619U;
+    }
+    msg.IncRef();
+    return Enqueue(key, msg.unwrap());
+}
+
+QStatus _LocalEndpoint::Dispatcher::DispatchDeferredCallbacks()
+{
+    return Enqueue(0, NULL);
+}
+
+QStatus _LocalEndpoint::Dispatcher::Enqueue(uint32_t key, _Message* msg)
+{
+    if (!running) {
+        Release(msg);
+        return ER_BUS_STOPPING;
+    }
+    int32_t depth = IncrementAndFetch(&queueDepth);
+    int32_t maxDepth = maxQueueDepth;
+    while ((depth > maxDepth) && !CompareAndExchange(&maxQueueDepth, maxDepth, depth)) {
+        maxDepth = maxQueueDepth;
+    }
+    Strand* strand = &strands[key % LOCAL_ENDPOINT_STRANDS];
+    strand->lock.Lock(MUTEX_CONTEXT);
+    strand->queue.push_back(Work(msg));
+    bool schedule = !strand->scheduled;
+    strand->scheduled = true;
+    strand->lock.Unlock(MUTEX_CONTEXT);
+    if (schedule) {
+        Schedule(strand, key % workers.size());
+    }
+    return ER_OK;
+}
+
+void _LocalEndpoint::Dispatcher::Schedule(Strand* strand, uint32_t home)
+{
+    Worker* worker = workers[home % workers.size()];
+    worker->Push(strand);
+    if (!worker->idle) {
+        /* The home worker is busy, wake up an idle worker to steal the strand */
+        for (size_t i = 1; i < workers.size(); ++i) {
+            Worker* thief = workers[(home + i) % workers.size()];
+            if (thief->idle) {
+                thief->wake.SetEvent();
+                break;
+            }
+        }
+    }
+}
+
+_LocalEndpoint::Dispatcher::Strand* _LocalEndpoint::Dispatcher::NextStrand(uint32_t index)
+{
+    Strand* strand = workers[index]->Pop(true);
+    for (size_t i = 1; !strand && (i < workers.size()); ++i) {
+        strand = workers[(index + i) % workers.size()]->Pop(false);
+    }
+    return strand;
+}
+
+void _LocalEndpoint::Dispatcher::RunStrand(Worker* worker, Strand* strand)
+{
+    worker->strand = strand;
+    for (uint32_t n = 0; n < LOCAL_ENDPOINT_STRAND_BATCH; ++n) {
+        strand->lock.Lock(MUTEX_CONTEXT);
+        if (strand->queue.empty()) {
+            strand->scheduled = false;
+            strand->lock.Unlock(MUTEX_CONTEXT);
+            worker->strand = NULL;
+            return;
+        }
+        Work work = strand->queue.front();
+        strand->queue.pop_front();
+        strand->lock.Unlock(MUTEX_CONTEXT);
+
+        Dispatch(worker, work);
+
+        if (worker->strand != strand) {
+            /* The handler enabled concurrent callbacks and handed the strand over */
+            return;
+        }
+    }
+    /*
+     * Give other strands a turn
+     */
+    worker->strand = NULL;
+    strand->lock.Lock(MUTEX_CONTEXT);
+    bool more = !strand->queue.empty();
+    strand->scheduled = more;
+    strand->lock.Unlock(MUTEX_CONTEXT);
+    if (more) {
+        worker->Push(strand);
+    }
+}
+
+void _LocalEndpoint::Dispatcher::Dispatch(Worker* worker, Work& work)
+{
+    DecrementAndFetch(&queueDepth);
+    uint64_t start = GetTimestamp64();
+    Record(queueLatency, start - work.queued);
+
+    callbackLock.Lock(MUTEX_CONTEXT);
+    worker->holdsLock = true;
+    if (work.msg) {
+        Message msg = Message::wrap(work.msg);
+        Release(work.msg);
+        if (running) {
+            QStatus status = endpoint->DoPushMessage(msg);
+            // ER_BUS_STOPPING is a common shutdown error
+            if (status != ER_OK && status != ER_BUS_STOPPING) {
+                QCC_LogError(status, ("LocalEndpoint::DoPushMessage failed"));
+            }
+        }
+    } else if (running) {
+        endpoint->deferredCallbacks->ObjectRegistrations();
+    }
+    if (worker->holdsLock) {
+        worker->holdsLock = false;
+        callbackLock.Unlock(MUTEX_CONTEXT);
+    }
+
+    Record(handlerLatency, GetTimestamp64() - start);
+}
+
+void _LocalEndpoint::Dispatcher::Record(volatile int32_t* histogram, uint64_t ms)
+{
+    size_t bucket = 0;
+    while (ms && (bucket < (DispatchStats::NUM_BUCKETS - 1))) {
+        ms >>= 1;
+        ++bucket;
+    }
+    IncrementAndFetch(&histogram[bucket]);
+}
+
+_LocalEndpoint::Dispatcher::Worker* _LocalEndpoint::Dispatcher::CurrentWorker()
+{
+    Thread* thread = Thread::GetThread();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (static_cast<Thread*>(workers[i]) == thread) {
+            return workers[i];
+        }
+    }
+    return NULL;
+}
+
+void _LocalEndpoint::Dispatcher::EnableReentrancy()
+{
+    Worker* worker = CurrentWorker();
+    if (!worker) {
+        QCC_DbgPrintf(("EnableConcurrentCallbacks called from non-dispatcher thread %s", Thread::GetThreadName()));
+        return;
+    }
+    if (worker->holdsLock) {
+        worker->holdsLock = false;
+        callbackLock.Unlock(MUTEX_CONTEXT);
+    }
+    Strand* strand = worker->strand;
+    if (strand) {
+        worker->strand = NULL;
+        strand->lock.Lock(MUTEX_CONTEXT);
+        bool more = !strand->queue.empty();
+        strand->scheduled = more;
+        strand->lock.Unlock(MUTEX_CONTEXT);
+        if (more) {
+            Schedule(strand, worker->index + 1);
+        }
+    }
+}
+
+bool _LocalEndpoint::Dispatcher::ThreadHoldsLock()
+{
+    Worker* worker = CurrentWorker();
+    return worker && worker->holdsLock;
+}
+
+void _LocalEndpoint::Dispatcher::GetStats(DispatchStats& stats)
+{
+    int32_t depth = queueDepth;
+    stats.queueDepth = (depth > 0) ? depth : 0;
+    stats.maxQueueDepth = maxQueueDepth;
+    for (size_t i = 0; i < DispatchStats::NUM_BUCKETS; ++i) {
+        stats.queueLatency[i] = queueLatency[i];
+        stats.handlerLatency[i] = handlerLatency[i];
+    }
+}
+
+ThreadReturn STDCALL _LocalEndpoint::Dispatcher::Worker::Run(void* arg)
+{
+    while (!IsStopping()) {
+        wake.ResetEvent();
+        Strand* s = dispatcher->NextStrand(index);
+        if (s) {
+            dispatcher->RunStrand(this, s);
+        } else {
+            idle = true;
+            Event::Wait(wake);
+            idle = false;
+        }
+    }
+    return (ThreadReturn) 0;
+}
+
 void _LocalEndpoint::EnableReentrancy()
 {
     if (dispatcher) {
@@ -424,18 +815,11 @@ bool _LocalEndpoint::IsReentrantCall()
 
 }
 
-void _LocalEndpoint::Dispatcher::AlarmTriggered(const Alarm& alarm, QStatus reason)
+void _LocalEndpoint::GetDispatchStats(DispatchStats& stats)
 {
-    Message* msg = static_cast<Message*>(alarm->GetContext());
-    if (msg) {
-        if (reason == ER_OK) {
-            QStatus status = endpoint->DoPushMessage(*msg);
-            // ER_BUS_STOPPING is a common shutdown error
-            if (status != ER_OK && status != ER_BUS_STOPPING) {
-                QCC_LogError(status, ("LocalEndpoint::DoPushMessage failed"));
-            }
-        }
-        delete msg;
+    memset(&stats, 0, sizeof(stats));
+    if (dispatcher) {
+        dispatcher->GetStats(stats);
     }
 }
 
@@ -1078,34 +1462,32 @@ QStatus _LocalEndpoint::HandleMethodReply(Message& message)
     return status;
 }
 
-void _LocalEndpoint::DeferredCallbacks::AlarmTriggered(const qcc::Alarm& alarm, QStatus reason)
+void _LocalEndpoint::DeferredCallbacks::ObjectRegistrations()
 {
-    if (reason == ER_OK) {
-        /*
-         * Allow synchronous method calls from within the object registration callbacks
-         */
-        endpoint->bus->EnableConcurrentCallbacks();
-        /*
-         * Call ObjectRegistered for any unregistered bus objects
-         */
-        endpoint->objectsLock.Lock(MUTEX_CONTEXT);
-        unordered_map<const char*, BusObject*, Hash, PathEq>::iterator iter = endpoint->localObjects.begin();
-        while (endpoint->running && (iter != endpoint->localObjects.end())) {
-            if (!iter->second->isRegistered) {
-                BusObject* bo = iter->second;
-                bo->isRegistered = true;
-                bo->InUseIncrement();
-                endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
-                bo->ObjectRegistered();
-                endpoint->objectsLock.Lock(MUTEX_CONTEXT);
-                bo->InUseDecrement();
-                iter = endpoint->localObjects.begin();
-            } else {
-                ++iter;
-            }
+    /*
+     * Allow synchronous method calls from within the object registration callbacks
+     */
+    endpoint->bus->EnableConcurrentCallbacks();
+    /*
+     * Call ObjectRegistered for any unregistered bus objects
+     */
+    endpoint->objectsLock.Lock(MUTEX_CONTEXT);
+    unordered_map<const char*, BusObject*, Hash, PathEq>::iterator iter = endpoint->localObjects.begin();
+    while (endpoint->running && (iter != endpoint->localObjects.end())) {
+        if (!iter->second->isRegistered) {
+            BusObject* bo = iter->second;
+            bo->isRegistered = true;
+            bo->InUseIncrement();
+            endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
+            bo->ObjectRegistered();
+            endpoint->objectsLock.Lock(MUTEX_CONTEXT);
+            bo->InUseDecrement();
+            iter = endpoint->localObjects.begin();
+        } else {
+            ++iter;
         }
-        endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
     }
+    endpoint->objectsLock.Unlock(MUTEX_CONTEXT);
 }
 
 void _LocalEndpoint::OnBusConnected()
@@ -1113,9 +1495,8 @@ void _LocalEndpoint::OnBusConnected()
     /*
      * Use the local endpoint's dispatcher to call back to report the object registrations.
      */
-    uint32_t zero = 0;
     if (dispatcher) {
-        dispatcher->AddAlarm(Alarm(zero, deferredCallbacks));
+        dispatcher->DispatchDeferredCallbacks();
     }
 }
 
@@ -369,6 +369,27 @@ class _LocalEndpoint : public _BusEndpoint, public qcc::AlarmListener, public Me
      */
     bool IsReentrantCall();
 
+    /**
+     * Statistics kept by the signal/method dispatcher.
+     *
+     * Latencies are in milliseconds. Bucket 0 counts latencies of 0ms, bucket i counts latencies
+     * in [2^(i-1), 2^i) and the last bucket counts everything longer.
+     */
+    struct DispatchStats {
+        static const size_t NUM_BUCKETS = 12;
+        uint32_t queueDepth;                    /**< Messages currently waiting to be dispatched */
+        uint32_t maxQueueDepth;                 /**< Largest queue depth seen */
+        uint32_t queueLatency[NUM_BUCKETS];     /**< Time messages spent queued before their handler ran */
+        uint32_t handlerLatency[NUM_BUCKETS];   /**< Time spent in handlers */
+    };
+
+    /**
+     * Get the dispatcher statistics.
+     *
+     * @param[out] stats  Returns a snapshot of the dispatcher statistics.
+     */
+    void GetDispatchStats(DispatchStats& stats);
+
   private:
 
     /**
@@ -315,8 +315,7 @@ _Message::_Message(BusAttachment& bus) :
     encrypt(false),
     readState(MESSAGE_NEW),
     countRead(0),
-    writeState(MESSAGE_NEW),
-    countWrite(0)
+    deferredLock(NULL)
 {
     msgHeader.msgType = MESSAGE_INVALID;
     msgHeader.endian = myEndian;
@@ -324,12 +323,13 @@ _Message::_Message(BusAttachment& bus) :
 
 _Message::~_Message(void)
 {
-    delete [] _msgBuf;
+    MsgBufPool::Free(_msgBuf);
     delete [] msgArgs;
     while (numHandles) {
         qcc::Close(handles[--numHandles]);
     }
     delete [] handles;
+    delete deferredLock;
 }
 
 _Message::_Message(const _Message& other) :
@@ -347,14 +347,13 @@ _Message::_Message(const _Message& other) :
     encrypt(other.encrypt),
     readState(other.readState),
     countRead(other.countRead),
-    writeState(other.writeState),
-    countWrite(other.countWrite),
+    deferredLock(NULL),
     hdrFields(other.hdrFields)
 {
     if (bufSize > 0) {
         assert(other.msgBuf != NULL);
-        _msgBuf = new uint8_t[bufSize + 7];
-        msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7);
+        _msgBuf = bus->GetInternal().GetMsgBufPool().Alloc(bufSize);
+        msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are 8 byte aligned */
         bufEOD = ((uint8_t*)msgBuf) + (other.bufEOD - ((uint8_t*)other.msgBuf));
         bufPos = ((uint8_t*)msgBuf) + (other.bufPos - ((uint8_t*)other.msgBuf));
         bodyPtr = ((uint8_t*)msgBuf) + (other.bodyPtr - ((uint8_t*)other.msgBuf));
@@ -417,8 +416,8 @@ QStatus _Message::ReMarshal(const char* senderName)
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((((msgHeader.headerLen + 7) & ~7) + msgHeader.bodyLen + 7) & ~7) + 8;
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = bus->GetInternal().GetMsgBufPool().Alloc(bufSize);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are 8 byte aligned */
     bufPos = (uint8_t*)msgBuf;
     memcpy(bufPos, &msgHeader, sizeof(msgHeader));
     bufPos += sizeof(msgHeader);
@@ -450,7 +449,7 @@ QStatus _Message::ReMarshal(const char* senderName)
      */
     assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
     memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
-    delete [] _savBuf;
+    MsgBufPool::Free(_savBuf);
     return ER_OK;
 }
 
@@ -33,6 +33,7 @@
 #include <alljoyn/AllJoynStd.h>
 #include <alljoyn/Message.h>
 #include <alljoyn/MsgArg.h>
+#include <alljoyn/MsgArgCodec.h>
 
 #include "LocalTransport.h"
 #include "PeerState.h"
@@ -149,8 +150,9 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             }
             alignment = SignatureUtils::AlignmentForType((AllJoynTypeId)(arg->v_array.elemSig[0]));
             if (arg->v_array.numElements > 0) {
-                if (!arg->v_array.elements) {
-                    status = ER_BUS_BAD_VALUE;
+                /* Parse the elements if the array was unmarshaled from a message */
+                status = arg->v_array.ParseElements();
+                if (status != ER_OK) {
                     break;
                 }
                 /*
@@ -517,78 +519,90 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
     return status;
 }
 
-QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint)
+QStatus _Message::PrepareDelivery(RemoteEndpoint& endpoint, MessageWriteCursor& cursor)
 {
-    size_t pushed;
     QStatus status = ER_OK;
-    Sink& sink = endpoint->GetSink();
 
-    switch (writeState) {
-    case MESSAGE_NEW:
-        writePtr = reinterpret_cast<uint8_t*>(msgBuf);
-        countWrite = bufEOD - writePtr;
-        pushed = 0;
+    cursor.writePtr = reinterpret_cast<uint8_t*>(msgBuf);
+    cursor.countWrite = bufEOD - cursor.writePtr;
 
-        if (countWrite == 0) {
-            status = ER_BUS_EMPTY_MESSAGE;
-            QCC_LogError(status, ("Message is empty"));
-            return status;
-        }
-        /*
-         * Handles can only be passed if that feature was negotiated.
-         */
-        if (handles && !endpoint->GetFeatures().handlePassing) {
-            status = ER_BUS_HANDLES_NOT_ENABLED;
-            QCC_LogError(status, ("Handle passing was not negotiated on this connection"));
-            return status;
-        }
+    if (cursor.countWrite == 0) {
+        status = ER_BUS_EMPTY_MESSAGE;
+        QCC_LogError(status, ("Message is empty"));
+        return status;
+    }
+    /*
+     * Handles can only be passed if that feature was negotiated.
+     */
+    if (handles && !endpoint->GetFeatures().handlePassing) {
+        status = ER_BUS_HANDLES_NOT_ENABLED;
+        QCC_LogError(status, ("Handle passing was not negotiated on this connection"));
+        return status;
+    }
+    /*
+     * If the message has a TTL, check if it has expired
+     */
+    if (ttl && IsExpired()) {
+        QCC_DbgHLPrintf(("TTL has expired - discarding message %s", Description().c_str()));
+        cursor.writeState = MESSAGE_COMPLETE;
+        return ER_OK;
+    }
+    /*
+     * Check if message needs to be encrypted
+     */
+    if (encrypt) {
+        status = EncryptMessage();
         /*
-         * If the message has a TTL, check if it has expired
+         * Delivery is retried when the authentication completes
          */
-        if (ttl && IsExpired()) {
-            QCC_DbgHLPrintf(("TTL has expired - discarding message %s", Description().c_str()));
+        if (status == ER_BUS_AUTHENTICATION_PENDING) {
+            cursor.writeState = MESSAGE_COMPLETE;
             return ER_OK;
         }
-        /*
-         * Check if message needs to be encrypted
-         */
-        if (encrypt) {
-            status = EncryptMessage();
-            /*
-             * Delivery is retried when the authentication completes
-             */
-            if (status == ER_BUS_AUTHENTICATION_PENDING) {
-                return ER_OK;
-            }
+    }
+    cursor.writeState = MESSAGE_HEADERFIELDS;
+    return status;
+}
+
+QStatus _Message::DeliverNonBlocking(RemoteEndpoint& endpoint, MessageWriteCursor& cursor)
+{
+    size_t pushed;
+    QStatus status = ER_OK;
+    Sink& sink = endpoint->GetSink();
+
+    switch (cursor.writeState) {
+    case MESSAGE_NEW:
+        status = PrepareDelivery(endpoint, cursor);
+        if (cursor.writeState != MESSAGE_HEADERFIELDS) {
+            return status;
         }
-        writeState = MESSAGE_HEADERFIELDS;
     /* no break  FALLTHROUGH*/
 
     case MESSAGE_HEADERFIELDS:
         if (handles) {
-            status = sink.PushBytesAndFds(writePtr, countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
+            status = sink.PushBytesAndFds(cursor.writePtr, cursor.countWrite, pushed, handles, numHandles, endpoint->GetProcessId());
         } else {
-            status = sink.PushBytes(writePtr, countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
+            status = sink.PushBytes(cursor.writePtr, cursor.countWrite, pushed, (msgHeader.flags & ALLJOYN_FLAG_SESSIONLESS) ? (ttl * 1000) : ttl);
         }
 
         if (status == ER_OK) {
-            countWrite -= pushed;
-            writePtr += pushed;
-            writeState = MESSAGE_HEADER_BODY;
+            cursor.countWrite -= pushed;
+            cursor.writePtr += pushed;
+            cursor.writeState = MESSAGE_HEADER_BODY;
         } else { break; }
     /* no break FALLTHROUGH*/
 
     case MESSAGE_HEADER_BODY:
         status = ER_OK;
-        while (status == ER_OK && countWrite > 0) {
-            status = sink.PushBytes(writePtr, countWrite, pushed);
+        while (status == ER_OK && cursor.countWrite > 0) {
+            status = sink.PushBytes(cursor.writePtr, cursor.countWrite, pushed);
             if (status == ER_OK) {
-                countWrite -= pushed;
-                writePtr += pushed;
+                cursor.countWrite -= pushed;
+                cursor.writePtr += pushed;
             }
         }
-        if (countWrite == 0) {
-            writeState = MESSAGE_COMPLETE;
+        if (cursor.countWrite == 0) {
+            cursor.writeState = MESSAGE_COMPLETE;
         }
         break;
 
@@ -734,11 +748,12 @@ size_t _Message::ComputeHeaderLen()
     return ROUNDUP8(sizeof(msgHeader) + hdrLen);
 }
 
-QStatus _Message::EncryptMessage()
+QStatus _Message::EncryptMessage(bool requestAuthentication)
 {
     KeyBlob key;
+    PeerCipher cipher;
     PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetDestination());
-    QStatus status = peerState->GetKey(key, PEER_SESSION_KEY);
+    QStatus status = peerState->GetKey(key, PEER_SESSION_KEY, cipher);
 
     if (status == ER_OK) {
         /*
@@ -752,7 +767,7 @@ QStatus _Message::EncryptMessage()
     if (status == ER_OK) {
         size_t argsLen = msgHeader.bodyLen - ajn::Crypto::MACLength;
         size_t hdrLen = ROUNDUP8(sizeof(msgHeader) + msgHeader.headerLen);
-        status = ajn::Crypto::Encrypt(*this, key, (uint8_t*)msgBuf, hdrLen, argsLen);
+        status = ajn::Crypto::Encrypt(*this, key, cipher->aes, (uint8_t*)msgBuf, hdrLen, argsLen);
         if (status == ER_OK) {
             QCC_DbgHLPrintf(("EncryptMessage: %s", Description().c_str()));
             /*
@@ -766,7 +781,7 @@ QStatus _Message::EncryptMessage()
     /*
      * Need to request an authentication if we don't have a key.
      */
-    if (status == ER_BUS_KEY_UNAVAILABLE) {
+    if ((status == ER_BUS_KEY_UNAVAILABLE) && requestAuthentication) {
         QCC_DbgHLPrintf(("Deliver: No key - requesting authentication %s", Description().c_str()));
         Message msg = Message::wrap(this);
         status = bus->GetInternal().GetLocalEndpoint()->GetPeerObj()->RequestAuthentication(msg);
@@ -785,29 +800,35 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
                                  const MsgArg* args,
                                  uint8_t numArgs,
                                  uint8_t flags,
-                                 uint32_t sessionId)
+                                 uint32_t sessionId,
+                                 const MsgBodyEncoder* body)
 {
     char signature[256];
     QStatus status = ER_OK;
     // if the MsgArg passed in is NULL force the numArgs to be zero.
-    if (args == NULL) {
+    if ((args == NULL) || body) {
         numArgs = 0;
     }
-    size_t argsLen = (numArgs == 0) ? 0 : SignatureUtils::GetSize(args, numArgs);
+    size_t argsLen;
+    if (body) {
+        argsLen = body->GetSize();
+    } else {
+        argsLen = (numArgs == 0) ? 0 : SignatureUtils::GetSize(args, numArgs);
+    }
     size_t hdrLen = 0;
 
     if (!bus->IsStarted()) {
         return ER_BUS_BUS_NOT_STARTED;
     }
     /*
-     * Check if endianess needs to be swapped.
+     * Check if endianess needs to be swapped. A body encoder can only write native endianess.
      */
-    endianSwap = outEndian != myEndian;
+    endianSwap = !body && (outEndian != myEndian);
     /*
      * We marshal new messages in native endianess
      */
     encrypt = (flags & ALLJOYN_FLAG_ENCRYPTED) ? true : false;
-    msgHeader.endian = outEndian;
+    msgHeader.endian = endianSwap ? outEndian : myEndian;
     msgHeader.flags = flags;
     msgHeader.msgType = (uint8_t)msgType;
     msgHeader.majorVersion = ALLJOYN_MAJOR_PROTOCOL_VERSION;
@@ -864,7 +885,20 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * If there are arguments build the signature
      */
     hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].Clear();
-    if (numArgs > 0) {
+    if (body) {
+        const char* bodySig = body->GetSignature();
+        size_t sigLen = strlen(bodySig);
+        if (sigLen >= sizeof(signature)) {
+            status = ER_BUS_BAD_SIGNATURE;
+            goto ExitMarshalMessage;
+        }
+        memcpy(signature, bodySig, sigLen + 1);
+        if (sigLen > 0) {
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].typeId = ALLJOYN_SIGNATURE;
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.sig = signature;
+            hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].v_signature.len = (uint8_t)sigLen;
+        }
+    } else if (numArgs > 0) {
         size_t sigLen = 0;
         status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
         if (status != ER_OK) {
@@ -917,8 +951,8 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Allocate buffer for entire message.
      */
     bufSize = (hdrLen + msgHeader.bodyLen + 7);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = bus->GetInternal().GetMsgBufPool().Alloc(bufSize);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are 8 byte aligned */
     /*
      * Initialize the buffer and copy in the message header
      */
@@ -957,7 +991,12 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Marshal the message body
      */
     bodyPtr = bufPos;
-    status = MarshalArgs(args, numArgs);
+    if (body) {
+        status = body->Encode(bodyPtr);
+        bufPos += argsLen;
+    } else {
+        status = MarshalArgs(args, numArgs);
+    }
     if (status != ER_OK) {
         goto ExitMarshalMessage;
     }
@@ -988,14 +1027,14 @@ ExitMarshalMessage:
     /*
      * Don't need the old message buffer any more
      */
-    delete [] _oldMsgBuf;
+    MsgBufPool::Free(_oldMsgBuf);
 
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("MarshalMessage: %d+%d %s %s", hdrLen, msgHeader.bodyLen, Description().c_str(), encrypt ? " (encrypted)" : ""));
     } else {
         QCC_LogError(status, ("MarshalMessage: %s", Description().c_str()));
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MsgBufPool::Free(_msgBuf);
         _msgBuf = NULL;
         bodyPtr = NULL;
         bufPos = NULL;
@@ -1158,7 +1197,8 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
                             const MsgArg* args,
                             size_t numArgs,
                             uint8_t flags,
-                            uint16_t timeToLive)
+                            uint16_t timeToLive,
+                            const MsgBodyEncoder* body)
 {
     QStatus status;
 
@@ -1217,14 +1257,14 @@ QStatus _Message::SignalMsg(const qcc::String& signature,
     /*
      * Build signal message
      */
-    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId);
+    status = MarshalMessage(signature, destination, MESSAGE_SIGNAL, args, numArgs, flags, sessionId, body);
 
 ExitSignalMsg:
     return status;
 }
 
 
-QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs)
+QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numArgs, const MsgBodyEncoder* body)
 {
     QStatus status;
     SessionId sessionId = call->GetSessionId();
@@ -1250,7 +1290,7 @@ QStatus _Message::ReplyMsg(const Message& call, const MsgArg* args, size_t numAr
      * Build method return message (encrypted if the method call was encrypted)
      */
     status = MarshalMessage(call->replySignature, destination, MESSAGE_METHOD_RET, args,
-                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId);
+                            numArgs, call->msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED, sessionId, body);
 
     return status;
 }
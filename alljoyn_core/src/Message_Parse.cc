@@ -24,6 +24,8 @@
 
 #include <algorithm>
 
+#include <qcc/atomic.h>
+#include <qcc/Mutex.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Socket.h>
@@ -64,6 +66,335 @@ namespace ajn {
 
 
 
+/*
+ * Arrays of non-scalar values are checked when a message is unmarshaled but the elements are not
+ * parsed until they are accessed. The state needed to parse them is kept in the same allocation as
+ * the element signature, after the signature's nul terminator.
+ */
+struct DeferredElements {
+    _Message* msg;    /* The message the array was unmarshaled from */
+    uint8_t* data;    /* Start of the first element in the message buffer */
+    uint8_t* eod;     /* End of the data in the message buffer */
+    bool endianSwap;  /* true if the elements need to be endian swapped */
+    QStatus status;   /* Status from parsing the elements if parsing them failed */
+};
+
+static inline size_t DeferredElementsOffset(size_t elemSigLen)
+{
+    return (elemSigLen + sizeof(void*)) & ~(sizeof(void*) - 1);
+}
+
+static inline DeferredElements* GetDeferredElements(char* elemSig)
+{
+    return reinterpret_cast<DeferredElements*>(elemSig + DeferredElementsOffset(strlen(elemSig)));
+}
+
+QStatus AllJoynArray::ParseDeferredElements() const
+{
+    AllJoynArray* self = const_cast<AllJoynArray*>(this);
+    DeferredElements* deferred = GetDeferredElements(elemSig);
+    _Message* msg = deferred->msg;
+    /*
+     * Parsing borrows the message's buffer position so parsing deferred arrays of the same message
+     * must be serialized. Another thread may have parsed the elements while we waited for the lock.
+     */
+    msg->deferredLock->Lock(MUTEX_CONTEXT);
+    if (elements || (deferred->status != ER_OK)) {
+        QStatus status = deferred->status;
+        msg->deferredLock->Unlock(MUTEX_CONTEXT);
+        return status;
+    }
+    /*
+     * The message may be in the middle of marshaling or parsing so save and restore its state.
+     */
+    uint8_t* savPos = msg->bufPos;
+    uint8_t* savEOD = msg->bufEOD;
+    bool savEndianSwap = msg->endianSwap;
+    msg->bufPos = deferred->data;
+    msg->bufEOD = deferred->eod;
+    msg->endianSwap = deferred->endianSwap;
+
+    QStatus status = ER_OK;
+    MsgArg* parsed = new MsgArg[numElements];
+    for (size_t i = 0; (status == ER_OK) && (i < numElements); ++i) {
+        const char* esig = elemSig;
+        status = msg->ParseValue(&parsed[i], esig, true);
+    }
+    msg->bufPos = savPos;
+    msg->bufEOD = savEOD;
+    msg->endianSwap = savEndianSwap;
+
+    if (status == ER_OK) {
+        /*
+         * GetElements() reads the elements pointer without the lock so publish it with a barrier
+         * after the elements have been built.
+         */
+        CompareAndExchangePointer(reinterpret_cast<void* volatile*>(&self->elements), NULL, parsed);
+    } else {
+        QCC_LogError(status, ("Failed to parse deferred array elements \"%s\"", elemSig));
+        delete [] parsed;
+        deferred->status = status;
+    }
+    msg->deferredLock->Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
+QStatus _Message::SkipElements(const char* elemSig, const uint8_t* endOfArray, size_t& numElements)
+{
+    QStatus status = ER_OK;
+    numElements = 0;
+    /*
+     * Loop until we have consumed all of the data bytes
+     */
+    while ((status == ER_OK) && (bufPos < endOfArray)) {
+        const char* esig = elemSig;
+        status = SkipValue(esig, true);
+        ++numElements;
+    }
+    return status;
+}
+
+QStatus _Message::SkipArray(const char*& sigPtr)
+{
+    QStatus status;
+    uint32_t len;
+    const char* sigStart = sigPtr;
+    MsgArg container;
+
+    container.typeId = ALLJOYN_ARRAY;
+    status = SignatureUtils::ParseContainerSignature(container, sigPtr);
+    container.typeId = ALLJOYN_INVALID;
+    if (status != ER_OK) {
+        return status;
+    }
+    bufPos = AlignPtr(bufPos, 4);
+    if (endianSwap) {
+        len = EndianSwap32(*((uint32_t*)bufPos));
+    } else {
+        len = *((uint32_t*)bufPos);
+    }
+    bufPos += 4;
+    if ((len > ALLJOYN_MAX_ARRAY_LEN) || ((len + bufPos) > bufEOD)) {
+        status = ER_BUS_BAD_LENGTH;
+        QCC_LogError(status, ("Array length %ld at pos:%ld is too big", len, bufPos - bodyPtr - 4));
+        return status;
+    }
+    switch (*sigStart) {
+    case ALLJOYN_BYTE:
+        bufPos += len;
+        break;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        if ((len & 1) == 0) {
+            bufPos += len;
+        } else {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        break;
+
+    case ALLJOYN_BOOLEAN:
+        if ((len & 3) == 0) {
+            for (size_t i = 0; i < (len / 4); i++) {
+                uint32_t b = *(uint32_t*)bufPos;
+                if (endianSwap) {
+                    b = EndianSwap32(b);
+                }
+                if (b > 1) {
+                    status = ER_BUS_BAD_VALUE;
+                    break;
+                }
+                bufPos += 4;
+            }
+        } else {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        break;
+
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+        if ((len & 3) == 0) {
+            bufPos += len;
+        } else {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        break;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_INT64:
+    case ALLJOYN_UINT64:
+        if ((len & 7) == 0) {
+            bufPos = AlignPtr(bufPos, 8) + len;
+        } else {
+            status = ER_BUS_BAD_LENGTH;
+        }
+        break;
+
+    case ALLJOYN_STRUCT_OPEN:
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        bufPos = AlignPtr(bufPos, 8);
+
+    /* Falling through */
+    default:
+        {
+            size_t numElements;
+            status = SkipElements(sigStart, bufPos + len, numElements);
+        }
+        break;
+    }
+    return status;
+}
+
+QStatus _Message::SkipValue(const char*& sigPtr, bool arrayElem)
+{
+    QStatus status = ER_OK;
+    MsgArg container;
+
+    switch (*sigPtr++) {
+    case ALLJOYN_BYTE:
+        ++bufPos;
+        break;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        bufPos = AlignPtr(bufPos, 2) + 2;
+        break;
+
+    case ALLJOYN_BOOLEAN:
+        {
+            bufPos = AlignPtr(bufPos, 4);
+            uint32_t v = *((uint32_t*)bufPos);
+            if (endianSwap) {
+                v = EndianSwap32(v);
+            }
+            if (v > 1) {
+                status = ER_BUS_BAD_VALUE;
+            } else {
+                bufPos += 4;
+            }
+        }
+        break;
+
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+        bufPos = AlignPtr(bufPos, 4) + 4;
+        break;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        bufPos = AlignPtr(bufPos, 8) + 8;
+        break;
+
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+        {
+            bufPos = AlignPtr(bufPos, 4);
+            uint32_t len = *((uint32_t*)bufPos);
+            if (endianSwap) {
+                len = EndianSwap32(len);
+            }
+            if (len > ALLJOYN_MAX_PACKET_LEN) {
+                status = ER_BUS_BAD_LENGTH;
+                break;
+            }
+            bufPos += 4 + len;
+            if (bufPos >= bufEOD) {
+                status = ER_BUS_BAD_LENGTH;
+            } else if (*bufPos++ != 0) {
+                status = ER_BUS_NOT_NUL_TERMINATED;
+            }
+        }
+        break;
+
+    case ALLJOYN_SIGNATURE:
+        status = ParseSignature(&container);
+        container.typeId = ALLJOYN_INVALID;
+        break;
+
+    case ALLJOYN_ARRAY:
+        status = SkipArray(sigPtr);
+        break;
+
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        if (!arrayElem) {
+            status = ER_BUS_BAD_SIGNATURE;
+            break;
+        }
+        container.typeId = ALLJOYN_DICT_ENTRY;
+
+    /* Falling through */
+    case ALLJOYN_STRUCT_OPEN:
+        {
+            const char* memberSig = sigPtr;
+            size_t numMembers = 2;
+            if (container.typeId != ALLJOYN_DICT_ENTRY) {
+                container.typeId = ALLJOYN_STRUCT;
+            }
+            status = SignatureUtils::ParseContainerSignature(container, sigPtr);
+            if (container.typeId == ALLJOYN_STRUCT) {
+                numMembers = container.v_struct.numMembers;
+            }
+            container.typeId = ALLJOYN_INVALID;
+            if (status == ER_OK) {
+                bufPos = AlignPtr(bufPos, 8);
+                for (size_t i = 0; (status == ER_OK) && (i < numMembers); ++i) {
+                    status = SkipValue(memberSig);
+                }
+            }
+        }
+        break;
+
+    case ALLJOYN_VARIANT:
+        {
+            size_t len = (size_t)(*((uint8_t*)bufPos));
+            const char* varSig = (char*)(++bufPos);
+            bufPos += len;
+            if (bufPos >= bufEOD) {
+                status = ER_BUS_BAD_LENGTH;
+            } else if (*bufPos++ != 0) {
+                status = ER_BUS_BAD_SIGNATURE;
+            } else {
+                status = SkipValue(varSig);
+                if ((status == ER_OK) && (*varSig != 0)) {
+                    status = ER_BUS_BAD_SIGNATURE;
+                }
+            }
+        }
+        break;
+
+    case ALLJOYN_HANDLE:
+        {
+            bufPos = AlignPtr(bufPos, 4);
+            uint32_t index = *((uint32_t*)bufPos);
+            if (endianSwap) {
+                index = EndianSwap32(index);
+            }
+            uint32_t numHandles = (hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].typeId == ALLJOYN_INVALID) ? 0 : hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].v_uint32;
+            if (index >=  numHandles) {
+                status = ER_BUS_NO_SUCH_HANDLE;
+            } else {
+                bufPos += 4;
+            }
+        }
+        break;
+
+    default:
+        status = ER_BUS_BAD_VALUE_TYPE;
+        break;
+    }
+    /*
+     * Check we are not running of the end of the buffer
+     */
+    if ((status == ER_OK) && (bufPos > bufEOD)) {
+        status = ER_BUS_BAD_SIGNATURE;
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Message arg parse error at or near %ld", bufPos - bodyPtr));
+    }
+    return status;
+}
+
 QStatus _Message::ParseArray(MsgArg* arg,
                              const char*& sigPtr)
 {
@@ -230,46 +561,33 @@ QStatus _Message::ParseArray(MsgArg* arg,
     /* Falling through */
     default:
         {
-            qcc::String elemSig(sigStart, sigPtr - sigStart);
+            /*
+             * Check the elements are well formed and count them but leave parsing them until the
+             * application accesses them.
+             */
+            uint8_t* startOfArray = bufPos;
             size_t numElements = 0;
-            MsgArg* elements = NULL;
-            if (len > 0) {
-                /*
-                 * We know how many bytes there are in the array but not how many elements until we
-                 * unmarshal them.
-                 */
-                uint8_t* endOfArray = bufPos + len;
-                size_t capacity = 8;
-                numElements = 0;
-                elements = new MsgArg[capacity];
-                /*
-                 * Loop until we have consumed all of the data bytes
-                 */
-                while (bufPos < endOfArray) {
-                    if (numElements == capacity) {
-                        capacity *= 2;
-                        MsgArg* bigger = new MsgArg[capacity];
-                        for (size_t i = 0; i < numElements; i++) {
-                            // copy all of the elements into the larger container
-                            bigger[i] = elements[i];
-                            // Since the copy constructor above makes a Clone i.e. deep copy,
-                            // it is ok to leave the flags for elements[i] as it is here.
-                        }
-                        delete [] elements;
-                        elements = bigger;
-                    }
-                    const char* esig = elemSig.c_str();
-                    status = ParseValue(&elements[numElements++], esig, true);
-                    if (status != ER_OK) {
-                        break;
-                    }
-                }
-            }
+            size_t elemSigLen = sigPtr - sigStart;
+            char* elemSig = new char[DeferredElementsOffset(elemSigLen) + sizeof(DeferredElements)];
+            memcpy(elemSig, sigStart, elemSigLen);
+            elemSig[elemSigLen] = 0;
+            status = SkipElements(elemSig, bufPos + len, numElements);
             if (status == ER_OK) {
-                arg->v_array.SetElements(elemSig.c_str(), numElements, elements);
+                DeferredElements* deferred = GetDeferredElements(elemSig);
+                deferred->msg = this;
+                deferred->data = startOfArray;
+                deferred->eod = bufEOD;
+                deferred->endianSwap = endianSwap;
+                deferred->status = ER_OK;
+                if (!deferredLock) {
+                    deferredLock = new qcc::Mutex;
+                }
+                arg->v_array.elemSig = elemSig;
+                arg->v_array.numElements = numElements;
+                arg->v_array.elements = NULL;
                 arg->flags |= MsgArg::OwnsArgs;
             } else {
-                delete [] elements;
+                delete [] elemSig;
             }
         }
         break;
@@ -591,7 +909,8 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
         size_t hdrLen = bodyPtr - (uint8_t*)msgBuf;
         PeerState peerState = bus->GetInternal().GetPeerStateTable()->GetPeerState(GetSender());
         KeyBlob key;
-        status = peerState->GetKey(key, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
+        PeerCipher cipher;
+        status = peerState->GetKey(key, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY, cipher);
         if (status != ER_OK) {
             QCC_LogError(status, ("Unable to decrypt message"));
             /*
@@ -613,7 +932,7 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
          * algorithm adds appends a MAC block to the end of the encrypted data.
          */
         size_t bodyLen = msgHeader.bodyLen;
-        status = ajn::Crypto::Decrypt(*this, key, (uint8_t*)msgBuf, hdrLen, bodyLen);
+        status = ajn::Crypto::Decrypt(*this, key, cipher->aes, (uint8_t*)msgBuf, hdrLen, bodyLen);
         if (status != ER_OK) {
             goto ExitUnmarshalArgs;
         }
@@ -891,8 +1210,8 @@ QStatus _Message::InterpretHeader()
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((pktSize + 7) & ~7) + sizeof(uint64_t);
-    _msgBuf = new uint8_t[bufSize + 7];
-    msgBuf = (uint64_t*)((uintptr_t)(_msgBuf + 7) & ~7); /* Align to 8 byte boundary */
+    _msgBuf = bus->GetInternal().GetMsgBufPool().Alloc(bufSize);
+    msgBuf = (uint64_t*)_msgBuf; /* Pool buffers are 8 byte aligned */
     /*
      * Copy header into the buffer
      */
@@ -1003,6 +1322,11 @@ QStatus _Message::LoadBytes(uint8_t* buf, size_t buflen)
 {
     QStatus status;
 
+    if (buflen < sizeof(msgHeader)) {
+        QCC_LogError(ER_BUS_BAD_LENGTH, ("_Message::Loadbytes(): Buffer length %d is too short", buflen));
+        return ER_BUS_BAD_LENGTH;
+    }
+
     /*
      * Copy in the message header.
      */
@@ -1019,6 +1343,10 @@ QStatus _Message::LoadBytes(uint8_t* buf, size_t buflen)
         QCC_LogError(status, ("_Message::Loadbytes(): InterpretHeader() failed"));
         return status;
     }
+    if ((buflen - sizeof(msgHeader)) > pktSize) {
+        QCC_LogError(ER_BUS_BAD_LENGTH, ("_Message::Loadbytes(): Buffer length %d exceeds message length %d", buflen, sizeof(msgHeader) + pktSize));
+        return ER_BUS_BAD_LENGTH;
+    }
 
     /*
      * Copy the bits into the newly allocated buffer
@@ -1058,7 +1386,7 @@ QStatus _Message::Read(RemoteEndpoint& endpoint, bool checkSender, bool pedantic
      * Clear out any stale message state
      */
     msgBuf = NULL;
-    delete [] _msgBuf;
+    MsgBufPool::Free(_msgBuf);
     _msgBuf = NULL;
     ClearHeader();
     readState = MESSAGE_NEW;
@@ -1321,7 +1649,7 @@ ExitUnmarshal:
          * There was an unrecoverable failure while unmarshaling the message, cleanup before we return.
          */
         msgBuf = NULL;
-        delete [] _msgBuf;
+        MsgBufPool::Free(_msgBuf);
         _msgBuf = NULL;
         ClearHeader();
         if ((status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_STOPPING_THREAD)) {
@@ -1345,13 +1673,17 @@ QStatus _Message::AddExpansionRule(uint32_t token, const MsgArg* expansionArg)
     /*
      * Unpack the expansion into a standard header field structure.
      */
-    QStatus status = ER_BUS_HDR_EXPANSION_INVALID;
+    QStatus status = expansionArg->v_array.ParseElements();
+    if (status != ER_OK) {
+        return status;
+    }
+    status = ER_BUS_HDR_EXPANSION_INVALID;
     HeaderFields expFields;
     for (size_t i = 0; i < ArraySize(expFields.field); i++) {
         expFields.field[i].typeId = ALLJOYN_INVALID;
     }
-    const MsgArg* field = expansionArg->v_array.elements;
-    for (size_t i = 0; i < expansionArg->v_array.numElements; i++, field++) {
+    const MsgArg* field = expansionArg->v_array.GetElements();
+    for (size_t i = 0; i < expansionArg->v_array.GetNumElements(); i++, field++) {
         const MsgArg* id = &(field->v_struct.members[0]);
         const MsgArg* variant =  &(field->v_struct.members[1]);
         /*
@@ -56,8 +56,10 @@ qcc::String MsgArg::ToString(size_t indent) const
     switch (typeId) {
     case ALLJOYN_ARRAY:
         str += "<array type_sig=\"" + qcc::String(CHK_STR(v_array.GetElemSig())) + "\">";
-        for (uint32_t i = 0; i < v_array.numElements; i++) {
-            str += "\n" + v_array.elements[i].ToString(indent);
+        if (v_array.GetElements()) {
+            for (uint32_t i = 0; i < v_array.numElements; i++) {
+                str += "\n" + v_array.elements[i].ToString(indent);
+            }
         }
         str += "\n" + in + "</array>";
         break;
@@ -393,8 +395,10 @@ void MsgArg::Stabilize()
             break;
 
         case ALLJOYN_ARRAY:
-            for (size_t i = 0; i < v_array.numElements; i++) {
-                v_array.elements[i].Stabilize();
+            if (v_array.GetElements()) {
+                for (size_t i = 0; i < v_array.numElements; i++) {
+                    v_array.elements[i].Stabilize();
+                }
             }
             break;
 
@@ -442,10 +446,16 @@ bool MsgArg::operator==(const MsgArg& other)
         if (v_array.numElements != other.v_array.numElements) {
             return false;
         }
-        for (size_t i = 0; i < v_array.numElements; i++) {
-            if (v_array.elements[i] != other.v_array.elements[i]) {
+        if (v_array.numElements) {
+            const MsgArg* otherElements = other.v_array.GetElements();
+            if (!v_array.GetElements() || !otherElements) {
                 return false;
             }
+            for (size_t i = 0; i < v_array.numElements; i++) {
+                if (v_array.elements[i] != otherElements[i]) {
+                    return false;
+                }
+            }
         }
         return true;
 
@@ -531,9 +541,15 @@ void MsgArg::Clone(MsgArg& dest, const MsgArg& src)
 
     case ALLJOYN_ARRAY:
         if (src.v_array.numElements > 0) {
+            const MsgArg* srcElements = src.v_array.GetElements();
+            if (!srcElements) {
+                /* The elements of an unmarshaled array could not be parsed */
+                dest.typeId = ALLJOYN_INVALID;
+                break;
+            }
             dest.v_array.elements = new MsgArg[src.v_array.numElements];
             for (size_t i = 0; i < src.v_array.numElements; i++) {
-                Clone(dest.v_array.elements[i], src.v_array.elements[i]);
+                Clone(dest.v_array.elements[i], srcElements[i]);
             }
         } else {
             dest.v_array.elements = NULL;
@@ -702,7 +718,8 @@ void MsgArg::Clear()
         break;
 
     case ALLJOYN_ARRAY:
-        if (flags & OwnsArgs) {
+        /* Elements are NULL if parsing the elements of an unmarshaled array was deferred */
+        if ((flags & OwnsArgs) && v_array.elements) {
             for (size_t i = 0; i < v_array.numElements; i++) {
                 v_array.elements[i].Clear();
             }
@@ -961,7 +978,12 @@ QStatus MsgArg::VBuildArgs(const char*& signature, size_t sigLen, MsgArg* arg, s
                     return ER_INVALID_ADDRESS;
                 }
                 if (inArg->typeId == ALLJOYN_ARRAY) {
-                    status = arg->v_array.SetElements(inArg->v_array.elemSig, inArg->v_array.numElements, inArg->v_array.elements);
+                    status = inArg->v_array.ParseElements();
+                    if (status != ER_OK) {
+                        return status;
+                    }
+                    const MsgArg* elements = inArg->v_array.GetElements();
+                    status = arg->v_array.SetElements(inArg->v_array.elemSig, inArg->v_array.numElements, const_cast<MsgArg*>(elements));
                     arg->typeId = ALLJOYN_ARRAY;
                     arg->flags = 0;
                 } else {
@@ -1295,10 +1317,13 @@ QStatus MsgArg::GetElement(const char* elemSig, ...) const
     size_t numArgs;
     ++elemSig;
     QStatus status = MsgArg::VBuildArgs(elemSig, 1, &key, 1, &argp, &numArgs);
+    if (status == ER_OK) {
+        status = v_array.ParseElements();
+    }
     if (status == ER_OK) {
         status = ER_BUS_ELEMENT_NOT_FOUND;
         /* Linear search to match the key */
-        const MsgArg* entry = v_array.elements;
+        const MsgArg* entry = v_array.GetElements();
         for (size_t i = 0; i < v_array.numElements; ++i, ++entry) {
             if (*entry->v_dictEntry.key == key) {
                 status = ER_OK;
@@ -1331,8 +1356,10 @@ void MsgArg::SetOwnershipDeep()
         break;
 
     case ALLJOYN_ARRAY:
-        for (size_t i = 0; i < v_array.numElements; i++) {
-            v_array.elements[i].SetOwnershipFlags(flags, true);
+        if (v_array.GetElements()) {
+            for (size_t i = 0; i < v_array.numElements; i++) {
+                v_array.elements[i].SetOwnershipFlags(flags, true);
+            }
         }
         break;
 
@@ -1420,9 +1447,11 @@ QStatus MsgArg::ParseArray(const MsgArg* arry, const char* elemSig, size_t elemS
     case ALLJOYN_VARIANT:
     case ALLJOYN_HANDLE:
         if (strncmp(elemSig, arry->v_array.elemSig, elemSigLen) == 0) {
-            *l = arry->v_array.GetNumElements();
-            *p = (const void*)arry->v_array.GetElements();
-            status = ER_OK;
+            status = arry->v_array.ParseElements();
+            if (status == ER_OK) {
+                *p = (const void*)arry->v_array.GetElements();
+                *l = arry->v_array.GetNumElements();
+            }
         }
         break;
 
@@ -0,0 +1,220 @@
+/**
+ * @file
+ * Size-classed pool for message marshaling buffers
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <assert.h>
+
+#if defined(QCC_OS_GROUP_WINDOWS)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include <qcc/Debug.h>
+#include <qcc/atomic.h>
+
+#include "MsgBufPool.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Every block starts with a 16 byte header holding the owning pool and the size class. This keeps
+ * the buffer that follows 8 byte aligned.
+ */
+static const size_t HeaderWords = 2;
+static const size_t HeaderSize = HeaderWords * sizeof(uint64_t);
+
+MsgBufPool::MsgBufPool() : refs(1), globalHits(0), heapAllocs(0), heapFrees(0)
+{
+    global.bytes = 0;
+    for (size_t i = 0; i < NumCaches; ++i) {
+        caches[i].free.bytes = 0;
+        caches[i].allocs = 0;
+        caches[i].frees = 0;
+        caches[i].hits = 0;
+        for (size_t c = 0; c < NumClasses; ++c) {
+            caches[i].free.blocks[c].reserve(MaxCached(c));
+        }
+    }
+}
+
+MsgBufPool::~MsgBufPool()
+{
+    for (size_t c = 0; c < NumClasses; ++c) {
+        for (size_t i = 0; i < NumCaches; ++i) {
+            vector<uint64_t*>& blocks = caches[i].free.blocks[c];
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                delete [] blocks[b];
+            }
+        }
+        for (size_t b = 0; b < global.blocks[c].size(); ++b) {
+            delete [] global.blocks[c][b];
+        }
+    }
+}
+
+void MsgBufPool::Release()
+{
+    if (DecrementAndFetch(&refs) == 0) {
+        delete this;
+    }
+}
+
+size_t MsgBufPool::MaxCached(size_t sizeClass)
+{
+    /* Cache up to 16 of the small buffers but only a couple of the large ones per thread cache */
+    size_t max = (256 * 1024) / ClassSize(sizeClass);
+    return (max > 16) ? 16 : max;
+}
+
+MsgBufPool::ThreadCache& MsgBufPool::GetThreadCache()
+{
+#if defined(QCC_OS_GROUP_WINDOWS)
+    uint32_t id = (uint32_t)GetCurrentThreadId();
+#else
+    uint64_t tid = (uint64_t)(uintptr_t)pthread_self();
+    uint32_t id = (uint32_t)((tid >> 12) ^ (tid >> 24) ^ tid);
+#endif
+    return caches[((id * 2654435761U) >> 16) % NumCaches];
+}
+
+uint8_t* MsgBufPool::Alloc(size_t size)
+{
+    size_t sizeClass = 0;
+    while ((sizeClass < NumClasses) && (ClassSize(sizeClass) < (size + HeaderSize))) {
+        ++sizeClass;
+    }
+    uint64_t* block = NULL;
+
+    if (sizeClass < NumClasses) {
+        ThreadCache& cache = GetThreadCache();
+        cache.lock.Lock(MUTEX_CONTEXT);
+        ++cache.allocs;
+        vector<uint64_t*>& blocks = cache.free.blocks[sizeClass];
+        if (!blocks.empty()) {
+            block = blocks.back();
+            blocks.pop_back();
+            cache.free.bytes -= ClassSize(sizeClass);
+            ++cache.hits;
+        }
+        cache.lock.Unlock(MUTEX_CONTEXT);
+
+        if (!block) {
+            globalLock.Lock(MUTEX_CONTEXT);
+            vector<uint64_t*>& gblocks = global.blocks[sizeClass];
+            if (!gblocks.empty()) {
+                block = gblocks.back();
+                gblocks.pop_back();
+                global.bytes -= ClassSize(sizeClass);
+                ++globalHits;
+            } else {
+                ++heapAllocs;
+            }
+            globalLock.Unlock(MUTEX_CONTEXT);
+        }
+        if (!block) {
+            block = new uint64_t[ClassSize(sizeClass) / sizeof(uint64_t)];
+        }
+        IncrementAndFetch(&refs);
+        block[0] = (uint64_t)(uintptr_t)this;
+    } else {
+        /* Larger than any size class, these buffers are not tracked by the pool */
+        QCC_DbgPrintf(("MsgBufPool::Alloc unpooled buffer of %u bytes", (unsigned int)size));
+        block = new uint64_t[HeaderWords + (size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+        block[0] = 0;
+    }
+    block[1] = sizeClass;
+    return reinterpret_cast<uint8_t*>(block + HeaderWords);
+}
+
+void MsgBufPool::Free(uint8_t* buf)
+{
+    if (buf) {
+        uint64_t* block = reinterpret_cast<uint64_t*>(buf) - HeaderWords;
+        MsgBufPool* pool = reinterpret_cast<MsgBufPool*>((uintptr_t)block[0]);
+        if (pool) {
+            pool->Free(block, (size_t)block[1]);
+        } else {
+            delete [] block;
+        }
+    }
+}
+
+void MsgBufPool::Free(uint64_t* block, size_t sizeClass)
+{
+    assert(sizeClass < NumClasses);
+    size_t classSize = ClassSize(sizeClass);
+
+    ThreadCache& cache = GetThreadCache();
+    cache.lock.Lock(MUTEX_CONTEXT);
+    ++cache.frees;
+    vector<uint64_t*>& blocks = cache.free.blocks[sizeClass];
+    if (blocks.size() < MaxCached(sizeClass)) {
+        blocks.push_back(block);
+        cache.free.bytes += classSize;
+        block = NULL;
+    }
+    cache.lock.Unlock(MUTEX_CONTEXT);
+
+    if (block) {
+        globalLock.Lock(MUTEX_CONTEXT);
+        if ((global.bytes + classSize) <= MaxGlobalBytes) {
+            global.blocks[sizeClass].push_back(block);
+            global.bytes += classSize;
+            block = NULL;
+        } else {
+            ++heapFrees;
+        }
+        globalLock.Unlock(MUTEX_CONTEXT);
+        delete [] block;
+    }
+    Release();
+}
+
+void MsgBufPool::GetStats(Stats& stats)
+{
+    stats.allocs = 0;
+    stats.frees = 0;
+    stats.cacheHits = 0;
+    stats.cachedBytes = 0;
+    for (size_t i = 0; i < NumCaches; ++i) {
+        caches[i].lock.Lock(MUTEX_CONTEXT);
+        stats.allocs += caches[i].allocs;
+        stats.frees += caches[i].frees;
+        stats.cacheHits += caches[i].hits;
+        stats.cachedBytes += caches[i].free.bytes;
+        caches[i].lock.Unlock(MUTEX_CONTEXT);
+    }
+    globalLock.Lock(MUTEX_CONTEXT);
+    stats.globalHits = globalHits;
+    stats.heapAllocs = heapAllocs;
+    stats.heapFrees = heapFrees;
+    stats.cachedBytes += global.bytes;
+    globalLock.Unlock(MUTEX_CONTEXT);
+}
+
+}
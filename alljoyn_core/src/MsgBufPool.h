@@ -0,0 +1,150 @@
+/**
+ * @file
+ * Size-classed pool for message marshaling buffers
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MSGBUFPOOL_H
+#define _ALLJOYN_MSGBUFPOOL_H
+
+#ifndef __cplusplus
+#error Only include MsgBufPool.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+#include <qcc/Mutex.h>
+
+#include <vector>
+
+namespace ajn {
+
+/**
+ * A pool of 8 byte aligned buffers for holding marshaled messages.
+ *
+ * Buffers are grouped in power-of-two size classes. Freed buffers are first returned to a small
+ * cache picked by the calling thread so that threads marshaling and parsing messages rarely
+ * contend with each other, and from there overflow into a bounded global free list. Only when
+ * both are empty (or full, when freeing) is the heap used.
+ *
+ * Each bus attachment owns one pool. The pool is reference counted by the buffers it hands out
+ * so that messages that outlive their bus attachment can still be freed safely.
+ */
+class MsgBufPool {
+  public:
+
+    /**
+     * Buffer pool statistics
+     */
+    struct Stats {
+        uint64_t allocs;       /**< Number of buffers handed out */
+        uint64_t frees;        /**< Number of buffers returned */
+        uint64_t cacheHits;    /**< Allocations satisfied from a thread cache */
+        uint64_t globalHits;   /**< Allocations satisfied from the global free list */
+        uint64_t heapAllocs;   /**< Allocations that went to the heap */
+        uint64_t heapFrees;    /**< Frees that went back to the heap */
+        uint64_t cachedBytes;  /**< Bytes currently held in the thread caches and the global free list */
+    };
+
+    /**
+     * Constructor. The pool starts with a single reference held by the creator.
+     */
+    MsgBufPool();
+
+    /**
+     * Release the creator's reference. The pool is deleted once all buffers have been freed.
+     */
+    void Release();
+
+    /**
+     * Get a buffer that can hold at least size bytes.
+     *
+     * @param size  Required size in bytes.
+     *
+     * @return  An 8 byte aligned buffer that must be returned with MsgBufPool::Free().
+     */
+    uint8_t* Alloc(size_t size);
+
+    /**
+     * Return a buffer to the pool it was allocated from.
+     *
+     * @param buf  A buffer returned by Alloc() or NULL.
+     */
+    static void Free(uint8_t* buf);
+
+    /**
+     * Get a snapshot of the pool statistics.
+     *
+     * @param[out] stats  Returns the statistics.
+     */
+    void GetStats(Stats& stats);
+
+  private:
+
+    /** Smallest size class is 2^MinClassShift bytes */
+    static const size_t MinClassShift = 9;
+
+    /** Number of size classes, the largest one can hold a maximum sized message */
+    static const size_t NumClasses = 10;
+
+    /** Number of thread caches */
+    static const size_t NumCaches = 8;
+
+    /** Upper limit on the bytes held in the global free list */
+    static const size_t MaxGlobalBytes = 4 * 1024 * 1024;
+
+    /** Free lists for each size class */
+    struct FreeLists {
+        std::vector<uint64_t*> blocks[NumClasses];
+        uint64_t bytes;
+    };
+
+    /** Cache used by a subset of the threads */
+    struct ThreadCache {
+        qcc::Mutex lock;
+        FreeLists free;
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t hits;
+    };
+
+    MsgBufPool(const MsgBufPool& other);
+    MsgBufPool& operator=(const MsgBufPool& other);
+
+    ~MsgBufPool();
+
+    void Free(uint64_t* block, size_t sizeClass);
+
+    ThreadCache& GetThreadCache();
+
+    static size_t ClassSize(size_t sizeClass) { return (size_t)1 << (sizeClass + MinClassShift); }
+
+    static size_t MaxCached(size_t sizeClass);
+
+    volatile int32_t refs;    /**< Reference held by the owner plus one for each buffer handed out */
+
+    ThreadCache caches[NumCaches];
+
+    qcc::Mutex globalLock;    /**< Protects global and the global counters */
+    FreeLists global;
+    uint64_t globalHits;
+    uint64_t heapAllocs;
+    uint64_t heapFrees;
+};
+
+}
+
+#endif
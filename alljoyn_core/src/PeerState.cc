@@ -116,6 +116,23 @@ bool _PeerState::IsValidSerial(uint32_t serial, bool secure, bool unreliable)
 
 }
 
+QStatus _PeerState::GetKey(qcc::KeyBlob& key, PeerKeyType keyType, PeerCipher& cipher)
+{
+    keyLock.Lock(MUTEX_CONTEXT);
+    QStatus status = GetKey(key, keyType);
+    if (status == ER_OK) {
+        /*
+         * Expand the key the first time it is used.
+         */
+        if (!ciphers[keyType]->aes && (key.GetType() == KeyBlob::AES)) {
+            ciphers[keyType]->aes = new Crypto_AES(key, Crypto_AES::CCM);
+        }
+        cipher = ciphers[keyType];
+    }
+    keyLock.Unlock(MUTEX_CONTEXT);
+    return status;
+}
+
 PeerStateTable::PeerStateTable()
 {
     Clear();
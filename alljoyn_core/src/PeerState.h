@@ -35,6 +35,7 @@
 
 #include <qcc/String.h>
 #include <qcc/GUID.h>
+#include <qcc/Crypto.h>
 #include <qcc/KeyBlob.h>
 #include <qcc/ManagedObj.h>
 #include <qcc/Mutex.h>
@@ -56,6 +57,47 @@ typedef enum {
     PEER_GROUP_KEY   = 1  /**< broadcast key for secure point-to-multipoint communication */
 } PeerKeyType;
 
+/**
+ * Holds the AES-CCM context for one of a peer's keys so the key schedule is expanded when the key is
+ * first used rather than for every message encrypted or decrypted with the key.
+ */
+class _PeerCipher {
+  public:
+
+    /**
+     * Default constructor
+     */
+    _PeerCipher() : aes(NULL) { }
+
+    /**
+     * Destructor
+     */
+    ~_PeerCipher() { delete aes; }
+
+    /**
+     * The AES-CCM context or NULL if the key is not an AES key.
+     */
+    qcc::Crypto_AES* aes;
+
+  private:
+
+    /**
+     * Copy constructor is private
+     */
+    _PeerCipher(const _PeerCipher& other);
+
+    /**
+     * Assigment operator is private
+     */
+    _PeerCipher& operator=(const _PeerCipher& other);
+};
+
+/**
+ * PeerCipher is reference counted so that a context that is being used for a message outlives the
+ * key being replaced or cleared.
+ */
+typedef qcc::ManagedObj<_PeerCipher> PeerCipher;
+
 /**
  * PeerState is a reference counted (managed) class that keeps track of state information for other
  * peers that this peer communicates with.
@@ -141,8 +183,11 @@ class _PeerState {
      * @param keyType    Indicate if this is the unicast or broadcast key.
      */
     void SetKey(const qcc::KeyBlob& key, PeerKeyType keyType) {
+        keyLock.Lock(MUTEX_CONTEXT);
         keys[keyType] = key;
+        ciphers[keyType] = PeerCipher();
         isSecure = key.IsValid();
+        keyLock.Unlock(MUTEX_CONTEXT);
     }
 
     /**
@@ -155,26 +200,45 @@ class _PeerState {
      *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
      */
     QStatus GetKey(qcc::KeyBlob& key, PeerKeyType keyType) {
+        QStatus status = ER_BUS_KEY_UNAVAILABLE;
+        keyLock.Lock(MUTEX_CONTEXT);
         if (isSecure) {
             key = keys[keyType];
             if (key.HasExpired()) {
                 ClearKeys();
-                return ER_BUS_KEY_EXPIRED;
+                status = ER_BUS_KEY_EXPIRED;
             } else {
-                return ER_OK;
+                status = ER_OK;
             }
-        } else {
-            return ER_BUS_KEY_UNAVAILABLE;
         }
+        keyLock.Unlock(MUTEX_CONTEXT);
+        return status;
     }
 
+    /**
+     * Gets the session key for this peer and the AES-CCM context for that key.
+     *
+     * @param key     [out]Returns the session key.
+     * @param keyType Indicate if this is the unicast or broadcast key.
+     * @param cipher  [out]Returns the cipher context for the session key.
+     *
+     * @return  - ER_OK if there is a session key set for this peer.
+     *          - ER_BUS_KEY_UNAVAILABLE if no session key has been set for this peer.
+     *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
+     */
+    QStatus GetKey(qcc::KeyBlob& key, PeerKeyType keyType, PeerCipher& cipher);
+
     /**
      * Clear the keys for this peer.
      */
     void ClearKeys() {
+        keyLock.Lock(MUTEX_CONTEXT);
         keys[PEER_SESSION_KEY].Erase();
         keys[PEER_GROUP_KEY].Erase();
+        ciphers[PEER_SESSION_KEY] = PeerCipher();
+        ciphers[PEER_GROUP_KEY] = PeerCipher();
         isSecure = false;
+        keyLock.Unlock(MUTEX_CONTEXT);
     }
 
     /**
@@ -315,6 +379,16 @@ class _PeerState {
      */
     qcc::KeyBlob keys[2];
 
+    /**
+     * The cipher contexts for the session keys.
+     */
+    PeerCipher ciphers[2];
+
+    /**
+     * Lock that protects the session keys and cipher contexts.
+     */
+    qcc::Mutex keyLock;
+
     /**
      * Serial number window. Used by IsValidSerial() to detect replay attacks. The size of the
      * window defines that largest tolerable gap between consecutive serial numbers.
@@ -21,6 +21,10 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
@@ -29,6 +33,7 @@
 #include <qcc/SocketStream.h>
 #include <qcc/atomic.h>
 #include <qcc/IODispatch.h>
+#include <qcc/ThreadPool.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/AllJoynStd.h>
@@ -82,8 +87,13 @@ class _RemoteEndpoint::Internal {
         hasRxSessionMsg(false),
         getNextMsg(true),
         currentWriteMsg(bus),
+        writeCursor(),
+        gatherWrites(true),
         stopping(false),
-        sessionId(0)
+        sessionId(0),
+        cryptoTasks(0),
+        txWaitCrypto(false),
+        pendingAuth(NULL)
     {
     }
 
@@ -125,9 +135,39 @@ class _RemoteEndpoint::Internal {
     bool validateSender;                     /**< If true, the sender field on incomming messages will be overwritten with actual endpoint name */
     bool hasRxSessionMsg;                    /**< true iff this endpoint has previously processed a non-control message */
     bool getNextMsg;                         /**< If true, read the next message from the txQueue */
-    Message currentWriteMsg;                 /**< The message currently being read for this endpoint */
+    Message currentWriteMsg;                 /**< The message currently being written for this endpoint */
+    MessageWriteCursor writeCursor;          /**< Write position of this endpoint in currentWriteMsg */
+    bool gatherWrites;                       /**< If true, the stream can write several queued messages at once */
+    std::vector<Message> gatherMsgs;         /**< Messages being written by the current gathered write */
     bool stopping;                           /**< Is this EP stopping? */
     uint32_t sessionId;                      /**< SessionId for BusToBus endpoint. (not used for non-B2B endpoints) */
+    std::map<_Message*, bool> cryptoClaimed; /**< Queued messages taken by the crypto pool, true while they are being encrypted */
+    uint32_t cryptoTasks;                    /**< Number of encryption tasks handed to the bus crypto pool */
+    bool txWaitCrypto;                       /**< Writes are paused until the next message to write is encrypted */
+    EndpointAuth* pendingAuth;               /**< Establishment left waiting for data by TryEstablish() */
+
+    /**
+     * Check if the message at the back of the tx queue is being encrypted. Must be called with lock held.
+     */
+    bool NextMsgPending() const {
+        if (txQueue.empty()) {
+            return false;
+        }
+        std::map<_Message*, bool>::const_iterator it = cryptoClaimed.find(const_cast<_Message*>(txQueue.back().unwrap()));
+        return (it != cryptoClaimed.end()) && it->second;
+    }
+};
+
+/*
+ * The closure handed to the bus crypto pool. The endpoint reference keeps the endpoint alive
+ * until the task has run.
+ */
+class _RemoteEndpoint::EncryptTask : public qcc::Runnable {
+  public:
+    EncryptTask(RemoteEndpoint& ep) : endpoint(ep) { }
+    virtual void Run(void) { endpoint->EncryptQueued(); }
+  private:
+    RemoteEndpoint endpoint;
 };
 
 
@@ -283,6 +323,46 @@ QStatus _RemoteEndpoint::Establish(const qcc::String& authMechanisms, qcc::Strin
     return status;
 }
 
+QStatus _RemoteEndpoint::TryEstablish(const qcc::String& authMechanisms, qcc::String& authUsed, AuthListener* listener)
+{
+    if (!internal || minimalEndpoint) {
+        return ER_BUS_NO_ENDPOINT;
+    }
+    if (!internal->pendingAuth) {
+        RemoteEndpoint rep = RemoteEndpoint::wrap(this);
+        internal->pendingAuth = new EndpointAuth(internal->bus, rep, internal->incoming);
+    }
+    EndpointAuth* auth = internal->pendingAuth;
+
+    QStatus status = auth->TryEstablish(authMechanisms, authUsed, listener);
+    if (status == ER_WOULDBLOCK) {
+        return status;
+    }
+    if (status == ER_OK) {
+        internal->uniqueName = auth->GetUniqueName();
+        internal->remoteName = auth->GetRemoteName();
+        internal->remoteGUID = auth->GetRemoteGUID();
+        internal->features.protocolVersion = auth->GetRemoteProtocolVersion();
+        internal->features.trusted = (authUsed != "ANONYMOUS");
+        internal->features.nameTransfer = (SessionOpts::NameTransferType)auth->GetNameTransfer();
+    }
+    AbortEstablish();
+    return status;
+}
+
+void _RemoteEndpoint::AbortEstablish()
+{
+    /*
+     * The pending EndpointAuth holds a reference to this endpoint, so it must be
+     * detached before it is deleted.
+     */
+    if (internal && internal->pendingAuth) {
+        EndpointAuth* auth = internal->pendingAuth;
+        internal->pendingAuth = NULL;
+        delete auth;
+    }
+}
+
 QStatus _RemoteEndpoint::SetLinkTimeout(uint32_t& idleTimeout)
 {
     if (internal) {
@@ -808,10 +888,21 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut)
         if (internal->getNextMsg) {
             internal->lock.Lock(MUTEX_CONTEXT);
             if (!internal->txQueue.empty()) {
-                /* Make a deep copy of the message since there is state information inside the message.
-                 * Each copy of the message could be in different write state.
+                /* The write state is kept in the endpoint so the marshaled buffer can be shared with
+                 * every other endpoint the message was routed to. Only messages that get rewritten
+                 * during delivery need a copy of their own.
                  */
-                internal->currentWriteMsg = Message(internal->txQueue.back(), true);
+                Message& next = internal->txQueue.back();
+                /* Let the crypto pool finish the next message rather than encrypting it twice */
+                if (internal->NextMsgPending()) {
+                    internal->txWaitCrypto = true;
+                    internal->bus.GetInternal().GetIODispatch().DisableWriteCallback(internal->stream);
+                    internal->lock.Unlock(MUTEX_CONTEXT);
+                    return ER_OK;
+                }
+                internal->cryptoClaimed.erase(next.unwrap());
+                internal->currentWriteMsg = next->NeedsPrivateCopy() ? Message(next, true) : next;
+                internal->writeCursor = MessageWriteCursor();
 
                 /* Alert next thread on wait queue */
                 if (0 < internal->txWaitQueue.size()) {
@@ -833,22 +924,42 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut)
         }
         /* Deliver message */
         RemoteEndpoint rep = RemoteEndpoint::wrap(this);
-        status = internal->currentWriteMsg->DeliverNonBlocking(rep);
-        /* Report authorization failure as a security violation */
-        if (status == ER_BUS_NOT_AUTHORIZED) {
-            internal->bus.GetInternal().GetLocalEndpoint()->GetPeerObj()->HandleSecurityViolation(internal->currentWriteMsg, status);
-            /*
-             * Clear the error after reporting the security violation otherwise we will exit
-             * this thread which will shut down the endpoint.
-             */
-            status = ER_OK;
+        size_t numDelivered = 0;
+        if (internal->gatherWrites && !internal->currentWriteMsg->handles) {
+            status = DeliverGathered(rep, numDelivered);
+        } else {
+            status = internal->currentWriteMsg->DeliverNonBlocking(rep, internal->writeCursor);
+            /* Report authorization failure as a security violation */
+            if (status == ER_BUS_NOT_AUTHORIZED) {
+                internal->bus.GetInternal().GetLocalEndpoint()->GetPeerObj()->HandleSecurityViolation(internal->currentWriteMsg, status);
+                /*
+                 * Clear the error after reporting the security violation otherwise we will exit
+                 * this thread which will shut down the endpoint.
+                 */
+                status = ER_OK;
+            }
+            if (status == ER_OK) {
+                internal->writeCursor.writeState = MESSAGE_COMPLETE;
+                numDelivered = 1;
+            }
         }
-        if (status == ER_OK) {
-            /* Message has been successfully delivered. i.e. PushBytes is complete
+        if (numDelivered > 0) {
+            /* Messages have been successfully delivered. i.e. PushBytes is complete
              */
             internal->lock.Lock(MUTEX_CONTEXT);
-            internal->txQueue.pop_back();
-            internal->getNextMsg = true;
+            for (size_t i = 0; i < numDelivered; ++i) {
+                internal->txQueue.pop_back();
+                /* The first message already alerted a waiting thread when it was dequeued */
+                if ((i > 0) && (0 < internal->txWaitQueue.size())) {
+                    Thread* wakeMe = internal->txWaitQueue.back();
+                    internal->txWaitQueue.pop_back();
+                    QStatus alertStatus = wakeMe->Alert();
+                    if (ER_OK != alertStatus) {
+                        QCC_LogError(alertStatus, ("Failed to alert thread blocked on full tx queue"));
+                    }
+                }
+            }
+            internal->getNextMsg = (internal->writeCursor.writeState == MESSAGE_COMPLETE);
             internal->lock.Unlock(MUTEX_CONTEXT);
         }
     }
@@ -876,6 +987,98 @@ QStatus _RemoteEndpoint::WriteCallback(qcc::Sink& sink, bool isTimedOut)
     return status;
 }
 
+QStatus _RemoteEndpoint::DeliverGathered(RemoteEndpoint& rep, size_t& numDelivered)
+{
+    /* Limits chosen so a full tx queue of small messages goes out in one write */
+    static const size_t MAX_GATHER_MSGS = 32;
+    static const size_t MAX_GATHER_BYTES = 64 * 1024;
+
+    QStatus status = ER_OK;
+    MessageWriteCursor cursors[MAX_GATHER_MSGS];
+    IOVec iov[MAX_GATHER_MSGS];
+
+    numDelivered = 0;
+    if (internal->writeCursor.writeState == MESSAGE_NEW) {
+        status = internal->currentWriteMsg->PrepareDelivery(rep, internal->writeCursor);
+        if (internal->writeCursor.writeState != MESSAGE_HEADERFIELDS) {
+            if (status == ER_OK) {
+                /* Message was dropped rather than written */
+                numDelivered = 1;
+            }
+            return status;
+        }
+    }
+
+    /*
+     * The current message is at the back of the tx queue followed by the messages that will be
+     * written after it. Messages that carry handles or have to be encrypted are not gathered,
+     * they are delivered on their own when they become the current message.
+     */
+    vector<Message>& batch = internal->gatherMsgs;
+    batch.push_back(internal->currentWriteMsg);
+    cursors[0] = internal->writeCursor;
+    size_t numBytes = cursors[0].countWrite;
+
+    internal->lock.Lock(MUTEX_CONTEXT);
+    size_t queued = internal->txQueue.size();
+    for (size_t i = 1; (i < queued) && (batch.size() < MAX_GATHER_MSGS) && (numBytes < MAX_GATHER_BYTES); ++i) {
+        Message& next = internal->txQueue[queued - 1 - i];
+        if (next->handles || next->NeedsPrivateCopy()) {
+            break;
+        }
+        MessageWriteCursor& cursor = cursors[batch.size()];
+        cursor = MessageWriteCursor();
+        if ((next->PrepareDelivery(rep, cursor) != ER_OK) || (cursor.writeState != MESSAGE_HEADERFIELDS)) {
+            break;
+        }
+        batch.push_back(next);
+        numBytes += cursor.countWrite;
+    }
+    internal->lock.Unlock(MUTEX_CONTEXT);
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        iov[i].buf = reinterpret_cast<char*>(cursors[i].writePtr);
+        iov[i].len = cursors[i].countWrite;
+    }
+    size_t sent = 0;
+    status = rep->GetSink().PushBytesV(iov, batch.size(), sent);
+    if (status == ER_NOT_IMPLEMENTED) {
+        /* Fall back to writing one message at a time */
+        internal->gatherWrites = false;
+        batch.clear();
+        return ER_OK;
+    }
+
+    /* Advance through the batch by the number of bytes written */
+    size_t i = 0;
+    if (status == ER_OK) {
+        while (i < batch.size()) {
+            size_t pushed = (std::min)(sent, cursors[i].countWrite);
+            cursors[i].writePtr += pushed;
+            cursors[i].countWrite -= pushed;
+            sent -= pushed;
+            if (cursors[i].countWrite > 0) {
+                if (pushed > 0) {
+                    cursors[i].writeState = MESSAGE_HEADER_BODY;
+                }
+                break;
+            }
+            cursors[i].writeState = MESSAGE_COMPLETE;
+            ++numDelivered;
+            ++i;
+        }
+    }
+    /* The first message that was not completely written becomes the current message */
+    if (i < batch.size()) {
+        internal->currentWriteMsg = batch[i];
+        internal->writeCursor = cursors[i];
+    } else {
+        internal->writeCursor = cursors[i - 1];
+    }
+    batch.clear();
+    return status;
+}
+
 QStatus _RemoteEndpoint::PushMessage(Message& msg)
 {
     assert(minimalEndpoint == false && "_RemoteEndpoint::PushMessage(): Unexpected PushMessage with no queues");
@@ -913,6 +1116,7 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
             while (it != internal->txQueue.end()) {
                 uint32_t expMs;
                 if ((*it)->IsExpired(&expMs)) {
+                    internal->cryptoClaimed.erase(it->unwrap());
                     internal->txQueue.erase(it);
                     break;
                 } else {
@@ -969,6 +1173,19 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     if (wasEmpty && (status == ER_OK)) {
         internal->bus.GetInternal().GetIODispatch().EnableWriteCallbackNow(internal->stream);
     }
+    /*
+     * Messages that have to be encrypted are handed to the crypto pool, if there is one, so they
+     * are encrypted while the messages ahead of them are being written.
+     */
+    if ((status == ER_OK) && msg->NeedsPrivateCopy() && !msg->handles) {
+        ThreadPool* cryptoPool = internal->bus.GetInternal().GetCryptoPool();
+        if (cryptoPool && (internal->cryptoTasks < cryptoPool->GetConcurrency())) {
+            RemoteEndpoint rep = RemoteEndpoint::wrap(this);
+            if (cryptoPool->Execute(Ptr<Runnable>(new EncryptTask(rep))) == ER_OK) {
+                ++internal->cryptoTasks;
+            }
+        }
+    }
     internal->lock.Unlock(MUTEX_CONTEXT);
 #ifndef NDEBUG
 #undef QCC_MODULE
@@ -985,6 +1202,63 @@ QStatus _RemoteEndpoint::PushMessage(Message& msg)
     return status;
 }
 
+void _RemoteEndpoint::EncryptQueued()
+{
+    internal->lock.Lock(MUTEX_CONTEXT);
+    while (!internal->stopping) {
+        /*
+         * Find the oldest queued message that still has to be encrypted and has not already been
+         * taken by the pool. Once the writer has picked up the message at the back of the queue it
+         * is no longer ours to replace.
+         */
+        size_t queued = internal->txQueue.size();
+        size_t i = internal->getNextMsg ? 0 : 1;
+        for (; i < queued; ++i) {
+            Message& next = internal->txQueue[queued - 1 - i];
+            if (next->NeedsPrivateCopy() && !next->handles && (internal->cryptoClaimed.find(next.unwrap()) == internal->cryptoClaimed.end())) {
+                break;
+            }
+        }
+        if (i >= queued) {
+            break;
+        }
+        Message msg = internal->txQueue[queued - 1 - i];
+        internal->cryptoClaimed[msg.unwrap()] = true;
+        internal->lock.Unlock(MUTEX_CONTEXT);
+
+        /*
+         * Encrypt a private copy exactly as the writer would have done. Messages that need an
+         * authentication or are not authorized are left for the writer to deal with.
+         */
+        Message copy(msg, true);
+        QStatus status = copy->EncryptMessage(false);
+
+        internal->lock.Lock(MUTEX_CONTEXT);
+        std::map<_Message*, bool>::iterator claimed = internal->cryptoClaimed.find(msg.unwrap());
+        if (claimed != internal->cryptoClaimed.end()) {
+            if (status == ER_OK) {
+                internal->cryptoClaimed.erase(claimed);
+                for (deque<Message>::iterator it = internal->txQueue.begin(); it != internal->txQueue.end(); ++it) {
+                    if (it->iden(msg)) {
+                        *it = copy;
+                        break;
+                    }
+                }
+            } else {
+                /* The claim stays so the message is not tried again until the writer takes it */
+                QCC_DbgPrintf(("Message %s will be encrypted when it is written: %s", msg->Description().c_str(), QCC_StatusText(status)));
+                claimed->second = false;
+            }
+        }
+        if (internal->txWaitCrypto && !internal->NextMsgPending() && !internal->stopping) {
+            internal->txWaitCrypto = false;
+            internal->bus.GetInternal().GetIODispatch().EnableWriteCallbackNow(internal->stream);
+        }
+    }
+    --internal->cryptoTasks;
+    internal->lock.Unlock(MUTEX_CONTEXT);
+}
+
 void _RemoteEndpoint::IncrementRef()
 {
     int refs = IncrementAndFetch(&internal->refCount);
@@ -286,6 +286,28 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus Establish(const qcc::String& authMechanisms, qcc::String& authUsed, qcc::String& redirection, AuthListener* listener = NULL);
 
+    /**
+     * Establish an incoming connection without blocking. Runs as much of the authentication
+     * exchange as the data already received allows. If ER_WOULDBLOCK is returned, call again
+     * with the same arguments once the stream is readable, or call AbortEstablish() to give up.
+     *
+     * @param authMechanisms  The authentication mechanism(s) to use.
+     * @param authUsed        [OUT]    Returns the name of the authentication method
+     *                                 that was used to establish the connection.
+     * @param listener        Optional authentication listener
+     *
+     * @return
+     *      - ER_OK if successful.
+     *      - ER_WOULDBLOCK if the exchange is waiting for more data from the remote side.
+     *      - An error status otherwise
+     */
+    QStatus TryEstablish(const qcc::String& authMechanisms, qcc::String& authUsed, AuthListener* listener = NULL);
+
+    /**
+     * Abandon an establishment that TryEstablish() left waiting for data.
+     */
+    void AbortEstablish();
+
     /**
      * Get the GUID of the remote side of a bus-to-bus endpoint.
      *
@@ -529,6 +551,25 @@ class _RemoteEndpoint : public _BusEndpoint, public qcc::ThreadListener, public
      */
     QStatus WriteCallback(qcc::Sink& sink, bool isTimedOut);
 
+    /**
+     * Write the rest of the current message followed by as many of the next queued messages as
+     * possible with a single gathered write.
+     *
+     * @param rep            This endpoint.
+     * @param numDelivered   [OUT] Number of messages that were completely written.
+     * @return   ER_OK if successful
+     */
+    QStatus DeliverGathered(RemoteEndpoint& rep, size_t& numDelivered);
+
+    class EncryptTask;
+
+    /**
+     * Encrypt queued messages on a thread from the bus encryption pool. The encrypted copy of a
+     * message replaces the original in the tx queue so the write order is unchanged. Messages
+     * that cannot be encrypted ahead of delivery are left to be encrypted when they are written.
+     */
+    void EncryptQueued();
+
     /**
      * Internal callback used to indicate that the Stream for this endpoint has been removed
      * from the IODispatch.
@@ -229,7 +229,7 @@ size_t SignatureUtils::GetSize(const MsgArg* values, size_t numValues, size_t of
         case ALLJOYN_ARRAY:
             sz = PadUp(sz, 4) + 4;
             if (values->v_array.numElements) {
-                sz = GetSize(values->v_array.elements, values->v_array.numElements, sz);
+                sz = GetSize(values->v_array.GetElements(), values->v_array.numElements, sz);
             } else {
                 size_t alignment = AlignmentForType((AllJoynTypeId)(values->v_array.elemSig[0]));
                 sz = PadUp(sz, alignment);
@@ -1,7 +1,8 @@
 /**
  * @file
  *
- * This file tests AES-CCM against the RFC 3610 test vectors and some or our own tests
+ * This file tests AES-CCM against the RFC 3610 test vectors and some or our own tests. With -b it
+ * also measures encrypt/decrypt throughput for message bodies from 64 bytes to 1 MB.
  */
 
 /******************************************************************************
@@ -28,6 +29,7 @@
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Util.h>
+#include <qcc/time.h>
 
 #include <alljoyn/version.h>
 
@@ -322,10 +324,110 @@ static TEST_CASE testVector[] = {
 };
 
 
+/*
+ * Encrypt and then decrypt message bodies the same way message encryption does: a 5 byte nonce
+ * carrying the serial number and the header as additional authenticated data. If cached is false a
+ * new context is constructed for every message.
+ */
+static QStatus Throughput(const KeyBlob& kb, bool cached, size_t bodyLen, uint32_t iterations, uint64_t& encTime, uint64_t& decTime)
+{
+    const size_t hdrLen = 64;
+    const uint8_t authLen = 8;
+    uint8_t* msg = new uint8_t[hdrLen + bodyLen];
+    uint8_t* enc = new uint8_t[bodyLen + authLen];
+    uint8_t* dec = new uint8_t[bodyLen + authLen];
+    uint8_t nd[5] = { 0, 0, 0, 0, 0 };
+    QStatus status = ER_OK;
+    Crypto_AES aes(kb, Crypto_AES::CCM);
+    size_t len = bodyLen;
+
+    memset(msg, 0xA5, hdrLen + bodyLen);
+    uint64_t start = GetTimestamp64();
+    for (uint32_t serial = 1; (status == ER_OK) && (serial <= iterations); ++serial) {
+        nd[1] = (uint8_t)(serial >> 24);
+        nd[2] = (uint8_t)(serial >> 16);
+        nd[3] = (uint8_t)(serial >> 8);
+        nd[4] = (uint8_t)(serial);
+        KeyBlob nonce(nd, sizeof(nd), KeyBlob::GENERIC);
+        len = bodyLen;
+        if (cached) {
+            status = aes.Encrypt_CCM(msg + hdrLen, enc, len, nonce, msg, hdrLen, authLen);
+        } else {
+            Crypto_AES perMsg(kb, Crypto_AES::CCM);
+            status = perMsg.Encrypt_CCM(msg + hdrLen, enc, len, nonce, msg, hdrLen, authLen);
+        }
+    }
+    encTime = GetTimestamp64() - start;
+    /*
+     * The last message encrypted is decrypted repeatedly.
+     */
+    const size_t encLen = len;
+    start = GetTimestamp64();
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        KeyBlob nonce(nd, sizeof(nd), KeyBlob::GENERIC);
+        len = encLen;
+        if (cached) {
+            status = aes.Decrypt_CCM(enc, dec, len, nonce, msg, hdrLen, authLen);
+        } else {
+            Crypto_AES perMsg(kb, Crypto_AES::CCM);
+            status = perMsg.Decrypt_CCM(enc, dec, len, nonce, msg, hdrLen, authLen);
+        }
+    }
+    decTime = GetTimestamp64() - start;
+    if ((status == ER_OK) && ((len != bodyLen) || (memcmp(dec, msg + hdrLen, bodyLen) != 0))) {
+        status = ER_FAIL;
+    }
+    delete [] msg;
+    delete [] enc;
+    delete [] dec;
+    return status;
+}
+
+static QStatus Benchmark()
+{
+    static const uint8_t key[] = { 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF };
+    /*
+     * Move 64MB through each body size
+     */
+    const size_t total = 64 * 1024 * 1024;
+    KeyBlob kb(key, sizeof(key), KeyBlob::AES);
+
+    printf("%8s %10s %12s %12s %12s %12s\n", "body", "messages", "enc MB/s", "dec MB/s", "enc MB/s", "dec MB/s");
+    printf("%8s %10s %25s %25s\n", "", "", "(context per message)", "(cached context)");
+    for (size_t bodyLen = 64; bodyLen <= 1024 * 1024; bodyLen *= 4) {
+        uint32_t iterations = (uint32_t)(total / bodyLen);
+        double mb = (double)(bodyLen * iterations) / (1024.0 * 1024.0);
+        uint64_t enc[2];
+        uint64_t dec[2];
+        for (int cached = 0; cached < 2; ++cached) {
+            QStatus status = Throughput(kb, cached != 0, bodyLen, iterations, enc[cached], dec[cached]);
+            if (status != ER_OK) {
+                printf("Throughput test failed %s for body length %u\n", QCC_StatusText(status), static_cast<unsigned int>(bodyLen));
+                return status;
+            }
+        }
+        printf("%8u %10u %12.1f %12.1f %12.1f %12.1f\n", static_cast<unsigned int>(bodyLen), iterations,
+               mb * 1000.0 / (double)max(enc[0], (uint64_t)1), mb * 1000.0 / (double)max(dec[0], (uint64_t)1),
+               mb * 1000.0 / (double)max(enc[1], (uint64_t)1), mb * 1000.0 / (double)max(dec[1], (uint64_t)1));
+    }
+    return ER_OK;
+}
 
 int main(int argc, char** argv)
 {
     QStatus status = ER_OK;
+    bool benchmark = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-b") == 0) {
+            benchmark = true;
+        } else {
+            printf("Usage: aes_ccm [-b]\n\n");
+            printf("Options:\n");
+            printf("   -b   = Measure encrypt/decrypt throughput after the tests pass\n");
+            return 1;
+        }
+    }
 
     printf("AllJoyn Library version: %s\n", ajn::GetVersion());
     printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
@@ -387,6 +489,10 @@ int main(int argc, char** argv)
         printf("Crypto_PseudorandomFunctionCCM test PASSED\n");
     }
 
+    if (benchmark && (Benchmark() != ER_OK)) {
+        goto ErrorExit;
+    }
+
     return 0;
 
 ErrorExit:
@@ -0,0 +1,376 @@
+/**
+ * @file
+ * A test program that measures how a routing node copes with a storm of incoming TCP connections
+ */
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/time.h>
+
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+/*
+ * Each simulated client runs the first leg of the handshake a TCP client does with a routing node:
+ * the initial NUL byte and an anonymous SASL exchange up to the "OK <guid>" response.  That is
+ * the part of connection setup the routing node runs on its authentication threads, so it is what
+ * a connection storm is really pounding on.
+ */
+static const char Greeting[] = "\0AUTH ANONYMOUS\r\n";
+
+class Client {
+  public:
+    enum State {
+        CONNECTING,  /**< Non-blocking connect is in progress */
+        WAITING,     /**< Greeting has been sent, waiting for the OK */
+        DONE,        /**< Got the OK */
+        FAILED       /**< Connection was refused, reset or timed out */
+    };
+
+    Client() : fd(-1), state(FAILED), start(0), latency(0) { }
+
+    int fd;
+    State state;
+    uint64_t start;
+    uint64_t latency;
+    qcc::String response;
+};
+
+static volatile sig_atomic_t g_interrupt = false;
+
+static void SigIntHandler(int sig)
+{
+    g_interrupt = true;
+}
+
+static int OpenSocket(const sockaddr_in& addr)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if ((connect(fd, (const sockaddr*)&addr, sizeof(addr)) < 0) && (errno != EINPROGRESS)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static uint32_t DaemonThreads(pid_t pid)
+{
+    if (pid <= 0) {
+        return 0;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    char line[128];
+    uint32_t threads = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "Threads:", 8) == 0) {
+            threads = strtoul(line + 8, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return threads;
+}
+
+static void Fail(Client& c)
+{
+    if (c.fd >= 0) {
+        close(c.fd);
+        c.fd = -1;
+    }
+    c.state = Client::FAILED;
+}
+
+/* Advance one client given the events poll() reported on its socket */
+static void Service(Client& c, short revents)
+{
+    if (c.state == Client::CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if ((revents & (POLLERR | POLLHUP)) || getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+            Fail(c);
+            return;
+        }
+        if (send(c.fd, Greeting, sizeof(Greeting) - 1, MSG_NOSIGNAL) != (ssize_t)(sizeof(Greeting) - 1)) {
+            Fail(c);
+            return;
+        }
+        c.state = Client::WAITING;
+        return;
+    }
+
+    char buf[256];
+    ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+        if ((n < 0) && (errno == EAGAIN)) {
+            return;
+        }
+        Fail(c);
+        return;
+    }
+    c.response.append(buf, n);
+    size_t eol = c.response.find("\r\n");
+    if (eol != qcc::String::npos) {
+        if (c.response.compare(0, 3, "OK ") == 0) {
+            c.latency = GetTimestamp64() - c.start;
+            c.state = Client::DONE;
+            close(c.fd);
+            c.fd = -1;
+        } else {
+            Fail(c);
+        }
+    }
+}
+
+static void usage(void)
+{
+    std::cout << "Usage: connstorm\n"
+              << "\t-a <addr> address of the routing node (default 127.0.0.1)\n"
+              << "\t-p <port> TCP port of the routing node (default 9955)\n"
+              << "\t-n <clients> number of clients in the storm (default 1000)\n"
+              << "\t-b <burst> maximum number of clients handshaking at once (default all of them)\n"
+              << "\t-s <stalled> number of connections opened first that send one byte and stall (default 0)\n"
+              << "\t-t <ms> give up on a client after this long (default 10000)\n"
+              << "\t-d <pid> process id of the routing node, to report its thread count\n"
+              << "\t-h/-? display usage \n"
+              << "\n"
+              << "The routing node must listen on TCP and raise max_incomplete_connections and\n"
+              << "max_completed_connections to at least <burst> + <stalled>.\n";
+}
+
+int main(int argc, char** argv)
+{
+    const char* addrStr = "127.0.0.1";
+    uint16_t port = 9955;
+    uint32_t numClients = 1000;
+    uint32_t burst = 0;
+    uint32_t numStalled = 0;
+    uint32_t timeout = 10000;
+    pid_t daemonPid = 0;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+    fflush(stdout);
+
+    /* Install SIGINT handler */
+    signal(SIGINT, SigIntHandler);
+    signal(SIGTERM, SigIntHandler);
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i]) || 0 == strcmp("-?", argv[i])) {
+            usage();
+            exit(0);
+        } else if (argv[i][0] == '-' && strchr("apnbstd", argv[i][1]) && argv[i][1] && !argv[i][2]) {
+            ++i;
+            if (i == argc) {
+                std::cout << "option " << argv[i - 1] << " requires a parameter" << std::endl;
+                usage();
+                exit(1);
+            }
+            switch (argv[i - 1][1]) {
+            case 'a': addrStr = argv[i]; break;
+            case 'p': port = (uint16_t)strtoul(argv[i], NULL, 10); break;
+            case 'n': numClients = strtoul(argv[i], NULL, 10); break;
+            case 'b': burst = strtoul(argv[i], NULL, 10); break;
+            case 's': numStalled = strtoul(argv[i], NULL, 10); break;
+            case 't': timeout = strtoul(argv[i], NULL, 10); break;
+            default: daemonPid = (pid_t)strtoul(argv[i], NULL, 10); break;
+            }
+        } else {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            usage();
+            exit(1);
+        }
+    }
+    if ((burst == 0) || (burst > numClients)) {
+        burst = numClients;
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, addrStr, &addr.sin_addr) != 1) {
+        std::cout << "Bad address: " << addrStr << std::endl;
+        exit(1);
+    }
+
+    /* A storm needs lots of file descriptors */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        if (rl.rlim_cur < (rlim_t)(burst + numStalled + 16)) {
+            std::cout << "Not enough file descriptors for " << burst + numStalled << " connections" << std::endl;
+            exit(1);
+        }
+    }
+
+    uint32_t threadsBefore = DaemonThreads(daemonPid);
+    uint32_t threadsPeak = threadsBefore;
+
+    /*
+     * Stalled connections connect, send the leading NUL byte and then sit there, which is what a
+     * slow or hostile client looks like to the routing node.  They tie up authentication slots until
+     * the routing node times them out, but they must not tie up the threads that authenticate
+     * everybody else.
+     */
+    vector<int> stalled;
+    for (uint32_t i = 0; i < numStalled; ++i) {
+        int fd = OpenSocket(addr);
+        if (fd >= 0) {
+            pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if ((poll(&pfd, 1, 1000) > 0) && (pfd.revents & POLLOUT)) {
+                send(fd, Greeting, 1, MSG_NOSIGNAL);
+            }
+            stalled.push_back(fd);
+        }
+    }
+
+    vector<Client> clients(numClients);
+    vector<pollfd> fds;
+    vector<uint32_t> index;
+    uint32_t next = 0;
+    uint32_t active = 0;
+    uint32_t finished = 0;
+
+    uint64_t start = GetTimestamp64();
+    while (!g_interrupt && (finished < numClients)) {
+        /* Top up the burst */
+        while ((active < burst) && (next < numClients)) {
+            Client& c = clients[next++];
+            c.start = GetTimestamp64();
+            c.fd = OpenSocket(addr);
+            if (c.fd < 0) {
+                c.state = Client::FAILED;
+                ++finished;
+            } else {
+                c.state = Client::CONNECTING;
+                ++active;
+            }
+        }
+
+        fds.clear();
+        index.clear();
+        uint64_t now = GetTimestamp64();
+        for (uint32_t i = 0; i < next; ++i) {
+            Client& c = clients[i];
+            if ((c.state != Client::CONNECTING) && (c.state != Client::WAITING)) {
+                continue;
+            }
+            if ((now - c.start) > timeout) {
+                Fail(c);
+                --active;
+                ++finished;
+                continue;
+            }
+            pollfd pfd;
+            pfd.fd = c.fd;
+            pfd.events = (c.state == Client::CONNECTING) ? POLLOUT : POLLIN;
+            pfd.revents = 0;
+            fds.push_back(pfd);
+            index.push_back(i);
+        }
+
+        if (!fds.empty() && (poll(&fds[0], fds.size(), 10) > 0)) {
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents) {
+                    Client& c = clients[index[i]];
+                    Service(c, fds[i].revents);
+                    if ((c.state == Client::DONE) || (c.state == Client::FAILED)) {
+                        --active;
+                        ++finished;
+                    }
+                }
+            }
+        }
+        threadsPeak = (std::max)(threadsPeak, DaemonThreads(daemonPid));
+    }
+    uint64_t elapsed = GetTimestamp64() - start;
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].fd >= 0) {
+            close(clients[i].fd);
+        }
+    }
+    for (size_t i = 0; i < stalled.size(); ++i) {
+        close(stalled[i]);
+    }
+
+    vector<uint64_t> latencies;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].state == Client::DONE) {
+            latencies.push_back(clients[i].latency);
+        }
+    }
+    sort(latencies.begin(), latencies.end());
+    uint32_t done = latencies.size();
+
+    printf("%8s %8s %8s %8s %10s %12s %8s %8s %8s\n", "clients", "burst", "stalled", "failed", "time(ms)", "handshakes/s", "p50(ms)", "p99(ms)", "max(ms)");
+    printf("%8u %8u %8u %8u %10u %12.0f %8u %8u %8u\n", numClients, burst, (unsigned int)stalled.size(), numClients - done,
+           (unsigned int)elapsed, done * 1000.0 / (elapsed ? elapsed : 1),
+           done ? (unsigned int)latencies[done / 2] : 0,
+           done ? (unsigned int)latencies[(done * 99) / 100] : 0,
+           done ? (unsigned int)latencies[done - 1] : 0);
+    if (daemonPid) {
+        printf("routing node threads: %u before, %u peak\n", threadsBefore, threadsPeak);
+    }
+
+    QStatus status = (done == numClients) ? ER_OK : ER_FAIL;
+    std::cout << argv[0] << " exiting with status " << QCC_StatusText(status) << std::endl;
+
+    return (int) status;
+}
@@ -0,0 +1,326 @@
+/**
+ * @file
+ * A test program that measures the throughput of signals broadcast to many endpoints
+ */
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Environ.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+#include <qcc/atomic.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static const char* ObjectPath = "/org/alljoyn/Fanout";
+static const char* InterfaceName = "org.alljoyn.Fanout";
+
+/* Payload sizes, from 1KB up to the largest array a message can carry */
+static const size_t PayloadSizes[] = { 1024, 4096, 16384, 65536, ALLJOYN_MAX_ARRAY_LEN };
+
+/*
+ * Every bus attachment uses a few dozen file descriptors so the receivers are spread over several
+ * processes to keep each process well below FD_SETSIZE.
+ */
+static const uint32_t ReceiversPerProcess = 16;
+
+/** Counters shared between the sender and the receiver processes */
+struct FanoutCounters {
+    volatile int32_t ready;     /**< Number of receivers that are connected and have added their match rule */
+    volatile int32_t failed;    /**< Number of receivers that could not be set up */
+    volatile int32_t received;  /**< Number of signals received by all receivers */
+};
+
+static FanoutCounters* g_counters = NULL;
+
+static volatile sig_atomic_t g_interrupt = false;
+
+static void SigIntHandler(int sig)
+{
+    g_interrupt = true;
+}
+
+static QStatus CreateFanoutInterface(BusAttachment& bus)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(InterfaceName, intf);
+    if (status == ER_OK) {
+        intf->AddSignal("blob", "ay", NULL, 0);
+        intf->Activate();
+    } else {
+        QCC_LogError(status, ("Failed to create interface %s", InterfaceName));
+    }
+    return status;
+}
+
+static QStatus StartAndConnect(BusAttachment& bus, const qcc::String& connectArgs)
+{
+    QStatus status = bus.Start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to start bus attachment"));
+        return status;
+    }
+    status = connectArgs.empty() ? bus.Connect() : bus.Connect(connectArgs.c_str());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to connect to \"%s\"", connectArgs.c_str()));
+    }
+    return status;
+}
+
+class Receiver : public MessageReceiver {
+  public:
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg)
+    {
+        IncrementAndFetch(&g_counters->received);
+    }
+};
+
+class Sender : public BusObject {
+  public:
+
+    Sender(BusAttachment& bus) : BusObject(ObjectPath), blobMember(NULL)
+    {
+        const InterfaceDescription* intf = bus.GetInterface(InterfaceName);
+        assert(intf);
+        AddInterface(*intf);
+        blobMember = intf->GetMember("blob");
+        assert(blobMember);
+    }
+
+    QStatus SendBlob(const uint8_t* data, size_t len)
+    {
+        MsgArg arg("ay", len, data);
+        return Signal(NULL, 0, *blobMember, &arg, 1);
+    }
+
+  private:
+    const InterfaceDescription::Member* blobMember;
+};
+
+/*
+ * Body of a receiver process. Each receiver has its own connection, and therefore its own
+ * endpoint, in the routing node.
+ */
+static void RunReceivers(uint32_t numReceivers, const qcc::String& connectArgs)
+{
+    Receiver receiver;
+    vector<BusAttachment*> receivers;
+    for (uint32_t i = 0; i < numReceivers; ++i) {
+        BusAttachment* bus = new BusAttachment("fanout-rx", true);
+        receivers.push_back(bus);
+        QStatus status = CreateFanoutInterface(*bus);
+        if (status == ER_OK) {
+            status = StartAndConnect(*bus, connectArgs);
+        }
+        if (status == ER_OK) {
+            status = bus->RegisterSignalHandler(&receiver,
+                                                static_cast<MessageReceiver::SignalHandler>(&Receiver::SignalHandler),
+                                                bus->GetInterface(InterfaceName)->GetMember("blob"),
+                                                NULL);
+        }
+        if (status == ER_OK) {
+            status = bus->AddMatch("type='signal',interface='org.alljoyn.Fanout'");
+        }
+        IncrementAndFetch((status == ER_OK) ? &g_counters->ready : &g_counters->failed);
+    }
+    while (!g_interrupt) {
+        qcc::Sleep(100);
+    }
+    for (size_t i = 0; i < receivers.size(); ++i) {
+        delete receivers[i];
+    }
+}
+
+static QStatus RunSender(uint32_t numReceivers, uint32_t numSignals, size_t payloadSize, const qcc::String& connectArgs)
+{
+    BusAttachment bus("fanout-tx", true);
+    QStatus status = CreateFanoutInterface(bus);
+    if (status == ER_OK) {
+        status = StartAndConnect(bus, connectArgs);
+    }
+    Sender sender(bus);
+    if (status == ER_OK) {
+        status = bus.RegisterBusObject(sender);
+    }
+    if (status != ER_OK) {
+        return status;
+    }
+
+    printf("%8s %10s %10s %12s %12s\n", "size", "signals", "time(ms)", "rx MB/s", "rx msgs/s");
+    size_t numSizes = payloadSize ? 1 : ArraySize(PayloadSizes);
+    for (size_t s = 0; (status == ER_OK) && !g_interrupt && (s < numSizes); ++s) {
+        size_t len = payloadSize ? payloadSize : PayloadSizes[s];
+        uint8_t* data = new uint8_t[len];
+        memset(data, 0xA5, len);
+
+        int32_t total = (int32_t)(numSignals * numReceivers);
+        int32_t expected = g_counters->received + total;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; (status == ER_OK) && (i < numSignals); ++i) {
+            status = sender.SendBlob(data, len);
+            if (status != ER_OK) {
+                QCC_LogError(status, ("Failed to send signal (# %u of %u)", i, numSignals));
+            }
+        }
+        /* Give up if delivery stalls for 10 seconds */
+        int32_t last = g_counters->received;
+        uint64_t lastProgress = GetTimestamp64();
+        while ((status == ER_OK) && !g_interrupt && (g_counters->received < expected)) {
+            qcc::Sleep(5);
+            if (g_counters->received != last) {
+                last = g_counters->received;
+                lastProgress = GetTimestamp64();
+            } else if ((GetTimestamp64() - lastProgress) > 10000) {
+                status = ER_TIMEOUT;
+                QCC_LogError(status, ("Only %d of %d signals were received", total - (expected - last), total));
+            }
+        }
+        uint64_t elapsed = GetTimestamp64() - start;
+        delete [] data;
+
+        if (status == ER_OK) {
+            uint64_t rxBytes = (uint64_t)len * total;
+            double secs = (elapsed ? elapsed : 1) / 1000.0;
+            printf("%8u %10u %10u %12.1f %12.0f\n", (unsigned int)len, (unsigned int)total, (unsigned int)elapsed,
+                   (double)rxBytes / (1024.0 * 1024.0) / secs, total / secs);
+        }
+    }
+    return status;
+}
+
+static void usage(void)
+{
+    std::cout << "Usage: fanout\n"
+              << "\t-r <receivers> number of receiving bus attachments (default 64)\n"
+              << "\t-n <signals> number of signals to send for each payload size (default 100)\n"
+              << "\t-s <size> only send signals with this payload size\n"
+              << "\t-h/-? display usage \n";
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    uint32_t numReceivers = 64;
+    uint32_t numSignals = 100;
+    size_t payloadSize = 0;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+    fflush(stdout);
+
+    /* Install SIGINT handler */
+    signal(SIGINT, SigIntHandler);
+    signal(SIGTERM, SigIntHandler);
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i]) || 0 == strcmp("-?", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-r", argv[i]) || 0 == strcmp("-n", argv[i]) || 0 == strcmp("-s", argv[i])) {
+            ++i;
+            if (i == argc) {
+                std::cout << "option " << argv[i - 1] << " requires a parameter" << std::endl;
+                usage();
+                exit(1);
+            } else if (argv[i - 1][1] == 'r') {
+                numReceivers = strtoul(argv[i], NULL, 10);
+            } else if (argv[i - 1][1] == 's') {
+                payloadSize = (std::min)((size_t)strtoul(argv[i], NULL, 10), ALLJOYN_MAX_ARRAY_LEN);
+            } else {
+                numSignals = strtoul(argv[i], NULL, 10);
+            }
+        } else {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            usage();
+            exit(1);
+        }
+    }
+
+    Environ* env = Environ::GetAppEnviron();
+    qcc::String connectArgs = env->Find("BUS_ADDRESS");
+
+    g_counters = (FanoutCounters*)mmap(NULL, sizeof(FanoutCounters), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_counters == MAP_FAILED) {
+        std::cout << "Failed to map shared counters" << std::endl;
+        exit(1);
+    }
+    memset(g_counters, 0, sizeof(FanoutCounters));
+
+    /* Fork the receiver processes before this process creates any bus attachments */
+    vector<pid_t> children;
+    for (uint32_t r = 0; r < numReceivers; r += ReceiversPerProcess) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            RunReceivers((std::min)(ReceiversPerProcess, numReceivers - r), connectArgs);
+            _exit(0);
+        } else if (pid > 0) {
+            children.push_back(pid);
+        } else {
+            std::cout << "Failed to fork receiver process" << std::endl;
+            g_interrupt = true;
+            break;
+        }
+    }
+
+    while (!g_interrupt && ((uint32_t)(g_counters->ready + g_counters->failed) < numReceivers)) {
+        qcc::Sleep(10);
+    }
+    if (g_counters->failed || g_interrupt) {
+        status = ER_FAIL;
+        QCC_LogError(status, ("Failed to set up %d of %u receivers", g_counters->failed, numReceivers));
+    } else {
+        status = RunSender(numReceivers, numSignals, payloadSize, connectArgs);
+    }
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        kill(children[i], SIGTERM);
+        waitpid(children[i], NULL, 0);
+    }
+    munmap(g_counters, sizeof(FanoutCounters));
+
+    std::cout << argv[0] << " exiting with status " << QCC_StatusText(status) << std::endl;
+
+    return (int) status;
+}
@@ -46,8 +46,117 @@ using namespace ajn;
 
 static const char testData[] = "This is the message that we are going to encrypt and then decrypt and verify";
 
+static void usage(void)
+{
+    printf("Usage: keystore [-h] [-n #]\n\n");
+    printf("Options:\n");
+    printf("   -h                          = Print this help message\n");
+    printf("   -n #                        = Number of keys for the key store benchmark (default = 500)\n");
+}
+
+/*
+ * Measures the cost of storing keys one at a time as happens when pairing with many peers, and of
+ * loading the key store and looking up keys afterwards.
+ */
+static QStatus Benchmark(size_t numKeys)
+{
+    QStatus status = ER_OK;
+    qcc::GUID128* guids = new qcc::GUID128[numKeys];
+    KeyBlob key;
+    uint64_t start;
+    uint64_t elapsed;
+    const size_t numExtra = 100;
+
+    printf("Benchmarking key store with %u keys\n", (unsigned int)numKeys);
+    {
+        KeyStore keyStore("keystore_bench");
+        keyStore.Init(NULL, false);
+        keyStore.Clear();
+
+        start = GetTimestamp64();
+        for (size_t i = 0; (status == ER_OK) && (i < numKeys); ++i) {
+            key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+            keyStore.AddKey(guids[i], key);
+            status = keyStore.Store();
+        }
+        elapsed = GetTimestamp64() - start;
+        if (status != ER_OK) {
+            printf("Failed to store keystore\n");
+            goto ExitBenchmark;
+        }
+        printf("  Add and store %u keys:      %8u ms\n", (unsigned int)numKeys, (unsigned int)elapsed);
+
+        /*
+         * Cost of one more pairing once the key store is populated
+         */
+        start = GetTimestamp64();
+        for (size_t i = 0; (status == ER_OK) && (i < numExtra); ++i) {
+            qcc::GUID128 guid;
+            key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+            keyStore.AddKey(guid, key);
+            status = keyStore.Store();
+        }
+        elapsed = GetTimestamp64() - start;
+        if (status != ER_OK) {
+            printf("Failed to store keystore\n");
+            goto ExitBenchmark;
+        }
+        printf("  Store one more key:         %8.3f ms\n", (double)elapsed / numExtra);
+    }
+    {
+        start = GetTimestamp64();
+        KeyStore keyStore("keystore_bench");
+        status = keyStore.Init(NULL, false);
+        elapsed = GetTimestamp64() - start;
+        if (status != ER_OK) {
+            printf("Failed to load keystore\n");
+            goto ExitBenchmark;
+        }
+        printf("  Load key store:             %8u ms\n", (unsigned int)elapsed);
+
+        start = GetTimestamp64();
+        for (size_t i = 0; (status == ER_OK) && (i < numKeys); ++i) {
+            status = keyStore.GetKey(guids[i], key);
+        }
+        elapsed = GetTimestamp64() - start;
+        if (status != ER_OK) {
+            printf("Failed to get key\n");
+            goto ExitBenchmark;
+        }
+        printf("  Get all keys:               %8u ms\n", (unsigned int)elapsed);
+    }
+
+ExitBenchmark:
+
+    DeleteFile(GetHomeDir() + "/.alljoyn_keystore/keystore_bench");
+    delete [] guids;
+    return status;
+}
+
 int main(int argc, char** argv)
 {
+    size_t numKeys = 500;
+
+    for (int i = 1; i < argc; ++i) {
+        if ((0 == strcmp("-h", argv[i])) || (0 == strcmp("-?", argv[i]))) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-n", argv[i])) {
+            ++i;
+            if (i == argc) {
+                printf("option %s requires a parameter\n", argv[i - 1]);
+                usage();
+                exit(1);
+            } else {
+                numKeys = strtoul(argv[i], NULL, 10);
+            }
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
     qcc::GUID128 guid1;
     qcc::GUID128 guid2;
     qcc::GUID128 guid3;
@@ -269,6 +378,11 @@ int main(int argc, char** argv)
 
     }
 
+    status = Benchmark(numKeys);
+    if (status != ER_OK) {
+        goto ErrorExit;
+    }
+
     printf("keystore unit test PASSED\n");
     return 0;
 
@@ -31,9 +31,11 @@
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/ManagedObj.h>
+#include <qcc/time.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
+#include <alljoyn/MsgArgCodec.h>
 #include <alljoyn/version.h>
 
 #include <alljoyn/Status.h>
@@ -147,6 +149,16 @@ class _MyMessage : public _Message {
         return SignalMsg(sig, destination, 0, objPath, interface, signalName, argList, numArgs, 0, 0);
     }
 
+    QStatus Signal(const qcc::String& sig, const MsgArg* argList, size_t numArgs)
+    {
+        return SignalMsg(sig, NULL, 0, "/org/alljoyn/Marshal", "org.alljoyn.Marshal", "Sig", argList, numArgs, 0, 0);
+    }
+
+    QStatus Signal(const qcc::String& sig, const MsgBodyEncoder& body)
+    {
+        return SignalMsg(sig, NULL, 0, "/org/alljoyn/Marshal", "org.alljoyn.Marshal", "Sig", NULL, 0, 0, 0, &body);
+    }
+
     QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
 
     QStatus Read(RemoteEndpoint& ep, const qcc::String& endpointName, bool pedantic = true)
@@ -1057,6 +1069,73 @@ QStatus TestMsgUnpack()
 }
 
 
+typedef MsgArgStruct<int32_t, uint32_t, qcc::String> BenchEntry;
+typedef MsgArgCodec<uint32_t, std::vector<BenchEntry> > BenchCodec;
+
+/*
+ * Marshal a "ua(ius)" signal from MsgArgs built with MsgArg::Set().
+ */
+static QStatus MarshalDynamic(uint32_t count, const std::vector<BenchEntry>& entries)
+{
+    MyMessage msg;
+    MsgArg* structs = new MsgArg[entries.size()];
+    for (size_t i = 0; i < entries.size(); ++i) {
+        structs[i].Set("(ius)", entries[i].m1, entries[i].m2, entries[i].m3.c_str());
+    }
+    MsgArg args[2];
+    args[0].Set("u", count);
+    args[1].Set("a(ius)", entries.size(), structs);
+    QStatus status = msg->Signal("ua(ius)", args, ArraySize(args));
+    delete [] structs;
+    return status;
+}
+
+/*
+ * Marshal the same signal with a MsgArgCodec.
+ */
+static QStatus MarshalCodec(uint32_t count, const std::vector<BenchEntry>& entries)
+{
+    MyMessage msg;
+    return msg->Signal("ua(ius)", BenchCodec(count, entries));
+}
+
+/*
+ * Compare the time taken to marshal a signal using the dynamic MsgArg path and using MsgArgCodec.
+ */
+static QStatus Benchmark(uint32_t iterations)
+{
+    QStatus status = ER_OK;
+    static const size_t sizes[] = { 1, 8, 64, 512 };
+
+    printf("%-10s %10s %12s %12s %8s\n", "entries", "ops", "MsgArg ns", "codec ns", "speedup");
+    for (size_t s = 0; (status == ER_OK) && (s < ArraySize(sizes)); ++s) {
+        std::vector<BenchEntry> entries(sizes[s]);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            entries[i].m1 = -(int32_t)i;
+            entries[i].m2 = (uint32_t)i;
+            entries[i].m3 = "entry " + U32ToString((uint32_t)i);
+        }
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+            status = MarshalDynamic(i, entries);
+        }
+        uint64_t dynamicTime = GetTimestamp64() - start;
+        start = GetTimestamp64();
+        for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+            status = MarshalCodec(i, entries);
+        }
+        uint64_t codecTime = GetTimestamp64() - start;
+        if (status == ER_OK) {
+            printf("%-10u %10u %12.0f %12.0f %8.2f\n", (unsigned int)sizes[s], (unsigned int)iterations,
+                   (dynamicTime * 1000000.0) / iterations, (codecTime * 1000000.0) / iterations,
+                   (double)dynamicTime / (codecTime ? codecTime : 1));
+        } else {
+            QCC_LogError(status, ("Failed to marshal signal with %u entries", (unsigned int)sizes[s]));
+        }
+    }
+    return status;
+}
+
 static void usage(void)
 {
     printf("Usage: marshal [-f] [-q]\n");
@@ -1064,11 +1143,13 @@ static void usage(void)
     printf("   -f         = fuzzing\n");
     printf("   -q         = Quiet\n");
     printf("   -b         = Suppress big array test (which takes a long time)\n");
+    printf("   -p <n>     = Benchmark marshaling with MsgArgs against MsgArgCodec for n iterations\n");
 }
 
 int main(int argc, char** argv)
 {
     bool fuzz = false;
+    uint32_t benchmark = 0;
     QStatus status = ER_OK;
 
     printf("AllJoyn Library version: %s\n", ajn::GetVersion());
@@ -1082,6 +1163,13 @@ int main(int argc, char** argv)
             nobig = true;
         } else if (0 == strcmp("-q", argv[i])) {
             quiet = true;
+        } else if (0 == strcmp("-p", argv[i])) {
+            ++i;
+            if (i == argc) {
+                usage();
+                exit(1);
+            }
+            benchmark = strtoul(argv[i], NULL, 10);
         } else {
             usage();
             exit(1);
@@ -1091,6 +1179,12 @@ int main(int argc, char** argv)
     gBus = new BusAttachment("marshal");
     gBus->Start();
 
+    if (benchmark) {
+        status = Benchmark(benchmark);
+        delete gBus;
+        return (int) status;
+    }
+
     /*
      * Test complex signature parsing
      */
@@ -0,0 +1,244 @@
+/**
+ * @file
+ * A test program that measures the cost of marshaling, delivering and parsing typical signals
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+
+#include <qcc/Debug.h>
+#include <qcc/Pipe.h>
+#include <qcc/String.h>
+#include <qcc/Util.h>
+#include <qcc/atomic.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusInternal.h>
+#include <MsgBufPool.h>
+#include <RemoteEndpoint.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/*
+ * Count every heap allocation made by the process
+ */
+static volatile int32_t g_heapAllocs = 0;
+
+void* operator new(size_t size)
+{
+    IncrementAndFetch(&g_heapAllocs);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size)
+{
+    IncrementAndFetch(&g_heapAllocs);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p)
+{
+    free(p);
+}
+
+void operator delete[](void* p)
+{
+    free(p);
+}
+
+static BusAttachment* gBus;
+
+class _BenchMessage : public _Message {
+  public:
+
+    _BenchMessage() : _Message(*gBus) { }
+
+    QStatus Signal(const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return SignalMsg(sig, NULL, 0, "/org/alljoyn/MsgBuf", "org.alljoyn.MsgBuf", "Sig", argList, numArgs, 0, 0);
+    }
+
+    QStatus Deliver(RemoteEndpoint& ep) { return _Message::Deliver(ep); }
+
+    QStatus Read(RemoteEndpoint& ep) { return _Message::Read(ep, true); }
+
+    QStatus Unmarshal(RemoteEndpoint& ep) { return _Message::Unmarshal(ep, true); }
+
+    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+};
+
+typedef ManagedObj<_BenchMessage> BenchMessage;
+
+/*
+ * Marshal a signal, deliver it to the endpoint and parse it back out.
+ */
+static QStatus RoundTrip(RemoteEndpoint& ep, const MsgArg* args, size_t numArgs)
+{
+    BenchMessage tx;
+    QStatus status = tx->Signal(args, numArgs);
+    if (status == ER_OK) {
+        status = tx->Deliver(ep);
+    }
+    BenchMessage rx;
+    if (status == ER_OK) {
+        status = rx->Read(ep);
+    }
+    if (status == ER_OK) {
+        status = rx->Unmarshal(ep);
+    }
+    if (status == ER_OK) {
+        status = rx->UnmarshalBody();
+    }
+    return status;
+}
+
+static QStatus Measure(const char* name, const MsgArg* args, size_t numArgs, uint32_t iterations)
+{
+    Pipe stream;
+    Pipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*gBus, falsiness, String::Empty, pStream);
+    MsgBufPool& pool = gBus->GetInternal().GetMsgBufPool();
+
+    /* Warm up the pool and the pipe */
+    QStatus status = ER_OK;
+    for (uint32_t i = 0; (status == ER_OK) && (i < 100); ++i) {
+        status = RoundTrip(ep, args, numArgs);
+    }
+
+    MsgBufPool::Stats before;
+    pool.GetStats(before);
+    int32_t heapBefore = g_heapAllocs;
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; (status == ER_OK) && (i < iterations); ++i) {
+        status = RoundTrip(ep, args, numArgs);
+    }
+    uint64_t elapsed = GetTimestamp64() - start;
+    int32_t heapAllocs = g_heapAllocs - heapBefore;
+    MsgBufPool::Stats after;
+    pool.GetStats(after);
+
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Round trip of %s signal failed", name));
+        return status;
+    }
+    printf("%-12s %10u %10.0f %12.2f %12.2f\n", name, (unsigned int)iterations,
+           (elapsed * 1000000.0) / iterations,
+           (double)heapAllocs / iterations,
+           (double)(after.heapAllocs - before.heapAllocs) / iterations);
+    return status;
+}
+
+static void usage(void)
+{
+    std::cout << "Usage: msgbuf\n"
+              << "\t-n <iterations> number of signals to marshal, deliver and parse for each signal type (default 100000)\n"
+              << "\t-h/-? display usage \n";
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    uint32_t iterations = 100000;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i]) || 0 == strcmp("-?", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-n", argv[i])) {
+            ++i;
+            if (i == argc) {
+                std::cout << "option " << argv[i - 1] << " requires a parameter" << std::endl;
+                usage();
+                exit(1);
+            }
+            iterations = strtoul(argv[i], NULL, 10);
+        } else {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            usage();
+            exit(1);
+        }
+    }
+
+    gBus = new BusAttachment("msgbuf");
+    gBus->Start();
+
+    /* A small notification */
+    MsgArg small[2];
+    small[0].Set("s", "org.alljoyn.MsgBuf.Changed");
+    small[1].Set("u", 42);
+
+    /* A property change style dictionary */
+    MsgArg entries[8];
+    MsgArg values[ArraySize(entries)];
+    const char* keys[ArraySize(entries)] = { "Name", "Id", "Level", "Enabled", "Mode", "Count", "Label", "Flags" };
+    for (size_t i = 0; i < ArraySize(entries); ++i) {
+        values[i].Set("u", (uint32_t)i);
+        entries[i].Set("{sv}", keys[i], &values[i]);
+    }
+    MsgArg dict;
+    dict.Set("a{sv}", ArraySize(entries), entries);
+
+    /* A block of sensor data */
+    static uint8_t data[4096];
+    MsgArg blob;
+    blob.Set("ay", sizeof(data), data);
+
+    printf("%-12s %10s %10s %12s %12s\n", "signal", "ops", "ns/op", "allocs/op", "buf allocs/op");
+    if (status == ER_OK) {
+        status = Measure("s,u", small, ArraySize(small), iterations);
+    }
+    if (status == ER_OK) {
+        status = Measure("a{sv}", &dict, 1, iterations);
+    }
+    if (status == ER_OK) {
+        status = Measure("ay[4096]", &blob, 1, iterations);
+    }
+
+    MsgBufPool::Stats stats;
+    gBus->GetInternal().GetMsgBufPool().GetStats(stats);
+    printf("pool: %llu allocs, %llu cache hits, %llu global hits, %llu heap allocs, %llu bytes cached\n",
+           (unsigned long long)stats.allocs, (unsigned long long)stats.cacheHits, (unsigned long long)stats.globalHits,
+           (unsigned long long)stats.heapAllocs, (unsigned long long)stats.cachedBytes);
+
+    delete gBus;
+
+    std::cout << argv[0] << " exiting with status " << QCC_StatusText(status) << std::endl;
+
+    return (int) status;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file
+ * A test program that measures the throughput of encrypted signals with and without encryption
+ * ahead of delivery
+ */
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include <qcc/Debug.h>
+#include <qcc/Environ.h>
+#include <qcc/String.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+#include <qcc/atomic.h>
+
+#include <alljoyn/AuthListener.h>
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/ProxyBusObject.h>
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static const char* ObjectPath = "/org/alljoyn/SecureXfer";
+static const char* InterfaceName = "org.alljoyn.SecureXfer";
+static const char* Password = "123456";
+
+/* Payload sizes, from 4KB up to the largest array a message can carry */
+static const size_t PayloadSizes[] = { 4096, 16384, 65536, ALLJOYN_MAX_ARRAY_LEN };
+
+/** State shared between the sender and the receiver processes */
+struct XferShared {
+    volatile int32_t ready;     /**< 1 when the receiver is connected, -1 if it failed */
+    volatile int32_t received;  /**< Number of signals received */
+    volatile int32_t plaintext; /**< Number of signals that were received without encryption */
+    char uniqueName[64];        /**< Unique name of the receiver */
+};
+
+static XferShared* g_shared = NULL;
+
+static volatile sig_atomic_t g_interrupt = false;
+
+static void SigIntHandler(int sig)
+{
+    g_interrupt = true;
+}
+
+class XferAuthListener : public AuthListener {
+
+    bool RequestCredentials(const char* authMechanism, const char* authPeer, uint16_t authCount, const char* userId, uint16_t credMask, Credentials& creds)
+    {
+        if (credMask & AuthListener::CRED_PASSWORD) {
+            creds.SetPassword(Password);
+        }
+        return true;
+    }
+
+    void AuthenticationComplete(const char* authMechanism, const char* authPeer, bool success)
+    {
+        if (!success) {
+            QCC_LogError(ER_AUTH_FAIL, ("Authentication with %s failed", authPeer));
+        }
+    }
+};
+
+static QStatus SetUpBus(BusAttachment& bus, AuthListener& listener, const qcc::String& connectArgs)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(InterfaceName, intf, AJ_IFC_SECURITY_REQUIRED);
+    if (status == ER_OK) {
+        intf->AddSignal("chunk", "ay", NULL, 0);
+        intf->Activate();
+        status = bus.Start();
+    } else {
+        QCC_LogError(status, ("Failed to create interface %s", InterfaceName));
+    }
+    if (status == ER_OK) {
+        status = connectArgs.empty() ? bus.Connect() : bus.Connect(connectArgs.c_str());
+    }
+    if (status == ER_OK) {
+        status = bus.EnablePeerSecurity("ALLJOYN_SRP_KEYX", &listener, NULL, false);
+    }
+    if (status == ER_OK) {
+        bus.ClearKeyStore();
+    } else {
+        QCC_LogError(status, ("Failed to set up bus attachment"));
+    }
+    return status;
+}
+
+class Receiver : public MessageReceiver {
+  public:
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg)
+    {
+        if (!msg->IsEncrypted()) {
+            IncrementAndFetch(&g_shared->plaintext);
+        }
+        IncrementAndFetch(&g_shared->received);
+    }
+};
+
+class Sender : public BusObject {
+  public:
+
+    Sender(BusAttachment& bus) : BusObject(ObjectPath, true), chunkMember(NULL)
+    {
+        const InterfaceDescription* intf = bus.GetInterface(InterfaceName);
+        assert(intf);
+        AddInterface(*intf);
+        chunkMember = intf->GetMember("chunk");
+        assert(chunkMember);
+    }
+
+    QStatus SendChunk(const char* dest, const uint8_t* data, size_t len)
+    {
+        MsgArg arg("ay", len, data);
+        return Signal(dest, 0, *chunkMember, &arg, 1);
+    }
+
+  private:
+    const InterfaceDescription::Member* chunkMember;
+};
+
+static void RunReceiver(const qcc::String& connectArgs)
+{
+    XferAuthListener listener;
+    Receiver receiver;
+    BusAttachment bus("securexfer-rx", true);
+    QStatus status = SetUpBus(bus, listener, connectArgs);
+    if (status == ER_OK) {
+        status = bus.RegisterSignalHandler(&receiver,
+                                           static_cast<MessageReceiver::SignalHandler>(&Receiver::SignalHandler),
+                                           bus.GetInterface(InterfaceName)->GetMember("chunk"),
+                                           NULL);
+    }
+    if (status == ER_OK) {
+        strncpy(g_shared->uniqueName, bus.GetUniqueName().c_str(), sizeof(g_shared->uniqueName) - 1);
+        g_shared->ready = 1;
+    } else {
+        g_shared->ready = -1;
+    }
+    while (!g_interrupt) {
+        qcc::Sleep(100);
+    }
+}
+
+/*
+ * Send numSignals encrypted signals of each payload size to the receiver from a bus attachment that
+ * encrypts with the given number of threads.
+ */
+static QStatus RunSender(uint32_t cryptoThreads, uint32_t numSignals, size_t payloadSize, const qcc::String& connectArgs)
+{
+    XferAuthListener listener;
+    BusAttachment bus("securexfer-tx", true);
+    QStatus status = bus.SetEncryptionConcurrency(cryptoThreads);
+    if (status == ER_OK) {
+        status = SetUpBus(bus, listener, connectArgs);
+    }
+    Sender sender(bus);
+    if (status == ER_OK) {
+        status = bus.RegisterBusObject(sender, true);
+    }
+    if (status != ER_OK) {
+        return status;
+    }
+
+    /* Signals cannot start an authentication so secure the connection before timing anything */
+    ProxyBusObject remoteObj(bus, g_shared->uniqueName, ObjectPath, 0);
+    status = remoteObj.SecureConnection();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to authenticate with the receiver"));
+        return status;
+    }
+
+    printf("%8u %8s %10s %10s %12s %12s\n", cryptoThreads, "size", "signals", "time(ms)", "MB/s", "msgs/s");
+    size_t numSizes = payloadSize ? 1 : ArraySize(PayloadSizes);
+    for (size_t s = 0; (status == ER_OK) && !g_interrupt && (s < numSizes); ++s) {
+        size_t len = payloadSize ? payloadSize : PayloadSizes[s];
+        uint8_t* data = new uint8_t[len];
+        memset(data, 0xA5, len);
+
+        int32_t expected = g_shared->received + numSignals;
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; (status == ER_OK) && (i < numSignals); ++i) {
+            status = sender.SendChunk(g_shared->uniqueName, data, len);
+            if (status != ER_OK) {
+                QCC_LogError(status, ("Failed to send signal (# %u of %u)", i, numSignals));
+            }
+        }
+        /* Give up if delivery stalls for 10 seconds */
+        int32_t last = g_shared->received;
+        uint64_t lastProgress = GetTimestamp64();
+        while ((status == ER_OK) && !g_interrupt && (g_shared->received < expected)) {
+            qcc::Sleep(1);
+            if (g_shared->received != last) {
+                last = g_shared->received;
+                lastProgress = GetTimestamp64();
+            } else if ((GetTimestamp64() - lastProgress) > 10000) {
+                status = ER_TIMEOUT;
+                QCC_LogError(status, ("Only %d of %u signals were received", numSignals - (expected - last), numSignals));
+            }
+        }
+        uint64_t elapsed = GetTimestamp64() - start;
+        delete [] data;
+
+        if (status == ER_OK) {
+            double secs = (elapsed ? elapsed : 1) / 1000.0;
+            printf("%8s %8u %10u %10u %12.1f %12.0f\n", "", (unsigned int)len, numSignals, (unsigned int)elapsed,
+                   ((double)len * numSignals) / (1024.0 * 1024.0) / secs, numSignals / secs);
+        }
+    }
+    if (g_shared->plaintext) {
+        status = ER_FAIL;
+        QCC_LogError(status, ("%d signals were not encrypted", g_shared->plaintext));
+    }
+    bus.ClearKeyStore();
+    return status;
+}
+
+static void usage(void)
+{
+    std::cout << "Usage: securexfer\n"
+              << "\t-t <threads> number of encryption threads to compare with encrypting on write (default 2)\n"
+              << "\t-n <signals> number of signals to send for each payload size (default 1000)\n"
+              << "\t-s <size> only send signals with this payload size\n"
+              << "\t-h/-? display usage \n";
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    uint32_t cryptoThreads = 2;
+    uint32_t numSignals = 1000;
+    size_t payloadSize = 0;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+    fflush(stdout);
+
+    /* Install SIGINT handler */
+    signal(SIGINT, SigIntHandler);
+    signal(SIGTERM, SigIntHandler);
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i]) || 0 == strcmp("-?", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-t", argv[i]) || 0 == strcmp("-n", argv[i]) || 0 == strcmp("-s", argv[i])) {
+            ++i;
+            if (i == argc) {
+                std::cout << "option " << argv[i - 1] << " requires a parameter" << std::endl;
+                usage();
+                exit(1);
+            } else if (argv[i - 1][1] == 't') {
+                cryptoThreads = strtoul(argv[i], NULL, 10);
+            } else if (argv[i - 1][1] == 's') {
+                payloadSize = (std::min)((size_t)strtoul(argv[i], NULL, 10), ALLJOYN_MAX_ARRAY_LEN);
+            } else {
+                numSignals = strtoul(argv[i], NULL, 10);
+            }
+        } else {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            usage();
+            exit(1);
+        }
+    }
+
+    Environ* env = Environ::GetAppEnviron();
+    qcc::String connectArgs = env->Find("BUS_ADDRESS");
+
+    g_shared = (XferShared*)mmap(NULL, sizeof(XferShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_shared == MAP_FAILED) {
+        std::cout << "Failed to map shared state" << std::endl;
+        exit(1);
+    }
+    memset(g_shared, 0, sizeof(XferShared));
+
+    /* Fork the receiver process before this process creates any bus attachments */
+    pid_t child = fork();
+    if (child == 0) {
+        RunReceiver(connectArgs);
+        _exit(0);
+    } else if (child < 0) {
+        std::cout << "Failed to fork receiver process" << std::endl;
+        g_interrupt = true;
+    }
+
+    while (!g_interrupt && (g_shared->ready == 0)) {
+        qcc::Sleep(10);
+    }
+    if ((g_shared->ready < 0) || g_interrupt) {
+        status = ER_FAIL;
+        QCC_LogError(status, ("Failed to set up receiver"));
+    } else {
+        /* First encrypting as messages are written then encrypting ahead of delivery */
+        printf("%8s\n", "threads");
+        status = RunSender(0, numSignals, payloadSize, connectArgs);
+        if ((status == ER_OK) && cryptoThreads) {
+            status = RunSender(cryptoThreads, numSignals, payloadSize, connectArgs);
+        }
+    }
+
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    munmap(g_shared, sizeof(XferShared));
+
+    std::cout << argv[0] << " exiting with status " << QCC_StatusText(status) << std::endl;
+
+    return (int) status;
+}
@@ -0,0 +1,401 @@
+/**
+ * @file
+ * A test program that measures how long it takes many joiners to catch up on a large sessionless
+ * signal cache
+ */
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/Environ.h>
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+#include <qcc/atomic.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/BusObject.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/version.h>
+
+#include <alljoyn/Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static const char* ObjectPathPrefix = "/org/alljoyn/SlCatchup/";
+static const char* InterfaceName = "org.alljoyn.SlCatchup";
+static const char* MatchRule = "type='signal',sessionless='t',interface='org.alljoyn.SlCatchup'";
+
+/*
+ * The routing node keeps one sessionless signal per sender, interface, member and object path, so
+ * the cached signals are spread over this many members of as many objects as needed.
+ */
+static const uint32_t NumMembers = 100;
+
+/*
+ * Every bus attachment uses a few dozen file descriptors so the joiners are spread over several
+ * processes to keep each process well below FD_SETSIZE.
+ */
+static const uint32_t JoinersPerProcess = 16;
+
+/** Counters shared between the sender and the joiner processes */
+struct CatchupCounters {
+    volatile int32_t ready;     /**< Number of joiners that are connected and waiting to add their match rule */
+    volatile int32_t failed;    /**< Number of joiners that could not be set up */
+    volatile int32_t go;        /**< Set by the sender once the cache is filled */
+    volatile int32_t caughtUp;  /**< Number of joiners that have received every cached signal */
+    volatile int32_t received;  /**< Number of signals received by all joiners */
+};
+
+static CatchupCounters* g_counters = NULL;
+
+static volatile sig_atomic_t g_interrupt = false;
+
+static void SigIntHandler(int sig)
+{
+    g_interrupt = true;
+}
+
+static QStatus CreateCatchupInterface(BusAttachment& bus)
+{
+    InterfaceDescription* intf = NULL;
+    QStatus status = bus.CreateInterface(InterfaceName, intf);
+    if (status == ER_OK) {
+        for (uint32_t m = 0; m < NumMembers; ++m) {
+            intf->AddSignal(("S" + U32ToString(m)).c_str(), "u", NULL, 0);
+        }
+        intf->Activate();
+    } else {
+        QCC_LogError(status, ("Failed to create interface %s", InterfaceName));
+    }
+    return status;
+}
+
+static QStatus StartAndConnect(BusAttachment& bus, const qcc::String& connectArgs)
+{
+    QStatus status = bus.Start();
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to start bus attachment"));
+        return status;
+    }
+    status = connectArgs.empty() ? bus.Connect() : bus.Connect(connectArgs.c_str());
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to connect to \"%s\"", connectArgs.c_str()));
+    }
+    return status;
+}
+
+class Joiner : public MessageReceiver {
+  public:
+
+    Joiner(int32_t numCached) : numCached(numCached), numReceived(0) { }
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg)
+    {
+        IncrementAndFetch(&g_counters->received);
+        if (IncrementAndFetch(&numReceived) == numCached) {
+            IncrementAndFetch(&g_counters->caughtUp);
+        }
+    }
+
+  private:
+    int32_t numCached;
+    volatile int32_t numReceived;
+};
+
+class Sender : public BusObject {
+  public:
+
+    Sender(BusAttachment& bus, uint32_t index) : BusObject((ObjectPathPrefix + U32ToString(index)).c_str())
+    {
+        const InterfaceDescription* intf = bus.GetInterface(InterfaceName);
+        assert(intf);
+        AddInterface(*intf);
+        members.reserve(NumMembers);
+        for (uint32_t m = 0; m < NumMembers; ++m) {
+            members.push_back(intf->GetMember(("S" + U32ToString(m)).c_str()));
+            assert(members.back());
+        }
+    }
+
+    QStatus SendSessionless(uint32_t member, uint32_t value)
+    {
+        MsgArg arg("u", value);
+        return Signal(NULL, 0, *members[member], &arg, 1, 0, ALLJOYN_FLAG_SESSIONLESS);
+    }
+
+  private:
+    vector<const InterfaceDescription::Member*> members;
+};
+
+/*
+ * Body of a joiner process. Each joiner has its own connection, and therefore its own endpoint
+ * and sessionless match rule, in the routing node.
+ */
+static void RunJoiners(uint32_t numJoiners, uint32_t numSignals, const qcc::String& connectArgs)
+{
+    vector<Joiner*> joiners;
+    vector<BusAttachment*> buses;
+    for (uint32_t j = 0; j < numJoiners; ++j) {
+        BusAttachment* bus = new BusAttachment("slcatchup-rx", true);
+        Joiner* joiner = new Joiner(numSignals);
+        buses.push_back(bus);
+        joiners.push_back(joiner);
+        QStatus status = CreateCatchupInterface(*bus);
+        if (status == ER_OK) {
+            status = StartAndConnect(*bus, connectArgs);
+        }
+        const InterfaceDescription* intf = bus->GetInterface(InterfaceName);
+        for (uint32_t m = 0; (status == ER_OK) && (m < NumMembers); ++m) {
+            status = bus->RegisterSignalHandler(joiner,
+                                                static_cast<MessageReceiver::SignalHandler>(&Joiner::SignalHandler),
+                                                intf->GetMember(("S" + U32ToString(m)).c_str()),
+                                                NULL);
+        }
+        IncrementAndFetch((status == ER_OK) ? &g_counters->ready : &g_counters->failed);
+    }
+
+    /* Wait for the sender to fill the cache, then have every joiner catch up at once */
+    while (!g_interrupt && !g_counters->go) {
+        qcc::Sleep(1);
+    }
+    for (uint32_t j = 0; !g_interrupt && (j < numJoiners); ++j) {
+        QStatus status = buses[j]->AddMatch(MatchRule);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("AddMatch failed"));
+        }
+    }
+
+    while (!g_interrupt) {
+        qcc::Sleep(100);
+    }
+    for (size_t j = 0; j < buses.size(); ++j) {
+        delete buses[j];
+        delete joiners[j];
+    }
+}
+
+/*
+ * Wait until the shared counter reaches the expected value, giving up if it makes no progress
+ * for 10 seconds.
+ */
+static QStatus WaitForCounter(volatile int32_t* counter, int32_t expected, const char* what)
+{
+    QStatus status = ER_OK;
+    int32_t last = *counter;
+    uint64_t lastProgress = GetTimestamp64();
+    while ((status == ER_OK) && !g_interrupt && (*counter < expected)) {
+        qcc::Sleep(1);
+        if (*counter != last) {
+            last = *counter;
+            lastProgress = GetTimestamp64();
+        } else if ((GetTimestamp64() - lastProgress) > 10000) {
+            status = ER_TIMEOUT;
+            QCC_LogError(status, ("Only %d of %d %s", last, expected, what));
+        }
+    }
+    return g_interrupt ? ER_FAIL : status;
+}
+
+static QStatus RunSender(uint32_t numJoiners, uint32_t numSignals, uint32_t numUpdates, const qcc::String& connectArgs)
+{
+    BusAttachment bus("slcatchup-tx", true);
+    QStatus status = CreateCatchupInterface(bus);
+    if (status == ER_OK) {
+        status = StartAndConnect(bus, connectArgs);
+    }
+    vector<Sender*> senders;
+    for (uint32_t i = 0; (status == ER_OK) && (i < numSignals); i += NumMembers) {
+        senders.push_back(new Sender(bus, senders.size()));
+        status = bus.RegisterBusObject(*senders.back());
+    }
+
+    /* Fill the routing node's sessionless cache */
+    uint64_t start = GetTimestamp64();
+    for (uint32_t i = 0; (status == ER_OK) && (i < numSignals); ++i) {
+        status = senders[i / NumMembers]->SendSessionless(i % NumMembers, i);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to send signal (# %u of %u)", i, numSignals));
+        }
+    }
+    if (status == ER_OK) {
+        /* The reply to a method call is routed after every signal sent before it */
+        bool hasOwner;
+        status = bus.NameHasOwner(bus.GetUniqueName().c_str(), hasOwner);
+    }
+    uint64_t fillTime = GetTimestamp64() - start;
+
+    uint64_t firstTime = 0;
+    uint64_t catchupTime = 0;
+    if (status == ER_OK) {
+        start = GetTimestamp64();
+        g_counters->go = 1;
+        while (!g_interrupt && (g_counters->caughtUp == 0) && ((GetTimestamp64() - start) < 60000)) {
+            qcc::Sleep(1);
+        }
+        firstTime = GetTimestamp64() - start;
+        status = WaitForCounter(&g_counters->caughtUp, numJoiners, "joiners caught up");
+        catchupTime = GetTimestamp64() - start;
+    }
+
+    /* Replace some of the cached signals now that every joiner is up to date */
+    uint64_t updateTime = 0;
+    if (status == ER_OK) {
+        int32_t expected = g_counters->received + (int32_t)(numUpdates * numJoiners);
+        start = GetTimestamp64();
+        for (uint32_t i = 0; (status == ER_OK) && (i < numUpdates); ++i) {
+            uint32_t n = i % numSignals;
+            status = senders[n / NumMembers]->SendSessionless(n % NumMembers, numSignals + i);
+        }
+        if (status == ER_OK) {
+            status = WaitForCounter(&g_counters->received, expected, "signals received");
+        }
+        updateTime = GetTimestamp64() - start;
+    }
+
+    if (status == ER_OK) {
+        printf("%8s %8s %10s %10s %10s %10s %12s\n", "cached", "joiners", "fill(ms)", "first(ms)", "all(ms)", "updates", "update(ms)");
+        printf("%8u %8u %10u %10u %10u %10u %12u\n", numSignals, numJoiners, (unsigned int)fillTime,
+               (unsigned int)firstTime, (unsigned int)catchupTime, numUpdates, (unsigned int)updateTime);
+    }
+
+    bus.UnregisterAllHandlers(NULL);
+    for (size_t i = 0; i < senders.size(); ++i) {
+        bus.UnregisterBusObject(*senders[i]);
+        delete senders[i];
+    }
+    return status;
+}
+
+static void usage(void)
+{
+    std::cout << "Usage: slcatchup\n"
+              << "\t-n <signals> number of sessionless signals to cache (default 10000)\n"
+              << "\t-j <joiners> number of joining bus attachments (default 50)\n"
+              << "\t-u <updates> number of cached signals to replace after the joiners caught up (default 100)\n"
+              << "\t-c <connect spec> connect the joiners to this routing node instead of $BUS_ADDRESS\n"
+              << "\t-h/-? display usage \n";
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    uint32_t numSignals = 10000;
+    uint32_t numJoiners = 50;
+    uint32_t numUpdates = 100;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+    fflush(stdout);
+
+    /* Install SIGINT handler */
+    signal(SIGINT, SigIntHandler);
+    signal(SIGTERM, SigIntHandler);
+
+    Environ* env = Environ::GetAppEnviron();
+    qcc::String connectArgs = env->Find("BUS_ADDRESS");
+    qcc::String joinerConnectArgs = connectArgs;
+
+    /* Parse command line args */
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i]) || 0 == strcmp("-?", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-n", argv[i]) || 0 == strcmp("-j", argv[i]) || 0 == strcmp("-u", argv[i]) ||
+                   0 == strcmp("-c", argv[i])) {
+            ++i;
+            if (i == argc) {
+                std::cout << "option " << argv[i - 1] << " requires a parameter" << std::endl;
+                usage();
+                exit(1);
+            } else if (argv[i - 1][1] == 'n') {
+                numSignals = (std::max)(strtoul(argv[i], NULL, 10), 1UL);
+            } else if (argv[i - 1][1] == 'j') {
+                numJoiners = strtoul(argv[i], NULL, 10);
+            } else if (argv[i - 1][1] == 'u') {
+                numUpdates = strtoul(argv[i], NULL, 10);
+            } else {
+                joinerConnectArgs = argv[i];
+            }
+        } else {
+            std::cout << "Unknown option: " << argv[i] << std::endl;
+            usage();
+            exit(1);
+        }
+    }
+
+    g_counters = (CatchupCounters*)mmap(NULL, sizeof(CatchupCounters), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (g_counters == MAP_FAILED) {
+        std::cout << "Failed to map shared counters" << std::endl;
+        exit(1);
+    }
+    memset(g_counters, 0, sizeof(CatchupCounters));
+
+    /* Fork the joiner processes before this process creates any bus attachments */
+    vector<pid_t> children;
+    for (uint32_t j = 0; j < numJoiners; j += JoinersPerProcess) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            RunJoiners((std::min)(JoinersPerProcess, numJoiners - j), numSignals, joinerConnectArgs);
+            _exit(0);
+        } else if (pid > 0) {
+            children.push_back(pid);
+        } else {
+            std::cout << "Failed to fork joiner process" << std::endl;
+            g_interrupt = true;
+            break;
+        }
+    }
+
+    while (!g_interrupt && ((uint32_t)(g_counters->ready + g_counters->failed) < numJoiners)) {
+        qcc::Sleep(10);
+    }
+    if (g_counters->failed || g_interrupt) {
+        status = ER_FAIL;
+        QCC_LogError(status, ("Failed to set up %d of %u joiners", g_counters->failed, numJoiners));
+    } else {
+        status = RunSender(numJoiners, numSignals, numUpdates, connectArgs);
+    }
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        kill(children[i], SIGTERM);
+        waitpid(children[i], NULL, 0);
+    }
+    munmap(g_counters, sizeof(CatchupCounters));
+
+    std::cout << argv[0] << " exiting with status " << QCC_StatusText(status) << std::endl;
+
+    return (int) status;
+}
@@ -30,6 +30,7 @@
 #include <qcc/FileStream.h>
 #include <qcc/KeyBlob.h>
 #include <qcc/Pipe.h>
+#include <qcc/StringSink.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Util.h>
 #include <qcc/GUID.h>
@@ -233,3 +234,323 @@ TEST(KeyStoreTest, keystore_store_load_merge) {
     DeleteFile("keystore_test");
 }
 
+static const char journalFile[] = ".alljoyn_keystore/keystore_journal_test";
+
+static qcc::String ReadKeyStoreFile()
+{
+    qcc::String data;
+    FileSource source(GetHomeDir() + "/" + journalFile);
+    uint8_t buf[1024];
+    size_t pulled;
+    while (source.PullBytes(buf, sizeof(buf), pulled) == ER_OK) {
+        data.append((const char*)buf, pulled);
+    }
+    return data;
+}
+
+static void WriteKeyStoreFile(const qcc::String& data)
+{
+    FileSink sink(GetHomeDir() + "/" + journalFile, FileSink::PRIVATE);
+    size_t pushed;
+    sink.PushBytes(data.data(), data.size(), pushed);
+}
+
+static bool SameKey(const KeyBlob& a, const KeyBlob& b)
+{
+    return (a.GetSize() == b.GetSize()) && (memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0);
+}
+
+TEST(KeyStoreTest, keystore_journal) {
+    const size_t numKeys = 100;
+    qcc::GUID128 guids[numKeys];
+    KeyBlob keys[numKeys];
+    KeyBlob key;
+    QStatus status;
+    size_t journalSize;
+
+    /*
+     * Each store appends just the key that changed
+     */
+    {
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        keyStore.Clear();
+
+        size_t size = ReadKeyStoreFile().size();
+        for (size_t i = 0; i < numKeys; ++i) {
+            keys[i].Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+            keyStore.AddKey(guids[i], keys[i]);
+            status = keyStore.Store();
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to store key " << i;
+            size_t newSize = ReadKeyStoreFile().size();
+            ASSERT_GT(newSize, size);
+            ASSERT_LT(newSize - size, 200U) << "Store rewrote the key store";
+            size = newSize;
+        }
+        status = keyStore.DelKey(guids[0]);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        journalSize = ReadKeyStoreFile().size();
+    }
+
+    /*
+     * Keys are replayed from the journal
+     */
+    {
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        status = keyStore.GetKey(guids[0], key);
+        ASSERT_EQ(ER_BUS_KEY_UNAVAILABLE, status) << "  Actual Status: " << QCC_StatusText(status) << " guid0 was not deleted";
+        for (size_t i = 1; i < numKeys; ++i) {
+            status = keyStore.GetKey(guids[i], key);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to load key " << i;
+            ASSERT_TRUE(SameKey(keys[i], key)) << "Key " << i << " does not match";
+        }
+
+        /*
+         * Replacing a key over and over again eventually compacts the journal
+         */
+        for (size_t i = 0; i < 2 * numKeys; ++i) {
+            keys[1].Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+            keyStore.AddKey(guids[1], keys[1]);
+            status = keyStore.Store();
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        }
+        ASSERT_LT(ReadKeyStoreFile().size(), 2 * journalSize) << "Key store was not compacted";
+    }
+
+    /*
+     * A partially written entry at the end of the journal is ignored and the journal is
+     * rewritten on the next store
+     */
+    {
+        const uint8_t partial[] = { 0x80, 0x00, 0x00, 0x00, 0x01 };
+        WriteKeyStoreFile(ReadKeyStoreFile() + qcc::String((const char*)partial, sizeof(partial)));
+
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = keyStore.GetKey(guids[1], key);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(keys[1], key));
+
+        keys[0].Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+        keyStore.AddKey(guids[0], keys[0]);
+        status = keyStore.Store();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+    {
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        for (size_t i = 0; i < numKeys; ++i) {
+            status = keyStore.GetKey(guids[i], key);
+            ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to load key " << i;
+            ASSERT_TRUE(SameKey(keys[i], key)) << "Key " << i << " does not match";
+        }
+    }
+    DeleteFile(GetHomeDir() + "/" + journalFile);
+}
+
+TEST(KeyStoreTest, keystore_journal_integrity) {
+    qcc::GUID128 guid1;
+    qcc::GUID128 guid2;
+    qcc::GUID128 guid3;
+    KeyBlob key1;
+    KeyBlob key2;
+    KeyBlob key3;
+    KeyBlob key;
+    QStatus status;
+
+    {
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, true);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        keyStore.Clear();
+        key1.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+        key2.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+        keyStore.AddKey(guid1, key1);
+        keyStore.AddKey(guid2, key2);
+        status = keyStore.Store();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    /*
+     * A deletion entry that is not authenticated by the key store key does not delete the key
+     */
+    {
+        uint32_t len = sizeof(uint8_t) + sizeof(uint32_t) + qcc::GUID128::SIZE;
+        uint8_t op = 2;
+        uint32_t rev = 0x1000;
+        qcc::String forged((const char*)&len, sizeof(len));
+        forged.append((const char*)&op, sizeof(op));
+        forged.append((const char*)&rev, sizeof(rev));
+        forged.append((const char*)guid1.GetBytes(), qcc::GUID128::SIZE);
+        qcc::String data = ReadKeyStoreFile();
+        WriteKeyStoreFile(data + forged);
+
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, true);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = keyStore.GetKey(guid1, key);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Forged deletion removed the key";
+        ASSERT_TRUE(SameKey(key1, key));
+        WriteKeyStoreFile(data);
+    }
+
+    /*
+     * A key that fails to decrypt is removed from the journal by the next store, even when the
+     * store appends to the journal
+     */
+    {
+        qcc::String data = ReadKeyStoreFile();
+        size_t pos = 0;
+        while (((pos + qcc::GUID128::SIZE) <= data.size()) && (memcmp(data.data() + pos, guid2.GetBytes(), qcc::GUID128::SIZE) != 0)) {
+            ++pos;
+        }
+        ASSERT_LE(pos + qcc::GUID128::SIZE, data.size());
+        /* Flip a bit in the encrypted key that follows the GUID, the expiration and the nonce */
+        size_t keyPos = pos + qcc::GUID128::SIZE + sizeof(uint64_t) + sizeof(uint16_t) + 12;
+        ASSERT_LT(keyPos, data.size());
+        data[keyPos] = data[keyPos] ^ 1;
+        WriteKeyStoreFile(data);
+
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, true);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(keyStore.HasKey(guid2));
+        status = keyStore.GetKey(guid2, key);
+        ASSERT_EQ(ER_BUS_KEY_UNAVAILABLE, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        size_t size = ReadKeyStoreFile().size();
+        key3.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+        keyStore.AddKey(guid3, key3);
+        status = keyStore.Store();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_GT(ReadKeyStoreFile().size(), size) << "Store rewrote the key store";
+    }
+    {
+        KeyStore keyStore("keystore_journal_test");
+        status = keyStore.Init(journalFile, true);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_FALSE(keyStore.HasKey(guid2)) << "Undecryptable key is still in the journal";
+        status = keyStore.GetKey(guid1, key);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(key1, key));
+        status = keyStore.GetKey(guid3, key);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(key3, key));
+    }
+    DeleteFile(GetHomeDir() + "/" + journalFile);
+}
+
+/*
+ * Key store listener that keeps the key store in a string
+ */
+class StringKeyStoreListener : public KeyStoreListener {
+  public:
+    StringKeyStoreListener(const qcc::String& keys) : keys(keys) { }
+
+    QStatus LoadRequest(KeyStore& keyStore) {
+        return PutKeys(keyStore, keys, "password");
+    }
+
+    QStatus StoreRequest(KeyStore& keyStore) {
+        return GetKeys(keyStore, keys);
+    }
+
+    qcc::String keys;
+};
+
+/*
+ * Build a key store in the version 0x0103 format where all the keys are encrypted in one blob
+ */
+static qcc::String BlobKeyStore(const qcc::GUID128& storeGuid, const qcc::GUID128& guid, const KeyBlob& key, const uint8_t accessRights[4])
+{
+    const uint16_t version = 0x0103;
+    uint32_t revision = 1;
+    size_t pushed;
+
+    StringSink keys;
+    keys.PushBytes(&revision, sizeof(revision), pushed);
+    keys.PushBytes(guid.GetBytes(), qcc::GUID128::SIZE, pushed);
+    key.Store(keys);
+    keys.PushBytes(accessRights, 4, pushed);
+
+    /* The key store key is derived from the password while the key store is being loaded */
+    KeyBlob storeKey;
+    storeKey.Derive("password", Crypto_AES::AES128_SIZE, KeyBlob::AES);
+    KeyBlob nonce((uint8_t*)&revision, sizeof(revision), KeyBlob::GENERIC);
+    size_t len = keys.GetString().size();
+    uint8_t* data = new uint8_t[len + 16];
+    Crypto_AES aes(storeKey, Crypto_AES::CCM);
+    aes.Encrypt_CCM(keys.GetString().data(), data, len, nonce, NULL, 0, 16);
+
+    StringSink sink;
+    sink.PushBytes(&version, sizeof(version), pushed);
+    sink.PushBytes(&revision, sizeof(revision), pushed);
+    sink.PushBytes(storeGuid.GetBytes(), qcc::GUID128::SIZE, pushed);
+    sink.PushBytes(&len, sizeof(len), pushed);
+    sink.PushBytes(data, len, pushed);
+    delete [] data;
+    return sink.GetString();
+}
+
+TEST(KeyStoreTest, keystore_migrate_blob) {
+    qcc::GUID128 storeGuid;
+    qcc::GUID128 guid1;
+    qcc::GUID128 guid2;
+    KeyBlob key1;
+    KeyBlob key2;
+    KeyBlob key;
+    const uint8_t rights[4] = { 1, 2, 3, 4 };
+    uint8_t accessRights[4];
+    QStatus status;
+
+    key1.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+    key2.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+    StringKeyStoreListener listener(BlobKeyStore(storeGuid, guid1, key1, rights));
+    {
+        KeyStore keyStore("keystore_migrate_test");
+        keyStore.SetListener(listener);
+        status = keyStore.Init(NULL, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to load old key store";
+        ASSERT_STREQ(storeGuid.ToString().c_str(), keyStore.GetGuid().c_str());
+
+        status = keyStore.GetKey(guid1, key, accessRights);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(key1, key));
+        ASSERT_EQ(0, memcmp(rights, accessRights, sizeof(rights)));
+
+        keyStore.AddKey(guid2, key2);
+        status = keyStore.Store();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    /*
+     * The key store is now written in the journal format
+     */
+    uint16_t version;
+    ASSERT_GE(listener.keys.size(), sizeof(version));
+    memcpy(&version, listener.keys.data(), sizeof(version));
+    ASSERT_EQ(0x0104, version);
+    {
+        StringKeyStoreListener journal(listener.keys);
+        KeyStore keyStore("keystore_migrate_test");
+        keyStore.SetListener(journal);
+        status = keyStore.Init(NULL, false);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status) << " Failed to load converted key store";
+        ASSERT_STREQ(storeGuid.ToString().c_str(), keyStore.GetGuid().c_str());
+
+        status = keyStore.GetKey(guid1, key, accessRights);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(key1, key));
+        ASSERT_EQ(0, memcmp(rights, accessRights, sizeof(rights)));
+
+        status = keyStore.GetKey(guid2, key);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        ASSERT_TRUE(SameKey(key2, key));
+    }
+}
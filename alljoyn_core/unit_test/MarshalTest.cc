@@ -22,6 +22,7 @@
 #include <qcc/Pipe.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
@@ -297,6 +298,178 @@ TEST(MarshalTest, TestMsgUnpack) {
     delete bus;
 }
 
+TEST(MarshalTest, DeferredArrayElements) {
+    QStatus status = ER_OK;
+
+    BusAttachment* bus = new BusAttachment("DeferredArrayElements", false);
+    bus->Start();
+
+    TestPipe stream;
+    MyMessage msg(*bus);
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+
+    /* A property bag with a nested array of structs in one of the values */
+    const size_t numEntries = 40;
+    MsgArg entries[numEntries];
+    MsgArg values[numEntries];
+    String keys[numEntries];
+    static const char* names[] = { "one", "two", "three" };
+    MsgArg structs[ArraySize(names)];
+    for (size_t i = 0; i < ArraySize(names); ++i) {
+        structs[i].Set("(sas)", names[i], ArraySize(names), names);
+    }
+    for (size_t i = 0; i < numEntries; ++i) {
+        keys[i] = "key" + U32ToString(i);
+        if (i == 7) {
+            values[i].Set("a(sas)", ArraySize(structs), structs);
+        } else {
+            values[i].Set("u", (uint32_t)i);
+        }
+        entries[i].Set("{sv}", keys[i].c_str(), &values[i]);
+    }
+    MsgArg dict("a{sv}", numEntries, entries);
+
+    status = msg.Signal(NULL, "/foo/bar", "foo.bar", "test", &dict, 1);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Deliver(ep);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Read(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.Unmarshal(ep, ":88.88");
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    status = msg.UnmarshalBody();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    /* The number of elements is known before any element is parsed */
+    const MsgArg* arg = msg.GetArg(0);
+    ASSERT_TRUE(arg != NULL);
+    EXPECT_EQ(numEntries, arg->v_array.GetNumElements());
+    EXPECT_STREQ("{sv}", arg->v_array.GetElemSig());
+
+    /* Copying a deferred array parses it */
+    MsgArg copy = *arg;
+    EXPECT_TRUE(copy == dict);
+
+    uint32_t u;
+    status = arg->GetElement("{su}", "key12", &u);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    EXPECT_EQ(12U, u);
+
+    size_t numStructs;
+    MsgArg* parsedStructs;
+    status = arg->GetElement("{sa(sas)}", "key7", &numStructs, &parsedStructs);
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_EQ(ArraySize(structs), numStructs);
+    for (size_t i = 0; i < numStructs; ++i) {
+        const char* name;
+        size_t numStrs;
+        MsgArg* strs;
+        status = parsedStructs[i].Get("(sas)", &name, &numStrs, &strs);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        EXPECT_STREQ(names[i], name);
+        ASSERT_EQ(ArraySize(names), numStrs);
+        EXPECT_STREQ(names[2], strs[2].v_string.str);
+    }
+    delete bus;
+}
+
+class DeferredReaderThread : public Thread {
+  public:
+    DeferredReaderThread(const MsgArg* args, size_t numArgs, size_t first) :
+        Thread("DeferredReaderThread"), failures(0), args(args), numArgs(numArgs), first(first) { }
+
+    uint32_t failures;
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        /* Walk the arrays in a different order on each thread so they race to parse them */
+        for (size_t n = 0; n < numArgs; ++n) {
+            const MsgArg& array = args[(n + first) % numArgs];
+            if (array.v_array.ParseElements() != ER_OK) {
+                ++failures;
+                continue;
+            }
+            const MsgArg* structs = array.v_array.GetElements();
+            for (size_t i = 0; structs && (i < array.v_array.GetNumElements()); ++i) {
+                const char* name;
+                size_t numStrs;
+                MsgArg* strs;
+                if ((structs[i].Get("(sas)", &name, &numStrs, &strs) != ER_OK) || (numStrs != i + 1) ||
+                    (strcmp(strs[i].v_string.str, name) != 0)) {
+                    ++failures;
+                }
+            }
+        }
+        return 0;
+    }
+
+  private:
+    const MsgArg* args;
+    size_t numArgs;
+    size_t first;
+};
+
+TEST(MarshalTest, DeferredArrayElementsConcurrentAccess) {
+    QStatus status = ER_OK;
+
+    BusAttachment* bus = new BusAttachment("DeferredArrayElementsConcurrentAccess", false);
+    bus->Start();
+
+    TestPipe stream;
+    TestPipe* pStream = &stream;
+    static const bool falsiness = false;
+    RemoteEndpoint ep(*bus, falsiness, String::Empty, pStream);
+
+    /* Several top level arrays of structs, all of them are deferred when the body is unmarshaled */
+    static const char* names[] = { "one", "two", "three", "four", "five", "six" };
+    const size_t numStructs = ArraySize(names);
+    MsgArg structs[numStructs];
+    for (size_t i = 0; i < numStructs; ++i) {
+        structs[i].Set("(sas)", names[i], i + 1, names);
+    }
+    const size_t numArgs = 8;
+    MsgArg arrays[numArgs];
+    for (size_t i = 0; i < numArgs; ++i) {
+        arrays[i].Set("a(sas)", numStructs, structs);
+    }
+
+    for (int iteration = 0; iteration < 20; ++iteration) {
+        MyMessage msg(*bus);
+        status = msg.Signal(NULL, "/foo/bar", "foo.bar", "test", arrays, numArgs);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = msg.Deliver(ep);
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = msg.Read(ep, ":88.88");
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = msg.Unmarshal(ep, ":88.88");
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = msg.UnmarshalBody();
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+        size_t numMsgArgs;
+        const MsgArg* msgArgs;
+        msg.GetArgs(numMsgArgs, msgArgs);
+        ASSERT_EQ(numArgs, numMsgArgs);
+
+        DeferredReaderThread* readers[4];
+        for (size_t i = 0; i < ArraySize(readers); ++i) {
+            readers[i] = new DeferredReaderThread(msgArgs, numMsgArgs, i * 3);
+        }
+        for (size_t i = 0; i < ArraySize(readers); ++i) {
+            readers[i]->Start();
+        }
+        for (size_t i = 0; i < ArraySize(readers); ++i) {
+            readers[i]->Join();
+            EXPECT_EQ(0U, readers[i]->failures);
+            delete readers[i];
+        }
+    }
+    delete bus;
+}
+
 /*--------------------------FUZZING TEST CODE---------------------------------*/
 static bool fuzzing = false;
 static bool nobig = false;
@@ -0,0 +1,295 @@
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <map>
+#include <vector>
+
+#include <qcc/Pipe.h>
+#include <qcc/String.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/MsgArgCodec.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <RemoteEndpoint.h>
+
+/* Header files included for Google Test Framework */
+#include <gtest/gtest.h>
+
+using namespace ajn;
+using namespace qcc;
+using namespace std;
+
+class CodecMessage : public _Message {
+  public:
+
+    CodecMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return SignalMsg(sig, NULL, 0, "/foo/bar", "foo.bar", "test", argList, numArgs, 0, 0);
+    }
+
+    QStatus Signal(const qcc::String& sig, const MsgBodyEncoder& body)
+    {
+        return SignalMsg(sig, NULL, 0, "/foo/bar", "foo.bar", "test", NULL, 0, 0, 0, &body);
+    }
+
+    QStatus Deliver(RemoteEndpoint& ep) { return _Message::Deliver(ep); }
+
+    QStatus Read(RemoteEndpoint& ep) { return _Message::Read(ep, true); }
+
+    QStatus Unmarshal(RemoteEndpoint& ep) { return _Message::Unmarshal(ep, true); }
+
+    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+};
+
+static const bool falsiness = false;
+
+class MsgArgCodecTest : public testing::Test {
+  public:
+    MsgArgCodecTest() : bus("MsgArgCodecTest", false), pStream(&stream), ep(bus, falsiness, String::Empty, pStream) { }
+
+    virtual void SetUp() { ASSERT_EQ(ER_OK, bus.Start()); }
+
+    /* Get the wire format of a message with the serial number zeroed */
+    qcc::String WireFormat(CodecMessage& msg)
+    {
+        EXPECT_EQ(ER_OK, msg.Deliver(ep));
+        size_t len = stream.AvailBytes();
+        qcc::String wire(len, 0);
+        stream.PullBytes((void*)wire.data(), len, len);
+        memset((void*)(wire.data() + 8), 0, 4);
+        return wire;
+    }
+
+    /* Marshal the args both ways and check the messages are identical */
+    void CheckSameBody(const MsgArg* args, size_t numArgs, const MsgBodyEncoder& body)
+    {
+        CodecMessage dynamic(bus);
+        CodecMessage codec(bus);
+        ASSERT_EQ(ER_OK, dynamic.Signal(args, numArgs));
+        ASSERT_STREQ(MsgArg::Signature(args, numArgs).c_str(), body.GetSignature());
+        ASSERT_EQ(ER_OK, codec.Signal(body.GetSignature(), body));
+        EXPECT_STREQ(dynamic.GetSignature(), codec.GetSignature());
+        qcc::String dynamicWire = WireFormat(dynamic);
+        qcc::String codecWire = WireFormat(codec);
+        ASSERT_EQ(dynamicWire.size(), codecWire.size());
+        EXPECT_TRUE(dynamicWire == codecWire);
+    }
+
+    /* Send a message marshaled by a body encoder through a pipe and unmarshal it */
+    void RoundTrip(const MsgBodyEncoder& body, CodecMessage& rx)
+    {
+        CodecMessage tx(bus);
+        ASSERT_EQ(ER_OK, tx.Signal(body.GetSignature(), body));
+        ASSERT_EQ(ER_OK, tx.Deliver(ep));
+        ASSERT_EQ(ER_OK, rx.Read(ep));
+        ASSERT_EQ(ER_OK, rx.Unmarshal(ep));
+        ASSERT_EQ(ER_OK, rx.UnmarshalBody());
+    }
+
+    BusAttachment bus;
+    Pipe stream;
+    Pipe* pStream;
+    RemoteEndpoint ep;
+};
+
+TEST_F(MsgArgCodecTest, BasicTypes) {
+    uint8_t y = 0xA5;
+    bool b = true;
+    int16_t n = -42;
+    uint16_t q = 0xBEBE;
+    int32_t i = -9999;
+    uint32_t u = 0x32323232;
+    int64_t x = -1LL;
+    double d = 3.14159265;
+
+    MsgArg args[8];
+    args[0].Set("y", y);
+    args[1].Set("b", b);
+    args[2].Set("n", n);
+    args[3].Set("q", q);
+    args[4].Set("i", i);
+    args[5].Set("u", u);
+    args[6].Set("x", x);
+    args[7].Set("d", d);
+    typedef MsgArgCodec<uint8_t, bool, int16_t, uint16_t, int32_t, uint32_t, int64_t, double> Codec;
+    CheckSameBody(args, ArraySize(args), Codec(y, b, n, q, i, u, x, d));
+
+    CodecMessage rx(bus);
+    RoundTrip(Codec(y, b, n, q, i, u, x, d), rx);
+    const MsgArg* rxArgs;
+    size_t rxNumArgs;
+    rx.GetArgs(rxNumArgs, rxArgs);
+    uint8_t y2 = 0;
+    bool b2 = false;
+    int16_t n2 = 0;
+    uint16_t q2 = 0;
+    int32_t i2 = 0;
+    uint32_t u2 = 0;
+    int64_t x2 = 0;
+    double d2 = 0;
+    ASSERT_EQ(ER_OK, Codec::Get(rxArgs, rxNumArgs, &y2, &b2, &n2, &q2, &i2, &u2, &x2, &d2));
+    EXPECT_EQ(y, y2);
+    EXPECT_EQ(b, b2);
+    EXPECT_EQ(n, n2);
+    EXPECT_EQ(q, q2);
+    EXPECT_EQ(i, i2);
+    EXPECT_EQ(u, u2);
+    EXPECT_EQ(x, x2);
+    EXPECT_EQ(d, d2);
+
+    /* Arguments with a NULL pointer are skipped */
+    u2 = 0;
+    ASSERT_EQ(ER_OK, Codec::Get(rxArgs, rxNumArgs, NULL, NULL, NULL, NULL, NULL, &u2));
+    EXPECT_EQ(u, u2);
+}
+
+TEST_F(MsgArgCodecTest, Containers) {
+    typedef MsgArgStruct<int32_t, uint32_t, qcc::String> Entry;
+
+    qcc::String s = "this is a string";
+    vector<qcc::String> as;
+    as.push_back("one");
+    as.push_back("two");
+    as.push_back("three");
+    vector<uint8_t> ay;
+    for (uint8_t i = 0; i < 13; ++i) {
+        ay.push_back(i);
+    }
+    vector<Entry> entries(3);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i].m1 = -(int32_t)i;
+        entries[i].m2 = (uint32_t)i * 1000;
+        entries[i].m3 = as[i];
+    }
+    map<qcc::String, uint32_t> dict;
+    dict["red"] = 1;
+    dict["green"] = 2;
+    dict["blue"] = 3;
+    pair<int32_t, bool> ib(7, true);
+    vector<bool> ab;
+    ab.push_back(true);
+    ab.push_back(false);
+    ab.push_back(true);
+    vector<double> ad;
+    ad.push_back(0.5);
+    ad.push_back(1.5);
+
+    MsgArg args[8];
+    args[0].Set("s", s.c_str());
+    const char* strs[] = { "one", "two", "three" };
+    args[1].Set("as", ArraySize(strs), strs);
+    args[2].Set("ay", ay.size(), &ay[0]);
+    MsgArg structs[3];
+    for (size_t i = 0; i < ArraySize(structs); ++i) {
+        structs[i].Set("(ius)", entries[i].m1, entries[i].m2, entries[i].m3.c_str());
+    }
+    args[3].Set("a(ius)", ArraySize(structs), structs);
+    MsgArg dictEntries[3];
+    size_t e = 0;
+    for (map<qcc::String, uint32_t>::iterator it = dict.begin(); it != dict.end(); ++it) {
+        dictEntries[e++].Set("{su}", it->first.c_str(), it->second);
+    }
+    args[4].Set("a{su}", ArraySize(dictEntries), dictEntries);
+    args[5].Set("(ib)", ib.first, ib.second);
+    bool abArray[] = { true, false, true };
+    args[6].Set("ab", ArraySize(abArray), abArray);
+    args[7].Set("ad", ad.size(), &ad[0]);
+
+    typedef MsgArgCodec<qcc::String, vector<qcc::String>, vector<uint8_t>, vector<Entry>,
+                        map<qcc::String, uint32_t>, pair<int32_t, bool>, vector<bool>, vector<double> > Codec;
+    CheckSameBody(args, ArraySize(args), Codec(s, as, ay, entries, dict, ib, ab, ad));
+
+    CodecMessage rx(bus);
+    RoundTrip(Codec(s, as, ay, entries, dict, ib, ab, ad), rx);
+    const MsgArg* rxArgs;
+    size_t rxNumArgs;
+    rx.GetArgs(rxNumArgs, rxArgs);
+    qcc::String s2;
+    vector<qcc::String> as2;
+    vector<uint8_t> ay2;
+    vector<Entry> entries2;
+    map<qcc::String, uint32_t> dict2;
+    pair<int32_t, bool> ib2;
+    vector<bool> ab2;
+    vector<double> ad2;
+    ASSERT_EQ(ER_OK, Codec::Get(rxArgs, rxNumArgs, &s2, &as2, &ay2, &entries2, &dict2, &ib2, &ab2, &ad2));
+    EXPECT_STREQ(s.c_str(), s2.c_str());
+    EXPECT_TRUE(as == as2);
+    EXPECT_TRUE(ay == ay2);
+    ASSERT_EQ(entries.size(), entries2.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        EXPECT_EQ(entries[i].m1, entries2[i].m1);
+        EXPECT_EQ(entries[i].m2, entries2[i].m2);
+        EXPECT_STREQ(entries[i].m3.c_str(), entries2[i].m3.c_str());
+    }
+    EXPECT_TRUE(dict == dict2);
+    EXPECT_TRUE(ib == ib2);
+    EXPECT_TRUE(ab == ab2);
+    EXPECT_TRUE(ad == ad2);
+}
+
+TEST_F(MsgArgCodecTest, EmptyArrays) {
+    vector<uint32_t> au;
+    vector<qcc::String> as;
+    map<uint32_t, qcc::String> dict;
+
+    MsgArg args[3];
+    args[0].Set("au", 0, NULL);
+    args[1].Set("as", 0, NULL);
+    args[2].Set("a{us}", 0, NULL);
+    typedef MsgArgCodec<vector<uint32_t>, vector<qcc::String>, map<uint32_t, qcc::String> > Codec;
+    CheckSameBody(args, ArraySize(args), Codec(au, as, dict));
+
+    CodecMessage rx(bus);
+    RoundTrip(Codec(au, as, dict), rx);
+    const MsgArg* rxArgs;
+    size_t rxNumArgs;
+    rx.GetArgs(rxNumArgs, rxArgs);
+    au.push_back(1);
+    ASSERT_EQ(ER_OK, Codec::Get(rxArgs, rxNumArgs, &au, &as, &dict));
+    EXPECT_TRUE(au.empty());
+    EXPECT_TRUE(as.empty());
+    EXPECT_TRUE(dict.empty());
+}
+
+TEST_F(MsgArgCodecTest, Mismatch) {
+    uint32_t u = 42;
+    qcc::String s = "forty two";
+
+    /* The signature of the encoded body must match the expected signature */
+    CodecMessage tx(bus);
+    EXPECT_EQ(ER_BUS_UNEXPECTED_SIGNATURE, tx.Signal("us", MsgArgCodec<uint32_t>(u)));
+
+    CodecMessage rx(bus);
+    RoundTrip(MsgArgCodec<uint32_t, qcc::String>(u, s), rx);
+    const MsgArg* rxArgs;
+    size_t rxNumArgs;
+    rx.GetArgs(rxNumArgs, rxArgs);
+    int32_t i;
+    qcc::String s2;
+    EXPECT_EQ(ER_BUS_SIGNATURE_MISMATCH, (MsgArgCodec<int32_t, qcc::String>::Get(rxArgs, rxNumArgs, &i, &s2)));
+    EXPECT_EQ(ER_BUS_SIGNATURE_MISMATCH, MsgArgCodec<uint32_t>::Get(rxArgs, rxNumArgs, &u));
+    EXPECT_EQ(ER_BUS_SIGNATURE_MISMATCH, (MsgArgCodec<uint32_t, qcc::String, uint32_t>::Get(rxArgs, rxNumArgs, &u, &s2, &u)));
+}
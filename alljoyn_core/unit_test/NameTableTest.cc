@@ -0,0 +1,210 @@
+/**
+ * @file
+ *
+ * This file tests name table lookups and their behavior under contention
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <alljoyn/DBusStd.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusEndpoint.h>
+#include <NameTable.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+class _NamedEndpoint : public _BusEndpoint {
+  public:
+    _NamedEndpoint(const qcc::String& name) : _BusEndpoint(ENDPOINT_TYPE_REMOTE), uniqueName(name) { }
+
+    const qcc::String& GetUniqueName() const { return uniqueName; }
+
+  private:
+    qcc::String uniqueName;
+};
+
+typedef ManagedObj<_NamedEndpoint> NamedEndpoint;
+
+static const size_t NUM_NAMES = 1000;
+
+static void PopulateNameTable(NameTable& nameTable, vector<NamedEndpoint>& endpoints)
+{
+    for (size_t i = 0; i < NUM_NAMES; ++i) {
+        String name = ":test.";
+        name += U32ToString(i);
+        NamedEndpoint ep(name);
+        endpoints.push_back(ep);
+        BusEndpoint busEp = BusEndpoint::cast(ep);
+        nameTable.AddUniqueName(busEp);
+
+        uint32_t disposition;
+        EXPECT_EQ(ER_OK, nameTable.AddAlias("org.test.name" + U32ToString(i), name, 0, disposition));
+        EXPECT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER, disposition);
+    }
+}
+
+TEST(NameTableTest, FindEndpointTracksOwnership) {
+    NameTable nameTable;
+    vector<NamedEndpoint> endpoints;
+    PopulateNameTable(nameTable, endpoints);
+
+    BusEndpoint ep = nameTable.FindEndpoint("org.test.name7");
+    ASSERT_TRUE(ep->IsValid());
+    EXPECT_EQ(String(":test.7"), ep->GetUniqueName());
+
+    /* Queue a second owner and hand the name over to it */
+    uint32_t disposition;
+    EXPECT_EQ(ER_OK, nameTable.AddAlias("org.test.name7", ":test.8", 0, disposition));
+    EXPECT_EQ((uint32_t)DBUS_REQUEST_NAME_REPLY_IN_QUEUE, disposition);
+    ep = nameTable.FindEndpoint("org.test.name7");
+    EXPECT_EQ(String(":test.7"), ep->GetUniqueName());
+
+    nameTable.RemoveAlias("org.test.name7", ":test.7", disposition);
+    EXPECT_EQ((uint32_t)DBUS_RELEASE_NAME_REPLY_RELEASED, disposition);
+    ep = nameTable.FindEndpoint("org.test.name7");
+    ASSERT_TRUE(ep->IsValid());
+    EXPECT_EQ(String(":test.8"), ep->GetUniqueName());
+
+    /* Removing the unique name removes the aliases it owns */
+    nameTable.RemoveUniqueName(":test.8");
+    EXPECT_FALSE(nameTable.FindEndpoint(":test.8")->IsValid());
+    EXPECT_FALSE(nameTable.FindEndpoint("org.test.name7")->IsValid());
+    EXPECT_FALSE(nameTable.FindEndpoint("org.test.name8")->IsValid());
+    EXPECT_TRUE(nameTable.FindEndpoint("org.test.name9")->IsValid());
+}
+
+class LookupThread : public Thread {
+  public:
+    LookupThread(NameTable& nameTable, bool useLock, uint32_t iterations) :
+        Thread("LookupThread"), failures(0), nameTable(nameTable), useLock(useLock), iterations(iterations) { }
+
+    uint32_t failures;
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        vector<String> names;
+        for (size_t i = 0; i < NUM_NAMES; ++i) {
+            names.push_back("org.test.name" + U32ToString(i));
+        }
+        for (uint32_t i = 0; i < iterations; ++i) {
+            const String& name = names[i % NUM_NAMES];
+            BusEndpoint ep;
+            if (useLock) {
+                /* This is how DaemonRouter::PushMessage used to look up destinations */
+                nameTable.Lock();
+                ep = nameTable.FindEndpoint(name);
+                nameTable.Unlock();
+            } else {
+                ep = nameTable.FindEndpoint(name);
+            }
+            if (!ep->IsValid()) {
+                ++failures;
+            }
+        }
+        return 0;
+    }
+
+  private:
+    NameTable& nameTable;
+    bool useLock;
+    uint32_t iterations;
+};
+
+class ChurnThread : public Thread {
+  public:
+    ChurnThread(NameTable& nameTable) : Thread("ChurnThread"), changes(0), nameTable(nameTable) { }
+
+    uint32_t changes;
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        while (!IsStopping()) {
+            uint32_t disposition;
+            nameTable.AddAlias("org.test.churn", ":test.0", 0, disposition);
+            nameTable.RemoveAlias("org.test.churn", ":test.0", disposition);
+            changes += 2;
+            qcc::Sleep(1);
+        }
+        return 0;
+    }
+
+  private:
+    NameTable& nameTable;
+};
+
+static uint64_t RunLookups(NameTable& nameTable, size_t numThreads, bool useLock, uint32_t iterations)
+{
+    vector<LookupThread*> threads;
+    for (size_t i = 0; i < numThreads; ++i) {
+        threads.push_back(new LookupThread(nameTable, useLock, iterations));
+    }
+    uint64_t start = GetTimestamp64();
+    for (size_t i = 0; i < numThreads; ++i) {
+        threads[i]->Start();
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        threads[i]->Join();
+        EXPECT_EQ(0U, threads[i]->failures);
+        delete threads[i];
+    }
+    uint64_t elapsed = GetTimestamp64() - start;
+    return elapsed ? elapsed : 1;
+}
+
+/*
+ * Measure lookup throughput with 1 to 16 routing threads while another thread
+ * keeps changing name ownership, with and without holding the name table lock
+ * around each lookup.
+ */
+TEST(NameTableTest, ContendedLookupBenchmark) {
+    const uint32_t iterations = 100000;
+
+    NameTable nameTable;
+    vector<NamedEndpoint> endpoints;
+    PopulateNameTable(nameTable, endpoints);
+
+    ChurnThread churn(nameTable);
+    churn.Start();
+    for (size_t numThreads = 1; numThreads <= 16; numThreads *= 2) {
+        uint64_t locked = RunLookups(nameTable, numThreads, true, iterations);
+        uint64_t snapshot = RunLookups(nameTable, numThreads, false, iterations);
+        uint64_t total = (uint64_t)numThreads * iterations;
+        printf("%2u threads: locked %8u lookups/ms, snapshot %8u lookups/ms\n", (unsigned int)numThreads,
+               (unsigned int)(total / locked), (unsigned int)(total / snapshot));
+    }
+    churn.Stop();
+    churn.Join();
+    EXPECT_NE(0U, churn.changes);
+}
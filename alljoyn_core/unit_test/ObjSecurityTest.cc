@@ -3090,3 +3090,173 @@ TEST_F(ObjectSecurityTest, Test33) {
     EXPECT_EQ(Intf2->GetSecurityPolicy(), AJ_IFC_SECURITY_INHERIT);
     EXPECT_FALSE(clientProxyObject.IsSecure());
 }
+
+class EncryptAheadSignalObject : public BusObject {
+
+  public:
+
+    EncryptAheadSignalObject(const char* path, InterfaceDescription& intf) :
+        BusObject(path),
+        objectRegistered(false),
+        intf(intf)  { }
+
+    void ObjectRegistered(void)
+    {
+        objectRegistered = true;
+    }
+
+    QStatus SendSignal(const char* destination, uint32_t seq, const uint8_t* data, size_t len) {
+        const InterfaceDescription::Member*  signal_member = intf.GetMember("my_blob");
+        MsgArg args[2];
+        args[0].Set("u", seq);
+        args[1].Set("ay", len, data);
+        return Signal(destination, 0, *signal_member, args, 2, 0, 0);
+    }
+
+    bool objectRegistered;
+    InterfaceDescription& intf;
+};
+
+class EncryptAheadSignalReceiver : public MessageReceiver {
+
+  public:
+
+    EncryptAheadSignalReceiver() : received(0), outOfOrder(0), notEncrypted(0) { }
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg) {
+        if (!msg->IsEncrypted()) {
+            ++notEncrypted;
+        }
+        if (msg->GetArg(0)->v_uint32 != received) {
+            ++outOfOrder;
+        }
+        ++received;
+    }
+
+    volatile uint32_t received;
+    uint32_t outOfOrder;
+    uint32_t notEncrypted;
+};
+
+class ObjectSecurityEncryptAheadTest : public testing::Test, public AuthListener {
+  public:
+    ObjectSecurityEncryptAheadTest() :
+        clientbus("ObjectSecurityTestClient", false),
+        servicebus("ObjectSecurityTestService", false),
+        status(ER_OK)
+    { };
+
+    virtual void SetUp() {
+        EXPECT_EQ(ER_OK, clientbus.SetEncryptionConcurrency(4));
+        EXPECT_EQ(ER_OK, servicebus.SetEncryptionConcurrency(4));
+
+        status = clientbus.Start();
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = clientbus.Connect(ajn::getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        clientbus.EnablePeerSecurity("ALLJOYN_SRP_KEYX", this, NULL, false);
+        clientbus.ClearKeyStore();
+
+        status = servicebus.Start();
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        status = servicebus.Connect(ajn::getConnectArg().c_str());
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+        servicebus.EnablePeerSecurity("ALLJOYN_SRP_KEYX", this, NULL, false);
+        servicebus.ClearKeyStore();
+    }
+
+    virtual void TearDown() {
+        clientbus.ClearKeyStore();
+        servicebus.ClearKeyStore();
+        clientbus.Stop();
+        servicebus.Stop();
+        clientbus.Join();
+        servicebus.Join();
+    }
+
+    BusAttachment clientbus;
+    BusAttachment servicebus;
+    QStatus status;
+
+  private:
+
+    bool RequestCredentials(const char* authMechanism, const char* authPeer, uint16_t authCount, const char* userId, uint16_t credMask, Credentials& creds) {
+        if (credMask & AuthListener::CRED_PASSWORD) {
+            creds.SetPassword("123456");
+        }
+        return true;
+    }
+
+    void AuthenticationComplete(const char* authMechanism, const char* authPeer, bool success) {
+        EXPECT_TRUE(success);
+    }
+};
+
+/*
+ * Both bus attachments encrypt queued messages ahead of delivery.
+ * service sends a burst of large encrypted signals to the client.
+ * expected that every signal arrives encrypted and in the order it was sent.
+ */
+TEST_F(ObjectSecurityEncryptAheadTest, SignalsArriveInOrder) {
+
+    static const uint32_t numSignals = 200;
+    uint8_t blob[16 * 1024];
+    memset(blob, 0x5A, sizeof(blob));
+
+    EXPECT_EQ(ER_BUS_BUS_ALREADY_STARTED, servicebus.SetEncryptionConcurrency(0));
+    EXPECT_EQ(4U, servicebus.GetEncryptionConcurrency());
+
+    InterfaceDescription* servicetestIntf = NULL;
+    status = servicebus.CreateInterface(interface1, servicetestIntf, AJ_IFC_SECURITY_REQUIRED);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_TRUE(servicetestIntf != NULL);
+    status = servicetestIntf->AddSignal("my_blob", "uay", NULL, 0);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    servicetestIntf->Activate();
+
+    EncryptAheadSignalObject serviceObject(object_path, *servicetestIntf);
+    servicebus.RegisterBusObject(serviceObject, true);
+    //Wait for a maximum of 3 sec for object to be registered
+    for (int i = 0; i < 300; ++i) {
+        qcc::Sleep(10);
+        if (serviceObject.objectRegistered) {
+            break;
+        }
+    }
+    ASSERT_TRUE(serviceObject.objectRegistered);
+
+    InterfaceDescription* clienttestIntf = NULL;
+    status = clientbus.CreateInterface(interface1, clienttestIntf, AJ_IFC_SECURITY_REQUIRED);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    ASSERT_TRUE(clienttestIntf != NULL);
+    status = clienttestIntf->AddSignal("my_blob", "uay", NULL, 0);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    clienttestIntf->Activate();
+
+    EncryptAheadSignalReceiver signalReceiver;
+    status = clientbus.RegisterSignalHandler(&signalReceiver,
+                                             static_cast<MessageReceiver::SignalHandler>(&EncryptAheadSignalReceiver::SignalHandler),
+                                             clienttestIntf->GetMember("my_blob"),
+                                             NULL);
+    EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    ProxyBusObject clientProxyObject(clientbus, servicebus.GetUniqueName().c_str(), object_path, 0, false);
+    status = clientProxyObject.SecureConnection();
+    ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+
+    for (uint32_t i = 0; i < numSignals; ++i) {
+        status = serviceObject.SendSignal(clientbus.GetUniqueName().c_str(), i, blob, sizeof(blob));
+        ASSERT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    //Wait for a maximum of 10 sec for the signals to arrive
+    for (int i = 0; i < 1000; ++i) {
+        if (signalReceiver.received == numSignals) {
+            break;
+        }
+        qcc::Sleep(10);
+    }
+    EXPECT_EQ(numSignals, signalReceiver.received);
+    EXPECT_EQ(0U, signalReceiver.outOfOrder);
+    EXPECT_EQ(0U, signalReceiver.notEncrypted);
+}
@@ -0,0 +1,234 @@
+/**
+ * @file
+ *
+ * This file tests the routing rule table and its broadcast index
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <set>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+
+#include <alljoyn/Status.h>
+
+/* Private files included for unit testing */
+#include <BusEndpoint.h>
+#include <RuleTable.h>
+
+#include <gtest/gtest.h>
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+class _RuleTestMessage : public _Message {
+  public:
+    _RuleTestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Signal(const char* objPath, const char* iface, const char* signalName)
+    {
+        return SignalMsg("", NULL, 0, objPath, iface, signalName, NULL, 0, 0, 0);
+    }
+};
+
+typedef ManagedObj<_RuleTestMessage> RuleTestMessage;
+
+/* Reference implementation: evaluate every rule in the table */
+static void LinearMatch(RuleTable& table, Message& msg, set<BusEndpoint>& endpoints)
+{
+    RuleIterator it = table.Begin();
+    while (it != table.End()) {
+        if (it->second.IsMatch(msg)) {
+            endpoints.insert(it->first);
+            it = table.AdvanceToNextEndpoint(it->first);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static Message MakeSignal(BusAttachment& bus, const char* objPath, const char* iface, const char* member)
+{
+    RuleTestMessage msg(bus);
+    EXPECT_EQ(ER_OK, msg->Signal(objPath, iface, member));
+    return Message::cast(msg);
+}
+
+static BusEndpoint MakeEndpoint()
+{
+    EndpointType type = ENDPOINT_TYPE_REMOTE;
+    return BusEndpoint(type);
+}
+
+TEST(RuleTableTest, IndexedMatch) {
+    BusAttachment bus("RuleTableTest");
+    RuleTable table;
+    ASSERT_EQ(ER_OK, bus.Start());
+
+    BusEndpoint byIface = MakeEndpoint();
+    BusEndpoint byMember = MakeEndpoint();
+    BusEndpoint byPath = MakeEndpoint();
+    BusEndpoint wildcard = MakeEndpoint();
+    BusEndpoint otherIface = MakeEndpoint();
+
+    table.AddRule(byIface, Rule("type='signal',interface='org.test.A',member='Sig'"));
+    table.AddRule(byMember, Rule("type='signal',member='Sig'"));
+    table.AddRule(byPath, Rule("type='signal',path='/test'"));
+    table.AddRule(wildcard, Rule("type='signal'"));
+    table.AddRule(otherIface, Rule("type='signal',interface='org.test.B'"));
+
+    Message msg = MakeSignal(bus, "/test", "org.test.A", "Sig");
+    set<BusEndpoint> indexed;
+    set<BusEndpoint> linear;
+    table.Lock();
+    table.FindMatchingEndpoints(msg, indexed);
+    LinearMatch(table, msg, linear);
+    table.Unlock();
+
+    EXPECT_EQ(4U, indexed.size());
+    EXPECT_TRUE(indexed == linear);
+    EXPECT_TRUE(indexed.find(otherIface) == indexed.end());
+
+    msg = MakeSignal(bus, "/other", "org.test.B", "Other");
+    indexed.clear();
+    linear.clear();
+    table.Lock();
+    table.FindMatchingEndpoints(msg, indexed);
+    LinearMatch(table, msg, linear);
+    table.Unlock();
+
+    EXPECT_EQ(2U, indexed.size());
+    EXPECT_TRUE(indexed == linear);
+    EXPECT_TRUE(indexed.find(wildcard) != indexed.end());
+    EXPECT_TRUE(indexed.find(otherIface) != indexed.end());
+}
+
+TEST(RuleTableTest, RemoveRuleUpdatesIndex) {
+    BusAttachment bus("RuleTableTest");
+    RuleTable table;
+    ASSERT_EQ(ER_OK, bus.Start());
+
+    BusEndpoint ep1 = MakeEndpoint();
+    BusEndpoint ep2 = MakeEndpoint();
+    Rule ifaceRule("type='signal',interface='org.test.A'");
+    Rule memberRule("type='signal',member='Sig'");
+
+    table.AddRule(ep1, ifaceRule);
+    table.AddRule(ep1, memberRule);
+    table.AddRule(ep2, ifaceRule);
+
+    Message msg = MakeSignal(bus, "/test", "org.test.A", "Sig");
+    set<BusEndpoint> matches;
+    table.Lock();
+    table.FindMatchingEndpoints(msg, matches);
+    table.Unlock();
+    EXPECT_EQ(2U, matches.size());
+
+    EXPECT_EQ(ER_OK, table.RemoveRule(ep1, ifaceRule));
+    matches.clear();
+    table.Lock();
+    table.FindMatchingEndpoints(msg, matches);
+    table.Unlock();
+    /* ep1 still matches through its member rule */
+    EXPECT_EQ(2U, matches.size());
+
+    EXPECT_EQ(ER_OK, table.RemoveAllRules(ep1));
+    matches.clear();
+    table.Lock();
+    table.FindMatchingEndpoints(msg, matches);
+    table.Unlock();
+    ASSERT_EQ(1U, matches.size());
+    EXPECT_TRUE(*matches.begin() == ep2);
+
+    EXPECT_EQ(ER_BUS_MATCH_RULE_NOT_FOUND, table.RemoveRule(ep1, memberRule));
+    EXPECT_EQ(ER_OK, table.RemoveRule(ep2, ifaceRule));
+    matches.clear();
+    table.Lock();
+    table.FindMatchingEndpoints(msg, matches);
+    table.Unlock();
+    EXPECT_EQ(0U, matches.size());
+}
+
+/*
+ * Route signals against 10k rules (1000 endpoints with 10 rules each) using
+ * both the indexed lookup and a full table scan and report the time for each.
+ */
+TEST(RuleTableTest, BroadcastRoutingBenchmark) {
+    const size_t numEndpoints = 1000;
+    const size_t rulesPerEndpoint = 10;
+    const size_t numSignals = 1000;
+
+    BusAttachment bus("RuleTableTest");
+    RuleTable table;
+    ASSERT_EQ(ER_OK, bus.Start());
+    vector<BusEndpoint> endpoints;
+
+    for (size_t i = 0; i < numEndpoints; ++i) {
+        BusEndpoint ep = MakeEndpoint();
+        endpoints.push_back(ep);
+        for (size_t r = 0; r < rulesPerEndpoint; ++r) {
+            String ruleStr = "type='signal',interface='org.test.I" + U32ToString(i * rulesPerEndpoint + r) + "',member='Sig'";
+            table.AddRule(ep, Rule(ruleStr.c_str()));
+        }
+    }
+    /* A few endpoints that want every signal */
+    for (size_t i = 0; i < 4; ++i) {
+        table.AddRule(endpoints[i], Rule("type='signal'"));
+    }
+
+    vector<Message> signals;
+    for (size_t i = 0; i < numSignals; ++i) {
+        String iface = "org.test.I" + U32ToString((i * 7919) % (numEndpoints * rulesPerEndpoint));
+        signals.push_back(MakeSignal(bus, "/test", iface.c_str(), "Sig"));
+    }
+
+    size_t indexedMatches = 0;
+    uint64_t start = GetTimestamp64();
+    table.Lock();
+    for (size_t i = 0; i < numSignals; ++i) {
+        set<BusEndpoint> matches;
+        table.FindMatchingEndpoints(signals[i], matches);
+        indexedMatches += matches.size();
+    }
+    table.Unlock();
+    uint64_t indexedTime = GetTimestamp64() - start;
+
+    size_t linearMatches = 0;
+    start = GetTimestamp64();
+    table.Lock();
+    for (size_t i = 0; i < numSignals; ++i) {
+        set<BusEndpoint> matches;
+        LinearMatch(table, signals[i], matches);
+        linearMatches += matches.size();
+    }
+    table.Unlock();
+    uint64_t linearTime = GetTimestamp64() - start;
+
+    EXPECT_EQ(linearMatches, indexedMatches);
+    printf("Routed %u signals against %u rules: indexed %u ms, linear scan %u ms\n",
+           (unsigned int)numSignals, (unsigned int)(numEndpoints * rulesPerEndpoint + 4),
+           (unsigned int)indexedTime, (unsigned int)linearTime);
+}
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include <qcc/String.h>
+#include <qcc/StringUtil.h>
 #include <qcc/Thread.h>
 
 #include <alljoyn/BusAttachment.h>
@@ -42,8 +43,8 @@ using namespace ajn;
 
 class TestObject : public BusObject {
   public:
-    TestObject(BusAttachment& bus)
-        : BusObject("/signals/test"), bus(bus) {
+    TestObject(BusAttachment& bus, const char* path = "/signals/test")
+        : BusObject(path), bus(bus) {
         const InterfaceDescription* Intf1 = bus.GetInterface("org.test");
         EXPECT_TRUE(Intf1 != NULL);
         AddInterface(*Intf1);
@@ -51,9 +52,9 @@ class TestObject : public BusObject {
 
     virtual ~TestObject() { }
 
-    QStatus SendSignal(const char* dest, SessionId id, uint8_t flags = 0) {
+    QStatus SendSignal(const char* dest, SessionId id, uint8_t flags = 0, const char* text = "Signal") {
         const InterfaceDescription::Member*  signal_member = bus.GetInterface("org.test")->GetMember("my_signal");
-        MsgArg arg("s", "Signal");
+        MsgArg arg("s", text);
         QStatus status = Signal(dest, id, *signal_member, &arg, 1, 0, flags);
         return status;
     }
@@ -471,3 +472,160 @@ TEST_F(SignalTest, Paths) {
     recvAn.verify_norecv();
     recvBn.verify_norecv();
 }
+
+class OrderReceiver : public SignalReceiver {
+  public:
+    OrderReceiver() : SignalReceiver(), outOfOrder(0), next(0) { }
+    virtual ~OrderReceiver() { }
+
+    virtual void RegisterSignalHandler(const InterfaceDescription::Member* member) {
+        QStatus status = participant->bus.RegisterSignalHandler(this,
+                                                                static_cast<MessageReceiver::SignalHandler>(&OrderReceiver::SignalHandler),
+                                                                member,
+                                                                NULL);
+        EXPECT_EQ(ER_OK, status) << "  Actual Status: " << QCC_StatusText(status);
+    }
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg) {
+        const char* text;
+        if ((msg->GetArgs("s", &text) != ER_OK) || (StringToU32(text) != next)) {
+            outOfOrder++;
+        }
+        next++;
+        signalReceived++;
+    }
+
+    int outOfOrder;
+    uint32_t next;
+};
+
+TEST_F(SignalTest, InOrderDelivery)
+{
+    Participant A("A.A");
+    Participant B("B.B");
+    OrderReceiver recvA;
+    recvA.Register(&A);
+
+    const int numSignals = 200;
+    for (int i = 0; i < numSignals; ++i) {
+        ASSERT_EQ(ER_OK, B.busobj->SendSignal("A.A", 0, 0, U32ToString(i).c_str()));
+    }
+    wait_for_signal();
+    recvA.verify_recv(numSignals);
+    EXPECT_EQ(0, recvA.outOfOrder);
+}
+
+TEST_F(SignalTest, InOrderDeliveryAcrossPaths)
+{
+    Participant A("A.A");
+    Participant B("B.B");
+    OrderReceiver recvA;
+    recvA.Register(&A);
+
+    /* Signals from one sender are delivered in order whichever object emitted them */
+    TestObject other(B.bus, "/signals/other");
+    ASSERT_EQ(ER_OK, B.bus.RegisterBusObject(other));
+
+    const int numSignals = 200;
+    for (int i = 0; i < numSignals; ++i) {
+        TestObject* emitter = (i % 2) ? &other : B.busobj;
+        ASSERT_EQ(ER_OK, emitter->SendSignal("A.A", 0, 0, U32ToString(i).c_str()));
+    }
+    wait_for_signal();
+    recvA.verify_recv(numSignals);
+    EXPECT_EQ(0, recvA.outOfOrder);
+    B.bus.UnregisterBusObject(other);
+}
+
+/* Emits a signal to the caller before replying to each ping */
+class PingObject : public BusObject {
+  public:
+    PingObject(BusAttachment& bus) : BusObject("/signals/ping") {
+        const InterfaceDescription* intf = bus.GetInterface("org.test.ping");
+        EXPECT_TRUE(intf != NULL);
+        AddInterface(*intf);
+        AddMethodHandler(intf->GetMember("ping"), static_cast<MessageReceiver::MethodHandler>(&PingObject::Ping));
+        pinged = intf->GetMember("pinged");
+    }
+
+    void Ping(const InterfaceDescription::Member* member, Message& msg) {
+        Signal(msg->GetSender(), 0, *pinged, msg->GetArg(0), 1);
+        MethodReply(msg, msg->GetArg(0), 1);
+    }
+
+    const InterfaceDescription::Member* pinged;
+};
+
+class PingReceiver : public MessageReceiver {
+  public:
+    PingReceiver() : signals(0), replies(0), outOfOrder(0) { }
+
+    void SignalHandler(const InterfaceDescription::Member* member, const char* sourcePath, Message& msg) {
+        uint32_t n = 0;
+        msg->GetArgs("u", &n);
+        /* A slow handler gives a reply that was queued separately the chance to overtake */
+        qcc::Sleep(2);
+        if (replies != n) {
+            outOfOrder++;
+        }
+        signals++;
+    }
+
+    void ReplyHandler(Message& msg, void* context) {
+        uint32_t n = 0;
+        msg->GetArgs("u", &n);
+        if (signals != n + 1) {
+            outOfOrder++;
+        }
+        replies++;
+    }
+
+    volatile int32_t signals;
+    volatile int32_t replies;
+    volatile int32_t outOfOrder;
+};
+
+TEST_F(SignalTest, SignalBeforeReply)
+{
+    Participant A("A.A");
+    Participant B("B.B");
+
+    InterfaceDescription* intf = NULL;
+    ASSERT_EQ(ER_OK, A.bus.CreateInterface("org.test.ping", intf));
+    ASSERT_EQ(ER_OK, intf->AddMethod("ping", "u", "u", "in,out", 0));
+    ASSERT_EQ(ER_OK, intf->AddSignal("pinged", "u", NULL, 0));
+    intf->Activate();
+    ASSERT_EQ(ER_OK, B.bus.CreateInterface("org.test.ping", intf));
+    ASSERT_EQ(ER_OK, intf->AddMethod("ping", "u", "u", "in,out", 0));
+    ASSERT_EQ(ER_OK, intf->AddSignal("pinged", "u", NULL, 0));
+    intf->Activate();
+
+    PingObject pingObj(B.bus);
+    ASSERT_EQ(ER_OK, B.bus.RegisterBusObject(pingObj));
+
+    PingReceiver receiver;
+    const InterfaceDescription* pingIntf = A.bus.GetInterface("org.test.ping");
+    ASSERT_EQ(ER_OK, A.bus.RegisterSignalHandler(&receiver, static_cast<MessageReceiver::SignalHandler>(&PingReceiver::SignalHandler),
+                                                 pingIntf->GetMember("pinged"), NULL));
+
+    ProxyBusObject proxy(A.bus, "B.B", "/signals/ping", 0);
+    ASSERT_EQ(ER_OK, proxy.AddInterface(*pingIntf));
+
+    /* Each reply must be handled after the signal that was sent ahead of it */
+    const uint32_t numPings = 50;
+    for (uint32_t i = 0; i < numPings; ++i) {
+        MsgArg arg("u", i);
+        ASSERT_EQ(ER_OK, proxy.MethodCallAsync("org.test.ping", "ping", &receiver,
+                                               static_cast<MessageReceiver::ReplyHandler>(&PingReceiver::ReplyHandler), &arg, 1));
+    }
+    for (int i = 0; (i < 500) && (receiver.replies < static_cast<int32_t>(numPings)); ++i) {
+        qcc::Sleep(10);
+    }
+    EXPECT_EQ(static_cast<int32_t>(numPings), receiver.signals);
+    EXPECT_EQ(static_cast<int32_t>(numPings), receiver.replies);
+    EXPECT_EQ(0, receiver.outOfOrder);
+
+    A.bus.UnregisterSignalHandler(&receiver, static_cast<MessageReceiver::SignalHandler>(&PingReceiver::SignalHandler),
+                                  pingIntf->GetMember("pinged"), NULL);
+    B.bus.UnregisterBusObject(pingObj);
+}
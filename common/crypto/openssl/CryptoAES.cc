@@ -26,7 +26,11 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
+#include <vector>
 
+#include <qcc/Debug.h>
+#include <qcc/Mutex.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Crypto.h>
@@ -42,20 +46,92 @@ using namespace qcc;
 
 namespace qcc {
 
-#ifdef CCM_TRACE
-static void Trace(const char* tag, void* data, size_t len)
-{
-    qcc::String s = BytesToHexString((uint8_t*)data, len, false, ' ');
-    printf("%s %s\n", tag, s.c_str());
-}
-#else
-#define Trace(x, y, z)
-#endif
-
 struct Crypto_AES::KeyState {
+    /*
+     * An OpenSSL CCM context is configured with the nonce length, the tag length, and the
+     * direction before the key is set so we keep track of what each pooled context was keyed for.
+     */
+    struct CCMContext {
+        EVP_CIPHER_CTX* ctx;
+        uint8_t L;
+        uint8_t M;
+        bool encrypt;
+    };
+
+    KeyState() : cipher(NULL) { }
+
+    ~KeyState() {
+        while (!ccmPool.empty()) {
+            EVP_CIPHER_CTX_free(ccmPool.back().ctx);
+            ccmPool.pop_back();
+        }
+        memset(keyData, 0, sizeof(keyData));
+    }
+
+    /*
+     * Get a CCM context keyed for the nonce length, tag length, and direction requested. Contexts
+     * are pooled so the key schedule is expanded once per context rather than once per message,
+     * and so that multiple threads can encrypt or decrypt with the same key at the same time.
+     */
+    EVP_CIPHER_CTX* AcquireCCM(uint8_t L, uint8_t M, bool encrypt);
+
+    /*
+     * Return a context obtained from AcquireCCM() to the pool.
+     */
+    void ReleaseCCM(EVP_CIPHER_CTX* ctx, uint8_t L, uint8_t M, bool encrypt);
+
+    /* Key schedule for the ECB modes */
     AES_KEY key;
+
+    /* Cipher and raw key for CCM mode */
+    const EVP_CIPHER* cipher;
+    uint8_t keyData[32];
+
+    /* Idle keyed CCM contexts */
+    std::vector<CCMContext> ccmPool;
+    Mutex ccmLock;
 };
 
+EVP_CIPHER_CTX* Crypto_AES::KeyState::AcquireCCM(uint8_t L, uint8_t M, bool encrypt)
+{
+    EVP_CIPHER_CTX* ctx = NULL;
+    ccmLock.Lock(MUTEX_CONTEXT);
+    for (size_t i = ccmPool.size(); i > 0; --i) {
+        const CCMContext& ccm = ccmPool[i - 1];
+        if ((ccm.L == L) && (ccm.M == M) && (ccm.encrypt == encrypt)) {
+            ctx = ccm.ctx;
+            ccmPool.erase(ccmPool.begin() + (i - 1));
+            break;
+        }
+    }
+    ccmLock.Unlock(MUTEX_CONTEXT);
+    if (ctx) {
+        return ctx;
+    }
+    /*
+     * The tag length can only be set without a tag value while encrypting so the direction is
+     * chosen when the key is set.
+     */
+    ctx = EVP_CIPHER_CTX_new();
+    if (!ctx ||
+        (EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, 1) != 1) ||
+        (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_IVLEN, 15 - L, NULL) != 1) ||
+        (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_TAG, M, NULL) != 1) ||
+        (EVP_CipherInit_ex(ctx, NULL, NULL, keyData, NULL, encrypt ? 1 : 0) != 1)) {
+        EVP_CIPHER_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void Crypto_AES::KeyState::ReleaseCCM(EVP_CIPHER_CTX* ctx, uint8_t L, uint8_t M, bool encrypt)
+{
+    CCMContext ccm = { ctx, L, M, encrypt };
+    ccmLock.Lock(MUTEX_CONTEXT);
+    ccmPool.push_back(ccm);
+    ccmLock.Unlock(MUTEX_CONTEXT);
+}
+
 Crypto_AES::Crypto_AES(const KeyBlob& key, Mode mode) : mode(mode), keyState(new KeyState())
 {
     /*
@@ -63,7 +139,26 @@ Crypto_AES::Crypto_AES(const KeyBlob& key, Mode mode) : mode(mode), keyState(new
      */
     OpenSsl_ScopedLock lock;
 
-    if ((mode == ECB_ENCRYPT) || (mode == CCM)) {
+    if (mode == CCM) {
+        switch (key.GetSize()) {
+        case 16:
+            keyState->cipher = EVP_aes_128_ccm();
+            break;
+
+        case 24:
+            keyState->cipher = EVP_aes_192_ccm();
+            break;
+
+        case 32:
+            keyState->cipher = EVP_aes_256_ccm();
+            break;
+
+        default:
+            QCC_LogError(ER_CRYPTO_ERROR, ("Invalid AES key length %u", static_cast<unsigned int>(key.GetSize())));
+            return;
+        }
+        memcpy(keyState->keyData, key.GetData(), key.GetSize());
+    } else if (mode == ECB_ENCRYPT) {
         AES_set_encrypt_key((unsigned char*)key.GetData(), key.GetSize() * 8, &keyState->key);
     } else {
         AES_set_decrypt_key((unsigned char*)key.GetData(), key.GetSize() * 8, &keyState->key);
@@ -192,95 +287,6 @@ QStatus Crypto_AES::Decrypt(const Block* in, uint32_t numBlocks, void* out, size
 }
 
 
-static void Compute_CCM_AuthField(AES_KEY* key, Crypto_AES::Block& T, uint8_t M, uint8_t L, const KeyBlob& nonce, const uint8_t* mData, size_t mLen, const uint8_t* addData, size_t addLen)
-{
-    uint8_t flags = ((addLen) ? 0x40 : 0) | (((M - 2) / 2) << 3) | (L - 1);
-    /*
-     * Compute the B_0 block. This encodes the flags, the nonce, and the data length.
-     */
-    Crypto_AES::Block B_0(0);
-    B_0.data[0] = flags;
-    memset(&B_0.data[1], 0, 15 - L);
-    memcpy(&B_0.data[1], nonce.GetData(), min((size_t)15, nonce.GetSize()));
-    for (size_t i = 15, l = mLen; l != 0; i--) {
-        B_0.data[i] = (uint8_t)(l & 0xFF);
-        l >>= 8;
-    }
-    /*
-     * Initialize CBC-MAC with B_0 initialization vector is 0.
-     */
-    Crypto_AES::Block ivec(0);
-    Trace("CBC IV in: ", B_0.data, sizeof(B_0.data));
-    AES_cbc_encrypt(B_0.data, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-    Trace("CBC IV out:", T.data, sizeof(T.data));
-    /*
-     * Compute CBC-MAC for the add data.
-     */
-    if (addLen) {
-        /*
-         * This encodes the add data length and the first few octets of the add data
-         */
-        Crypto_AES::Block A;
-        size_t initialLen;
-        if (addLen < ((1 << 16) - (1 << 8))) {
-            A.data[0] = (uint8_t)(addLen >> 8);
-            A.data[1] = (uint8_t)(addLen >> 0);
-            initialLen = min(addLen, sizeof(A.data) - 2);
-            memcpy(&A.data[2], addData, initialLen);
-            A.Pad(16 - initialLen - 2);
-        } else {
-            A.data[0] = 0xFF;
-            A.data[1] = 0xFE;
-            A.data[2] = (uint8_t)(addLen >> 24);
-            A.data[3] = (uint8_t)(addLen >> 16);
-            A.data[4] = (uint8_t)(addLen >> 8);
-            A.data[5] = (uint8_t)(addLen >> 0);
-            initialLen = sizeof(A.data) - 6;
-            memcpy(&A.data[6], addData, initialLen);
-        }
-        addData += initialLen;
-        addLen -= initialLen;
-        /*
-         * Continue computing the CBC-MAC
-         */
-        AES_cbc_encrypt(A.data, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-        Trace("After AES: ", T.data, sizeof(T.data));
-        while (addLen >= sizeof(Crypto_AES::Block)) {
-            AES_cbc_encrypt(addData, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-            Trace("After AES: ", T.data, sizeof(T.data));
-            addData += sizeof(Crypto_AES::Block);
-            addLen -= sizeof(Crypto_AES::Block);
-        }
-        if (addLen) {
-            memcpy(A.data, addData, addLen);
-            A.Pad(16 - addLen);
-            AES_cbc_encrypt(A.data, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-            Trace("After AES: ", T.data, sizeof(T.data));
-        }
-
-    }
-    /*
-     * Continue computing CBC-MAC over the message data.
-     */
-    if (mLen) {
-        while (mLen >= sizeof(Crypto_AES::Block)) {
-            AES_cbc_encrypt(mData, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-            Trace("After AES: ", T.data, sizeof(T.data));
-            mData += sizeof(Crypto_AES::Block);
-            mLen -= sizeof(Crypto_AES::Block);
-        }
-        if (mLen) {
-            Crypto_AES::Block final;
-            memcpy(final.data, mData, mLen);
-            final.Pad(16 - mLen);
-            AES_cbc_encrypt(final.data, T.data, sizeof(T.data), key, ivec.data, AES_ENCRYPT);
-            Trace("After AES: ", T.data, sizeof(T.data));
-        }
-    }
-    Trace("CBC-MAC:   ", T.data, M);
-}
-
-
 static inline uint8_t LengthOctetsFor(size_t len)
 {
     if (len <= 0xFFFF) {
@@ -293,7 +299,8 @@ static inline uint8_t LengthOctetsFor(size_t len)
 }
 
 /*
- * Implementation of AES-CCM (Counter with CBC-MAC) as described in RFC 3610
+ * Implementation of AES-CCM (Counter with CBC-MAC) as described in RFC 3610. Nonces shorter than 11
+ * bytes are zero padded to 11 bytes.
  */
 QStatus Crypto_AES::Encrypt_CCM(const void* in, void* out, size_t& len, const KeyBlob& nonce, const void* addData, size_t addLen, uint8_t authLen)
 {
@@ -304,7 +311,7 @@ QStatus Crypto_AES::Encrypt_CCM(const void* in, void* out, size_t& len, const Ke
     /*
      * Check we are initialized for CCM
      */
-    if (mode != CCM) {
+    if ((mode != CCM) || !keyState->cipher) {
         return ER_CRYPTO_ERROR;
     }
     size_t nLen = nonce.GetSize();
@@ -317,34 +324,39 @@ QStatus Crypto_AES::Encrypt_CCM(const void* in, void* out, size_t& len, const Ke
     if (nLen < 4 || nLen > 14) {
         return ER_BAD_ARG_4;
     }
-    if ((authLen < 4) || (authLen > 16)) {
+    if ((authLen < 4) || (authLen > 16) || (authLen & 1)) {
         return ER_BAD_ARG_8;
     }
     const uint8_t L = 15 - (uint8_t)max(nLen, (size_t)11);
-    if (L < LengthOctetsFor(len)) {
+    if ((L < LengthOctetsFor(len)) || (len > INT_MAX)) {
         return ER_BAD_ARG_3;
     }
-    /*
-     * Compute the authentication field T.
-     */
-    Block T;
-    Compute_CCM_AuthField(&keyState->key, T, authLen, L, nonce, (uint8_t*)in, len, (uint8_t*)addData, addLen);
-    /*
-     * Initialize ivec and other initial args.
-     */
+    if (addLen > INT_MAX) {
+        return ER_BAD_ARG_6;
+    }
+    EVP_CIPHER_CTX* ctx = keyState->AcquireCCM(L, authLen, true);
+    if (!ctx) {
+        QCC_LogError(ER_CRYPTO_ERROR, ("Failed to initialize AES-CCM context"));
+        return ER_CRYPTO_ERROR;
+    }
     Block ivec(0);
-    ivec.data[0] = (L - 1);
-    memcpy(&ivec.data[1], nonce.GetData(), nLen);
-    unsigned int num = 0;
-    Block ecount_buf(0);
+    memcpy(ivec.data, nonce.GetData(), nLen);
     /*
-     * Encrypt the authentication field
+     * OpenSSL needs non-NULL data pointers even for a zero length message.
      */
-    Block U;
-    AES_ctr128_encrypt(T.data, U.data, 16, &keyState->key, ivec.data, ecount_buf.data, &num);
-    Trace("CTR Start: ", ivec.data, 16);
-    AES_ctr128_encrypt((const uint8_t*)in, (uint8_t*)out, len, &keyState->key, ivec.data, ecount_buf.data, &num);
-    memcpy((uint8_t*)out + len, U.data, authLen);
+    uint8_t empty;
+    int outl;
+    bool ok = (EVP_CipherInit_ex(ctx, NULL, NULL, NULL, ivec.data, 1) == 1) &&
+              (EVP_CipherUpdate(ctx, NULL, &outl, NULL, (int)len) == 1) &&
+              (!addLen || (EVP_CipherUpdate(ctx, NULL, &outl, (const uint8_t*)addData, (int)addLen) == 1)) &&
+              (EVP_CipherUpdate(ctx, len ? (uint8_t*)out : &empty, &outl, len ? (const uint8_t*)in : &empty, (int)len) == 1) &&
+              (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_GET_TAG, authLen, (uint8_t*)out + len) == 1);
+    if (!ok) {
+        EVP_CIPHER_CTX_free(ctx);
+        QCC_LogError(ER_CRYPTO_ERROR, ("AES-CCM encryption failed"));
+        return ER_CRYPTO_ERROR;
+    }
+    keyState->ReleaseCCM(ctx, L, authLen, true);
     len += authLen;
     return ER_OK;
 }
@@ -359,7 +371,7 @@ QStatus Crypto_AES::Decrypt_CCM(const void* in, void* out, size_t& len, const Ke
     /*
      * Check we are initialized for CCM
      */
-    if (mode != CCM) {
+    if ((mode != CCM) || !keyState->cipher) {
         return ER_CRYPTO_ERROR;
     }
     size_t nLen = nonce.GetSize();
@@ -372,41 +384,49 @@ QStatus Crypto_AES::Decrypt_CCM(const void* in, void* out, size_t& len, const Ke
     if (nLen < 4 || nLen > 14) {
         return ER_BAD_ARG_4;
     }
-    if ((authLen < 4) || (authLen > 16)) {
+    if ((authLen < 4) || (authLen > 16) || (authLen & 1)) {
         return ER_BAD_ARG_8;
     }
     const uint8_t L = 15 - (uint8_t)max(nLen, (size_t)11);
-    if (L < LengthOctetsFor(len)) {
+    if ((L < LengthOctetsFor(len)) || (len > INT_MAX)) {
         return ER_BAD_ARG_3;
     }
-    /*
-     * Initialize ivec and other initial args.
-     */
+    if (addLen > INT_MAX) {
+        return ER_BAD_ARG_6;
+    }
+    EVP_CIPHER_CTX* ctx = keyState->AcquireCCM(L, authLen, false);
+    if (!ctx) {
+        QCC_LogError(ER_CRYPTO_ERROR, ("Failed to initialize AES-CCM context"));
+        return ER_CRYPTO_ERROR;
+    }
     Block ivec(0);
-    ivec.data[0] = (L - 1);
-    memcpy(&ivec.data[1], nonce.GetData(), nLen);
-    unsigned int num = 0;
-    Block ecount_buf(0);
+    memcpy(ivec.data, nonce.GetData(), nLen);
     /*
-     * Decrypt the authentication field
+     * Copy the authentication field out first because the decryption may be in place.
      */
-    Block U;
     Block T;
     len = len - authLen;
-    memcpy(U.data, (const uint8_t*)in + len, authLen);
-    AES_ctr128_encrypt(U.data, T.data, sizeof(T.data), &keyState->key, ivec.data, ecount_buf.data, &num);
-    /*
-     * Decrypt message.
-     */
-    AES_ctr128_encrypt((const uint8_t*)in, (uint8_t*)out, len, &keyState->key, ivec.data, ecount_buf.data, &num);
+    memcpy(T.data, (const uint8_t*)in + len, authLen);
+    uint8_t empty;
+    int outl;
+    bool ok = (EVP_CipherInit_ex(ctx, NULL, NULL, NULL, ivec.data, 0) == 1) &&
+              (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_TAG, authLen, T.data) == 1) &&
+              (EVP_CipherUpdate(ctx, NULL, &outl, NULL, (int)len) == 1) &&
+              (!addLen || (EVP_CipherUpdate(ctx, NULL, &outl, (const uint8_t*)addData, (int)addLen) == 1));
+    if (!ok) {
+        EVP_CIPHER_CTX_free(ctx);
+        QCC_LogError(ER_CRYPTO_ERROR, ("AES-CCM decryption failed"));
+        len = 0;
+        return ER_CRYPTO_ERROR;
+    }
     /*
-     * Compute and verify the authentication field T.
+     * The authentication field is verified as part of the decryption.
      */
-    Block F;
-    Compute_CCM_AuthField(&keyState->key, F, authLen, L, nonce, (uint8_t*)out, len, (uint8_t*)addData, addLen);
-    if (memcmp(F.data, T.data, authLen) == 0) {
+    if (EVP_CipherUpdate(ctx, len ? (uint8_t*)out : &empty, &outl, len ? (const uint8_t*)in : &empty, (int)len) > 0) {
+        keyState->ReleaseCCM(ctx, L, authLen, false);
         return ER_OK;
     } else {
+        EVP_CIPHER_CTX_free(ctx);
         /* Clear the decrypted data */
         memset(out, 0, len + authLen);
         len = 0;
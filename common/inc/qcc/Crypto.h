@@ -341,6 +341,9 @@ class Crypto_AES  {
     /**
      * CryptoAES constructor.
      *
+     * The key is expanded once when it is first used so an instance should be kept for as long as
+     * the key is in use. An instance constructed for CCM mode may be shared by multiple threads.
+     *
      * @param key   The AES key
      * @param mode  Specifies the operation mode.
      */
@@ -437,7 +440,7 @@ class Crypto_AES  {
      *                    component that is different for every encryption in a given session.
      * @param addData     Additional data to be authenticated.
      * @param addLen      Length of the additional data.
-     * @param authLen     Lengh of the authentication field, must be in range 4..16
+     * @param authLen     Length of the authentication field, must be an even number in range 4..16
      *
      * @return ER_OK if the data was encrypted.
      */
@@ -453,7 +456,7 @@ class Crypto_AES  {
      * @param hdrLen   Length in bytes of the header portion of the message
      * @param nonce    A nonce with length between 4 and 14 bytes. The nonce must contain a variable
      *                 component that is different for every encryption in a given session.
-     * @param authLen  Lengh of the authentication field, must be in range 4..16
+     * @param authLen  Length of the authentication field, must be an even number in range 4..16
      */
     QStatus Encrypt_CCM(void* msg, size_t& msgLen, size_t hdrLen, const KeyBlob& nonce, uint8_t authLen = 8)
     {
@@ -479,7 +482,7 @@ class Crypto_AES  {
      *                    component that is different for every encryption in a given session.
      * @param addData     Additional data to be authenticated.
      * @param addLen      Length of the additional data.
-     * @param authLen     Length of the authentication field, must be in range 4..16
+     * @param authLen     Length of the authentication field, must be an even number in range 4..16
      *
      * @return ER_OK if the data was decrypted and verified.
      *         ER_AUTH_FAIL if the decryption failed.
@@ -495,7 +498,7 @@ class Crypto_AES  {
      * @param hdrLen   Length in bytes of the header portion of the message
      * @param nonce    A nonce with length between 11 and 14 bytes. The nonce must contain a variable
      *                 component that is different for every encryption in a given session.
-     * @param authLen  Lengh of the authentication field, must be in range 4..16
+     * @param authLen  Length of the authentication field, must be an even number in range 4..16
      */
     QStatus Decrypt_CCM(void* msg, size_t& msgLen, size_t hdrLen, const KeyBlob& nonce, uint8_t authLen = 8)
     {
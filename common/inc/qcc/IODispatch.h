@@ -28,6 +28,7 @@
 #include <qcc/Timer.h>
 #include <Status.h>
 #include <map>
+#include <vector>
 namespace qcc {
 
 /* Forward References */
@@ -201,6 +202,24 @@ class IODispatch : public Thread, public AlarmListener {
     IODispatch(const char* name, uint32_t concurrency);
     ~IODispatch();
 
+    /**
+     * Dispatch streams from a number of independent event loops instead of the single
+     * IODispatch thread. Each event loop owns the streams that hash to it and has a
+     * dedicated pair of reader/writer threads, pinned to a core, that wait on a persistent
+     * epoll set. Write callbacks are made directly by the writer thread. Read callbacks and
+     * timeout callbacks are made by a pool of concurrency worker threads per event loop so
+     * a read callback that blocks does not stall the other streams. Read and write timeouts
+     * are tracked by the event loops; the timer is only used for exit callbacks.
+     *
+     * Must be called before Start(). Only supported on Linux.
+     *
+     * @param numLoops   Number of event loops or 0 to use the single IODispatch thread.
+     *
+     * @return  ER_OK if successful.
+     *          ER_NOT_IMPLEMENTED if event loops are not supported on this platform.
+     */
+    QStatus SetEventLoops(uint32_t numLoops);
+
     /**
      * Start the IODispatch and timer.
      *
@@ -323,6 +342,15 @@ class IODispatch : public Thread, public AlarmListener {
     virtual ThreadReturn STDCALL Run(void* arg);
 
   private:
+    class EventLoop;
+    class EventPoller;
+    class EventWorker;
+
+    /**
+     * Get the event loop that a stream is assigned to.
+     */
+    EventLoop* GetEventLoop(const Stream* stream) const;
+
     Timer timer;                                /* The timer used to add and process callbacks */
     Mutex lock;                                 /* Lock for mutual exclusion of dispatchEntries */
     std::map<Stream*, IODispatchEntry> dispatchEntries; /* map holding details of various streams registered with this IODispatch */
@@ -334,6 +362,8 @@ class IODispatch : public Thread, public AlarmListener {
      * is waiting on it.
      */
     bool crit;
+    uint32_t concurrency;                       /* Number of concurrent callbacks per event loop */
+    std::vector<EventLoop*> eventLoops;         /* Event loops used instead of the Run thread, if any */
     static int32_t iodispatchCnt;
 };
 
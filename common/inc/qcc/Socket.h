@@ -257,6 +257,60 @@ QStatus Recv(SocketFd sockfd, void* buf, size_t len, size_t& received);
 QStatus RecvFrom(SocketFd sockfd, IPAddress& remoteAddr, uint16_t& remotePort,
                  void* buf, size_t len, size_t& received);
 
+/**
+ * One slot of a batched datagram receive.  The caller owns buf and len;
+ * RecvFromBatch() fills in received, remoteAddr and remotePort.
+ */
+struct Datagram {
+    void* buf;              ///< Buffer where the datagram will be stored.
+    size_t len;             ///< Size of buf in octets.
+    size_t received;        ///< OUT: Octets received (0 if the datagram was truncated).
+    IPAddress remoteAddr;   ///< OUT: IP Address of remote host.
+    uint16_t remotePort;    ///< OUT: IP Port on remote host.
+};
+
+/**
+ * Receive as many datagrams as are immediately available on a socket, up to
+ * count, without blocking.  On Linux this is a single recvmmsg() call.
+ *
+ * @param sockfd        Socket descriptor.
+ * @param datagrams     Array of count datagram slots.
+ * @param count         Number of slots in datagrams.
+ * @param received      OUT: Number of slots that were filled.
+ *
+ * @return  ER_OK if at least one datagram was received, ER_WOULDBLOCK if none
+ *          was available, otherwise an error status.
+ */
+QStatus RecvFromBatch(SocketFd sockfd, Datagram* datagrams, size_t count, size_t& received);
+
+/**
+ * One datagram of a batched send.  The payload is the concatenation of the
+ * numIov buffers in iov; the caller keeps them valid until SendToBatch()
+ * returns.
+ */
+struct OutDatagram {
+    const IOVec* iov;       ///< Buffers making up the datagram.
+    size_t numIov;          ///< Number of entries in iov.
+    IPAddress remoteAddr;   ///< IP Address of remote host.
+    uint16_t remotePort;    ///< IP Port on remote host.
+};
+
+/**
+ * Send a batch of datagrams, in order, on a socket.  On Linux this is
+ * sendmmsg(), and consecutive datagrams of equal size to the same peer are
+ * handed to the kernel as a single UDP_SEGMENT (GSO) super-datagram where
+ * the kernel supports it.
+ *
+ * @param sockfd        Socket descriptor.
+ * @param datagrams     Array of count datagrams.
+ * @param count         Number of entries in datagrams.
+ * @param sent          OUT: Number of leading datagrams that were sent.
+ *
+ * @return  ER_OK if every datagram was sent, ER_WOULDBLOCK if the socket
+ *          filled up after the first sent datagrams, otherwise an error status.
+ */
+QStatus SendToBatch(SocketFd sockfd, const OutDatagram* datagrams, size_t count, size_t& sent);
+
 /**
  * Receive a buffer of data and ancillary data from a remote host on a socket.
  *
@@ -305,6 +359,20 @@ QStatus RecvWithFds(SocketFd sockfd, void* buf, size_t len, size_t& received, So
  */
 QStatus SendWithFds(SocketFd sockfd, const void* buf, size_t len, size_t& sent, SocketFd* fdList, size_t numFds, uint32_t pid);
 
+/**
+ * Send the data held in several buffers over a socket with a single system call.
+ *
+ * @param sockfd    Socket descriptor.
+ * @param iov       Array of buffers containing the data to send.
+ * @param numIov    Number of entries in iov, at most QCC_MAX_SG_ENTRIES.
+ * @param sent      [OUT] Number of octets sent.
+ *
+ * @return  #ER_OK if the send succeeded
+ *          #ER_WOULDBLOCK if the socket is non-blocking and data cannot be sent at this time.
+ *          #ER_OS_ERROR if the send failed
+ */
+QStatus SendV(SocketFd sockfd, const IOVec* iov, size_t numIov, size_t& sent);
+
 /**
  * Set a socket to blocking or not blocking.
  *
@@ -143,6 +143,16 @@ class SocketStream : public Stream {
      */
     QStatus PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, SocketFd* fdList, size_t numFds, uint32_t pid = -1);
 
+    /**
+     * Push the bytes held in several buffers into the sink with a single write.
+     *
+     * @param iov       Array of buffers to push.
+     * @param numIov    Number of entries in iov.
+     * @param numSent   [OUT] Number of bytes actually consumed by sink.
+     * @return   ER_OK if successful.
+     */
+    QStatus PushBytesV(const IOVec* iov, size_t numIov, size_t& numSent);
+
     /**
      * Get the Event indicating that data is available.
      *
@@ -147,6 +147,18 @@ class Sink {
      */
     virtual QStatus PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, SocketFd* fdList, size_t numFds, uint32_t pid = -1) { return ER_NOT_IMPLEMENTED; }
 
+    /**
+     * Push the bytes held in several buffers into the sink. Sinks that implement this consume
+     * all of the buffers with a single write so several small messages can be sent at once.
+     *
+     * @param iov       Array of buffers to push, the buffers are consumed in order.
+     * @param numIov    Number of entries in iov.
+     * @param numSent   [OUT] Number of bytes actually consumed by sink.
+     *
+     * @return  ER_OK if successful. ER_NOT_IMPLEMENTED if the sink cannot gather writes.
+     */
+    virtual QStatus PushBytesV(const IOVec* iov, size_t numIov, size_t& numSent) { return ER_NOT_IMPLEMENTED; }
+
     /**
      * Get the Event that indicates when data can be pushed to sink.
      *
@@ -48,6 +48,7 @@ namespace qcc {
 class Timer;
 class _Alarm;
 class TimerThread;
+class TimerWheel;
 
 /**
  * An alarm listener is capable of receiving alarm callbacks
@@ -79,6 +80,7 @@ class _Alarm : public OSAlarm {
     friend class TimerThread;
     friend class OSTimer;
     friend class CompareAlarm;
+    friend class TimerWheel;
 
   public:
 
@@ -148,12 +150,28 @@ class _Alarm : public OSAlarm {
 
   private:
 
+    /**
+     * Intrusive links used while the alarm is queued on a timing wheel.
+     * Copies of an alarm are never linked.
+     */
+    struct WheelLink {
+        WheelLink() : prev(NULL), next(NULL), wheel(NULL), list(0) { }
+        WheelLink(const WheelLink&) : prev(NULL), next(NULL), wheel(NULL), list(0) { }
+        WheelLink& operator=(const WheelLink&) { return *this; }
+
+        _Alarm* prev;
+        _Alarm* next;
+        TimerWheel* wheel;      /**< Wheel the alarm is queued on or NULL */
+        uint32_t list;          /**< Slot or list within the wheel */
+    };
+
     static int32_t nextId;
     Timespec alarmTime;
     AlarmListener* listener;
     uint32_t periodMs;
     mutable void* context;
     int32_t id;
+    mutable WheelLink wheelLink;
 };
 
 /**
@@ -167,6 +185,17 @@ class Timer : public OSTimer, public ThreadListener {
 
   public:
 
+    /**
+     * Data structure used to hold the pending alarms of a timer.
+     */
+    enum AlarmStore {
+        ALARM_SET,      /**< Ordered set. Alarms fire in exact time order; add and remove are O(log n) and allocate. */
+        ALARM_WHEEL     /**< Hierarchical timing wheel with 1ms resolution. Add and remove are O(1) and do not allocate;
+                             due alarms are expired in batches and alarms due in the same millisecond fire in the
+                             order they were added. Alarms are identified by object so RemoveAlarm must be passed
+                             (a reference to) the alarm that was added rather than a deep copy. */
+    };
+
     /**
      * Constructor
      *
@@ -175,8 +204,10 @@ class Timer : public OSTimer, public ThreadListener {
      * @param concurency         Dispatch up to this number of alarms concurently (using multiple threads).
      * @param prevenReentrancy   Prevent re-entrant call of AlarmTriggered.
      * @param maxAlarms          Maximum number of outstanding alarms allowed before blocking calls to AddAlarm or 0 for infinite.
+     * @param store              Data structure used to hold the pending alarms.
      */
-    Timer(qcc::String name, bool expireOnExit = false, uint32_t concurency = 1, bool preventReentrancy = false, uint32_t maxAlarms = 0);
+    Timer(qcc::String name, bool expireOnExit = false, uint32_t concurency = 1, bool preventReentrancy = false, uint32_t maxAlarms = 0,
+          AlarmStore store = ALARM_SET);
 
     /**
      * Destructor.
@@ -329,8 +360,18 @@ class Timer : public OSTimer, public ThreadListener {
 
   protected:
 
+    /* Operations on the pending alarms that hide which AlarmStore is in use. Called with lock held. */
+    size_t NumAlarms() const;
+    void InsertAlarm(const Alarm& alarm);
+    bool EraseAlarm(const Alarm& alarm);
+    bool IsNextAlarm(const Alarm& alarm) const;
+    Alarm PeekAlarm(const Timespec& now, Timespec& when);
+    bool TakeAlarm(const Alarm& alarm);
+    Alarm PopAlarm();
+
     Mutex lock;
     std::set<Alarm, std::less<Alarm> >  alarms;
+    TimerWheel* wheel;
     Alarm* currentAlarm;
     bool expireOnExit;
     std::vector<TimerThread*> timerThreads;
@@ -0,0 +1,107 @@
+/**
+ * @file
+ *
+ * Define a class that abstracts Linux condition variables.
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#ifndef _OS_QCC_CONDITION_H
+#define _OS_QCC_CONDITION_H
+
+#include <qcc/platform.h>
+
+#include <pthread.h>
+
+#include <qcc/Mutex.h>
+
+#include <Status.h>
+
+namespace qcc {
+
+/**
+ * The Linux implementation of a condition variable abstraction class.
+ *
+ * Unlike an Event, a Condition does not consume a file descriptor, so it can
+ * be embedded in objects that exist in large numbers.  It has no state of its
+ * own: a thread waits on a predicate protected by a Mutex and the thread that
+ * changes the predicate calls Signal() or Broadcast().  Since waits may return
+ * spuriously the predicate must be checked again when Wait() returns.
+ */
+class Condition {
+
+  public:
+    /**
+     * The constructor initializes the underlying condition variable.
+     */
+    Condition() { Init(); }
+
+    /**
+     * The destructor will destroy the underlying condition variable.  No
+     * thread may be waiting on it.
+     */
+    ~Condition();
+
+    /**
+     * Atomically release the mutex and wait for the condition to be signaled,
+     * then reacquire the mutex.  The mutex must be held exactly once by the
+     * calling thread; a recursively locked mutex would stay locked during the
+     * wait.
+     *
+     * @param mutex     The mutex protecting the predicate.
+     * @param timeout   Maximum time to wait in milliseconds, or
+     *                  Condition::WAIT_FOREVER to wait until signaled.
+     *
+     * @return  ER_OK if the condition was signaled (or the wait returned
+     *          spuriously), ER_TIMEOUT if the timeout expired, ER_INIT_FAILED
+     *          or ER_OS_ERROR if the underlying OS reports an error.
+     */
+    QStatus Wait(qcc::Mutex& mutex, uint32_t timeout = WAIT_FOREVER);
+
+    /**
+     * Wake one of the threads waiting on the condition, if there are any.
+     *
+     * @return  ER_OK if successful, ER_INIT_FAILED or ER_OS_ERROR otherwise.
+     */
+    QStatus Signal();
+
+    /**
+     * Wake all of the threads waiting on the condition.
+     *
+     * @return  ER_OK if successful, ER_INIT_FAILED or ER_OS_ERROR otherwise.
+     */
+    QStatus Broadcast();
+
+    /**
+     * Timeout value for waiting until the condition is signaled.
+     */
+    static const uint32_t WAIT_FOREVER = static_cast<uint32_t>(-1);
+
+  private:
+    /**
+     * Condition variables cannot be copied.
+     */
+    Condition(const Condition& other);
+    Condition& operator=(const Condition& other);
+
+    pthread_cond_t cond;    ///< The Linux condition variable implementation uses pthread condition variables.
+    bool isInitialized;     ///< true iff the condition variable was successfully initialized.
+    void Init();            ///< Initialize underlying OS condition variable
+};
+
+} /* namespace */
+
+#endif
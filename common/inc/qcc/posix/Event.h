@@ -183,6 +183,21 @@ class Event {
      */
     SocketFd GetFD() { return ioFd; }
 
+    /**
+     * Get the read end of the pipe backing a general purpose event. I/O events that also
+     * act as general purpose events have both this and an I/O file descriptor.
+     *
+     * @return  The pipe file descriptor or -1 if there is no pipe.
+     */
+    int GetGenPurposeFD() const { return fd; }
+
+    /**
+     * Get the type of this event.
+     *
+     * @return  The event type.
+     */
+    EventType GetEventType() const { return eventType; }
+
     /**
      * Get the number of threads that are currently blocked waiting for this event
      *
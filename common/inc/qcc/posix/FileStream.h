@@ -144,12 +144,14 @@ class FileSink : public Sink {
         PRIVATE = 0,        /**< Private to the calling user */
         WORLD_READABLE = 1, /**< World readable */
         WORLD_WRITABLE = 2, /**< World writable */
+        APPEND = 4          /**< Append to an existing file instead of truncating it */
     } Mode;
 
     /**
      * Create an FileSink.
      *
      * @param fileName     Name of file to use as sink.
+     * @param mode         File creation mode. Add APPEND to write to the end of an existing file.
      */
     FileSink(qcc::String fileName, Mode mode = WORLD_READABLE);
 
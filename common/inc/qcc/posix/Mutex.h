@@ -95,6 +95,8 @@ class Mutex {
     Mutex& operator=(const Mutex& other) { Init(); return *this; }
 
   private:
+    friend class Condition; ///< Condition::Wait() needs the OS mutex.
+
     pthread_mutex_t mutex;  ///< The Linux mutex implementation uses pthread mutex's.
     bool isInitialized;     ///< true iff mutex was successfully initialized.
     void Init();            ///< Initialize underlying OS mutex
@@ -95,6 +95,8 @@ class Mutex {
     Mutex& operator=(const Mutex& other) { Init(); return *this; }
 
   private:
+    friend class Condition; ///< Condition::Wait() needs the OS mutex.
+
     bool initialized;
     CRITICAL_SECTION mutex; ///< Mutex variable.
     void Init();            ///< initialize a mutex
@@ -48,6 +48,32 @@ inline int32_t DecrementAndFetch(volatile int32_t* mem) {
     return InterlockedDecrement(reinterpret_cast<volatile long*>(mem));
 }
 
+/**
+ * Atomically set an int32_t to a new value if it still holds an expected value. This is a full
+ * memory barrier.
+ *
+ * @param mem            Pointer to int32_t to be updated.
+ * @param expectedValue  Value *mem must hold for the update to happen.
+ * @param newValue       Value to store in *mem.
+ * @return  true if *mem held expectedValue and was updated.
+ */
+inline bool CompareAndExchange(volatile int32_t* mem, int32_t expectedValue, int32_t newValue) {
+    return InterlockedCompareExchange(reinterpret_cast<volatile long*>(mem), newValue, expectedValue) == expectedValue;
+}
+
+/**
+ * Atomically set a pointer to a new value if it still holds an expected value. This is a full
+ * memory barrier.
+ *
+ * @param mem            Pointer to the pointer to be updated.
+ * @param expectedValue  Value *mem must hold for the update to happen.
+ * @param newValue       Value to store in *mem.
+ * @return  true if *mem held expectedValue and was updated.
+ */
+inline bool CompareAndExchangePointer(void* volatile* mem, void* expectedValue, void* newValue) {
+    return InterlockedCompareExchangePointer(mem, newValue, expectedValue) == expectedValue;
+}
+
 }
 
 #endif
@@ -0,0 +1,141 @@
+/**
+ * @file
+ *
+ * Define a class that abstracts Linux condition variables.
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <assert.h>
+
+#include <qcc/Condition.h>
+
+#include <Status.h>
+
+/** @internal */
+#define QCC_MODULE "CONDITION"
+
+using namespace qcc;
+
+void Condition::Init()
+{
+    isInitialized = false;
+    int ret;
+    pthread_condattr_t attr;
+    ret = pthread_condattr_init(&attr);
+    if (ret != 0) {
+        fflush(stdout);
+        // Can't use QCC_LogError() since it uses mutexes under the hood.
+        printf("***** Condition attribute initialization failure: %d - %s\n", ret, strerror(ret));
+        return;
+    }
+#if defined(QCC_OS_LINUX)
+    // Timed waits must not be affected by changes to the wall clock.
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+
+    ret = pthread_cond_init(&cond, &attr);
+    if (ret != 0) {
+        fflush(stdout);
+        // Can't use QCC_LogError() since it uses mutexes under the hood.
+        printf("***** Condition initialization failure: %d - %s\n", ret, strerror(ret));
+    } else {
+        isInitialized = true;
+    }
+    pthread_condattr_destroy(&attr);
+}
+
+Condition::~Condition()
+{
+    if (!isInitialized) {
+        return;
+    }
+
+    int ret = pthread_cond_destroy(&cond);
+    if (ret != 0) {
+        fflush(stdout);
+        // Can't use QCC_LogError() since it uses mutexes under the hood.
+        printf("***** Condition destruction failure: %d - %s\n", ret, strerror(ret));
+        assert(false);
+    }
+}
+
+QStatus Condition::Wait(qcc::Mutex& mutex, uint32_t timeout)
+{
+    if (!isInitialized || !mutex.isInitialized) {
+        return ER_INIT_FAILED;
+    }
+
+    int ret;
+    if (timeout == WAIT_FOREVER) {
+        ret = pthread_cond_wait(&cond, &mutex.mutex);
+    } else {
+#if defined(QCC_OS_DARWIN)
+        struct timespec rel;
+        rel.tv_sec = timeout / 1000;
+        rel.tv_nsec = (timeout % 1000) * 1000000;
+        ret = pthread_cond_timedwait_relative_np(&cond, &mutex.mutex, &rel);
+#else
+        struct timespec abs;
+#if defined(QCC_OS_LINUX)
+        clock_gettime(CLOCK_MONOTONIC, &abs);
+#else
+        clock_gettime(CLOCK_REALTIME, &abs);
+#endif
+        abs.tv_sec += timeout / 1000;
+        abs.tv_nsec += (timeout % 1000) * 1000000;
+        if (abs.tv_nsec >= 1000000000) {
+            abs.tv_sec += 1;
+            abs.tv_nsec -= 1000000000;
+        }
+        ret = pthread_cond_timedwait(&cond, &mutex.mutex, &abs);
+#endif
+    }
+
+    if (ret == 0) {
+        return ER_OK;
+    } else if (ret == ETIMEDOUT) {
+        return ER_TIMEOUT;
+    }
+    fflush(stdout);
+    // Can't use QCC_LogError() since it uses mutexes under the hood.
+    printf("***** Condition wait failure: %d - %s\n", ret, strerror(ret));
+    assert(false);
+    return ER_OS_ERROR;
+}
+
+QStatus Condition::Signal()
+{
+    if (!isInitialized) {
+        return ER_INIT_FAILED;
+    }
+    return (pthread_cond_signal(&cond) == 0) ? ER_OK : ER_OS_ERROR;
+}
+
+QStatus Condition::Broadcast()
+{
+    if (!isInitialized) {
+        return ER_INIT_FAILED;
+    }
+    return (pthread_cond_broadcast(&cond) == 0) ? ER_OK : ER_OS_ERROR;
+}
@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
 #include <time.h>
 #include <unistd.h>
@@ -790,12 +791,15 @@ QStatus Event::SetEvent()
 
     if (GEN_PURPOSE == eventType) {
         char val = 's';
-        fd_set rdSet;
-        struct timeval tv;
-        tv.tv_sec = tv.tv_usec = 0;
-        FD_ZERO(&rdSet);
-        FD_SET(fd, &rdSet);
-        int ret = select(fd + 1, &rdSet, NULL, NULL, &tv);
+        /*
+         * Use poll() rather than select() to see if the event is already set
+         * since a busy process can easily have descriptors beyond FD_SETSIZE.
+         */
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, 0);
         if (ret == 0) {
             ret = write(signalFd, &val, sizeof(val));
         }
@@ -315,13 +315,25 @@ static uint32_t NetlinkRecv(int sockFd, char* buffer, int buflen)
             return nBytes;
         }
 
-        struct nlmsghdr* p = (struct nlmsghdr*)&buffer[nBytes];
-
-        if (p->nlmsg_type == NLMSG_DONE) {
-            break;
+        //
+        // Newer kernels may deliver the NLMSG_DONE that ends a dump in the
+        // same datagram as the last of the data, so look at every message we
+        // got rather than only the first.
+        //
+        bool done = false;
+        uint32_t len = tmp;
+        for (struct nlmsghdr* p = (struct nlmsghdr*)&buffer[nBytes]; NLMSG_OK(p, len); p = NLMSG_NEXT(p, len)) {
+            if (p->nlmsg_type == NLMSG_DONE) {
+                done = true;
+                break;
+            }
         }
 
         nBytes += tmp;
+
+        if (done) {
+            break;
+        }
     }
 
     return nBytes;
@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <net/if.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -640,6 +641,280 @@ QStatus RecvFrom(SocketFd sockfd, IPAddress& remoteAddr, uint16_t& remotePort,
     return status;
 }
 
+/*
+ * Decode a peer address without going through getnameinfo(), which formats
+ * the address as a string only to have IPAddress parse it straight back.
+ */
+static void DecodeSockAddr(const sockaddr_storage* addrBuf, IPAddress& addr, uint16_t& port)
+{
+    if (addrBuf->ss_family == AF_INET) {
+        const struct sockaddr_in* sa = reinterpret_cast<const struct sockaddr_in*>(addrBuf);
+        addr = IPAddress(reinterpret_cast<const uint8_t*>(&sa->sin_addr.s_addr), IPAddress::IPv4_SIZE);
+        port = ntohs(sa->sin_port);
+    } else if (addrBuf->ss_family == AF_INET6) {
+        const struct sockaddr_in6* sa = reinterpret_cast<const struct sockaddr_in6*>(addrBuf);
+        addr = IPAddress(reinterpret_cast<const uint8_t*>(&sa->sin6_addr.s6_addr), IPAddress::IPv6_SIZE);
+        port = ntohs(sa->sin6_port);
+    } else {
+        addr = IPAddress();
+        port = 0;
+    }
+}
+
+QStatus RecvFromBatch(SocketFd sockfd, Datagram* datagrams, size_t count, size_t& received)
+{
+    QCC_DbgTrace(("RecvFromBatch(sockfd = %d, datagrams = <>, count = %lu, received = <>)", sockfd, count));
+    assert(datagrams != NULL);
+    received = 0;
+
+#if defined(QCC_OS_LINUX)
+    const size_t MAX_BATCH = 64;
+    struct mmsghdr msgs[MAX_BATCH];
+    struct iovec iovs[MAX_BATCH];
+    struct sockaddr_storage addrs[MAX_BATCH];
+
+    if (count > MAX_BATCH) {
+        count = MAX_BATCH;
+    }
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (size_t i = 0; i < count; ++i) {
+        iovs[i].iov_base = datagrams[i].buf;
+        iovs[i].iov_len = datagrams[i].len;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+
+    int ret = recvmmsg(static_cast<int>(sockfd), msgs, count, MSG_DONTWAIT, NULL);
+    if (ret == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return ER_WOULDBLOCK;
+        }
+        QCC_DbgHLPrintf(("RecvFromBatch (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+
+    for (int i = 0; i < ret; ++i) {
+        Datagram& dg = datagrams[i];
+        dg.received = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : msgs[i].msg_len;
+        DecodeSockAddr(&addrs[i], dg.remoteAddr, dg.remotePort);
+        QCC_DbgRemoteData(dg.buf, dg.received);
+    }
+    received = static_cast<size_t>(ret);
+#else
+    while (received < count) {
+        Datagram& dg = datagrams[received];
+        struct sockaddr_storage addr;
+        socklen_t addrLen = sizeof(addr);
+        ssize_t ret = recvfrom(static_cast<int>(sockfd), dg.buf, dg.len, MSG_DONTWAIT,
+                               reinterpret_cast<struct sockaddr*>(&addr), &addrLen);
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (received == 0) {
+                QCC_DbgHLPrintf(("RecvFromBatch (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+                return ER_OS_ERROR;
+            }
+            break;
+        }
+        dg.received = static_cast<size_t>(ret);
+        DecodeSockAddr(&addr, dg.remoteAddr, dg.remotePort);
+        QCC_DbgRemoteData(dg.buf, dg.received);
+        ++received;
+    }
+#endif
+
+    return (received > 0) ? ER_OK : ER_WOULDBLOCK;
+}
+
+#if defined(QCC_OS_LINUX) && defined(UDP_SEGMENT)
+/*
+ * Largest segment size the kernel has accepted for UDP_SEGMENT.  A send that
+ * fails with EINVAL (typically a segment larger than the path MTU) lowers it
+ * so later batches stop trying; ENOPROTOOPT and friends turn offload off.
+ */
+static volatile size_t gsoSegmentLimit = 65507;
+#endif
+
+/*
+ * Send a single datagram with sendmsg().
+ */
+static QStatus SendDatagram(SocketFd sockfd, const OutDatagram& dg)
+{
+    struct sockaddr_storage addr;
+    socklen_t addrLen = sizeof(addr);
+    QStatus status = MakeSockAddr(dg.remoteAddr, dg.remotePort, &addr, addrLen);
+    if (status != ER_OK) {
+        return status;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = addrLen;
+    /* IOVec matches the layout of struct iovec */
+    msg.msg_iov = reinterpret_cast<struct iovec*>(const_cast<IOVec*>(dg.iov));
+    msg.msg_iovlen = dg.numIov;
+
+    if (sendmsg(static_cast<int>(sockfd), &msg, MSG_NOSIGNAL) == -1) {
+        if (errno == EAGAIN || errno == EINTR || errno == EWOULDBLOCK) {
+            return ER_WOULDBLOCK;
+        }
+        QCC_LogError(ER_OS_ERROR, ("SendToBatch (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    return ER_OK;
+}
+
+QStatus SendToBatch(SocketFd sockfd, const OutDatagram* datagrams, size_t count, size_t& sent)
+{
+    QCC_DbgTrace(("SendToBatch(sockfd = %d, datagrams = <>, count = %lu, sent = <>)", sockfd, count));
+    assert(datagrams != NULL);
+    sent = 0;
+
+#if defined(QCC_OS_LINUX)
+    const size_t MAX_BATCH = 64;
+    const size_t MAX_IOVS = 256;
+    const size_t MAX_GSO_SEGMENTS = 64;
+    const size_t MAX_GSO_BYTES = 65507;
+    struct mmsghdr msgs[MAX_BATCH];
+    struct sockaddr_storage addrs[MAX_BATCH];
+    struct iovec iovs[MAX_IOVS];
+    size_t covers[MAX_BATCH];
+#if defined(UDP_SEGMENT)
+    char ctrl[MAX_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    bool gso = (gsoSegmentLimit > 0);
+#endif
+
+    while (sent < count) {
+        if (datagrams[sent].numIov > MAX_IOVS) {
+            /* Too many buffers to share the iovec array with other datagrams so send it alone */
+            QStatus status = SendDatagram(sockfd, datagrams[sent]);
+            if (status != ER_OK) {
+                return status;
+            }
+            ++sent;
+            continue;
+        }
+        size_t nmsgs = 0;
+        size_t niovs = 0;
+        size_t next = sent;
+        memset(msgs, 0, sizeof(msgs));
+
+        while (next < count && nmsgs < MAX_BATCH && niovs + datagrams[next].numIov <= MAX_IOVS) {
+            const OutDatagram& first = datagrams[next];
+            struct msghdr& hdr = msgs[nmsgs].msg_hdr;
+            socklen_t addrLen = sizeof(addrs[nmsgs]);
+            QStatus status = MakeSockAddr(first.remoteAddr, first.remotePort, &addrs[nmsgs], addrLen);
+            if (status != ER_OK) {
+                return status;
+            }
+            hdr.msg_name = &addrs[nmsgs];
+            hdr.msg_namelen = addrLen;
+            hdr.msg_iov = &iovs[niovs];
+
+            size_t segSize = 0;
+            for (size_t j = 0; j < first.numIov; ++j) {
+                iovs[niovs].iov_base = first.iov[j].buf;
+                iovs[niovs].iov_len = first.iov[j].len;
+                segSize += first.iov[j].len;
+                QCC_DbgLocalData(first.iov[j].buf, first.iov[j].len);
+                ++niovs;
+            }
+            size_t total = segSize;
+            size_t segments = 1;
+            ++next;
+
+#if defined(UDP_SEGMENT)
+            /*
+             * Fold following datagrams to the same peer into this one while
+             * they are the same size; a shorter one may end the run.
+             */
+            while (gso && segSize <= gsoSegmentLimit && next < count && segments < MAX_GSO_SEGMENTS) {
+                const OutDatagram& dg = datagrams[next];
+                if (dg.remotePort != first.remotePort || !(dg.remoteAddr == first.remoteAddr) || niovs + dg.numIov > MAX_IOVS) {
+                    break;
+                }
+                size_t len = 0;
+                for (size_t j = 0; j < dg.numIov; ++j) {
+                    len += dg.iov[j].len;
+                }
+                if (len > segSize || total + len > MAX_GSO_BYTES) {
+                    break;
+                }
+                for (size_t j = 0; j < dg.numIov; ++j) {
+                    iovs[niovs].iov_base = dg.iov[j].buf;
+                    iovs[niovs].iov_len = dg.iov[j].len;
+                    QCC_DbgLocalData(dg.iov[j].buf, dg.iov[j].len);
+                    ++niovs;
+                }
+                total += len;
+                ++segments;
+                ++next;
+                if (len < segSize) {
+                    break;
+                }
+            }
+            if (segments > 1) {
+                hdr.msg_control = ctrl[nmsgs];
+                hdr.msg_controllen = sizeof(ctrl[nmsgs]);
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gsoSize = static_cast<uint16_t>(segSize);
+                memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+            }
+#endif
+            hdr.msg_iovlen = &iovs[niovs] - hdr.msg_iov;
+            covers[nmsgs] = segments;
+            ++nmsgs;
+        }
+
+        int ret = sendmmsg(static_cast<int>(sockfd), msgs, nmsgs, MSG_NOSIGNAL);
+        if (ret == -1) {
+            if (errno == EAGAIN || errno == EINTR || errno == EWOULDBLOCK) {
+                return ER_WOULDBLOCK;
+            }
+#if defined(UDP_SEGMENT)
+            if (covers[0] > 1) {
+                /* The offloaded send was refused; fall back to one datagram per message */
+                if (errno == EINVAL) {
+                    size_t rejected = 0;
+                    for (size_t j = 0; j < datagrams[sent].numIov; ++j) {
+                        rejected += datagrams[sent].iov[j].len;
+                    }
+                    gsoSegmentLimit = std::min(static_cast<size_t>(gsoSegmentLimit), rejected - 1);
+                } else if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+                    gsoSegmentLimit = 0;
+                }
+                QCC_DbgHLPrintf(("SendToBatch (sockfd = %u): UDP_SEGMENT refused: %d - %s", sockfd, errno, strerror(errno)));
+                gso = false;
+                continue;
+            }
+#endif
+            QCC_LogError(ER_OS_ERROR, ("SendToBatch (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+            return ER_OS_ERROR;
+        }
+        for (int i = 0; i < ret; ++i) {
+            sent += covers[i];
+        }
+    }
+#else
+    while (sent < count) {
+        QStatus status = SendDatagram(sockfd, datagrams[sent]);
+        if (status != ER_OK) {
+            return status;
+        }
+        ++sent;
+    }
+#endif
+
+    return ER_OK;
+}
+
 QStatus RecvWithAncillaryData(SocketFd sockfd, IPAddress& remoteAddr, uint16_t& remotePort, IPAddress& localAddr,
                               void* buf, size_t len, size_t& received, int32_t& interfaceIndex)
 {
@@ -835,6 +1110,33 @@ QStatus SendWithFds(SocketFd sockfd, const void* buf, size_t len, size_t& sent,
     return status;
 }
 
+QStatus SendV(SocketFd sockfd, const IOVec* iov, size_t numIov, size_t& sent)
+{
+    QStatus status = ER_OK;
+
+    QCC_DbgTrace(("SendV(sockfd = %d, iov = <>, numIov = %lu, sent = <>)", sockfd, numIov));
+    assert(iov != NULL);
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    /* IOVec matches the layout of struct iovec */
+    msg.msg_iov = reinterpret_cast<struct iovec*>(const_cast<IOVec*>(iov));
+    msg.msg_iovlen = numIov;
+
+    ssize_t ret = sendmsg(static_cast<int>(sockfd), &msg, MSG_NOSIGNAL);
+    if (ret == -1) {
+        if (errno == EAGAIN) {
+            status = ER_WOULDBLOCK;
+        } else {
+            status = ER_OS_ERROR;
+            QCC_DbgHLPrintf(("SendV (sockfd = %u): %d - %s", sockfd, errno, strerror(errno)));
+        }
+    } else {
+        sent = static_cast<size_t>(ret);
+    }
+    return status;
+}
+
 QStatus SocketPair(SocketFd(&sockets)[2])
 {
     int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
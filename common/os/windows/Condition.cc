@@ -0,0 +1,51 @@
+/**
+ * @file
+ *
+ * Define a class that abstracts Windows condition variables.
+ */
+
+/******************************************************************************
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <windows.h>
+#include <assert.h>
+
+#include <qcc/Condition.h>
+
+#include <Status.h>
+
+/** @internal */
+#define QCC_MODULE "CONDITION"
+
+using namespace qcc;
+
+QStatus Condition::Wait(qcc::Mutex& mutex, uint32_t timeout)
+{
+    if (!mutex.initialized) {
+        return ER_INIT_FAILED;
+    }
+
+    DWORD ms = (timeout == WAIT_FOREVER) ? INFINITE : timeout;
+    if (SleepConditionVariableCS(&cond, &mutex.mutex, ms)) {
+        return ER_OK;
+    }
+    if (GetLastError() == ERROR_TIMEOUT) {
+        return ER_TIMEOUT;
+    }
+    assert(false);
+    return ER_OS_ERROR;
+}
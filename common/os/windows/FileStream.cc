@@ -176,7 +176,8 @@ FileSink::FileSink(qcc::String fileName, Mode mode) : handle(INVALID_HANDLE_VALU
     ReSlash(fileName);
 
     DWORD attributes;
-    switch (mode) {
+    bool append = (APPEND & mode) != 0;
+    switch (mode & ~APPEND) {
     case PRIVATE :
         attributes = FILE_ATTRIBUTE_HIDDEN;
         break;
@@ -236,10 +237,10 @@ FileSink::FileSink(qcc::String fileName, Mode mode) : handle(INVALID_HANDLE_VALU
 
     /* Create and open the file */
     handle = CreateFileA(fileName.substr(skip).c_str(),
-                         GENERIC_WRITE,
+                         append ? (GENERIC_READ | FILE_APPEND_DATA) : GENERIC_WRITE,
                          FILE_SHARE_READ,
                          NULL,
-                         CREATE_ALWAYS,
+                         append ? OPEN_ALWAYS : CREATE_ALWAYS,
                          attributes,
                          INVALID_HANDLE_VALUE);
 
@@ -649,6 +649,61 @@ QStatus RecvFrom(SocketFd sockfd, IPAddress& remoteAddr, uint16_t& remotePort,
     return status;
 }
 
+QStatus RecvFromBatch(SocketFd sockfd, Datagram* datagrams, size_t count, size_t& received)
+{
+    QCC_DbgTrace(("RecvFromBatch(sockfd = %d, datagrams = <>, count = %lu, received = <>)", sockfd, count));
+    assert(datagrams != NULL);
+    QStatus status = ER_OK;
+    received = 0;
+
+    /*
+     * Winsock has no recvmmsg() equivalent; drain the (non-blocking) socket
+     * one datagram at a time until it runs dry or the batch is full.
+     */
+    while (received < count) {
+        Datagram& dg = datagrams[received];
+        status = RecvFrom(sockfd, dg.remoteAddr, dg.remotePort, dg.buf, dg.len, dg.received);
+        if (status != ER_OK) {
+            break;
+        }
+        ++received;
+    }
+
+    if (received > 0) {
+        return ER_OK;
+    }
+    return status;
+}
+
+QStatus SendToBatch(SocketFd sockfd, const OutDatagram* datagrams, size_t count, size_t& sent)
+{
+    QCC_DbgTrace(("SendToBatch(sockfd = %d, datagrams = <>, count = %lu, sent = <>)", sockfd, count));
+    assert(datagrams != NULL);
+    sent = 0;
+
+    /* Winsock has no sendmmsg() or segmentation offload; send one datagram at a time */
+    while (sent < count) {
+        const OutDatagram& dg = datagrams[sent];
+        SOCKADDR_STORAGE addr;
+        socklen_t addrLen = sizeof(addr);
+        DWORD numSent = 0;
+
+        MakeSockAddr(dg.remoteAddr, dg.remotePort, 0, &addr, addrLen);
+        /* IOVec matches the layout of WSABUF */
+        int ret = WSASendTo(static_cast<SOCKET>(sockfd), reinterpret_cast<LPWSABUF>(const_cast<IOVec*>(dg.iov)), static_cast<DWORD>(dg.numIov),
+                            &numSent, 0, reinterpret_cast<struct sockaddr*>(&addr), addrLen, NULL, NULL);
+        if (ret == SOCKET_ERROR) {
+            if (WSAGetLastError() == WSAEWOULDBLOCK) {
+                return ER_WOULDBLOCK;
+            }
+            QCC_LogError(ER_OS_ERROR, ("SendToBatch: %s", StrError().c_str()));
+            return ER_OS_ERROR;
+        }
+        ++sent;
+    }
+    return ER_OK;
+}
+
 
 int InetPtoN(int af, const char* src, void* dst)
 {
@@ -847,6 +902,30 @@ QStatus SendWithFds(SocketFd sockfd, const void* buf, size_t len, size_t& sent,
     return status;
 }
 
+QStatus SendV(SocketFd sockfd, const IOVec* iov, size_t numIov, size_t& sent)
+{
+    QStatus status = ER_OK;
+    DWORD numSent = 0;
+
+    QCC_DbgTrace(("SendV(sockfd = %d, iov = <>, numIov = %lu, sent = <>)", sockfd, numIov));
+    assert(iov != NULL);
+
+    /* IOVec matches the layout of WSABUF */
+    int ret = WSASend(static_cast<SOCKET>(sockfd), reinterpret_cast<LPWSABUF>(const_cast<IOVec*>(iov)), static_cast<DWORD>(numIov), &numSent, 0, NULL, NULL);
+    if (ret == SOCKET_ERROR) {
+        if (WSAGetLastError() == WSAEWOULDBLOCK) {
+            sent = 0;
+            status = ER_WOULDBLOCK;
+        } else {
+            status = ER_OS_ERROR;
+            QCC_LogError(status, ("SendV: %s", StrError().c_str()));
+        }
+    } else {
+        sent = static_cast<size_t>(numSent);
+    }
+    return status;
+}
+
 QStatus SocketPair(SocketFd(&sockets)[2])
 {
     QStatus status = ER_OK;
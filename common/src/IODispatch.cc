@@ -20,7 +20,21 @@
  *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  ******************************************************************************/
 #include <qcc/IODispatch.h>
+#include <qcc/Condition.h>
 #include <qcc/StringUtil.h>
+#include <qcc/Util.h>
+
+#if defined(QCC_OS_LINUX)
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#endif
+
+#include <algorithm>
+#include <deque>
+
 #define QCC_MODULE "IODISPATCH"
 
 using namespace qcc;
@@ -28,12 +42,787 @@ using namespace std;
 
 int32_t IODispatch::iodispatchCnt = 0;
 
+#if defined(QCC_OS_LINUX)
+
+/* Sentinel deadline meaning no timeout is pending */
+static const uint64_t NO_DEADLINE = static_cast<uint64_t>(-1);
+
+/*
+ * Stream timeouts are specified in seconds so an event loop does not scan for
+ * expired timeouts more often than this many milliseconds.
+ */
+static const uint64_t TIMEOUT_GRANULARITY = 100;
+
+/* Maximum number of epoll events processed per wakeup */
+static const int MAX_EPOLL_EVENTS = 64;
+
+/**
+ * Thread that waits on one of the two epoll sets of an event loop.
+ */
+class IODispatch::EventPoller : public Thread {
+  public:
+    EventPoller(const qcc::String& name, EventLoop& loop, bool forWrite, uint32_t core) :
+        Thread(name), loop(loop), forWrite(forWrite), core(core) { }
+
+    ThreadReturn STDCALL Run(void* arg);
+
+  private:
+    EventLoop& loop;
+    bool forWrite;
+    uint32_t core;
+};
+
+/**
+ * Thread that makes read callbacks and timeout callbacks for an event loop.
+ */
+class IODispatch::EventWorker : public Thread {
+  public:
+    EventWorker(const qcc::String& name, EventLoop& loop) : Thread(name), loop(loop) { }
+
+    ThreadReturn STDCALL Run(void* arg);
+
+  private:
+    EventLoop& loop;
+};
+
+/**
+ * A shard of the streams registered with an IODispatch.
+ *
+ * Every stream is registered with two persistent epoll sets, one for its source event and
+ * one for its sink event, using EPOLLONESHOT so that a readiness notification disarms the
+ * event until the listener re-enables the callback.
+ *
+ * The reader thread only waits for readiness and expired timeouts and queues the callbacks
+ * to a pool of worker threads. A read callback may block, for example waiting for room in a
+ * transmit queue, so running it on the reader thread would stall every other stream and
+ * timeout on the loop. Write callbacks do not block and drain the transmit queues that read
+ * callbacks wait on so the writer thread makes them directly.
+ */
+class IODispatch::EventLoop {
+  public:
+    EventLoop(IODispatch& dispatch, const qcc::String& name, uint32_t core, uint32_t numWorkers);
+    ~EventLoop();
+
+    QStatus Init();
+    QStatus Start();
+    void Stop();
+    void Join();
+    void StopStreams();
+    void JoinStreams();
+
+    QStatus StartStream(Stream* stream, IOReadListener* readListener, IOWriteListener* writeListener, IOExitListener* exitListener, bool readEnable, bool writeEnable);
+    QStatus StopStream(Stream* stream);
+    QStatus JoinStream(Stream* stream);
+    QStatus EnableReadCallback(Stream* stream, uint32_t timeout);
+    QStatus DisableReadCallback(Stream* stream);
+    QStatus EnableWriteCallback(Stream* stream, uint32_t timeout, bool now);
+    QStatus DisableWriteCallback(Stream* stream);
+    QStatus EnableTimeoutCallback(Stream* stream, uint32_t timeout);
+    void ExitStream(Stream* stream);
+    void Poll(EventPoller& poller, bool forWrite);
+    void Work(EventWorker& worker);
+
+  private:
+    /*
+     * An event may be backed by both an I/O descriptor and a general purpose pipe, in which
+     * case it is signaled by either so both descriptors are monitored.
+     */
+    struct Watch {
+        int fd;                  /* Monitored descriptor or -1 */
+        uint32_t events;         /* Epoll events that signal the event */
+    };
+
+    struct Entry {
+        IODispatchEntry dispatch;
+        Watch read[2];           /* Descriptors monitored for the source event */
+        Watch write[2];          /* Descriptors monitored for the sink event */
+        uint64_t readDeadline;   /* Time at which a read timeout callback is due or 0 */
+        uint64_t writeDeadline;  /* Time at which a write timeout callback is due or 0 */
+        int32_t numCallbacks;    /* Number of callbacks currently being made or queued for this stream */
+    };
+
+    struct Callback {
+        Stream* stream;
+        IOReadListener* readListener;   /* Listener for a read callback or NULL */
+        IOWriteListener* writeListener; /* Listener for a write timeout callback or NULL */
+        bool isTimedOut;
+    };
+
+    static void SetWatches(Watch* watches, Event& event);
+    std::map<Stream*, Entry>::iterator FindRunning(Stream* stream);
+    QStatus Register(Stream* stream, const Entry& entry, bool forWrite, bool enable);
+    void Unregister(const Entry& entry, bool forWrite);
+    void Arm(Stream* stream, const Entry& entry, bool forWrite, bool enable);
+    void SetDeadline(uint64_t& deadline, uint32_t timeout);
+    void Dispatch(Stream* stream, bool forWrite);
+    void CheckTimeouts(uint64_t now);
+
+    IODispatch& dispatch;
+    Mutex lock;                                 /* Lock for mutual exclusion of entries, nextCheck and callbacks */
+    std::map<Stream*, Entry> entries;           /* Streams assigned to this event loop */
+    uint64_t nextCheck;                         /* Next time the reader thread must check for expired timeouts */
+    Event wakeEvent;                            /* Wakes the reader thread when nextCheck moves earlier */
+    int readEpollFd;
+    int writeEpollFd;
+    EventPoller reader;
+    EventPoller writer;
+    std::deque<Callback> callbacks;             /* Callbacks waiting for a worker */
+    Condition callbacksReady;                   /* Signaled when a callback is queued or the loop is stopping */
+    bool stopping;                              /* Set when the workers must exit once the queue is empty */
+    std::vector<EventWorker*> workers;
+};
+
+ThreadReturn STDCALL IODispatch::EventPoller::Run(void* arg)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        QCC_DbgPrintf(("Unable to pin %s to core %u: %s", GetName(), core, strerror(errno)));
+    }
+    loop.Poll(*this, forWrite);
+    return (ThreadReturn) 0;
+}
+
+ThreadReturn STDCALL IODispatch::EventWorker::Run(void* arg)
+{
+    loop.Work(*this);
+    return (ThreadReturn) 0;
+}
+
+IODispatch::EventLoop::EventLoop(IODispatch& dispatch, const qcc::String& name, uint32_t core, uint32_t numWorkers) :
+    dispatch(dispatch),
+    nextCheck(NO_DEADLINE),
+    readEpollFd(-1),
+    writeEpollFd(-1),
+    reader(name + "-rd", *this, false, core),
+    writer(name + "-wr", *this, true, core),
+    stopping(false)
+{
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+        workers.push_back(new EventWorker(name + "-cb" + U32ToString(i), *this));
+    }
+}
+
+IODispatch::EventLoop::~EventLoop()
+{
+    for (vector<EventWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        delete *it;
+    }
+    if (readEpollFd != -1) {
+        close(readEpollFd);
+    }
+    if (writeEpollFd != -1) {
+        close(writeEpollFd);
+    }
+}
+
+QStatus IODispatch::EventLoop::Init()
+{
+    readEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    writeEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if ((readEpollFd == -1) || (writeEpollFd == -1)) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_create failed with %d (%s)", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+
+    /*
+     * The thread stop events and the wake event are level triggered and are identified
+     * by a data pointer that can never be a stream.
+     */
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &reader;
+    if (epoll_ctl(readEpollFd, EPOLL_CTL_ADD, reader.GetStopEvent().GetGenPurposeFD(), &ev) == -1) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_ctl add failed with %d (%s)", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    ev.data.ptr = &wakeEvent;
+    if (epoll_ctl(readEpollFd, EPOLL_CTL_ADD, wakeEvent.GetGenPurposeFD(), &ev) == -1) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_ctl add failed with %d (%s)", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    ev.data.ptr = &writer;
+    if (epoll_ctl(writeEpollFd, EPOLL_CTL_ADD, writer.GetStopEvent().GetGenPurposeFD(), &ev) == -1) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_ctl add failed with %d (%s)", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::Start()
+{
+    QStatus status = ER_OK;
+    for (vector<EventWorker*>::iterator it = workers.begin(); (status == ER_OK) && (it != workers.end()); ++it) {
+        status = (*it)->Start();
+    }
+    if (status == ER_OK) {
+        status = reader.Start();
+    }
+    if (status == ER_OK) {
+        status = writer.Start();
+    }
+    return status;
+}
+
+void IODispatch::EventLoop::Stop()
+{
+    reader.Stop();
+    writer.Stop();
+    lock.Lock();
+    stopping = true;
+    callbacksReady.Broadcast();
+    lock.Unlock();
+}
+
+void IODispatch::EventLoop::Join()
+{
+    reader.Join();
+    writer.Join();
+    for (vector<EventWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        (*it)->Join();
+    }
+}
+
+void IODispatch::EventLoop::StopStreams()
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = entries.begin();
+    while (it != entries.end()) {
+        Stream* stream = it->first;
+        lock.Unlock();
+        StopStream(stream);
+        lock.Lock();
+        it = entries.upper_bound(stream);
+    }
+    lock.Unlock();
+}
+
+void IODispatch::EventLoop::JoinStreams()
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = entries.begin();
+    while (it != entries.end()) {
+        Stream* stream = it->first;
+        lock.Unlock();
+        JoinStream(stream);
+        lock.Lock();
+        it = entries.upper_bound(stream);
+    }
+    lock.Unlock();
+}
+
+map<Stream*, IODispatch::EventLoop::Entry>::iterator IODispatch::EventLoop::FindRunning(Stream* stream)
+{
+    map<Stream*, Entry>::iterator it = entries.find(stream);
+    if ((it != entries.end()) && (it->second.dispatch.stopping_state != IO_RUNNING)) {
+        it = entries.end();
+    }
+    return it;
+}
+
+void IODispatch::EventLoop::SetWatches(Watch* watches, Event& event)
+{
+    watches[0].fd = event.GetFD();
+    watches[0].events = (event.GetEventType() == Event::IO_WRITE) ? EPOLLOUT : EPOLLIN;
+    watches[1].fd = event.GetGenPurposeFD();
+    watches[1].events = EPOLLIN;
+}
+
+QStatus IODispatch::EventLoop::Register(Stream* stream, const Entry& entry, bool forWrite, bool enable)
+{
+    const Watch* watches = forWrite ? entry.write : entry.read;
+    int epollFd = forWrite ? writeEpollFd : readEpollFd;
+    for (size_t i = 0; i < ArraySize(entry.read); ++i) {
+        if (watches[i].fd < 0) {
+            continue;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLONESHOT | (enable ? watches[i].events : 0);
+        ev.data.ptr = stream;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, watches[i].fd, &ev) == -1) {
+            QCC_LogError(ER_OS_ERROR, ("epoll_ctl add failed for fd %d with %d (%s)", watches[i].fd, errno, strerror(errno)));
+            while (i--) {
+                if (watches[i].fd >= 0) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, watches[i].fd, &ev);
+                }
+            }
+            return ER_OS_ERROR;
+        }
+    }
+    return ER_OK;
+}
+
+void IODispatch::EventLoop::Unregister(const Entry& entry, bool forWrite)
+{
+    const Watch* watches = forWrite ? entry.write : entry.read;
+    for (size_t i = 0; i < ArraySize(entry.read); ++i) {
+        if (watches[i].fd >= 0) {
+            struct epoll_event ev;
+            epoll_ctl(forWrite ? writeEpollFd : readEpollFd, EPOLL_CTL_DEL, watches[i].fd, &ev);
+        }
+    }
+}
+
+void IODispatch::EventLoop::Arm(Stream* stream, const Entry& entry, bool forWrite, bool enable)
+{
+    const Watch* watches = forWrite ? entry.write : entry.read;
+    for (size_t i = 0; i < ArraySize(entry.read); ++i) {
+        if (watches[i].fd < 0) {
+            continue;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLONESHOT | (enable ? watches[i].events : 0);
+        ev.data.ptr = stream;
+        if (epoll_ctl(forWrite ? writeEpollFd : readEpollFd, EPOLL_CTL_MOD, watches[i].fd, &ev) == -1) {
+            QCC_LogError(ER_OS_ERROR, ("epoll_ctl mod failed for fd %d with %d (%s)", watches[i].fd, errno, strerror(errno)));
+        }
+    }
+}
+
+void IODispatch::EventLoop::SetDeadline(uint64_t& deadline, uint32_t timeout)
+{
+    if (timeout == 0) {
+        deadline = 0;
+        return;
+    }
+    deadline = GetTimestamp64() + static_cast<uint64_t>(timeout) * 1000;
+    if (deadline < nextCheck) {
+        nextCheck = deadline;
+        wakeEvent.SetEvent();
+    }
+}
+
+QStatus IODispatch::EventLoop::StartStream(Stream* stream, IOReadListener* readListener, IOWriteListener* writeListener, IOExitListener* exitListener, bool readEnable, bool writeEnable)
+{
+    Event& source = stream->GetSourceEvent();
+    Event& sink = stream->GetSinkEvent();
+    if (((source.GetFD() < 0) && (source.GetGenPurposeFD() < 0)) || ((sink.GetFD() < 0) && (sink.GetGenPurposeFD() < 0))) {
+        return ER_INVALID_STREAM;
+    }
+
+    lock.Lock();
+    /* Dont attempt to register a stream if the IODispatch is shutting down */
+    if (!dispatch.isRunning) {
+        lock.Unlock();
+        return ER_IODISPATCH_STOPPING;
+    }
+    if (entries.find(stream) != entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    Entry& entry = entries[stream];
+    entry.dispatch = IODispatchEntry(stream, readListener, writeListener, exitListener, readEnable, writeEnable);
+    entry.dispatch.readCtxt = NULL;
+    entry.dispatch.writeCtxt = NULL;
+    entry.dispatch.readTimeoutCtxt = NULL;
+    entry.dispatch.writeTimeoutCtxt = NULL;
+    entry.dispatch.exitCtxt = new CallbackContext(stream, IO_EXIT);
+    SetWatches(entry.read, source);
+    SetWatches(entry.write, sink);
+    entry.readDeadline = 0;
+    entry.writeDeadline = 0;
+    entry.numCallbacks = 0;
+
+    QStatus status = Register(stream, entry, false, readEnable);
+    if (status == ER_OK) {
+        status = Register(stream, entry, true, writeEnable);
+        if (status != ER_OK) {
+            Unregister(entry, false);
+        }
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to add stream %p to the event loop", stream));
+        delete entry.dispatch.exitCtxt;
+        entries.erase(stream);
+    }
+    lock.Unlock();
+    return status;
+}
+
+QStatus IODispatch::EventLoop::StopStream(Stream* stream)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = entries.find(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    if (it->second.dispatch.stopping_state == IO_STOPPED) {
+        lock.Unlock();
+        return ER_FAIL;
+    }
+
+    /*
+     * Disable further read and write callbacks. There is no main thread to hand the
+     * exit alarm to so it is added right here.
+     */
+    it->second.dispatch.stopping_state = IO_STOPPED;
+    Arm(stream, it->second, false, false);
+    Arm(stream, it->second, true, false);
+    int32_t when = 0;
+    AlarmListener* listener = &dispatch;
+    Alarm exitAlarm = Alarm(when, listener, it->second.dispatch.exitCtxt);
+    lock.Unlock();
+
+    /*
+     * Use the non-blocking version of AddAlarm since this may be called from within a
+     * read or write callback.
+     */
+    QStatus status = dispatch.timer.AddAlarmNonBlocking(exitAlarm);
+    while (status == ER_TIMER_FULL) {
+        qcc::Sleep(2);
+        status = dispatch.timer.AddAlarmNonBlocking(exitAlarm);
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to add exit alarm for stream %p", stream));
+    }
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::JoinStream(Stream* stream)
+{
+    /* Wait until the exit callback is complete and the entry has been removed */
+    lock.Lock();
+    while (entries.find(stream) != entries.end()) {
+        lock.Unlock();
+        qcc::Sleep(10);
+        lock.Lock();
+    }
+    lock.Unlock();
+    return ER_OK;
+}
+
+void IODispatch::EventLoop::ExitStream(Stream* stream)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = entries.find(stream);
+    assert(it != entries.end());
+
+    /*
+     * Remove the stream from the epoll sets before the exit callback closes it and wait
+     * for any read or write callback that is in progress to complete.
+     */
+    Unregister(it->second, false);
+    Unregister(it->second, true);
+    while (it->second.numCallbacks) {
+        lock.Unlock();
+        qcc::Sleep(2);
+        lock.Lock();
+        it = entries.find(stream);
+    }
+    IOExitListener* exitListener = it->second.dispatch.exitListener;
+    lock.Unlock();
+
+    exitListener->ExitCallback();
+
+    lock.Lock();
+    it = entries.find(stream);
+    assert(it != entries.end());
+    delete it->second.dispatch.exitCtxt;
+    entries.erase(it);
+    lock.Unlock();
+}
+
+QStatus IODispatch::EventLoop::EnableReadCallback(Stream* stream, uint32_t timeout)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    it->second.dispatch.readEnable = true;
+    it->second.dispatch.readInProgress = false;
+    SetDeadline(it->second.readDeadline, timeout);
+    Arm(stream, it->second, false, true);
+    lock.Unlock();
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::DisableReadCallback(Stream* stream)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    it->second.dispatch.readEnable = false;
+    it->second.readDeadline = 0;
+    Arm(stream, it->second, false, false);
+    lock.Unlock();
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::EnableWriteCallback(Stream* stream, uint32_t timeout, bool now)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    if (now && it->second.dispatch.writeEnable) {
+        /* Write callbacks are already enabled or a write is in progress */
+        lock.Unlock();
+        return ER_OK;
+    }
+    it->second.dispatch.writeEnable = true;
+    it->second.dispatch.writeInProgress = false;
+    SetDeadline(it->second.writeDeadline, timeout);
+    /*
+     * A sink that can be written to now is signaled as soon as it is armed so there
+     * is no need to special case EnableWriteCallbackNow.
+     */
+    Arm(stream, it->second, true, true);
+    lock.Unlock();
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::DisableWriteCallback(Stream* stream)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    it->second.dispatch.writeEnable = false;
+    it->second.writeDeadline = 0;
+    Arm(stream, it->second, true, false);
+    lock.Unlock();
+    return ER_OK;
+}
+
+QStatus IODispatch::EventLoop::EnableTimeoutCallback(Stream* stream, uint32_t timeout)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (it == entries.end()) {
+        lock.Unlock();
+        return ER_INVALID_STREAM;
+    }
+    /*
+     * If a read is in progress, the ReadCallback will take care of setting the
+     * timeout for this stream.
+     */
+    if (!it->second.dispatch.readInProgress) {
+        SetDeadline(it->second.readDeadline, timeout);
+    }
+    lock.Unlock();
+    return ER_OK;
+}
+
+void IODispatch::EventLoop::Dispatch(Stream* stream, bool forWrite)
+{
+    lock.Lock();
+    map<Stream*, Entry>::iterator it = FindRunning(stream);
+    if (!dispatch.isRunning || (it == entries.end())) {
+        lock.Unlock();
+        return;
+    }
+    IODispatchEntry& entry = it->second.dispatch;
+    if (forWrite) {
+        if (!entry.writeEnable || entry.writeInProgress) {
+            lock.Unlock();
+            return;
+        }
+        entry.writeInProgress = true;
+        it->second.writeDeadline = 0;
+    } else {
+        if (!entry.readEnable || entry.readInProgress) {
+            lock.Unlock();
+            return;
+        }
+        entry.readInProgress = true;
+        it->second.readDeadline = 0;
+    }
+    ++it->second.numCallbacks;
+    if (!forWrite) {
+        /* Read callbacks may block so they are handed to a worker */
+        Callback cb = { stream, entry.readListener, NULL, false };
+        callbacks.push_back(cb);
+        callbacksReady.Signal();
+        lock.Unlock();
+        return;
+    }
+    IOWriteListener* writeListener = entry.writeListener;
+    lock.Unlock();
+
+    writeListener->WriteCallback(*stream, false);
+
+    /* The entry cannot be removed while numCallbacks is non-zero */
+    lock.Lock();
+    --entries[stream].numCallbacks;
+    lock.Unlock();
+}
+
+void IODispatch::EventLoop::CheckTimeouts(uint64_t now)
+{
+    uint64_t next = NO_DEADLINE;
+
+    lock.Lock();
+    for (map<Stream*, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        Entry& entry = it->second;
+        if (!dispatch.isRunning || (entry.dispatch.stopping_state != IO_RUNNING)) {
+            continue;
+        }
+        if (entry.readDeadline) {
+            if (entry.readDeadline <= now) {
+                entry.readDeadline = 0;
+                if (entry.dispatch.readEnable && !entry.dispatch.readInProgress) {
+                    entry.dispatch.readInProgress = true;
+                    Arm(it->first, entry, false, false);
+                    Callback cb = { it->first, entry.dispatch.readListener, NULL, true };
+                    callbacks.push_back(cb);
+                    callbacksReady.Signal();
+                    ++entry.numCallbacks;
+                }
+            } else {
+                next = (std::min)(next, entry.readDeadline);
+            }
+        }
+        if (entry.writeDeadline) {
+            if (entry.writeDeadline <= now) {
+                entry.writeDeadline = 0;
+                if (entry.dispatch.writeEnable && !entry.dispatch.writeInProgress) {
+                    entry.dispatch.writeInProgress = true;
+                    Arm(it->first, entry, true, false);
+                    Callback cb = { it->first, NULL, entry.dispatch.writeListener, true };
+                    callbacks.push_back(cb);
+                    callbacksReady.Signal();
+                    ++entry.numCallbacks;
+                }
+            } else {
+                next = (std::min)(next, entry.writeDeadline);
+            }
+        }
+    }
+    nextCheck = (next == NO_DEADLINE) ? NO_DEADLINE : (std::max)(next, now + TIMEOUT_GRANULARITY);
+    lock.Unlock();
+}
+
+void IODispatch::EventLoop::Work(EventWorker& worker)
+{
+    lock.Lock();
+    while (true) {
+        while (callbacks.empty() && !stopping) {
+            callbacksReady.Wait(lock);
+        }
+        if (callbacks.empty()) {
+            break;
+        }
+        Callback cb = callbacks.front();
+        callbacks.pop_front();
+        /*
+         * Callbacks queued before the stream was stopped are dropped but they must still
+         * be counted off so that ExitStream() can complete.
+         */
+        map<Stream*, Entry>::iterator it = FindRunning(cb.stream);
+        bool run = dispatch.isRunning && (it != entries.end());
+        lock.Unlock();
+
+        if (run) {
+            if (cb.readListener) {
+                cb.readListener->ReadCallback(*cb.stream, cb.isTimedOut);
+            } else {
+                cb.writeListener->WriteCallback(*cb.stream, cb.isTimedOut);
+            }
+        }
+
+        /* The entry cannot be removed while numCallbacks is non-zero */
+        lock.Lock();
+        --entries[cb.stream].numCallbacks;
+    }
+    lock.Unlock();
+    QCC_DbgPrintf(("IODispatch::EventLoop::Work exiting %s", worker.GetName()));
+}
+
+void IODispatch::EventLoop::Poll(EventPoller& poller, bool forWrite)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int epollFd = forWrite ? writeEpollFd : readEpollFd;
+
+    while (!poller.IsStopping()) {
+        int waitMs = -1;
+        if (!forWrite) {
+            /* The reader thread also queues the callbacks for expired read and write timeouts */
+            uint64_t now = GetTimestamp64();
+            lock.Lock();
+            uint64_t check = nextCheck;
+            lock.Unlock();
+            if (check <= now) {
+                CheckTimeouts(now);
+                lock.Lock();
+                check = nextCheck;
+                lock.Unlock();
+                now = GetTimestamp64();
+            }
+            if (check != NO_DEADLINE) {
+                waitMs = (check > now) ? static_cast<int>(check - now) : 0;
+            }
+        }
+
+        int ret = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, waitMs);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            QCC_LogError(ER_OS_ERROR, ("epoll_wait failed with %d (%s)", errno, strerror(errno)));
+            break;
+        }
+        for (int n = 0; n < ret; ++n) {
+            void* ptr = events[n].data.ptr;
+            if (ptr == &poller) {
+                /*
+                 * Stopping or alerted. The latter happens if a callback made from this thread
+                 * blocked waiting for an event that was signaled after the wait returned.
+                 */
+                if (!poller.IsStopping()) {
+                    poller.GetStopEvent().ResetEvent();
+                }
+            } else if (ptr == &wakeEvent) {
+                /* nextCheck has moved, it will be picked up at the top of the loop */
+                wakeEvent.ResetEvent();
+            } else {
+                Dispatch(static_cast<Stream*>(ptr), forWrite);
+            }
+        }
+    }
+    QCC_DbgPrintf(("IODispatch::EventLoop::Poll exiting"));
+}
+
+#else
+
+/* Event loops are only available on Linux so SetEventLoops() never creates one elsewhere. */
+class IODispatch::EventLoop {
+  public:
+    QStatus Start() { return ER_NOT_IMPLEMENTED; }
+    void Stop() { }
+    void Join() { }
+    void StopStreams() { }
+    void JoinStreams() { }
+    QStatus StartStream(Stream*, IOReadListener*, IOWriteListener*, IOExitListener*, bool, bool) { return ER_NOT_IMPLEMENTED; }
+    QStatus StopStream(Stream*) { return ER_NOT_IMPLEMENTED; }
+    QStatus JoinStream(Stream*) { return ER_NOT_IMPLEMENTED; }
+    QStatus EnableReadCallback(Stream*, uint32_t) { return ER_NOT_IMPLEMENTED; }
+    QStatus DisableReadCallback(Stream*) { return ER_NOT_IMPLEMENTED; }
+    QStatus EnableWriteCallback(Stream*, uint32_t, bool) { return ER_NOT_IMPLEMENTED; }
+    QStatus DisableWriteCallback(Stream*) { return ER_NOT_IMPLEMENTED; }
+    QStatus EnableTimeoutCallback(Stream*, uint32_t) { return ER_NOT_IMPLEMENTED; }
+    void ExitStream(Stream*) { }
+};
+
+#endif
+
 IODispatch::IODispatch(const char* name, uint32_t concurrency) :
-    timer((String(name) + U32ToString(IncrementAndFetch(&iodispatchCnt)).c_str()), true, concurrency, false, 96),
+    timer((String(name) + U32ToString(IncrementAndFetch(&iodispatchCnt)).c_str()), true, concurrency, false, 96, Timer::ALARM_WHEEL),
     reload(false),
     isRunning(false),
     numAlarmsInProgress(0),
-    crit(false)
+    crit(false),
+    concurrency(concurrency)
 {
 
 }
@@ -48,7 +837,55 @@ IODispatch::~IODispatch()
      * Just a sanity check.
      */
     assert(dispatchEntries.size() == 0);
+
+    for (vector<EventLoop*>::iterator it = eventLoops.begin(); it != eventLoops.end(); ++it) {
+        delete *it;
+    }
+}
+
+IODispatch::EventLoop* IODispatch::GetEventLoop(const Stream* stream) const
+{
+    /* Streams are heap allocated so the low order bits of the pointer carry no information */
+    uint32_t hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(stream) >> 4) * 2654435761U;
+    return eventLoops[(hash >> 16) % eventLoops.size()];
+}
+
+QStatus IODispatch::SetEventLoops(uint32_t numLoops)
+{
+    if (isRunning) {
+        return ER_FAIL;
+    }
+    for (vector<EventLoop*>::iterator it = eventLoops.begin(); it != eventLoops.end(); ++it) {
+        delete *it;
+    }
+    eventLoops.clear();
+    if (numLoops == 0) {
+        return ER_OK;
+    }
+
+#if defined(QCC_OS_LINUX)
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numCores < 1) {
+        numCores = 1;
+    }
+    QStatus status = ER_OK;
+    for (uint32_t i = 0; (status == ER_OK) && (i < numLoops); ++i) {
+        EventLoop* loop = new EventLoop(*this, "iodisploop" + U32ToString(i), i % numCores, concurrency);
+        eventLoops.push_back(loop);
+        status = loop->Init();
+    }
+    if (status != ER_OK) {
+        for (vector<EventLoop*>::iterator it = eventLoops.begin(); it != eventLoops.end(); ++it) {
+            delete *it;
+        }
+        eventLoops.clear();
+    }
+    return status;
+#else
+    return ER_NOT_IMPLEMENTED;
+#endif
 }
+
 QStatus IODispatch::Start(void* arg, ThreadListener* listener)
 {
     /* Start the timer thread */
@@ -60,6 +897,13 @@ QStatus IODispatch::Start(void* arg, ThreadListener* listener)
         return status;
     } else {
         isRunning = true;
+        if (!eventLoops.empty()) {
+            /* The event loops replace the main thread */
+            for (vector<EventLoop*>::iterator it = eventLoops.begin(); (status == ER_OK) && (it != eventLoops.end()); ++it) {
+                status = (*it)->Start();
+            }
+            return status;
+        }
         /* Start the main thread */
         return Thread::Start(arg, listener);
     }
@@ -69,6 +913,15 @@ QStatus IODispatch::Stop()
 {
     lock.Lock();
     isRunning = false;
+    if (!eventLoops.empty()) {
+        lock.Unlock();
+        for (vector<EventLoop*>::iterator it = eventLoops.begin(); it != eventLoops.end(); ++it) {
+            (*it)->StopStreams();
+            (*it)->Stop();
+        }
+        timer.Stop();
+        return ER_OK;
+    }
     map<Stream*, IODispatchEntry>::iterator it = dispatchEntries.begin();
     Stream* stream;
     while (it != dispatchEntries.end()) {
@@ -88,6 +941,15 @@ QStatus IODispatch::Stop()
 
 QStatus IODispatch::Join()
 {
+    if (!eventLoops.empty()) {
+        for (vector<EventLoop*>::iterator it = eventLoops.begin(); it != eventLoops.end(); ++it) {
+            (*it)->JoinStreams();
+            (*it)->Join();
+        }
+        timer.Join();
+        return ER_OK;
+    }
+
     lock.Lock();
 
     map<Stream*, IODispatchEntry>::iterator it = dispatchEntries.begin();
@@ -109,6 +971,9 @@ QStatus IODispatch::Join()
 QStatus IODispatch::StartStream(Stream* stream, IOReadListener* readListener, IOWriteListener* writeListener, IOExitListener* exitListener, bool readEnable, bool writeEnable)
 {
     QCC_DbgTrace(("StartStream %p", stream));
+    if (!eventLoops.empty()) {
+        return GetEventLoop(stream)->StartStream(stream, readListener, writeListener, exitListener, readEnable, writeEnable);
+    }
     lock.Lock();
     /* Dont attempt to register a stream if the IODispatch is shutting down */
     if (!isRunning) {
@@ -140,6 +1005,9 @@ QStatus IODispatch::StartStream(Stream* stream, IOReadListener* readListener, IO
 
 
 QStatus IODispatch::StopStream(Stream* stream) {
+    if (!eventLoops.empty()) {
+        return GetEventLoop(stream)->StopStream(stream);
+    }
     lock.Lock();
     QCC_DbgTrace(("StopStream %p", stream));
     map<Stream*, IODispatchEntry>::iterator it = dispatchEntries.find(stream);
@@ -201,6 +1069,9 @@ QStatus IODispatch::StopStream(Stream* stream) {
     return ER_OK;
 }
 QStatus IODispatch::JoinStream(Stream* stream) {
+    if (!eventLoops.empty()) {
+        return GetEventLoop(stream)->JoinStream(stream);
+    }
     lock.Lock();
     QCC_DbgTrace(("JoinStream %p", stream));
 
@@ -219,11 +1090,19 @@ QStatus IODispatch::JoinStream(Stream* stream) {
 }
 void IODispatch::AlarmTriggered(const Alarm& alarm, QStatus reason)
 {
-    lock.Lock();
     /* Find the stream associated with this alarm */
     CallbackContext* ctxt = static_cast<CallbackContext*>(alarm->GetContext());
     Stream* stream = ctxt->stream;
 
+    if (!eventLoops.empty()) {
+        /* Event loops only use the timer for exit callbacks */
+        assert(ctxt->type == IO_EXIT);
+        GetEventLoop(stream)->ExitStream(stream);
+        return;
+    }
+
+    lock.Lock();
+
     /* Only correct values of type are IO_READ, IO_READ_TIMEOUT,
      * IO_WRITE, IO_WRITE_TIMEOUT, IO_EXIT
      */
@@ -568,6 +1447,9 @@ ThreadReturn STDCALL IODispatch::Run(void* arg) {
 
 QStatus IODispatch::EnableReadCallback(const Source* source, uint32_t timeout)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)source)->EnableReadCallback((Stream*)source, timeout) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
@@ -633,6 +1515,9 @@ QStatus IODispatch::EnableReadCallback(const Source* source, uint32_t timeout)
 
 QStatus IODispatch::EnableTimeoutCallback(const Source* source, uint32_t timeout)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)source)->EnableTimeoutCallback((Stream*)source, timeout) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
@@ -696,6 +1581,9 @@ QStatus IODispatch::EnableTimeoutCallback(const Source* source, uint32_t timeout
 }
 QStatus IODispatch::DisableReadCallback(const Source* source)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)source)->DisableReadCallback((Stream*)source) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
@@ -724,6 +1612,9 @@ QStatus IODispatch::DisableReadCallback(const Source* source)
 
 QStatus IODispatch::EnableWriteCallbackNow(Sink* sink)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)sink)->EnableWriteCallback((Stream*)sink, 0, true) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
@@ -766,6 +1657,9 @@ QStatus IODispatch::EnableWriteCallbackNow(Sink* sink)
 
 QStatus IODispatch::EnableWriteCallback(Sink* sink, uint32_t timeout)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)sink)->EnableWriteCallback((Stream*)sink, timeout, false) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
@@ -827,6 +1721,9 @@ QStatus IODispatch::EnableWriteCallback(Sink* sink, uint32_t timeout)
 }
 QStatus IODispatch::DisableWriteCallback(const Sink* sink)
 {
+    if (!eventLoops.empty()) {
+        return isRunning ? GetEventLoop((Stream*)sink)->DisableWriteCallback((Stream*)sink) : ER_IODISPATCH_STOPPING;
+    }
     lock.Lock();
     /* Dont attempt to modify an entry if the IODispatch is shutting down */
     if (!isRunning) {
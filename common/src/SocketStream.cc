@@ -280,6 +280,34 @@ QStatus SocketStream::PushBytesAndFds(const void* buf, size_t numBytes, size_t&
     return status;
 }
 
+QStatus SocketStream::PushBytesV(const IOVec* iov, size_t numIov, size_t& numSent)
+{
+    if (numIov == 0) {
+        numSent = 0;
+        return ER_OK;
+    }
+    QStatus status;
+    while (true) {
+        if (!isConnected) {
+            return ER_WRITE_ERROR;
+        }
+        status = qcc::SendV(sock, iov, numIov, numSent);
+        if (ER_WOULDBLOCK == status) {
+            if (sendTimeout == Event::WAIT_FOREVER) {
+                status = Event::Wait(*sinkEvent);
+            } else {
+                status = Event::Wait(*sinkEvent, sendTimeout);
+            }
+            if (ER_OK != status) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    return status;
+}
+
 QStatus SocketStream::SetNagle(bool reuse)
 {
     return qcc::SetNagle(sock, reuse);
@@ -27,6 +27,7 @@
 #include <qcc/StringUtil.h>
 #include <Status.h>
 #include <algorithm>
+#include <string.h>
 
 #define QCC_MODULE  "TIMER"
 
@@ -83,6 +84,104 @@ class TimerThread : public Thread {
     const Alarm* currentAlarm;
 };
 
+/**
+ * Hierarchical timing wheel holding the alarms of timers created with Timer::ALARM_WHEEL.
+ *
+ * Alarms are kept on intrusive lists hanging off the wheel slots so adding and removing an alarm
+ * is O(1) and never allocates. Level 0 has 256 slots of 1ms. Each of the four upper levels has 64
+ * slots, one slot covering a full turn of the level below, for a total span of 2^32ms. Alarms due
+ * further out than that are parked on an overflow list. Upper level slots are cascaded down as time
+ * reaches them and due level 0 slots are moved as a batch onto the expired list that the timer
+ * threads dispatch from.
+ *
+ * All methods must be called with the timer lock held.
+ */
+class TimerWheel {
+  public:
+
+    TimerWheel();
+
+    ~TimerWheel();
+
+    size_t Size() const { return count; }
+
+    /** Queue an alarm. Alarms that are already queued are left alone. */
+    void Insert(const Alarm& alarm);
+
+    /** Remove a queued alarm. Returns false if the alarm is not on this wheel. */
+    bool Remove(const Alarm& alarm);
+
+    bool Contains(const Alarm& alarm) const { return alarm->wheelLink.wheel == this; }
+
+    /** Returns true if the alarm is due before the time the timer threads last decided to wake up at. */
+    bool IsBefore(const Alarm& alarm) const { return (count == 0) || (alarm->alarmTime.GetAbsoluteMillis() < nextWake); }
+
+    /**
+     * Expire all alarms due at or before now and return the alarm at the head of the expired list.
+     * If no alarm has expired return some queued alarm and set when to the time the wheel next needs
+     * servicing. Must not be called on an empty wheel.
+     */
+    Alarm Peek(uint64_t now, uint64_t& when);
+
+    /** Remove an alarm if it is on the expired list. */
+    bool TakeExpired(const Alarm& alarm);
+
+    /** Remove and return an alarm, expired alarms first. Must not be called on an empty wheel. */
+    Alarm Pop();
+
+    /** Remove and return an alarm belonging to listener. */
+    bool RemoveListener(const AlarmListener* listener, Alarm& alarm);
+
+  private:
+
+    enum {
+        L0_BITS = 8,
+        LN_BITS = 6,
+        NUM_UPPER_LEVELS = 4,
+        L0_SLOTS = 1 << L0_BITS,
+        LN_SLOTS = 1 << LN_BITS,
+        WHEEL_SLOTS = L0_SLOTS + NUM_UPPER_LEVELS * LN_SLOTS,
+        OVERFLOW_LIST = WHEEL_SLOTS,
+        EXPIRED_LIST = WHEEL_SLOTS + 1,
+        NUM_LISTS = WHEEL_SLOTS + 2
+    };
+
+    struct List {
+        _Alarm* head;
+        _Alarm* tail;
+    };
+
+    /* Log2 of the number of milliseconds covered by one slot of an upper level (1..NUM_UPPER_LEVELS) */
+    static uint32_t LevelShift(uint32_t level) { return L0_BITS + (level - 1) * LN_BITS; }
+
+    /* Index of the first slot of an upper level */
+    static uint32_t LevelBase(uint32_t level) { return L0_SLOTS + (level - 1) * LN_SLOTS; }
+
+    static uint64_t Millis(const _Alarm* a) { return a->alarmTime.GetAbsoluteMillis(); }
+
+    /* Hand the wheel's reference to an unlinked alarm back to the caller */
+    static Alarm Release(_Alarm* a)
+    {
+        Alarm alarm = Alarm::wrap(a);
+        alarm.DecRef();
+        return alarm;
+    }
+
+    uint32_t ListFor(uint64_t ms) const;
+    void Link(_Alarm* a, uint32_t list);
+    void Unlink(_Alarm* a);
+    void Redistribute(uint32_t list);
+    void Advance(uint64_t now);
+    int FirstOccupied(uint32_t from, uint32_t to) const;
+    int NextOccupied(uint32_t base, uint32_t numSlots, uint32_t start) const;
+
+    List lists[NUM_LISTS];
+    uint64_t occupied[WHEEL_SLOTS / 64];    /**< Bitmap of the non-empty wheel slots */
+    uint64_t curTick;                       /**< Next millisecond to be expired */
+    uint64_t nextWake;                      /**< Time the wheel last asked to be serviced at */
+    size_t count;
+};
+
 }
 
 _Alarm::_Alarm() : listener(NULL), periodMs(0), context(NULL), id(IncrementAndFetch(&nextId))
@@ -135,8 +234,277 @@ bool _Alarm::operator==(const _Alarm& other) const
     return (alarmTime == other.alarmTime) && (id == other.id);
 }
 
-Timer::Timer(String name, bool expireOnExit, uint32_t concurency, bool preventReentrancy, uint32_t maxAlarms) :
+TimerWheel::TimerWheel() : curTick(0), nextWake(END_OF_TIME), count(0)
+{
+    memset(lists, 0, sizeof(lists));
+    memset(occupied, 0, sizeof(occupied));
+}
+
+TimerWheel::~TimerWheel()
+{
+    while (count) {
+        Pop();
+    }
+}
+
+uint32_t TimerWheel::ListFor(uint64_t ms) const
+{
+    if (ms < curTick) {
+        return EXPIRED_LIST;
+    }
+    uint64_t delta = ms - curTick;
+    if (delta < L0_SLOTS) {
+        return static_cast<uint32_t>(ms & (L0_SLOTS - 1));
+    }
+    for (uint32_t level = 1; level <= NUM_UPPER_LEVELS; ++level) {
+        uint32_t shift = LevelShift(level);
+        if (delta < (static_cast<uint64_t>(LN_SLOTS) << shift)) {
+            return LevelBase(level) + static_cast<uint32_t>((ms >> shift) & (LN_SLOTS - 1));
+        }
+    }
+    return OVERFLOW_LIST;
+}
+
+void TimerWheel::Link(_Alarm* a, uint32_t list)
+{
+    List& l = lists[list];
+    a->wheelLink.wheel = this;
+    a->wheelLink.list = list;
+    a->wheelLink.next = NULL;
+    a->wheelLink.prev = l.tail;
+    if (l.tail) {
+        l.tail->wheelLink.next = a;
+    } else {
+        l.head = a;
+    }
+    l.tail = a;
+    if (list < WHEEL_SLOTS) {
+        occupied[list >> 6] |= static_cast<uint64_t>(1) << (list & 63);
+    }
+}
+
+void TimerWheel::Unlink(_Alarm* a)
+{
+    uint32_t list = a->wheelLink.list;
+    List& l = lists[list];
+    if (a->wheelLink.prev) {
+        a->wheelLink.prev->wheelLink.next = a->wheelLink.next;
+    } else {
+        l.head = a->wheelLink.next;
+    }
+    if (a->wheelLink.next) {
+        a->wheelLink.next->wheelLink.prev = a->wheelLink.prev;
+    } else {
+        l.tail = a->wheelLink.prev;
+    }
+    if (!l.head && (list < WHEEL_SLOTS)) {
+        occupied[list >> 6] &= ~(static_cast<uint64_t>(1) << (list & 63));
+    }
+    a->wheelLink.prev = NULL;
+    a->wheelLink.next = NULL;
+    a->wheelLink.wheel = NULL;
+}
+
+void TimerWheel::Insert(const Alarm& alarm)
+{
+    _Alarm* a = const_cast<_Alarm*>(alarm.unwrap());
+    if (a->wheelLink.wheel) {
+        return;
+    }
+    if (count == 0) {
+        /* Don't make Advance() walk over the time the wheel spent empty */
+        Timespec now;
+        GetTimeNow(&now);
+        curTick = now.GetAbsoluteMillis();
+    }
+    Alarm ref = alarm;
+    ref.IncRef();
+    Link(a, ListFor(Millis(a)));
+    ++count;
+}
+
+bool TimerWheel::Remove(const Alarm& alarm)
+{
+    _Alarm* a = const_cast<_Alarm*>(alarm.unwrap());
+    if (a->wheelLink.wheel != this) {
+        return false;
+    }
+    Unlink(a);
+    --count;
+    Release(a);
+    return true;
+}
+
+void TimerWheel::Redistribute(uint32_t list)
+{
+    _Alarm* a = lists[list].head;
+    lists[list].head = lists[list].tail = NULL;
+    if (list < WHEEL_SLOTS) {
+        occupied[list >> 6] &= ~(static_cast<uint64_t>(1) << (list & 63));
+    }
+    while (a) {
+        _Alarm* next = a->wheelLink.next;
+        Link(a, ListFor(Millis(a)));
+        a = next;
+    }
+}
+
+int TimerWheel::FirstOccupied(uint32_t from, uint32_t to) const
+{
+    while (from < to) {
+        uint64_t bits = occupied[from >> 6] >> (from & 63);
+        if (bits == 0) {
+            from = (from | 63) + 1;
+            continue;
+        }
+        while (!(bits & 1)) {
+            bits >>= 1;
+            ++from;
+        }
+        return (from < to) ? static_cast<int>(from) : -1;
+    }
+    return -1;
+}
+
+int TimerWheel::NextOccupied(uint32_t base, uint32_t numSlots, uint32_t start) const
+{
+    int slot = FirstOccupied(base + start, base + numSlots);
+    if (slot >= 0) {
+        return slot - static_cast<int>(base + start);
+    }
+    slot = FirstOccupied(base, base + start);
+    if (slot >= 0) {
+        return slot + static_cast<int>(numSlots - start) - static_cast<int>(base);
+    }
+    return -1;
+}
+
+void TimerWheel::Advance(uint64_t now)
+{
+    if (count == 0) {
+        curTick = now + 1;
+        return;
+    }
+    while (curTick <= now) {
+        if ((curTick & (L0_SLOTS - 1)) == 0) {
+            /* Cascade the upper levels whose current slot starts here, highest level first */
+            uint32_t top = 0;
+            while ((top < NUM_UPPER_LEVELS) && ((curTick & ((static_cast<uint64_t>(1) << LevelShift(top + 1)) - 1)) == 0)) {
+                ++top;
+            }
+            if (top == NUM_UPPER_LEVELS) {
+                Redistribute(OVERFLOW_LIST);
+            }
+            for (uint32_t level = top; level > 0; --level) {
+                Redistribute(LevelBase(level) + static_cast<uint32_t>((curTick >> LevelShift(level)) & (LN_SLOTS - 1)));
+            }
+        }
+        /* Expire the occupied level 0 slots between curTick and now, stopping at the end of the turn */
+        uint64_t last = curTick | (L0_SLOTS - 1);
+        if (last > now) {
+            last = now;
+        }
+        int slot = FirstOccupied(static_cast<uint32_t>(curTick & (L0_SLOTS - 1)), static_cast<uint32_t>(last & (L0_SLOTS - 1)) + 1);
+        if (slot < 0) {
+            curTick = last + 1;
+            continue;
+        }
+        curTick = (curTick & ~static_cast<uint64_t>(L0_SLOTS - 1)) + slot + 1;
+        _Alarm* a = lists[slot].head;
+        lists[slot].head = lists[slot].tail = NULL;
+        occupied[slot >> 6] &= ~(static_cast<uint64_t>(1) << (slot & 63));
+        while (a) {
+            _Alarm* next = a->wheelLink.next;
+            Link(a, EXPIRED_LIST);
+            a = next;
+        }
+    }
+}
+
+Alarm TimerWheel::Peek(uint64_t now, uint64_t& when)
+{
+    assert(count > 0);
+    Advance(now);
+    if (lists[EXPIRED_LIST].head) {
+        when = Millis(lists[EXPIRED_LIST].head);
+        nextWake = when;
+        return Alarm::wrap(lists[EXPIRED_LIST].head);
+    }
+
+    /* Nothing is due, find the earliest tick at which a slot expires or cascades */
+    _Alarm* a = NULL;
+    when = END_OF_TIME;
+    int d = NextOccupied(0, L0_SLOTS, static_cast<uint32_t>(curTick & (L0_SLOTS - 1)));
+    if (d >= 0) {
+        when = curTick + d;
+        a = lists[(curTick + d) & (L0_SLOTS - 1)].head;
+    }
+    for (uint32_t level = 1; level <= NUM_UPPER_LEVELS; ++level) {
+        uint32_t shift = LevelShift(level);
+        uint64_t cur = curTick >> shift;
+        /* The current slot is only still pending if its cascade at curTick has not been done yet */
+        uint32_t first = ((curTick & ((static_cast<uint64_t>(1) << shift) - 1)) == 0) ? 0 : 1;
+        d = NextOccupied(LevelBase(level), LN_SLOTS, static_cast<uint32_t>((cur + first) & (LN_SLOTS - 1)));
+        if (d >= 0) {
+            uint64_t tick = (cur + first + d) << shift;
+            if (tick < when) {
+                when = tick;
+                a = lists[LevelBase(level) + static_cast<uint32_t>((cur + first + d) & (LN_SLOTS - 1))].head;
+            }
+        }
+    }
+    if (lists[OVERFLOW_LIST].head) {
+        /* Overflow alarms are redistributed when the top level turns over */
+        uint32_t shift = LevelShift(NUM_UPPER_LEVELS) + LN_BITS;
+        uint64_t tick = ((curTick >> shift) + 1) << shift;
+        if (tick < when) {
+            when = tick;
+            a = lists[OVERFLOW_LIST].head;
+        }
+    }
+    nextWake = when;
+    return Alarm::wrap(a);
+}
+
+bool TimerWheel::TakeExpired(const Alarm& alarm)
+{
+    _Alarm* a = const_cast<_Alarm*>(alarm.unwrap());
+    if ((a->wheelLink.wheel != this) || (a->wheelLink.list != EXPIRED_LIST)) {
+        return false;
+    }
+    return Remove(alarm);
+}
+
+Alarm TimerWheel::Pop()
+{
+    assert(count > 0);
+    _Alarm* a = lists[EXPIRED_LIST].head;
+    for (uint32_t list = 0; !a && (list < EXPIRED_LIST); ++list) {
+        a = lists[list].head;
+    }
+    Unlink(a);
+    --count;
+    return Release(a);
+}
+
+bool TimerWheel::RemoveListener(const AlarmListener* listener, Alarm& alarm)
+{
+    for (uint32_t list = 0; list < NUM_LISTS; ++list) {
+        for (_Alarm* a = lists[list].head; a; a = a->wheelLink.next) {
+            if (a->listener == listener) {
+                Unlink(a);
+                --count;
+                alarm = Release(a);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+Timer::Timer(String name, bool expireOnExit, uint32_t concurency, bool preventReentrancy, uint32_t maxAlarms, AlarmStore store) :
     OSTimer(this),
+    wheel((store == ALARM_WHEEL) ? new TimerWheel() : NULL),
     currentAlarm(NULL),
     expireOnExit(expireOnExit),
     timerThreads(concurency),
@@ -159,6 +527,89 @@ Timer::~Timer()
             timerThreads[i] = NULL;
         }
     }
+    delete wheel;
+}
+
+size_t Timer::NumAlarms() const
+{
+    return wheel ? wheel->Size() : alarms.size();
+}
+
+void Timer::InsertAlarm(const Alarm& alarm)
+{
+    if (wheel) {
+        wheel->Insert(alarm);
+    } else {
+        alarms.insert(alarm);
+    }
+}
+
+bool Timer::EraseAlarm(const Alarm& alarm)
+{
+    if (wheel) {
+        return wheel->Remove(alarm);
+    }
+    if (alarm->periodMs) {
+        /* The time of a periodic alarm changes each time it fires so look it up by id */
+        for (set<Alarm>::iterator it = alarms.begin(); it != alarms.end(); ++it) {
+            if ((*it)->id == alarm->id) {
+                alarms.erase(it);
+                return true;
+            }
+        }
+    } else {
+        set<Alarm>::iterator it = alarms.find(alarm);
+        if (it != alarms.end()) {
+            alarms.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Timer::IsNextAlarm(const Alarm& alarm) const
+{
+    if (wheel) {
+        return wheel->IsBefore(alarm);
+    }
+    return alarms.empty() || (alarm < *alarms.begin());
+}
+
+Alarm Timer::PeekAlarm(const Timespec& now, Timespec& when)
+{
+    if (wheel) {
+        uint64_t ms;
+        Alarm top = wheel->Peek(now.GetAbsoluteMillis(), ms);
+        when = Timespec(ms);
+        return top;
+    }
+    const Alarm top = *alarms.begin();
+    when = top->alarmTime;
+    return top;
+}
+
+bool Timer::TakeAlarm(const Alarm& alarm)
+{
+    if (wheel) {
+        return wheel->TakeExpired(alarm);
+    }
+    set<Alarm>::iterator it = alarms.find(alarm);
+    if (it != alarms.end()) {
+        alarms.erase(it);
+        return true;
+    }
+    return false;
+}
+
+Alarm Timer::PopAlarm()
+{
+    if (wheel) {
+        return wheel->Pop();
+    }
+    set<Alarm>::iterator it = alarms.begin();
+    Alarm alarm = *it;
+    alarms.erase(it);
+    return alarm;
 }
 
 QStatus Timer::Start()
@@ -237,7 +688,7 @@ QStatus Timer::AddAlarm(const Alarm& alarm)
     lock.Lock();
     if (isRunning) {
         /* Don't allow an infinite number of alarms to exist on this timer */
-        while (maxAlarms && (alarms.size() >= maxAlarms) && isRunning) {
+        while (maxAlarms && (NumAlarms() >= maxAlarms) && isRunning) {
             Thread* thread = Thread::GetThread();
             assert(thread);
             addWaitQueue.push_front(thread);
@@ -261,8 +712,8 @@ QStatus Timer::AddAlarm(const Alarm& alarm)
         /* Ensure timer is still running */
         if (isRunning) {
             /* Insert the alarm and alert the Timer thread if necessary */
-            bool alertThread = alarms.empty() || (alarm < *alarms.begin());
-            alarms.insert(alarm);
+            bool alertThread = IsNextAlarm(alarm);
+            InsertAlarm(alarm);
 
             if (alertThread && (controllerIdx >= 0)) {
                 TimerThread* tt = timerThreads[controllerIdx];
@@ -288,14 +739,14 @@ QStatus Timer::AddAlarmNonBlocking(const Alarm& alarm)
     lock.Lock();
     if (isRunning) {
         /* Don't allow an infinite number of alarms to exist on this timer */
-        if (maxAlarms && (alarms.size() >= maxAlarms)) {
+        if (maxAlarms && (NumAlarms() >= maxAlarms)) {
             lock.Unlock();
             return ER_TIMER_FULL;
         }
 
         /* Insert the alarm and alert the Timer thread if necessary */
-        bool alertThread = alarms.empty() || (alarm < *alarms.begin());
-        alarms.insert(alarm);
+        bool alertThread = IsNextAlarm(alarm);
+        InsertAlarm(alarm);
 
         if (alertThread && (controllerIdx >= 0)) {
             TimerThread* tt = timerThreads[controllerIdx];
@@ -316,23 +767,7 @@ bool Timer::RemoveAlarm(const Alarm& alarm, bool blockIfTriggered)
     bool foundAlarm = false;
     lock.Lock();
     if (isRunning || expireOnExit) {
-        if (alarm->periodMs) {
-            set<Alarm>::iterator it = alarms.begin();
-            while (it != alarms.end()) {
-                if ((*it)->id == alarm->id) {
-                    foundAlarm = true;
-                    alarms.erase(it);
-                    break;
-                }
-                ++it;
-            }
-        } else {
-            set<Alarm>::iterator it = alarms.find(alarm);
-            if (it != alarms.end()) {
-                foundAlarm = true;
-                alarms.erase(it);
-            }
-        }
+        foundAlarm = EraseAlarm(alarm);
         if (blockIfTriggered && !foundAlarm) {
             /*
              * There might be a call in progress to the alarm that is being removed.
@@ -364,23 +799,7 @@ bool Timer::ForceRemoveAlarm(const Alarm& alarm, bool blockIfTriggered)
     bool foundAlarm = false;
     lock.Lock();
     if (isRunning || expireOnExit) {
-        if (alarm->periodMs) {
-            set<Alarm>::iterator it = alarms.begin();
-            while (it != alarms.end()) {
-                if ((*it)->id == alarm->id) {
-                    foundAlarm = true;
-                    alarms.erase(it);
-                    break;
-                }
-                ++it;
-            }
-        } else {
-            set<Alarm>::iterator it = alarms.find(alarm);
-            if (it != alarms.end()) {
-                foundAlarm = true;
-                alarms.erase(it);
-            }
-        }
+        foundAlarm = EraseAlarm(alarm);
         if (blockIfTriggered && !foundAlarm) {
             /*
              * There might be a call in progress to the alarm that is being removed.
@@ -413,9 +832,7 @@ QStatus Timer::ReplaceAlarm(const Alarm& origAlarm, const Alarm& newAlarm, bool
     QStatus status = ER_NO_SUCH_ALARM;
     lock.Lock();
     if (isRunning) {
-        set<Alarm>::iterator it = alarms.find(origAlarm);
-        if (it != alarms.end()) {
-            alarms.erase(it);
+        if (EraseAlarm(origAlarm)) {
             status = AddAlarm(newAlarm);
         } else if (blockIfTriggered) {
             /*
@@ -448,12 +865,16 @@ bool Timer::RemoveAlarm(const AlarmListener& listener, Alarm& alarm)
     bool removedOne = false;
     lock.Lock();
     if (isRunning) {
-        for (set<Alarm>::iterator it = alarms.begin(); it != alarms.end(); ++it) {
-            if ((*it)->listener == &listener) {
-                alarm = *it;
-                alarms.erase(it);
-                removedOne = true;
-                break;
+        if (wheel) {
+            removedOne = wheel->RemoveListener(&listener, alarm);
+        } else {
+            for (set<Alarm>::iterator it = alarms.begin(); it != alarms.end(); ++it) {
+                if ((*it)->listener == &listener) {
+                    alarm = *it;
+                    alarms.erase(it);
+                    removedOne = true;
+                    break;
+                }
             }
         }
         /*
@@ -495,7 +916,7 @@ bool Timer::HasAlarm(const Alarm& alarm)
     bool ret = false;
     lock.Lock();
     if (isRunning) {
-        ret = alarms.count(alarm) != 0;
+        ret = wheel ? wheel->Contains(alarm) : (alarms.count(alarm) != 0);
     }
     lock.Unlock();
     return ret;
@@ -557,10 +978,11 @@ ThreadReturn STDCALL TimerThread::Run(void* arg)
          * Check for something to do, either now or at some (alarm) time in the
          * future.
          */
-        if (!timer->alarms.empty()) {
+        if (timer->NumAlarms() != 0) {
             QCC_DbgPrintf(("TimerThread::Run(): Alarms pending"));
-            const Alarm topAlarm = *(timer->alarms.begin());
-            int64_t delay = topAlarm->alarmTime - now;
+            Timespec topTime;
+            const Alarm topAlarm = timer->PeekAlarm(now, topTime);
+            int64_t delay = topTime - now;
 
             /*
              * There is an alarm waiting to go off, but there is some delay
@@ -589,7 +1011,7 @@ ThreadReturn STDCALL TimerThread::Run(void* arg)
                                 status = Event::Wait(Event::neverSet, WORKER_IDLE_TIMEOUT_MS);
                                 timer->lock.Lock();
                                 GetTimeNow(&now);
-                                delay = topAlarm->alarmTime - now;
+                                delay = topTime - now;
                             }
 
                             if (status == ER_ALERTED_THREAD || status == ER_STOPPING_THREAD || !timer->isRunning || delay <= WORKER_IDLE_TIMEOUT_MS) {
@@ -770,10 +1192,8 @@ ThreadReturn STDCALL TimerThread::Run(void* arg)
                  * If it has already been serviced by another thread, just ignore
                  * and go back to the top of the loop.
                  */
-                set<Alarm>::iterator it = timer->alarms.find(topAlarm);
-                if (it != timer->alarms.end()) {
-                    Alarm top = *it;
-                    timer->alarms.erase(it);
+                if (timer->TakeAlarm(topAlarm)) {
+                    Alarm top = topAlarm;
                     currentAlarm = &top;
                     if (0 < timer->addWaitQueue.size()) {
                         Thread* wakeMe = timer->addWaitQueue.back();
@@ -910,13 +1330,11 @@ void Timer::ThreadExit(Thread* thread)
     lock.Lock();
     if ((!isRunning) && expireOnExit) {
         /* Call all alarms */
-        while (!alarms.empty()) {
+        while (NumAlarms() != 0) {
             /*
              * Note it is possible that the callback will call RemoveAlarm()
              */
-            set<Alarm>::iterator it = alarms.begin();
-            Alarm alarm = *it;
-            alarms.erase(it);
+            Alarm alarm = PopAlarm();
             tt->SetCurrentAlarm(&alarm);
             lock.Unlock();
             tt->hasTimerLock = preventReentrancy;
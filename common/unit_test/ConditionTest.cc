@@ -0,0 +1,109 @@
+/******************************************************************************
+ * Copyright (c) 2014 AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <qcc/Condition.h>
+#include <qcc/Mutex.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+
+using namespace qcc;
+
+/*
+ * Waiters park on the condition until the shared counter reaches the level
+ * they are waiting for.
+ */
+class ConditionWaiter : public Thread {
+  public:
+    ConditionWaiter(Mutex& lock, Condition& cond, uint32_t& value, uint32_t& woken)
+        : Thread("ConditionWaiter"), lock(lock), cond(cond), value(value), woken(woken) { }
+
+  protected:
+    ThreadReturn STDCALL Run(void* arg)
+    {
+        lock.Lock();
+        while (value == 0) {
+            cond.Wait(lock);
+        }
+        --value;
+        ++woken;
+        lock.Unlock();
+        return 0;
+    }
+
+  private:
+    Mutex& lock;
+    Condition& cond;
+    uint32_t& value;
+    uint32_t& woken;
+};
+
+TEST(ConditionTest, TimedWait) {
+    Mutex lock;
+    Condition cond;
+
+    uint64_t start = GetTimestamp64();
+    lock.Lock();
+    EXPECT_EQ(ER_TIMEOUT, cond.Wait(lock, 100));
+    lock.Unlock();
+    EXPECT_LE(start + 90, GetTimestamp64());
+
+    /* The mutex must have been reacquired */
+    EXPECT_EQ(ER_OK, lock.Lock());
+    EXPECT_EQ(ER_OK, lock.Unlock());
+}
+
+TEST(ConditionTest, SignalAndBroadcast) {
+    static const uint32_t NUM_WAITERS = 4;
+    Mutex lock;
+    Condition cond;
+    uint32_t value = 0;
+    uint32_t woken = 0;
+    ConditionWaiter* waiters[NUM_WAITERS];
+
+    for (uint32_t i = 0; i < NUM_WAITERS; ++i) {
+        waiters[i] = new ConditionWaiter(lock, cond, value, woken);
+        ASSERT_EQ(ER_OK, waiters[i]->Start());
+    }
+
+    /* Each signal lets exactly one waiter through */
+    lock.Lock();
+    value = 1;
+    EXPECT_EQ(ER_OK, cond.Signal());
+    lock.Unlock();
+    for (uint32_t ms = 0; ms < 5000; ms += 10) {
+        lock.Lock();
+        bool done = (woken == 1);
+        lock.Unlock();
+        if (done) {
+            break;
+        }
+        qcc::Sleep(10);
+    }
+    qcc::Sleep(50);
+    lock.Lock();
+    EXPECT_EQ(1U, woken);
+    value = NUM_WAITERS - 1;
+    EXPECT_EQ(ER_OK, cond.Broadcast());
+    lock.Unlock();
+
+    for (uint32_t i = 0; i < NUM_WAITERS; ++i) {
+        EXPECT_EQ(ER_OK, waiters[i]->Join());
+        delete waiters[i];
+    }
+    EXPECT_EQ(NUM_WAITERS, woken);
+    EXPECT_EQ(0U, value);
+}
@@ -0,0 +1,272 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2014, AllSeen Alliance. All rights reserved.
+ *
+ *    Permission to use, copy, modify, and/or distribute this software for any
+ *    purpose with or without fee is hereby granted, provided that the above
+ *    copyright notice and this permission notice appear in all copies.
+ *
+ *    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *    WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *    MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *    ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *    WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *    ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ ******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <Status.h>
+#include <qcc/atomic.h>
+#include <qcc/IODispatch.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/Thread.h>
+#include <qcc/Util.h>
+
+using namespace qcc;
+
+class TestStreamListener : public IOReadListener, public IOWriteListener, public IOExitListener {
+  public:
+    TestStreamListener(IODispatch& dispatch, uint32_t readTimeout) :
+        dispatch(dispatch), readTimeout(readTimeout),
+        bytesRead(0), readTimeouts(0), writes(0), exits(0) { }
+
+    QStatus ReadCallback(Source& source, bool isTimedOut)
+    {
+        if (isTimedOut) {
+            IncrementAndFetch(&readTimeouts);
+        } else {
+            char buf[64];
+            size_t actual = 0;
+            if (source.PullBytes(buf, sizeof(buf), actual, 0) == ER_OK) {
+                bytesRead += actual;
+            }
+        }
+        return dispatch.EnableReadCallback(&source, readTimeout);
+    }
+
+    QStatus WriteCallback(Sink& sink, bool isTimedOut)
+    {
+        IncrementAndFetch(&writes);
+        return dispatch.DisableWriteCallback(&sink);
+    }
+
+    void ExitCallback()
+    {
+        IncrementAndFetch(&exits);
+    }
+
+    IODispatch& dispatch;
+    uint32_t readTimeout;
+    volatile int32_t bytesRead;
+    volatile int32_t readTimeouts;
+    volatile int32_t writes;
+    volatile int32_t exits;
+};
+
+static bool WaitFor(volatile int32_t& counter, int32_t value, uint32_t ms)
+{
+    while ((counter < value) && ms) {
+        qcc::Sleep(10);
+        ms = (ms > 10) ? ms - 10 : 0;
+    }
+    return counter >= value;
+}
+
+/*
+ * Run each test against the single IODispatch thread and, where available,
+ * against a set of event loops.
+ */
+#if defined(QCC_OS_LINUX)
+static const uint32_t eventLoops[] = { 0, 3 };
+#else
+static const uint32_t eventLoops[] = { 0 };
+#endif
+
+TEST(IODispatchTest, ReadCallback)
+{
+    for (size_t i = 0; i < ArraySize(eventLoops); ++i) {
+        IODispatch dispatch("iodisptest", 4);
+        ASSERT_EQ(ER_OK, dispatch.SetEventLoops(eventLoops[i]));
+        ASSERT_EQ(ER_OK, dispatch.Start());
+
+        SocketFd fds[2];
+        ASSERT_EQ(ER_OK, SocketPair(fds));
+        SocketStream stream(fds[0]);
+        TestStreamListener listener(dispatch, 0);
+        ASSERT_EQ(ER_OK, dispatch.StartStream(&stream, &listener, &listener, &listener, true, false));
+
+        size_t sent;
+        for (int32_t n = 1; n <= 5; ++n) {
+            ASSERT_EQ(ER_OK, Send(fds[1], "hello", 5, sent));
+            EXPECT_TRUE(WaitFor(listener.bytesRead, n * 5, 2000)) << "loops " << eventLoops[i];
+        }
+        EXPECT_EQ(0, listener.writes);
+
+        EXPECT_EQ(ER_OK, dispatch.StopStream(&stream));
+        EXPECT_EQ(ER_OK, dispatch.JoinStream(&stream));
+        EXPECT_EQ(1, listener.exits);
+
+        dispatch.Stop();
+        dispatch.Join();
+        Close(fds[1]);
+    }
+}
+
+TEST(IODispatchTest, WriteCallback)
+{
+    for (size_t i = 0; i < ArraySize(eventLoops); ++i) {
+        IODispatch dispatch("iodisptest", 4);
+        ASSERT_EQ(ER_OK, dispatch.SetEventLoops(eventLoops[i]));
+        ASSERT_EQ(ER_OK, dispatch.Start());
+
+        SocketFd fds[2];
+        ASSERT_EQ(ER_OK, SocketPair(fds));
+        SocketStream stream(fds[0]);
+        TestStreamListener listener(dispatch, 0);
+        ASSERT_EQ(ER_OK, dispatch.StartStream(&stream, &listener, &listener, &listener, false, false));
+
+        for (int32_t n = 1; n <= 5; ++n) {
+            EXPECT_EQ(ER_OK, dispatch.EnableWriteCallbackNow(&stream));
+            EXPECT_TRUE(WaitFor(listener.writes, n, 2000)) << "loops " << eventLoops[i];
+        }
+        /* Write callbacks were disabled by the last callback */
+        qcc::Sleep(50);
+        EXPECT_EQ(5, listener.writes);
+
+        /* Streams that are still running are stopped by IODispatch::Stop */
+        dispatch.Stop();
+        dispatch.Join();
+        EXPECT_EQ(1, listener.exits);
+        Close(fds[1]);
+    }
+}
+
+TEST(IODispatchTest, ReadTimeout)
+{
+    for (size_t i = 0; i < ArraySize(eventLoops); ++i) {
+        IODispatch dispatch("iodisptest", 4);
+        ASSERT_EQ(ER_OK, dispatch.SetEventLoops(eventLoops[i]));
+        ASSERT_EQ(ER_OK, dispatch.Start());
+
+        SocketFd fds[2];
+        ASSERT_EQ(ER_OK, SocketPair(fds));
+        SocketStream stream(fds[0]);
+        TestStreamListener listener(dispatch, 1);
+        ASSERT_EQ(ER_OK, dispatch.StartStream(&stream, &listener, &listener, &listener, true, false));
+        ASSERT_EQ(ER_OK, dispatch.EnableReadCallback(&stream, 1));
+
+        /* Data arriving before the timeout pushes the timeout back */
+        qcc::Sleep(500);
+        size_t sent;
+        ASSERT_EQ(ER_OK, Send(fds[1], "hello", 5, sent));
+        EXPECT_TRUE(WaitFor(listener.bytesRead, 5, 2000));
+        EXPECT_EQ(0, listener.readTimeouts);
+
+        EXPECT_TRUE(WaitFor(listener.readTimeouts, 2, 5000)) << "loops " << eventLoops[i];
+
+        EXPECT_EQ(ER_OK, dispatch.StopStream(&stream));
+        EXPECT_EQ(ER_OK, dispatch.JoinStream(&stream));
+        EXPECT_EQ(1, listener.exits);
+
+        dispatch.Stop();
+        dispatch.Join();
+        Close(fds[1]);
+    }
+}
+
+#if defined(QCC_OS_LINUX)
+
+/* A read callback that blocks until it is released, like a push to a full transmit queue */
+class BlockingStreamListener : public TestStreamListener {
+  public:
+    BlockingStreamListener(IODispatch& dispatch) : TestStreamListener(dispatch, 0), blocked(0) { }
+
+    QStatus ReadCallback(Source& source, bool isTimedOut)
+    {
+        IncrementAndFetch(&blocked);
+        Event::Wait(release);
+        return TestStreamListener::ReadCallback(source, isTimedOut);
+    }
+
+    Event release;
+    volatile int32_t blocked;
+};
+
+TEST(IODispatchTest, BlockedReadCallback)
+{
+    IODispatch dispatch("iodisptest", 4);
+    ASSERT_EQ(ER_OK, dispatch.SetEventLoops(1));
+    ASSERT_EQ(ER_OK, dispatch.Start());
+
+    SocketFd slowFds[2];
+    ASSERT_EQ(ER_OK, SocketPair(slowFds));
+    SocketStream slowStream(slowFds[0]);
+    BlockingStreamListener slowListener(dispatch);
+    ASSERT_EQ(ER_OK, dispatch.StartStream(&slowStream, &slowListener, &slowListener, &slowListener, true, false));
+
+    SocketFd fds[2];
+    ASSERT_EQ(ER_OK, SocketPair(fds));
+    SocketStream stream(fds[0]);
+    TestStreamListener listener(dispatch, 1);
+    ASSERT_EQ(ER_OK, dispatch.StartStream(&stream, &listener, &listener, &listener, true, false));
+
+    size_t sent;
+    ASSERT_EQ(ER_OK, Send(slowFds[1], "hello", 5, sent));
+    ASSERT_TRUE(WaitFor(slowListener.blocked, 1, 2000));
+
+    /* Reads and timeouts for the other stream on the same loop carry on */
+    for (int32_t n = 1; n <= 3; ++n) {
+        ASSERT_EQ(ER_OK, Send(fds[1], "hello", 5, sent));
+        EXPECT_TRUE(WaitFor(listener.bytesRead, n * 5, 2000));
+    }
+    EXPECT_TRUE(WaitFor(listener.readTimeouts, 1, 3000));
+    EXPECT_EQ(0, slowListener.bytesRead);
+
+    slowListener.release.SetEvent();
+    EXPECT_TRUE(WaitFor(slowListener.bytesRead, 5, 2000));
+
+    dispatch.Stop();
+    dispatch.Join();
+    EXPECT_EQ(1, listener.exits);
+    EXPECT_EQ(1, slowListener.exits);
+    Close(fds[1]);
+    Close(slowFds[1]);
+}
+
+/* A stream whose source event is both an I/O event and a general purpose event */
+class DualEventStream : public SocketStream {
+  public:
+    DualEventStream(SocketFd sock) : SocketStream(sock), dualEvent(SocketStream::GetSourceEvent(), Event::IO_READ, true) { }
+
+    Event& GetSourceEvent() { return dualEvent; }
+
+  private:
+    Event dualEvent;
+};
+
+TEST(IODispatchTest, DualEventReadCallback)
+{
+    IODispatch dispatch("iodisptest", 4);
+    ASSERT_EQ(ER_OK, dispatch.SetEventLoops(1));
+    ASSERT_EQ(ER_OK, dispatch.Start());
+
+    SocketFd fds[2];
+    ASSERT_EQ(ER_OK, SocketPair(fds));
+    DualEventStream stream(fds[0]);
+    TestStreamListener listener(dispatch, 0);
+    ASSERT_EQ(ER_OK, dispatch.StartStream(&stream, &listener, &listener, &listener, true, false));
+
+    /* Socket readiness is seen even though the event also has a pipe */
+    size_t sent;
+    ASSERT_EQ(ER_OK, Send(fds[1], "hello", 5, sent));
+    EXPECT_TRUE(WaitFor(listener.bytesRead, 5, 2000));
+
+    dispatch.Stop();
+    dispatch.Join();
+    EXPECT_EQ(1, listener.exits);
+    Close(fds[1]);
+}
+
+#endif
@@ -375,3 +375,54 @@ TEST(SocketTest, send_and_receive_with_dummy_fds) {
                "\n\t      Status (socket pair creation) was %s.", QCC_StatusText(status));
     }
 }
+
+TEST(SocketTest, send_batch_with_many_buffers) {
+    IPAddress loopback("127.0.0.1");
+    SocketFd sender, receiver;
+    ASSERT_EQ(ER_OK, Socket(QCC_AF_INET, QCC_SOCK_DGRAM, sender));
+    ASSERT_EQ(ER_OK, Socket(QCC_AF_INET, QCC_SOCK_DGRAM, receiver));
+    ASSERT_EQ(ER_OK, Bind(receiver, loopback, 0));
+    IPAddress addr;
+    uint16_t port;
+    ASSERT_EQ(ER_OK, GetLocalAddress(receiver, addr, port));
+
+    /* A datagram gathered from more buffers than fit in one batch, between two small ones */
+    const size_t numIov = 300;
+    char payload[numIov];
+    IOVec iov[numIov];
+    for (size_t i = 0; i < numIov; ++i) {
+        payload[i] = 'a' + (i % 26);
+        iov[i].buf = &payload[i];
+        iov[i].len = 1;
+    }
+    char small[] = "small";
+    IOVec smallIov;
+    smallIov.buf = small;
+    smallIov.len = sizeof(small);
+    OutDatagram datagrams[3];
+    for (size_t i = 0; i < ArraySize(datagrams); ++i) {
+        datagrams[i].iov = (i == 1) ? iov : &smallIov;
+        datagrams[i].numIov = (i == 1) ? numIov : 1;
+        datagrams[i].remoteAddr = loopback;
+        datagrams[i].remotePort = port;
+    }
+
+    size_t sent = 0;
+    EXPECT_EQ(ER_OK, SendToBatch(sender, datagrams, ArraySize(datagrams), sent));
+    EXPECT_EQ(ArraySize(datagrams), sent);
+
+    size_t expected[] = { sizeof(small), numIov, sizeof(small) };
+    for (size_t i = 0; i < ArraySize(expected); ++i) {
+        char buf[512];
+        IPAddress from;
+        uint16_t fromPort;
+        size_t received = 0;
+        ASSERT_EQ(ER_OK, RecvFrom(receiver, from, fromPort, buf, sizeof(buf), received));
+        EXPECT_EQ(expected[i], received);
+        if (i == 1) {
+            EXPECT_EQ(0, memcmp(buf, payload, numIov));
+        }
+    }
+    Close(sender);
+    Close(receiver);
+}
@@ -16,8 +16,10 @@
 #include <gtest/gtest.h>
 
 #include <deque>
+#include <vector>
 
 #include <qcc/Timer.h>
+#include <qcc/Util.h>
 #include <Status.h>
 
 using namespace std;
@@ -198,3 +200,175 @@ TEST(TimerTest, TestReplaceTimer) {
 
     ASSERT_TRUE(testNextAlarm(ts + 5000, 0));
 }
+
+class OrderCheckingListener : public AlarmListener {
+  public:
+    OrderCheckingListener() : AlarmListener(), fired(0), early(0), outOfOrder(0), last(0)
+    {
+    }
+    void AlarmTriggered(const Alarm& alarm, QStatus reason)
+    {
+        Timespec now;
+        GetTimeNow(&now);
+        lock.Lock();
+        if ((reason == ER_OK) && (now.GetAbsoluteMillis() < alarm->GetAlarmTime())) {
+            ++early;
+        }
+        if (alarm->GetAlarmTime() < last) {
+            ++outOfOrder;
+        }
+        last = alarm->GetAlarmTime();
+        ++fired;
+        lock.Unlock();
+    }
+    uint32_t Fired()
+    {
+        lock.Lock();
+        uint32_t n = fired;
+        lock.Unlock();
+        return n;
+    }
+
+    Mutex lock;
+    uint32_t fired;
+    uint32_t early;
+    uint32_t outOfOrder;
+    uint64_t last;
+};
+
+TEST(TimerTest, WheelSingleThreaded) {
+    Timer t4("testTimer", false, 1, false, 0, Timer::ALARM_WHEEL);
+    Timespec ts;
+    QStatus status = t4.Start();
+    ASSERT_EQ(ER_OK, status) << "Status: " << QCC_StatusText(status);
+
+    MyAlarmListener alarmListener(1);
+    AlarmListener* al = &alarmListener;
+
+    /* Alarms spanning several levels of the wheel, added out of order */
+    uint32_t timeouts[] = { 1500, 10, 300, 700 };
+    void* contexts[] = { (void*)4, (void*)1, (void*)2, (void*)3 };
+    GetTimeNow(&ts);
+    for (size_t i = 0; i < ArraySize(timeouts); ++i) {
+        Alarm a(timeouts[i], al, contexts[i]);
+        status = t4.AddAlarm(a);
+        ASSERT_EQ(ER_OK, status) << "Status: " << QCC_StatusText(status);
+    }
+    ASSERT_TRUE(testNextAlarm(ts + 10, (void*)1));
+    ASSERT_TRUE(testNextAlarm(ts + 300, (void*)2));
+    ASSERT_TRUE(testNextAlarm(ts + 700, (void*)3));
+    ASSERT_TRUE(testNextAlarm(ts + 1500, (void*)4));
+
+    /* Removed alarms do not fire */
+    uint32_t timeout = 200;
+    void* ctx5 = (void*)5;
+    Alarm removed(timeout, al, ctx5);
+    ASSERT_EQ(ER_OK, t4.AddAlarm(removed));
+    ASSERT_TRUE(t4.HasAlarm(removed));
+    ASSERT_TRUE(t4.RemoveAlarm(removed));
+    ASSERT_FALSE(t4.HasAlarm(removed));
+
+    /* Replaced alarms fire at the new time */
+    timeout = 400;
+    void* ctx6 = (void*)6;
+    Alarm replacement(timeout, al, ctx6);
+    GetTimeNow(&ts);
+    timeout = 100;
+    void* ctx7 = (void*)7;
+    Alarm replaced(timeout, al, ctx7);
+    ASSERT_EQ(ER_OK, t4.AddAlarm(replaced));
+    ASSERT_EQ(ER_OK, t4.ReplaceAlarm(replaced, replacement));
+    ASSERT_TRUE(testNextAlarm(ts + 400, (void*)6));
+
+    /* Recurring alarm */
+    timeout = 500;
+    GetTimeNow(&ts);
+    void* ctx8 = (void*)8;
+    Alarm periodic(timeout, al, ctx8, timeout);
+    ASSERT_EQ(ER_OK, t4.AddAlarm(periodic));
+    ASSERT_TRUE(testNextAlarm(ts + 500, (void*)8));
+    ASSERT_TRUE(testNextAlarm(ts + 1000, (void*)8));
+    ASSERT_TRUE(testNextAlarm(ts + 1500, (void*)8));
+    ASSERT_TRUE(t4.RemoveAlarm(periodic));
+
+    status = t4.Stop();
+    ASSERT_EQ(ER_OK, status) << "Status: " << QCC_StatusText(status);
+    status = t4.Join();
+    ASSERT_EQ(ER_OK, status) << "Status: " << QCC_StatusText(status);
+    triggeredAlarmsLock.Lock();
+    EXPECT_TRUE(triggeredAlarms.empty());
+    triggeredAlarms.clear();
+    triggeredAlarmsLock.Unlock();
+}
+
+TEST(TimerTest, WheelOrdering) {
+    OrderCheckingListener listener;
+    AlarmListener* al = &listener;
+    Timer t5("testTimer", true, 1, false, 0, Timer::ALARM_WHEEL);
+    ASSERT_EQ(ER_OK, t5.Start());
+
+    const uint32_t numAlarms = 2000;
+    for (uint32_t i = 0; i < numAlarms; ++i) {
+        uint32_t timeout = Rand32() % 1500;
+        Alarm a(timeout, al);
+        ASSERT_EQ(ER_OK, t5.AddAlarm(a));
+    }
+    /* Alarms that are still pending are expired when the timer stops */
+    uint32_t forever = _Alarm::WAIT_FOREVER;
+    Alarm never(forever, al);
+    ASSERT_EQ(ER_OK, t5.AddAlarm(never));
+
+    for (uint32_t i = 0; (i < 300) && (listener.Fired() < numAlarms); ++i) {
+        qcc::Sleep(10);
+    }
+    EXPECT_EQ(numAlarms, listener.Fired());
+    EXPECT_EQ(0U, listener.early);
+    EXPECT_EQ(0U, listener.outOfOrder);
+
+    t5.Stop();
+    t5.Join();
+    EXPECT_EQ(numAlarms + 1, listener.Fired());
+}
+
+/*
+ * Not a pass/fail test. Compares the cost of adding and removing alarms with
+ * 100k alarms outstanding on each alarm store.
+ */
+TEST(TimerTest, AlarmChurn) {
+    const uint32_t numOutstanding = 100000;
+    const uint32_t numChurn = 200000;
+    static const char* names[] = { "set", "wheel" };
+    Timer::AlarmStore stores[] = { Timer::ALARM_SET, Timer::ALARM_WHEEL };
+
+    for (size_t s = 0; s < ArraySize(stores); ++s) {
+        MyAlarmListener alarmListener(0);
+        AlarmListener* al = &alarmListener;
+        Timer t6("testTimer", false, 1, false, 0, stores[s]);
+        ASSERT_EQ(ER_OK, t6.Start());
+
+        std::vector<Alarm> alarms;
+        alarms.reserve(numOutstanding);
+        uint64_t start = GetTimestamp64();
+        for (uint32_t i = 0; i < numOutstanding; ++i) {
+            uint32_t timeout = 60000 + Rand32() % 600000;
+            alarms.push_back(Alarm(timeout, al));
+            ASSERT_EQ(ER_OK, t6.AddAlarm(alarms.back()));
+        }
+        uint64_t added = GetTimestamp64();
+        for (uint32_t i = 0; i < numChurn; ++i) {
+            uint32_t victim = Rand32() % numOutstanding;
+            ASSERT_TRUE(t6.RemoveAlarm(alarms[victim], false));
+            uint32_t timeout = 60000 + Rand32() % 600000;
+            alarms[victim] = Alarm(timeout, al);
+            ASSERT_EQ(ER_OK, t6.AddAlarm(alarms[victim]));
+        }
+        uint64_t churned = GetTimestamp64();
+
+        printf("%-5s: %u adds in %u ms, %u remove/add pairs in %u ms\n", names[s],
+               numOutstanding, static_cast<uint32_t>(added - start),
+               numChurn, static_cast<uint32_t>(churned - added));
+
+        t6.Stop();
+        t6.Join();
+    }
+}